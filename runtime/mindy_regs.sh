@@ -0,0 +1,178 @@
+#==============================================================================
+# AXI register definitions
+#
+# Generated by mindyregs from software/src/mindylib/mindy_regs.def - don't edit by hand
+#==============================================================================
+
+# axi_revision
+BV_BASE=0x0000
+                REG_BV_MAJOR=0x0000
+                REG_BV_MINOR=0x0004
+                REG_BV_BUILD=0x0008
+                REG_BV_RCAND=0x000C
+                 REG_BV_DATE=0x0010
+
+# frame_counters
+FC_BASE=0x1000
+           REG_FC_MODULE_REV=0x1000
+          REG_FC_FRAME_CTR_0=0x1004
+          REG_FC_FRAME_CTR_1=0x1008
+          REG_FC_FRAME_ADD_0=0x100C
+          REG_FC_FRAME_ADD_1=0x1010
+          REG_FC_TIMESTAMP_H=0x1014
+          REG_FC_TIMESTAMP_L=0x1018
+          REG_FC_TRACE_COUNT=0x101C
+              REG_FC_TRACE_H=0x1020
+              REG_FC_TRACE_L=0x1024
+           REG_FC_TRACE_LOST=0x1028
+              REG_FC_STREAMS=0x102C
+           REG_FC_STREAM_SEL=0x1030
+           REG_FC_STREAM_ADD=0x1034
+       REG_FC_STREAM_WEIGHTS=0x1038
+           REG_FC_STREAM_CTR=0x1040
+
+# data_fetch
+DF_BASE=0x2000
+           REG_DF_MODULE_REV=0x2000
+         REG_DF_HFD00_ADDR_H=0x2004
+         REG_DF_HFD00_ADDR_L=0x2008
+         REG_DF_HFD01_ADDR_H=0x200C
+         REG_DF_HFD01_ADDR_L=0x2010
+         REG_DF_HFD10_ADDR_H=0x2014
+         REG_DF_HFD10_ADDR_L=0x2018
+         REG_DF_HFD11_ADDR_H=0x201C
+         REG_DF_HFD11_ADDR_L=0x2020
+          REG_DF_HMD0_ADDR_H=0x2024
+          REG_DF_HMD0_ADDR_L=0x2028
+          REG_DF_HMD1_ADDR_H=0x202C
+          REG_DF_HMD1_ADDR_L=0x2030
+          REG_DF_HFD_BYTES_H=0x2034
+          REG_DF_HFD_BYTES_L=0x2038
+          REG_DF_HMD_BYTES_H=0x203C
+          REG_DF_HMD_BYTES_L=0x2040
+           REG_DF_ABM_ADDR_H=0x2044
+           REG_DF_ABM_ADDR_L=0x2048
+            REG_DF_DESC_CTRL=0x204C
+         REG_DF_DESC0_ADDR_H=0x2050
+         REG_DF_DESC0_ADDR_L=0x2054
+         REG_DF_DESC1_ADDR_H=0x2058
+         REG_DF_DESC1_ADDR_L=0x205C
+         REG_DF_DESC_BYTES_H=0x2060
+         REG_DF_DESC_BYTES_L=0x2064
+          REG_DF_DESC_ERRORS=0x2068
+             REG_DF_FETCHED0=0x206C
+             REG_DF_FETCHED1=0x2070
+          REG_DF_TRACE_COUNT=0x2074
+              REG_DF_TRACE_H=0x2078
+              REG_DF_TRACE_L=0x207C
+           REG_DF_TRACE_LOST=0x2080
+          REG_DF_HFD0_OFFS_H=0x2084
+          REG_DF_HFD0_OFFS_L=0x2088
+          REG_DF_HFD1_OFFS_H=0x208C
+          REG_DF_HFD1_OFFS_L=0x2090
+          REG_DF_HMD0_OFFS_H=0x2094
+          REG_DF_HMD0_OFFS_L=0x2098
+          REG_DF_HMD1_OFFS_H=0x209C
+          REG_DF_HMD1_OFFS_L=0x20A0
+              REG_DF_ISSUED0=0x20A4
+              REG_DF_ISSUED1=0x20A8
+             REG_DF_CFG_CTRL=0x20AC
+           REG_DF_CFG_COMMIT=0x20B0
+           REG_DF_DELTA_CTRL=0x20B4
+         REG_DF_DELTA_SENT_H=0x20B8
+         REG_DF_DELTA_SENT_L=0x20BC
+      REG_DF_DELTA_SKIPPED_H=0x20C0
+      REG_DF_DELTA_SKIPPED_L=0x20C4
+       REG_DF_STREAM_FETCHED=0x2100
+
+# rdmx_shim_ctl
+RS_BASE=0x4000
+           REG_RS_RFD_ADDR_H=0x4000
+           REG_RS_RFD_ADDR_L=0x4004
+           REG_RS_RFD_SIZE_H=0x4008
+           REG_RS_RFD_SIZE_L=0x400C
+           REG_RS_RMD_ADDR_H=0x4010
+           REG_RS_RMD_ADDR_L=0x4014
+           REG_RS_RMD_SIZE_H=0x4018
+           REG_RS_RMD_SIZE_L=0x401C
+           REG_RS_RFC_ADDR_H=0x4020
+           REG_RS_RFC_ADDR_L=0x4024
+           REG_RS_FRAME_SIZE=0x4028
+          REG_RS_PACKET_SIZE=0x402C
+    REG_RS_PACKETS_PER_GROUP=0x4030
+             REG_RS_MD_STAMP=0x4034
+       REG_RS_PP_TRACE_COUNT=0x4038
+           REG_RS_PP_TRACE_H=0x403C
+           REG_RS_PP_TRACE_L=0x4040
+        REG_RS_PP_TRACE_LOST=0x4044
+       REG_RS_FC_TRACE_COUNT=0x4048
+           REG_RS_FC_TRACE_H=0x404C
+           REG_RS_FC_TRACE_L=0x4050
+        REG_RS_FC_TRACE_LOST=0x4054
+         REG_RS_STEER_POLICY=0x4058
+         REG_RS_LINK_WEIGHTS=0x405C
+          REG_RS_LINK_ENABLE=0x4060
+      REG_RS_LINK0_PACKETS_H=0x4064
+      REG_RS_LINK0_PACKETS_L=0x4068
+      REG_RS_LINK1_PACKETS_H=0x406C
+      REG_RS_LINK1_PACKETS_L=0x4070
+        REG_RS_LINK0_BYTES_H=0x4074
+        REG_RS_LINK0_BYTES_L=0x4078
+        REG_RS_LINK1_BYTES_H=0x407C
+        REG_RS_LINK1_BYTES_L=0x4080
+    REG_RS_PACKETS_PER_FRAME=0x4084
+      REG_RS_MAX_PACKET_SIZE=0x4088
+          REG_RS_FC_COALESCE=0x408C
+           REG_RS_FC_TIMEOUT=0x4090
+         REG_RS_FC_UPDATES_H=0x4094
+         REG_RS_FC_UPDATES_L=0x4098
+           REG_RS_FC_SAVED_H=0x409C
+           REG_RS_FC_SAVED_L=0x40A0
+
+# status_mgr
+SM_BASE=0x5000
+          REG_SM_QSFP_STATUS=0x5000
+           REG_SM_ERR_STATUS=0x5004
+        REG_SM_LINK_SNAPSHOT=0x5008
+        REG_SM_FD_FIFO_DEPTH=0x500C
+        REG_SM_FD_FIFO_LEVEL=0x5010
+         REG_SM_FD_FIFO_HIGH=0x5014
+         REG_SM_FD_UNDERRUNS=0x5018
+         REG_SM_FD_STARVED_H=0x501C
+         REG_SM_FD_STARVED_L=0x5020
+   REG_SM_LINK0_TX_PACKETS_H=0x5040
+   REG_SM_LINK0_TX_PACKETS_L=0x5044
+     REG_SM_LINK0_TX_BYTES_H=0x5048
+     REG_SM_LINK0_TX_BYTES_L=0x504C
+   REG_SM_LINK0_RX_PACKETS_H=0x5050
+   REG_SM_LINK0_RX_PACKETS_L=0x5054
+     REG_SM_LINK0_RX_BYTES_H=0x5058
+     REG_SM_LINK0_RX_BYTES_L=0x505C
+REG_SM_LINK0_FEC_CORRECTED_H=0x5060
+REG_SM_LINK0_FEC_CORRECTED_L=0x5064
+REG_SM_LINK0_FEC_UNCORRECTED_H=0x5068
+REG_SM_LINK0_FEC_UNCORRECTED_L=0x506C
+   REG_SM_LINK0_RX_BAD_FCS_H=0x5070
+   REG_SM_LINK0_RX_BAD_FCS_L=0x5074
+     REG_SM_LINK0_RX_PAUSE_H=0x5078
+     REG_SM_LINK0_RX_PAUSE_L=0x507C
+     REG_SM_LINK0_TX_PAUSE_H=0x5080
+     REG_SM_LINK0_TX_PAUSE_L=0x5084
+   REG_SM_LINK1_TX_PACKETS_H=0x50A0
+   REG_SM_LINK1_TX_PACKETS_L=0x50A4
+     REG_SM_LINK1_TX_BYTES_H=0x50A8
+     REG_SM_LINK1_TX_BYTES_L=0x50AC
+   REG_SM_LINK1_RX_PACKETS_H=0x50B0
+   REG_SM_LINK1_RX_PACKETS_L=0x50B4
+     REG_SM_LINK1_RX_BYTES_H=0x50B8
+     REG_SM_LINK1_RX_BYTES_L=0x50BC
+REG_SM_LINK1_FEC_CORRECTED_H=0x50C0
+REG_SM_LINK1_FEC_CORRECTED_L=0x50C4
+REG_SM_LINK1_FEC_UNCORRECTED_H=0x50C8
+REG_SM_LINK1_FEC_UNCORRECTED_L=0x50CC
+   REG_SM_LINK1_RX_BAD_FCS_H=0x50D0
+   REG_SM_LINK1_RX_BAD_FCS_L=0x50D4
+     REG_SM_LINK1_RX_PAUSE_H=0x50D8
+     REG_SM_LINK1_RX_PAUSE_L=0x50DC
+     REG_SM_LINK1_TX_PAUSE_H=0x50E0
+     REG_SM_LINK1_TX_PAUSE_L=0x50E4
@@ -0,0 +1,198 @@
+//=================================================================================================
+// mindybench - Measures the host-side cost of Mindy's optional software features
+//
+// Command line: mindybench [-frame <bytes>] [-seconds <n>]
+//=================================================================================================
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "crc32c.h"
+#include "FrameIntegrity.h"
+#include "FrameCopy.h"
+
+using namespace std;
+
+void execute();
+void parseCommandLine(const char** argv);
+
+// The size of a frame, and how long to run each benchmark
+uint32_t frameSize = 4 * 1024 * 1024;
+double   seconds   = 1.0;
+
+
+//=================================================================================================
+// main() - Execution starts here
+//=================================================================================================
+int main(int argc, const char** argv)
+{
+    parseCommandLine(argv);
+
+    try
+    {
+        execute();
+    }
+    catch(const std::exception& e)
+    {
+        printf("%s\n", e.what());
+        exit(1);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseCommandLine() - Parses the command line looking for switches
+//=================================================================================================
+void parseCommandLine(const char** argv)
+{
+    while (*++argv)
+    {
+        const char* arg = *argv;
+
+        if (strcmp(arg, "-frame") == 0 && argv[1])
+        {
+            frameSize = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-seconds") == 0 && argv[1])
+        {
+            seconds = strtod(*++argv, nullptr);
+            continue;
+        }
+
+        fprintf(stderr, "Unknown command line switch %s\n", arg);
+        exit(1);
+    }
+
+    if (frameSize < 256 || (frameSize & 127))
+    {
+        fprintf(stderr, "Frame size must be a multiple of 128 and at least 256\n");
+        exit(1);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// measure() - Calls "work" repeatedly for about "seconds" seconds
+//
+// Returns: The number of calls per second
+//=================================================================================================
+double measure(function<void()> work)
+{
+    using clock = chrono::steady_clock;
+
+    // Warm up the caches and the branch predictors
+    work();
+
+    uint64_t calls = 0;
+    auto     start = clock::now();
+    double   elapsed;
+
+    do
+    {
+        for (int i = 0; i < 8; ++i) work();
+        calls  += 8;
+        elapsed = chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < seconds);
+
+    return calls / elapsed;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// report() - Displays a benchmark result
+//=================================================================================================
+void report(const char* name, double framesPerSec)
+{
+    double gbPerSec = framesPerSec * frameSize / 1e9;
+    printf("  %-28s %12.1f frames/s  %8.2f GB/s\n", name, framesPerSec, gbPerSec);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// execute() - Runs the benchmarks
+//=================================================================================================
+void execute()
+{
+    vector<uint8_t> src(frameSize), dst(frameSize);
+
+    // The semiphase buffers have to be 64-byte aligned for the pattern fill
+    uint8_t* hfd = (uint8_t*)aligned_alloc(64, frameSize);
+    if (hfd == nullptr) {printf("Out of memory\n"); exit(1);}
+    uint8_t* hfd0 = hfd;
+    uint8_t* hfd1 = hfd + frameSize / 2;
+
+    alignas(128) uint8_t metadata[METADATA_RECORD_BYTES] = {};
+    volatile uint32_t sink;
+
+    // Fill the frame with something other than zeros
+    for (uint32_t i = 0; i < frameSize; ++i) src[i] = (uint8_t)(i * 131 + 7);
+
+    // Make sure the fast CRC agrees with the reference implementation before we time it
+    if (crc32c(src.data(), frameSize) != crc32cSoftware(src.data(), frameSize))
+    {
+        printf("CRC-32C self-test failed!\n");
+        exit(1);
+    }
+
+    // Make sure the streaming copy and the pattern fill produce what they should
+    splitFrame(hfd0, hfd1, src.data(), frameSize);
+    bool ok = (memcmp(hfd, src.data(), frameSize) == 0);
+    fillPattern(hfd0, hfd1, frameSize / 2, 1, 0);
+    if (!ok || checkPattern(hfd, frameSize, 1, 0) != 0)
+    {
+        printf("Streaming copy self-test failed!\n");
+        exit(1);
+    }
+
+    printf("Frame size: %u bytes\n", frameSize);
+    printf("CRC-32C implementation: %s\n", crc32cIsHardware() ? "SSE4.2" : "software");
+    printf("Streaming store implementation: %s\n", streamCopyImpl());
+
+    const uint8_t* sp0 = src.data();
+    const uint8_t* sp1 = src.data() + frameSize / 2;
+
+    FrameStamper  stamper;
+    FrameVerifier verifier;
+
+    // The baseline: just copying the frame
+    report("memcpy", measure([&]{memcpy(dst.data(), src.data(), frameSize);}));
+
+    // Splitting a frame into its semiphase buffers, with and without streaming stores
+    report("split (memcpy)", measure([&]
+    {
+        memcpy(hfd0, src.data(), frameSize / 2);
+        memcpy(hfd1, src.data() + frameSize / 2, frameSize / 2);
+    }));
+    report("split (streaming)", measure([&]{splitFrame(hfd0, hfd1, src.data(), frameSize);}));
+
+    // Filling a frame with the test pattern
+    uint32_t frameNumber = 0;
+    report("pattern fill", measure([&]{fillPattern(hfd0, hfd1, frameSize / 2, ++frameNumber, 0);}));
+
+    // The raw CRC implementations
+    report("crc32c", measure([&]{sink = crc32c(src.data(), frameSize);}));
+    report("crc32c (software)", measure([&]{sink = crc32cSoftware(src.data(), frameSize);}));
+
+    // The cost of integrity mode on the sender and on the receiver
+    report("stamp", measure([&]{stamper.stamp(0, metadata, sp0, sp1, frameSize / 2);}));
+
+    // Verify a stamped frame over and over.  Every verification after the first is a
+    // "sequence gap", which costs exactly as much to detect as a good frame
+    stamper.reset();
+    stamper.stamp(0, metadata, sp0, sp1, frameSize / 2);
+    report("verify", measure([&]{verifier.verify(0, metadata, src.data(), frameSize);}));
+
+    (void)sink;
+    free(hfd);
+}
+//=================================================================================================
@@ -0,0 +1,362 @@
+//=================================================================================================
+// mindycap - Decodes a pcap/pcapng capture of RDMX traffic and reports on the frames in it
+//
+// Command line: mindycap [switches] <capture>
+//
+// Switches:
+//   -rfd <addr>:<bytes>   A frame-data ring on the receiver
+//   -rmd <addr>:<bytes>   A meta-data ring on the receiver
+//   -rfc <addr>           A frame counter on the receiver
+//   -frame <bytes>        The frame size, to count frames that are short of data
+//   -port <n>             Only decode packets sent to this UDP port
+//   -gap <us>             Time between packets on a link that counts as a gap (default 100)
+//   -sizes <n>            How many of the most common packet sizes to list (default 10)
+//   -timeline <file>      Writes the timeline of every frame to <file> as CSV
+//
+// The ring and counter switches may be repeated, for each stream's rings.  Without any,
+// packets are sorted into frame data, meta-data and frame counters by size (see
+// RdmxCapture.h).  Frame counts can only be read from a capture that kept at least the first
+// 68 bytes of each packet.
+//
+// Times in the timeline are in nanoseconds from the first RDMX packet in the capture.
+//=================================================================================================
+#include <stdlib.h>
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include "RdmxCapture.h"
+#include "throwRuntime.h"
+
+using namespace std;
+
+// Command line options
+uint64_t frameSize  = 0;
+uint32_t port       = 0;
+double   gapUs      = 100;
+uint32_t topSizes   = 10;
+string   timelineFile;
+vector<RdmxAnalyzer::region_t> regions;
+
+void execute(const string& filename);
+void parseCommandLine(const char** argv, vector<string>& args);
+
+
+//=================================================================================================
+// main() - Execution starts here
+//=================================================================================================
+int main(int argc, const char** argv)
+{
+    vector<string> args;
+
+    parseCommandLine(argv, args);
+
+    try
+    {
+        execute(args[0]);
+    }
+    catch(const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        exit(1);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showUsage() - Displays the command-line syntax and exits
+//=================================================================================================
+void showUsage()
+{
+    fprintf(stderr, "Usage: mindycap [switches] <capture>\n");
+    fprintf(stderr, "  [-rfd <addr>:<bytes>] [-rmd <addr>:<bytes>] [-rfc <addr>] [-frame <bytes>]\n");
+    fprintf(stderr, "  [-port <n>] [-gap <us>] [-sizes <n>] [-timeline <file>]\n");
+    exit(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseRegion() - Parses "<addr>:<bytes>" and adds it to the regions
+//=================================================================================================
+static void parseRegion(RdmxAnalyzer::kind_t kind, const char* arg)
+{
+    char* end;
+    uint64_t base = strtoull(arg, &end, 0);
+    if (*end != ':')
+    {
+        fprintf(stderr, "Expected <addr>:<bytes>, not %s\n", arg);
+        exit(1);
+    }
+    regions.push_back({kind, base, strtoull(end + 1, nullptr, 0)});
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseCommandLine() - Parses the command line looking for switches.  Everything that isn't
+//                      a switch is returned in "args"
+//=================================================================================================
+void parseCommandLine(const char** argv, vector<string>& args)
+{
+    while (*++argv)
+    {
+        const char* arg = *argv;
+
+        if (strcmp(arg, "-rfd") == 0 && argv[1])
+        {
+            parseRegion(RdmxAnalyzer::FRAME_DATA, *++argv);
+            continue;
+        }
+
+        if (strcmp(arg, "-rmd") == 0 && argv[1])
+        {
+            parseRegion(RdmxAnalyzer::META_DATA, *++argv);
+            continue;
+        }
+
+        if (strcmp(arg, "-rfc") == 0 && argv[1])
+        {
+            regions.push_back({RdmxAnalyzer::FRAME_COUNTER, strtoull(*++argv, nullptr, 0), 4});
+            continue;
+        }
+
+        if (strcmp(arg, "-frame") == 0 && argv[1])
+        {
+            frameSize = strtoull(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-port") == 0 && argv[1])
+        {
+            port = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-gap") == 0 && argv[1])
+        {
+            gapUs = strtod(*++argv, nullptr);
+            continue;
+        }
+
+        if (strcmp(arg, "-sizes") == 0 && argv[1])
+        {
+            topSizes = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-timeline") == 0 && argv[1])
+        {
+            timelineFile = *++argv;
+            continue;
+        }
+
+        if (arg[0] == '-' && arg[1] != 0)
+        {
+            fprintf(stderr, "Unknown command line switch %s\n", arg);
+            exit(1);
+        }
+
+        args.push_back(arg);
+    }
+
+    if (args.size() != 1) showUsage();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showLinks() - Displays the traffic on each link, and what went wrong on it
+//=================================================================================================
+static void showLinks(const RdmxAnalyzer& analyzer)
+{
+    printf("\nLink  Source MAC         Source IP        Packets      GB     Gbps  Peak Gbps  FD/MD/FC/other\n");
+
+    uint32_t index = 0;
+    for (auto& link : analyzer.links())
+    {
+        const uint8_t* mac = link.srcMac;
+        char ip[32];
+        sprintf(ip, "%u.%u.%u.%u", link.srcIp >> 24, (link.srcIp >> 16) & 0xFF,
+                (link.srcIp >> 8) & 0xFF, link.srcIp & 0xFF);
+
+        printf("%4u  %02x:%02x:%02x:%02x:%02x:%02x  %-15s %8lu  %6.2f  %7.2f  %9.2f  %lu/%lu/%lu/%lu\n",
+               index, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], ip, link.packets,
+               link.wireBytes / 1e9, link.gbps(), link.peakGbps,
+               link.kindPackets[RdmxAnalyzer::FRAME_DATA], link.kindPackets[RdmxAnalyzer::META_DATA],
+               link.kindPackets[RdmxAnalyzer::FRAME_COUNTER], link.kindPackets[RdmxAnalyzer::UNKNOWN]);
+        ++index;
+    }
+
+    printf("\nLink  Gaps > %.0f us  Longest gap (us)  Out of order  Lost meta-data  Frame-count jumps\n", gapUs);
+
+    index = 0;
+    for (auto& link : analyzer.links())
+    {
+        printf("%4u  %12lu  %16.1f  %12lu  %14lu  %17lu\n", index, link.idleGaps,
+               link.maxIdleNs / 1e3, link.reordered, link.mdSkips, link.fcJumps);
+        ++index;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showFrames() - Displays the frame rate and the time between frames of each stream
+//=================================================================================================
+static void showFrames(const RdmxAnalyzer& analyzer)
+{
+    auto& frames = analyzer.frames();
+
+    printf("\nStream    Frames  Missing  Interval min/avg/max (us)    Frame data to meta-data avg/max (us)\n");
+
+    for (size_t i = 0; i < frames.size();)
+    {
+        // The frames are sorted by stream, then by number
+        size_t   first   = i;
+        uint32_t stream  = frames[i].stream;
+        uint64_t missing = 0;
+        double   minUs = 1e30, maxUs = 0, sumUs = 0, spanSum = 0, spanMax = 0;
+        uint32_t intervals = 0, spans = 0;
+
+        for (; i < frames.size() && frames[i].stream == stream; ++i)
+        {
+            auto& frame = frames[i];
+            if (frame.firstFdNs)
+            {
+                double us = (frame.mdNs - frame.firstFdNs) / 1e3;
+                spanSum += us;
+                spanMax  = max(spanMax, us);
+                ++spans;
+            }
+
+            if (i == first) continue;
+            auto& prev = frames[i - 1];
+            missing += frame.number - prev.number - 1;
+
+            double us = ((double)frame.mdNs - prev.mdNs) / 1e3;
+            minUs  = min(minUs, us);
+            maxUs  = max(maxUs, us);
+            sumUs += us;
+            ++intervals;
+        }
+
+        printf("%6u  %8lu  %7lu  ", stream, i - first, missing);
+        if (intervals)
+            printf("%8.1f / %8.1f / %8.1f", minUs, sumUs / intervals, maxUs);
+        else
+            printf("%28s", "-");
+        if (spans)
+            printf("    %9.1f / %9.1f\n", spanSum / spans, spanMax);
+        else
+            printf("    %21s\n", "-");
+    }
+
+    if (frameSize) printf("\nFrames with less than %lu bytes of frame data: %lu\n", frameSize, analyzer.shortFrames());
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showSizes() - Displays the most common payload sizes
+//=================================================================================================
+static void showSizes(const RdmxAnalyzer& analyzer)
+{
+    auto& sizes = analyzer.sizes();
+
+    vector<pair<uint64_t, uint32_t>> counts;
+    uint64_t total = 0;
+    for (uint32_t size = 0; size < sizes.size(); ++size)
+    {
+        if (sizes[size] == 0) continue;
+        counts.push_back({sizes[size], size});
+        total += sizes[size];
+    }
+    if (total == 0) return;
+
+    sort(counts.rbegin(), counts.rend());
+    if (counts.size() > topSizes) counts.resize(topSizes);
+
+    printf("\nPayload bytes     Packets  Percent\n");
+    for (auto& entry : counts)
+        printf("%13u  %10lu  %6.2f%%\n", entry.second, entry.first, entry.first * 100.0 / total);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// writeTimeline() - Writes the timeline of every frame as CSV
+//=================================================================================================
+static void writeTimeline(const RdmxAnalyzer& analyzer)
+{
+    FILE* ofile = fopen(timelineFile.c_str(), "w");
+    if (ofile == nullptr) throwRuntime("Can't create %s", timelineFile.c_str());
+
+    // Times are from the first packet on any link
+    uint64_t start = UINT64_MAX;
+    for (auto& link : analyzer.links()) start = min(start, link.firstNs);
+
+    auto rel = [&](uint64_t ns) {return ns ? (int64_t)(ns - start) : -1;};
+
+    fprintf(ofile, "stream,frame,first_fd_ns,last_fd_ns,md_ns,fc_ns,md_address,packets,bytes,out_of_order,links\n");
+    for (auto& f : analyzer.frames())
+    {
+        fprintf(ofile, "%u,%lu,%ld,%ld,%ld,%ld,0x%lx,%u,%lu,%u,0x%x\n", f.stream, f.number,
+                rel(f.firstFdNs), rel(f.lastFdNs), rel(f.mdNs), rel(f.fcNs), f.mdAddress,
+                f.packets, f.bytes, f.reordered, f.links);
+    }
+
+    fclose(ofile);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// execute() - Reads the capture and reports on it
+//=================================================================================================
+void execute(const string& filename)
+{
+    PcapReader   reader;
+    RdmxAnalyzer analyzer;
+
+    for (auto& region : regions) analyzer.addRegion(region.kind, region.base, region.size);
+    analyzer.setFrameSize(frameSize);
+    analyzer.setGapThreshold(gapUs * 1000);
+    analyzer.setPort(port);
+
+    reader.open(filename);
+
+    auto start = chrono::steady_clock::now();
+
+    capturedPacket_t packet;
+    uint64_t packets = 0;
+    while (reader.next(packet))
+    {
+        analyzer.add(packet);
+        ++packets;
+    }
+    analyzer.finish();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printf("Capture    : %s (%s, %.2f GB) read in %.3f seconds (%.2f GB/s)\n", filename.c_str(),
+           reader.format(), reader.size() / 1e9, seconds, seconds > 0 ? reader.size() / seconds / 1e9 : 0);
+    printf("Packets    : %lu RDMX, %lu other, %lu skipped\n", packets - analyzer.otherPackets(),
+           analyzer.otherPackets(), reader.skipped());
+
+    showLinks(analyzer);
+    showFrames(analyzer);
+    showSizes(analyzer);
+
+    if (!timelineFile.empty())
+    {
+        writeTimeline(analyzer);
+        printf("\nWrote %lu frames to %s\n", analyzer.frames().size(), timelineFile.c_str());
+    }
+}
+//=================================================================================================
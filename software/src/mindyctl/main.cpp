@@ -0,0 +1,1063 @@
+//=================================================================================================
+// mindyctl - Configures and inspects Mindy from a single process
+//
+// Command line: mindyctl [-device <vendor:device> | -emulate] [-v] [-record-mmio <file>]
+//                        <command> [arguments]
+//
+// Commands:
+//   list                          Lists every register in the register map
+//   get   <reg> [<reg> ...]       Displays registers
+//   set   [-live] <reg>=<value> [...]
+//                                 Writes registers, in the order given
+//   apply [-live] <file>          Runs a configuration script ("-" means stdin)
+//   dump                          Displays every register that can be read without side effects
+//   watch [-interval <ms>] [-count <n>] <reg> [<reg> ...]
+//                                 Displays registers and their rate of change periodically
+//   tune  [-seconds <s>] [-mtu <bytes>] [-max-frame <bytes>] [-hfd-bytes <bytes>] [<file>]
+//                                 Finds the best frame, packet, group and host-buffer sizes
+//                                 and saves them as a configuration script (see StreamTuner.h)
+//   rings                         Displays where each phase is in the host buffers, as a
+//                                 producer would see it after CMindy::attach()
+//   model [-frame <bytes>] [-packet <bytes>] [-group <n>] [-streams <n>] [-rate <frames/s>]
+//         [-measure [-seconds <s>]]
+//                                 Predicts the most frames per second a configuration can carry
+//                                 and which stage of the card limits it (see CapacityModel.h).
+//                                 With "-measure", the rest of the configuration is read from
+//                                 the card, and the prediction is checked by measuring it
+//   monitor [-count <n>]          Displays link and error events as they happen, until "n"
+//                                 have been seen (see LinkMonitor.h)
+//   links [-interval <ms>] [-count <n>]
+//                                 Displays the CMAC statistics of both QSFP ports and their
+//                                 rates periodically
+//   fifo  [-interval <ms>] [-count <n>]
+//                                 Restarts the telemetry of the frame-data FIFO, then displays
+//                                 its level, high-water mark and underruns periodically
+//   mmio-dump <file>              Displays a log of register accesses (see MmioTrace.h)
+//   mmio-replay [-speed <x>] [-writes-only] <file>
+//                                 Re-issues a log of register accesses, at "x" times the
+//                                 original pace (0 = as fast as possible)
+//
+// "-emulate" runs the command against an emulated card (see MindyEmulator.h) instead of the
+// hardware.  "-record-mmio" logs every register access the command makes.
+//
+// A register is named as in mindy_regs.def (e.g., DF_HMD0_ADDR, with or without a "REG_"
+// prefix, in any case), by one half of a 64-bit register (DF_HMD0_ADDR_H), or by its offset
+// in BAR 0.  Values may contain underscores (0x1_0000_0000).
+//
+// A configuration script has one statement per line.  "#" starts a comment.
+//   <reg> = <value>                              Writes a register
+//   read   <reg>                                 Displays a register
+//   expect <reg> <value> [mask <m>]              Fails unless (reg & m) == value
+//   wait   <reg> <value> [mask <m>] [timeout <ms>]  Waits until (reg & m) == value
+//   sleep  <ms>                                  Pauses
+//
+// The whole script is parsed before anything is written, so a typo can't leave the card
+// half-configured, and the register writes are issued back-to-back.
+//
+// "-live" stages the writes of "set" or "apply" and commits them at the next frame boundary
+// (see CMindy::beginConfig()), so a streaming card can be reconfigured without stopping it.
+// The commit restarts the rings, so where they restarted is displayed for the producer to
+// resync to.
+//=================================================================================================
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include "mindy.h"
+#include "MindyEmulator.h"
+#include "StreamTuner.h"
+#include "MmioTrace.h"
+#include "LinkMonitor.h"
+#include "CapacityModel.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+
+CMindy Mindy;
+
+// The card, when we're running against an emulated one
+MindyEmulator Emulator;
+
+// Logs our register accesses when "-record-mmio" is given
+MmioRecorder Recorder;
+
+// How a register may be accessed
+enum access_t {RW, RO, RC};
+
+// A register (or one half of a 64-bit register)
+struct reg_t
+{
+    string      name;
+    uint32_t    offset;
+    uint32_t    width;
+    access_t    access;
+    const char* description;
+};
+
+// One statement of a configuration script
+struct step_t
+{
+    enum op_t {WRITE, READ, EXPECT, WAIT, SLEEP} op;
+    reg_t       reg;
+    uint64_t    value;
+    uint64_t    mask;
+    uint32_t    ms;
+    string      where;
+};
+
+// Every register in the register map
+static const vector<reg_t> registerMap =
+{
+    #define REGMAP_BLOCK(block, base, module, directory)
+    #define REGMAP_REG(block, name, index, width, access, description) \
+        {#block "_" #name, MindyReg::block##_##name::offset, width, access, description},
+    #include "mindy_regs.def"
+    #undef REGMAP_BLOCK
+    #undef REGMAP_REG
+};
+
+// Command-line options
+string   device     = "10EE:903F";
+bool     verbose    = false;
+uint32_t intervalMs = 1000;
+uint32_t watchCount = 0;
+bool     emulate    = false;
+string   mmioLog;
+double   replaySpeed = 1.0;
+bool     writesOnly  = false;
+bool     live        = false;
+
+// The range of the "tune" sweep
+StreamTuner::limits_t tuneLimits;
+
+// The configuration the "model" command predicts (0 = the default, or the card's own value
+// with "-measure"), the target frame rate, and whether to measure it too
+uint32_t modelFrame   = 0;
+uint32_t modelPacket  = 0;
+uint32_t modelGroup   = 0;
+uint32_t modelStreams = 1;
+double   modelRate    = 0;
+bool     modelMeasure = false;
+
+void execute(vector<string> args);
+void parseCommandLine(const char** argv, vector<string>& args);
+
+//=================================================================================================
+// main() - Execution starts here
+//=================================================================================================
+int main(int argc, const char** argv)
+{
+    vector<string> args;
+
+    parseCommandLine(argv, args);
+
+    try
+    {
+        execute(args);
+    }
+    catch(const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        exit(1);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showUsage() - Displays the command-line syntax and exits
+//=================================================================================================
+void showUsage()
+{
+    fprintf(stderr, "Usage: mindyctl [-device <vendor:device> | -emulate] [-v] [-record-mmio <file>] <command> [arguments]\n");
+    fprintf(stderr, "  list\n");
+    fprintf(stderr, "  get   <reg> [<reg> ...]\n");
+    fprintf(stderr, "  set   [-live] <reg>=<value> [<reg>=<value> ...]\n");
+    fprintf(stderr, "  apply [-live] <file>\n");
+    fprintf(stderr, "  dump\n");
+    fprintf(stderr, "  watch [-interval <ms>] [-count <n>] <reg> [<reg> ...]\n");
+    fprintf(stderr, "  tune  [-seconds <s>] [-mtu <bytes>] [-max-frame <bytes>] [-hfd-bytes <bytes>] [<file>]\n");
+    fprintf(stderr, "  rings\n");
+    fprintf(stderr, "  model [-frame <bytes>] [-packet <bytes>] [-group <n>] [-streams <n>] [-rate <frames/s>] [-measure [-seconds <s>]]\n");
+    fprintf(stderr, "  monitor [-count <n>]\n");
+    fprintf(stderr, "  links [-interval <ms>] [-count <n>]\n");
+    fprintf(stderr, "  fifo  [-interval <ms>] [-count <n>]\n");
+    fprintf(stderr, "  mmio-dump <file>\n");
+    fprintf(stderr, "  mmio-replay [-speed <x>] [-writes-only] <file>\n");
+    exit(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseCommandLine() - Parses the command line looking for switches.  Everything that isn't
+//                      a switch is returned in "args"
+//=================================================================================================
+void parseCommandLine(const char** argv, vector<string>& args)
+{
+    while (*++argv)
+    {
+        const char* arg = *argv;
+
+        if (strcmp(arg, "-device") == 0 && argv[1])
+        {
+            device = *++argv;
+            continue;
+        }
+
+        if (strcmp(arg, "-v") == 0)
+        {
+            verbose = true;
+            continue;
+        }
+
+        if (strcmp(arg, "-interval") == 0 && argv[1])
+        {
+            intervalMs = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-count") == 0 && argv[1])
+        {
+            watchCount = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-emulate") == 0)
+        {
+            emulate = true;
+            continue;
+        }
+
+        if (strcmp(arg, "-seconds") == 0 && argv[1])
+        {
+            tuneLimits.secondsPerPoint = strtod(*++argv, nullptr);
+            continue;
+        }
+
+        if (strcmp(arg, "-mtu") == 0 && argv[1])
+        {
+            tuneLimits.mtu = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-max-frame") == 0 && argv[1])
+        {
+            tuneLimits.maxFrameSize = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-hfd-bytes") == 0 && argv[1])
+        {
+            tuneLimits.maxHostFrameDataBytes = strtoull(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-record-mmio") == 0 && argv[1])
+        {
+            mmioLog = *++argv;
+            continue;
+        }
+
+        if (strcmp(arg, "-speed") == 0 && argv[1])
+        {
+            replaySpeed = strtod(*++argv, nullptr);
+            continue;
+        }
+
+        if (strcmp(arg, "-writes-only") == 0)
+        {
+            writesOnly = true;
+            continue;
+        }
+
+        if (strcmp(arg, "-live") == 0)
+        {
+            live = true;
+            continue;
+        }
+
+        if (strcmp(arg, "-frame") == 0 && argv[1])
+        {
+            modelFrame = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-packet") == 0 && argv[1])
+        {
+            modelPacket = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-group") == 0 && argv[1])
+        {
+            modelGroup = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-streams") == 0 && argv[1])
+        {
+            modelStreams = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-rate") == 0 && argv[1])
+        {
+            modelRate = strtod(*++argv, nullptr);
+            continue;
+        }
+
+        if (strcmp(arg, "-measure") == 0)
+        {
+            modelMeasure = true;
+            continue;
+        }
+
+        if (arg[0] == '-' && arg[1] != 0)
+        {
+            fprintf(stderr, "Unknown command line switch %s\n", arg);
+            exit(1);
+        }
+
+        args.push_back(arg);
+    }
+
+    if (args.empty()) showUsage();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseNumber() - Converts a string (which may contain underscores) to a number
+//=================================================================================================
+bool parseNumber(string text, uint64_t& value)
+{
+    string digits;
+    for (char c : text) if (c != '_') digits += c;
+    if (digits.empty()) return false;
+
+    char* end;
+    errno = 0;
+    value = strtoull(digits.c_str(), &end, 0);
+    return *end == 0 && errno == 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// findRegister() - Looks up a register by name or by offset
+//=================================================================================================
+reg_t findRegister(string name)
+{
+    string key;
+    for (char c : name) key += toupper(c);
+    if (key.compare(0, 4, "REG_") == 0) key = key.substr(4);
+
+    // Is it the name of a register?
+    for (auto& reg : registerMap) if (reg.name == key) return reg;
+
+    // Is it one half of a 64-bit register?
+    if (key.size() > 2 && (key.ends_with("_H") || key.ends_with("_L")))
+    {
+        string base = key.substr(0, key.size() - 2);
+        for (auto& reg : registerMap)
+        {
+            if (reg.name != base || reg.width != 64) continue;
+            reg_t half = reg;
+            half.name   = key;
+            half.width  = 32;
+            half.offset = reg.offset + (key.back() == 'L' ? 4 : 0);
+            return half;
+        }
+    }
+
+    // Is it the offset of a register?
+    uint64_t offset;
+    if (parseNumber(name, offset) && (offset & 3) == 0 && offset < 0x10000)
+        return {name, (uint32_t)offset, 32, RW, ""};
+
+    throwRuntime("Unknown register '%s'", name.c_str());
+    return {};
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// readRegister() / writeRegister() - Access a register at its natural width
+//=================================================================================================
+uint64_t readRegister(const reg_t& reg)
+{
+    return (reg.width == 64) ? Mindy.read64(reg.offset) : Mindy.read32(reg.offset);
+}
+
+void writeRegister(const reg_t& reg, uint64_t value)
+{
+    if (reg.width == 64)
+        Mindy.write64(reg.offset, value);
+    else
+        Mindy.write32(reg.offset, value);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showRegister() - Displays the name, offset, and value of a register
+//=================================================================================================
+void showRegister(const reg_t& reg, uint64_t value)
+{
+    if (reg.width == 64)
+        printf("%-24s 0x%04X  0x%016lX  %lu\n", reg.name.c_str(), reg.offset, value, value);
+    else
+        printf("%-24s 0x%04X  0x%08lX          %lu\n", reg.name.c_str(), reg.offset, value, value);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseValue() - Parses a value that is to be compared with or written to a register
+//=================================================================================================
+uint64_t parseValue(const reg_t& reg, string text, const string& where)
+{
+    uint64_t value;
+    if (!parseNumber(text, value))
+        throwRuntime("%s: '%s' isn't a number", where.c_str(), text.c_str());
+    if (reg.width == 32 && value > 0xFFFFFFFF)
+        throwRuntime("%s: %s is a 32-bit register", where.c_str(), reg.name.c_str());
+    return value;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseStatement() - Parses one line of a configuration script into a step.  Returns false if
+//                    the line is blank
+//=================================================================================================
+bool parseStatement(string line, const string& where, step_t& step)
+{
+    // Throw away comments, and make sure "=" is a token of its own
+    line = line.substr(0, line.find('#'));
+    string spaced;
+    for (char c : line) if (c == '=') spaced += " = "; else spaced += c;
+
+    // Split the line into tokens
+    vector<string> token;
+    char* saveptr;
+    for (char* p = strtok_r(spaced.data(), " \t\r\n", &saveptr); p; p = strtok_r(nullptr, " \t\r\n", &saveptr))
+        token.push_back(p);
+
+    if (token.empty()) return false;
+
+    step.where = where;
+    step.mask  = ~0ULL;
+    step.ms    = 0;
+
+    // <reg> = <value>
+    if (token.size() == 3 && token[1] == "=")
+    {
+        step.op    = step_t::WRITE;
+        step.reg   = findRegister(token[0]);
+        step.value = parseValue(step.reg, token[2], where);
+        if (step.reg.access == RO)
+            throwRuntime("%s: %s is read-only", where.c_str(), step.reg.name.c_str());
+        return true;
+    }
+
+    // read <reg>
+    if (token.size() == 2 && token[0] == "read")
+    {
+        step.op  = step_t::READ;
+        step.reg = findRegister(token[1]);
+        return true;
+    }
+
+    // sleep <ms>
+    if (token.size() == 2 && token[0] == "sleep")
+    {
+        uint64_t ms;
+        if (!parseNumber(token[1], ms)) throwRuntime("%s: bad sleep time", where.c_str());
+        step.op = step_t::SLEEP;
+        step.ms = ms;
+        return true;
+    }
+
+    // expect <reg> <value> [mask <m>]
+    // wait   <reg> <value> [mask <m>] [timeout <ms>]
+    if (token.size() >= 3 && (token[0] == "expect" || token[0] == "wait"))
+    {
+        step.op    = (token[0] == "wait") ? step_t::WAIT : step_t::EXPECT;
+        step.reg   = findRegister(token[1]);
+        step.value = parseValue(step.reg, token[2], where);
+        step.ms    = (step.op == step_t::WAIT) ? 1000 : 0;
+
+        for (size_t i = 3; i < token.size(); i += 2)
+        {
+            if (i + 1 == token.size()) throwRuntime("%s: missing value after '%s'", where.c_str(), token[i].c_str());
+
+            if (token[i] == "mask")
+                step.mask = parseValue(step.reg, token[i+1], where);
+            else if (token[i] == "timeout" && step.op == step_t::WAIT)
+                step.ms = parseValue(step.reg, token[i+1], where);
+            else
+                throwRuntime("%s: unexpected '%s'", where.c_str(), token[i].c_str());
+        }
+
+        return true;
+    }
+
+    throwRuntime("%s: syntax error", where.c_str());
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseScript() - Parses a configuration script into a list of steps
+//=================================================================================================
+vector<step_t> parseScript(string filename)
+{
+    vector<step_t> steps;
+    step_t step;
+    char   buffer[1024];
+
+    FILE* ifile = (filename == "-") ? stdin : fopen(filename.c_str(), "r");
+    if (ifile == nullptr) throwRuntime("Can't open %s", filename.c_str());
+
+    for (int line = 1; fgets(buffer, sizeof(buffer), ifile); ++line)
+    {
+        string where = filename + ":" + to_string(line);
+        if (parseStatement(buffer, where, step)) steps.push_back(step);
+    }
+
+    if (ifile != stdin) fclose(ifile);
+    return steps;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// runSteps() - Executes a list of steps
+//=================================================================================================
+void runSteps(const vector<step_t>& steps)
+{
+    auto start = steady_clock::now();
+
+    for (auto& step : steps)
+    {
+        switch (step.op)
+        {
+            case step_t::WRITE:
+                writeRegister(step.reg, step.value);
+                break;
+
+            case step_t::READ:
+                showRegister(step.reg, readRegister(step.reg));
+                break;
+
+            case step_t::SLEEP:
+                this_thread::sleep_for(milliseconds(step.ms));
+                break;
+
+            case step_t::EXPECT:
+            {
+                uint64_t value = readRegister(step.reg);
+                if ((value & step.mask) != step.value)
+                    throwRuntime("%s: %s is 0x%lX, expected 0x%lX", step.where.c_str(),
+                                 step.reg.name.c_str(), value & step.mask, step.value);
+                break;
+            }
+
+            case step_t::WAIT:
+            {
+                auto deadline = steady_clock::now() + milliseconds(step.ms);
+                while ((readRegister(step.reg) & step.mask) != step.value)
+                {
+                    if (steady_clock::now() > deadline)
+                        throwRuntime("%s: timed out waiting for %s", step.where.c_str(), step.reg.name.c_str());
+                    this_thread::sleep_for(microseconds(100));
+                }
+                break;
+            }
+        }
+    }
+
+    if (verbose)
+    {
+        double us = duration<double, micro>(steady_clock::now() - start).count();
+        printf("%lu statements in %.1f us\n", steps.size(), us);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// listRegisters() - Displays the register map
+//=================================================================================================
+void listRegisters()
+{
+    static const char* accessName[] = {"RW", "RO", "RC"};
+
+    for (auto& reg : registerMap)
+        printf("%-24s 0x%04X  %2u  %s  %s\n", reg.name.c_str(), reg.offset, reg.width,
+               accessName[reg.access], reg.description);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// dumpRegisters() - Displays every register that can be read without side effects
+//=================================================================================================
+void dumpRegisters()
+{
+    for (auto& reg : registerMap)
+    {
+        if (reg.access == RC) continue;
+        showRegister(reg, readRegister(reg));
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// watchRegisters() - Displays registers and their rate of change every "intervalMs"
+//=================================================================================================
+void watchRegisters(const vector<reg_t>& regs)
+{
+    vector<uint64_t> previous(regs.size());
+
+    for (auto& reg : regs)
+        if (reg.access == RC) throwRuntime("Reading %s has side effects", reg.name.c_str());
+
+    // Print the column headings
+    printf("%10s", "seconds");
+    for (auto& reg : regs) printf("  %20s %12s", reg.name.c_str(), "per second");
+    printf("\n");
+
+    auto start = steady_clock::now();
+    auto last  = start;
+    for (size_t i = 0; i < regs.size(); ++i) previous[i] = readRegister(regs[i]);
+
+    for (uint32_t n = 0; watchCount == 0 || n < watchCount; ++n)
+    {
+        this_thread::sleep_until(last + milliseconds(intervalMs));
+
+        auto   now     = steady_clock::now();
+        double elapsed = duration<double>(now - last).count();
+        last = now;
+
+        printf("%10.3f", duration<double>(now - start).count());
+        for (size_t i = 0; i < regs.size(); ++i)
+        {
+            uint64_t value = readRegister(regs[i]);
+
+            // 32-bit counters are allowed to wrap
+            uint64_t delta = value - previous[i];
+            if (regs[i].width == 32) delta &= 0xFFFFFFFF;
+
+            printf("  %20lu %12.1f", value, delta / elapsed);
+            previous[i] = value;
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// tune() - Runs the stream tuner and saves the best configuration to "filename"
+//=================================================================================================
+void tune(string filename)
+{
+    StreamTuner tuner(Mindy);
+
+    printf("%10s %8s %6s %6s  %10s %8s\n", "frame", "packet", "group", "ring", "frames/s", "GB/s");
+
+    auto best = tuner.tune(tuneLimits, [](const StreamTuner::result_t& result)
+    {
+        auto& point = result.point;
+        printf("%10u %8u %6u %6u  ", point.frameSize, point.packetSize, point.packetsPerGroup,
+               point.ringFrames);
+        if (result.ok)
+            printf("%10.1f %8.2f\n", result.framesPerSec, result.gbPerSec);
+        else
+            printf("%s\n", result.error.c_str());
+        fflush(stdout);
+    });
+
+    if (!best.ok) throwRuntime("No configuration ran without errors: %s", best.error.c_str());
+
+    printf("Best: frame %u, packet %u, group %u, ring %u : %.2f GB/s\n", best.point.frameSize,
+           best.point.packetSize, best.point.packetsPerGroup, best.point.ringFrames, best.gbPerSec);
+
+    StreamTuner::saveProfile(best, filename);
+    printf("Saved to %s\n", filename.c_str());
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showRings() - Displays the ring state of both phases
+//=================================================================================================
+void showRings()
+{
+    CMindy::ringState_t states[2] = {Mindy.getRingState(0), Mindy.getRingState(1)};
+
+    printf("%5s %10s %10s %10s %9s %14s %14s\n", "phase", "submitted", "issued", "fetched",
+           "in-flight", "next HFD offs", "next HMD offs");
+
+    for (uint32_t phase = 0; phase < 2; ++phase)
+    {
+        auto& state = states[phase];
+        printf("%5u %10u %10u %10u %9u %14lu %14lu\n", phase, state.submitted, state.issued,
+               state.fetched, state.inFlight, state.nextHfdOffset, state.nextHmdOffset);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// model() - Displays the predicted capacity of a configuration and, with "-measure", checks it
+//           against the card
+//=================================================================================================
+void model()
+{
+    CapacityModel model;
+    CapacityModel::config_t config;
+    StreamTuner::result_t   measured;
+
+    // When we're measuring, the card's sizes stand in for any we weren't given
+    if (modelMeasure)
+    {
+        if (Mindy.getFrameSize())       config.frameSize       = Mindy.getFrameSize();
+        if (Mindy.getPacketSize())      config.packetSize      = Mindy.getPacketSize();
+        if (Mindy.getPacketsPerGroup()) config.packetsPerGroup = Mindy.getPacketsPerGroup();
+    }
+
+    if (modelFrame)  config.frameSize       = modelFrame;
+    if (modelPacket) config.packetSize      = modelPacket;
+    if (modelGroup)  config.packetsPerGroup = modelGroup;
+
+    // Run the configuration on the card, then predict it with the rest of the card's settings
+    if (modelMeasure)
+    {
+        // Give the card as many frames in flight as the tuner would, so we measure the card
+        // rather than how quickly we can ring the frame counters
+        uint64_t ringFrames = tuneLimits.maxHostFrameDataBytes / (config.frameSize / 2);
+        if (ringFrames > tuneLimits.maxRingFrames) ringFrames = tuneLimits.maxRingFrames;
+        if (ringFrames == 0) throwRuntime("The host frame-data buffers can't hold a frame");
+
+        StreamTuner tuner(Mindy);
+        StreamTuner::point_t point = {config.frameSize, config.packetSize, config.packetsPerGroup,
+                                      (uint32_t)ringFrames};
+        measured = tuner.measure(point, tuneLimits.secondsPerPoint, tuneLimits.mtu);
+        if (!measured.ok) throwRuntime("The measurement failed: %s", measured.error.c_str());
+        config = CapacityModel::readConfig(Mindy);
+    }
+
+    config.streams = modelStreams;
+    auto result = model.predict(config, modelRate);
+
+    printf("frame %u, packet %u, group %u, %u stream%s\n\n", config.frameSize, config.packetSize,
+           config.packetsPerGroup, config.streams, config.streams == 1 ? "" : "s");
+
+    printf("%-12s %12s %14s", "stage", "us/frame", "max frames/s");
+    if (modelRate) printf(" %12s", "utilization");
+    printf("\n");
+
+    for (auto& stage : result.stages)
+    {
+        printf("%-12s %12.3f %14.1f", stage.name.c_str(), stage.secondsPerFrame * 1e6,
+               1 / stage.secondsPerFrame);
+        if (modelRate) printf(" %11.1f%%", stage.utilization * 100);
+        printf("%s\n", stage.name == result.bottleneck ? "  <-- bottleneck" : "");
+    }
+
+    printf("\nPredicted: %.1f frames/s (%.2f GB/s), limited by %s\n", result.maxFramesPerSec,
+           result.maxGBps, result.bottleneck.c_str());
+
+    if (modelRate)
+        printf("%.1f frames/s %s (%.1f%% of capacity)\n", modelRate,
+               result.fits ? "fits" : "does NOT fit", modelRate / result.maxFramesPerSec * 100);
+
+    if (!modelMeasure) return;
+
+    double error = (result.maxFramesPerSec - measured.framesPerSec) / measured.framesPerSec * 100;
+    printf("Measured:  %.1f frames/s (%.2f GB/s), model is %+.1f%%\n", measured.framesPerSec,
+           measured.gbPerSec, error);
+
+    // The emulator is a throughput model too, so agreeing with it doesn't validate anything
+    if (emulate) printf("(This card is emulated, so the comparison doesn't check the model)\n");
+
+    if (result.bottleneck == "PCIe read")
+        printf("The measurement implies a host read bandwidth of %.2f GB/s (the model assumes %.2f)\n",
+               model.impliedPcieGBps(config, measured.framesPerSec), model.params().pcieGBps);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// monitorLinks() - Displays link and error events as the LinkMonitor sees them
+//=================================================================================================
+void monitorLinks()
+{
+    static const char* typeName[] = {"link down", "link up", "error"};
+
+    LinkMonitor monitor(Mindy);
+    atomic<uint32_t> events {0};
+
+    monitor.onEvent([&](const LinkMonitor::event_t& event)
+    {
+        printf("%12.6f  %-9s  %s 0x%X  links 0x%X\n", event.seconds, typeName[event.type],
+               event.type == LinkMonitor::ERROR_LATCHED ? "bits" : "link", event.detail, event.links);
+        fflush(stdout);
+        ++events;
+    });
+
+    monitor.start();
+    printf("Links 0x%X\n", monitor.status() & LinkMonitor::STATUS_LINKS_MASK);
+
+    while (watchCount == 0 || events < watchCount) this_thread::sleep_for(milliseconds(10));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showLinkStats() - Displays the CMAC statistics of both links every "intervalMs"
+//=================================================================================================
+void showLinkStats()
+{
+    // The first call sets the starting point for the rates
+    Mindy.getLinkStats(0);
+    Mindy.getLinkStats(1);
+
+    printf("%4s %12s %12s %12s %12s %10s %10s %8s %8s %8s\n", "link", "TX pkts/s", "TX Gb/s",
+           "RX pkts/s", "RX Gb/s", "FEC corr", "FEC uncor", "bad FCS", "RX pause", "TX pause");
+
+    for (uint32_t n = 0; watchCount == 0 || n < watchCount; ++n)
+    {
+        this_thread::sleep_for(milliseconds(intervalMs));
+
+        for (uint32_t link = 0; link < 2; ++link)
+        {
+            auto stats = Mindy.getLinkStats(link);
+            auto& rate = stats.perSecond;
+            auto& cmac = stats.cmac;
+            printf("%4u %12.0f %12.3f %12.0f %12.3f %10lu %10lu %8lu %8lu %8lu\n", link,
+                   rate.txPackets, rate.txBytes * 8 / 1e9, rate.rxPackets, rate.rxBytes * 8 / 1e9,
+                   cmac.fecCorrected, cmac.fecUncorrected, cmac.rxBadFcs, cmac.rxPause,
+                   cmac.txPause);
+        }
+        fflush(stdout);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showFdFifo() - Restarts the telemetry of the frame-data FIFO, then displays it every
+//                "intervalMs"
+//=================================================================================================
+void showFdFifo()
+{
+    auto stats = Mindy.getFdFifoStats();
+    if (stats.depth == 0) printf("This build has no frame-data FIFO; underruns are still counted\n");
+
+    Mindy.clearFdFifoStats();
+
+    printf("%10s %10s %10s %8s %10s %14s\n", "depth", "level", "high", "high %", "underruns",
+           "starved clks");
+
+    for (uint32_t n = 0; watchCount == 0 || n < watchCount; ++n)
+    {
+        this_thread::sleep_for(milliseconds(intervalMs));
+
+        stats = Mindy.getFdFifoStats();
+        double percent = stats.depth ? 100.0 * stats.highWater / stats.depth : 0;
+        printf("%10u %10u %10u %7.1f%% %10u %14lu\n", stats.depth, stats.level, stats.highWater,
+               percent, stats.underruns, stats.starvedCycles);
+        fflush(stdout);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// registerName() - Returns the name of the register (or half of a 64-bit register) at "offset"
+//=================================================================================================
+string registerName(uint32_t offset)
+{
+    for (auto& reg : registerMap)
+    {
+        if (reg.width == 32 && reg.offset == offset) return reg.name;
+        if (reg.width == 64 && reg.offset == offset    ) return reg.name + "_H";
+        if (reg.width == 64 && reg.offset == offset - 4) return reg.name + "_L";
+    }
+
+    char buffer[16];
+    sprintf(buffer, "0x%04X", offset);
+    return buffer;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// dumpMmioLog() - Displays every access in an MMIO log, in the order they happened
+//=================================================================================================
+void dumpMmioLog(string filename)
+{
+    MmioReplayer log;
+    log.load(filename);
+
+    auto& header = log.header();
+    printf("%lu accesses by %u threads, %lu not logged\n", header.records, header.threads,
+           header.dropped);
+
+    for (auto& record : log.records())
+    {
+        printf("%14.3f us  T%-3u %s %-24s 0x%08X\n", log.recordNs(record) / 1000, record.thread(),
+               record.isWrite() ? "W" : "R", registerName(record.offset()).c_str(), record.value);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// replayMmioLog() - Re-issues the accesses in an MMIO log
+//=================================================================================================
+void replayMmioLog(string filename)
+{
+    MmioReplayer replayer;
+    replayer.load(filename);
+
+    MmioReplayer::config_t config;
+    config.speed = replaySpeed;
+    config.reads = !writesOnly;
+
+    auto stats = replayer.replay(Mindy, config, [&](const mmioRecord_t& record, uint32_t actual)
+    {
+        if (!verbose) return;
+        printf("%14.3f us  %-24s read 0x%08X, logged 0x%08X\n", replayer.recordNs(record) / 1000,
+               registerName(record.offset()).c_str(), actual, record.value);
+    });
+
+    printf("%lu writes, %lu reads (%lu differed from the log) in %.3f seconds\n", stats.writes,
+           stats.reads, stats.mismatches, stats.seconds);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// execute() - Carries out the command
+//=================================================================================================
+void execute(vector<string> args)
+{
+    string command = args[0];
+    args.erase(args.begin());
+
+    // "list", "mmio-dump" and "model" without "-measure" don't need the hardware
+    if (command == "list")
+    {
+        listRegisters();
+        return;
+    }
+
+    if (command == "model" && !modelMeasure)
+    {
+        if (!args.empty()) showUsage();
+        model();
+        return;
+    }
+
+    if (command == "mmio-dump")
+    {
+        if (args.size() != 1) showUsage();
+        dumpMmioLog(args[0]);
+        return;
+    }
+
+    // Parse everything before touching the hardware
+    vector<step_t> steps;
+    vector<reg_t>  regs;
+
+    if (command == "set")
+    {
+        if (args.empty()) showUsage();
+        step_t step;
+        for (auto& arg : args)
+            if (parseStatement(arg, "argument '" + arg + "'", step)) steps.push_back(step);
+        for (auto& step : steps)
+            if (step.op != step_t::WRITE) throwRuntime("%s: expected <reg>=<value>", step.where.c_str());
+    }
+    else if (command == "apply")
+    {
+        if (args.size() != 1) showUsage();
+        steps = parseScript(args[0]);
+    }
+    else if (command == "get" || command == "watch")
+    {
+        if (args.empty()) showUsage();
+        for (auto& arg : args) regs.push_back(findRegister(arg));
+    }
+    else if (command == "tune")
+    {
+        if (args.size() > 1) showUsage();
+        if (args.empty()) args.push_back("tuned.cfg");
+    }
+    else if (command == "mmio-replay")
+    {
+        if (args.size() != 1) showUsage();
+    }
+    else if (command == "model")
+    {
+        if (!args.empty()) showUsage();
+    }
+    else if (command != "dump" && command != "rings" && command != "monitor" && command != "links"
+          && command != "fifo")
+        showUsage();
+
+    if (emulate)
+    {
+        Emulator.start();
+        Mindy.initEmulated(Emulator);
+    }
+    else
+        Mindy.init(device);
+
+    if (!mmioLog.empty()) Recorder.start(mmioLog, Mindy);
+
+    if      (command == "dump")  dumpRegisters();
+    else if (command == "rings") showRings();
+    else if (command == "monitor") monitorLinks();
+    else if (command == "links") showLinkStats();
+    else if (command == "fifo")  showFdFifo();
+    else if (command == "model") model();
+    else if (command == "tune")  tune(args[0]);
+    else if (command == "watch") watchRegisters(regs);
+    else if (command == "get")   for (auto& reg : regs) showRegister(reg, readRegister(reg));
+    else if (command == "mmio-replay") replayMmioLog(args[0]);
+    else if (live)
+    {
+        Mindy.beginConfig();
+        runSteps(steps);
+        Mindy.commitConfig();
+        showRings();
+    }
+    else                         runSteps(steps);
+
+    if (Recorder.recording())
+    {
+        auto stats = Recorder.stop();
+        fprintf(stderr, "Logged %lu register accesses to %s (%lu not logged)\n", stats.records,
+                mmioLog.c_str(), stats.dropped);
+    }
+}
+//=================================================================================================
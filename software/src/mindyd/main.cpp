@@ -0,0 +1,488 @@
+//=================================================================================================
+// mindyd - Owns the card, and submits frames to it on behalf of client processes
+//
+// Command line: mindyd [-device <vendor:device> | -emulate] [-shm <name>] [-mode <octal>]
+//                      [-status-us <us>] [-idle-us <us>] [-v]
+//
+// mindyd maps BAR 0 and is the only process that rings the card's doorbells.  Clients attach
+// through a POSIX shared-memory object (see MindyShared.h and MindyClient.h) that mindyd
+// creates with permissions "-mode" (default 0660), so they need no privileges of their own.
+//
+// Each sweep of the client rings is turned into at most one doorbell write per phase.  The
+// card's QSFP status, latched errors and frame counters are published every "-status-us"
+// microseconds (default 1000), or sooner when a client asks.  Latched errors are cleared on
+// the card as soon as they're seen, and are reported to clients until one of them clears
+// them.  When there's nothing to do, mindyd spins briefly, then polls every "-idle-us"
+// microseconds (default 20).
+//
+// mindyd doesn't configure the card; do that with mindyctl before starting clients.  With
+// "-emulate", it runs an emulated card (see MindyEmulator.h) set up for 64K frames.
+//
+// SIGINT or SIGTERM submits whatever the clients have queued, removes the shared-memory
+// object and exits.
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <immintrin.h>
+#include "mindy.h"
+#include "MindyEmulator.h"
+#include "MindyShared.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+
+CMindy Mindy;
+
+// The card, when we're running against an emulated one
+MindyEmulator Emulator;
+
+// Command-line options
+string   device   = "10EE:903F";
+bool     emulate  = false;
+string   shmName  = MINDYD_SHM_NAME;
+uint32_t shmMode  = 0660;
+uint32_t statusUs = 1000;
+uint32_t idleUs   = 20;
+bool     verbose  = false;
+
+// Set by SIGINT and SIGTERM
+volatile sig_atomic_t stopping = 0;
+
+// The shared-memory segment
+mindydShared_t* Shared = nullptr;
+
+// The errors latched on the card since a client last cleared them
+uint32_t latchedErrors = 0;
+
+void execute();
+void parseCommandLine(const char** argv);
+
+
+//=================================================================================================
+// main() - Execution starts here
+//=================================================================================================
+int main(int argc, const char** argv)
+{
+    parseCommandLine(argv);
+
+    try
+    {
+        execute();
+    }
+    catch(const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        if (Shared) shm_unlink(shmName.c_str());
+        exit(1);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showUsage() - Displays the command-line syntax and exits
+//=================================================================================================
+void showUsage()
+{
+    fprintf(stderr, "Usage: mindyd [-device <vendor:device> | -emulate] [-shm <name>] [-mode <octal>]\n");
+    fprintf(stderr, "              [-status-us <us>] [-idle-us <us>] [-v]\n");
+    exit(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseCommandLine() - Parses the command line
+//=================================================================================================
+void parseCommandLine(const char** argv)
+{
+    while (*++argv)
+    {
+        const char* arg = *argv;
+
+        if (strcmp(arg, "-device") == 0 && argv[1])
+        {
+            device = *++argv;
+            continue;
+        }
+
+        if (strcmp(arg, "-emulate") == 0)
+        {
+            emulate = true;
+            continue;
+        }
+
+        if (strcmp(arg, "-shm") == 0 && argv[1])
+        {
+            shmName = *++argv;
+            if (shmName[0] != '/') shmName = "/" + shmName;
+            continue;
+        }
+
+        if (strcmp(arg, "-mode") == 0 && argv[1])
+        {
+            shmMode = strtoul(*++argv, nullptr, 8);
+            continue;
+        }
+
+        if (strcmp(arg, "-status-us") == 0 && argv[1])
+        {
+            statusUs = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-idle-us") == 0 && argv[1])
+        {
+            idleUs = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-v") == 0)
+        {
+            verbose = true;
+            continue;
+        }
+
+        showUsage();
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// resetSlot() - Puts a client slot back into its empty state and frees it
+//=================================================================================================
+void resetSlot(mindydClient_t& client)
+{
+    for (uint32_t i = 0; i < MINDYD_RING_ENTRIES; ++i)
+        client.ring[i].sequence.store(i, memory_order_relaxed);
+
+    client.tail      = 0;
+    client.head      = 0;
+    client.completed = 0;
+    client.frames[0] = 0;
+    client.frames[1] = 0;
+    client.detaching = 0;
+
+    // Publish the reset slot along with the fact that it's free
+    client.owner.store(0, memory_order_release);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// createShared() - Creates and initializes the shared-memory segment
+//=================================================================================================
+void createShared()
+{
+    int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, shmMode);
+
+    // If the object is left over from a mindyd that died, replace it
+    if (fd < 0 && errno == EEXIST)
+    {
+        int old = shm_open(shmName.c_str(), O_RDONLY, 0);
+        if (old >= 0)
+        {
+            // The first three words are the magic number, the version and the daemon's PID
+            uint32_t header[3];
+            bool running = pread(old, header, sizeof header, 0) == sizeof header
+                        && header[0] == MINDYD_MAGIC && kill(header[2], 0) == 0;
+            close(old);
+            if (running) throwRuntime("mindyd is already running (pid %u)", header[2]);
+        }
+        shm_unlink(shmName.c_str());
+        fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, shmMode);
+    }
+
+    if (fd < 0) throwRuntime("Can't create %s: %s", shmName.c_str(), strerror(errno));
+
+    // The umask may have taken away permissions that the clients need
+    fchmod(fd, shmMode);
+
+    if (ftruncate(fd, sizeof(mindydShared_t)) < 0)
+    {
+        close(fd);
+        throwRuntime("Can't size %s: %s", shmName.c_str(), strerror(errno));
+    }
+
+    void* map = mmap(nullptr, sizeof(mindydShared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) throwRuntime("Can't map %s: %s", shmName.c_str(), strerror(errno));
+
+    // The new object is zero-filled, which is a valid state for every atomic in it
+    Shared = (mindydShared_t*)map;
+    Shared->version    = MINDYD_VERSION;
+    Shared->daemonPid  = getpid();
+    Shared->maxClients = MINDYD_MAX_CLIENTS;
+    for (auto& client : Shared->client) resetSlot(client);
+
+    // Clients won't attach until they see the magic number
+    Shared->magic.store(MINDYD_MAGIC, memory_order_release);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// publishStatus() - Reads the card's status and publishes it to the clients
+//=================================================================================================
+void publishStatus()
+{
+    uint32_t errors = Mindy.getErrorStatus();
+    if (errors)
+    {
+        Mindy.clearErrorStatus(errors);
+        if (verbose && (errors & ~latchedErrors)) printf("Card latched errors 0x%X\n", errors);
+        latchedErrors |= errors;
+    }
+
+    mindydStatus_t& status = Shared->status;
+    uint32_t sequence = status.sequence.load(memory_order_relaxed);
+
+    // An odd sequence number tells readers that we're in the middle of an update
+    status.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    status.qsfpStatus.store(Mindy.getQsfpStatus(), memory_order_relaxed);
+    status.errors.store(latchedErrors, memory_order_relaxed);
+    for (uint32_t phase = 0; phase < 2; ++phase)
+    {
+        status.submitted[phase].store(Mindy.getLocalFrameCounter(phase), memory_order_relaxed);
+        status.fetched[phase].store(Mindy.getFetchedFrameCount(phase), memory_order_relaxed);
+    }
+    status.updates.fetch_add(1, memory_order_relaxed);
+
+    status.sequence.store(sequence + 2, memory_order_release);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// drainClient() - Pops every request in a client's ring, adding up the frames to submit
+//
+// Returns: the number of requests popped
+//=================================================================================================
+uint32_t drainClient(mindydClient_t& client, uint64_t pending[2], bool& refresh)
+{
+    const uint32_t mask = MINDYD_RING_ENTRIES - 1;
+
+    uint64_t pos   = client.head.load(memory_order_relaxed);
+    uint32_t count = 0;
+
+    while (count < MINDYD_RING_ENTRIES)
+    {
+        mindydRequest_t& entry = client.ring[pos & mask];
+
+        // If the client hasn't filled this entry yet, the ring is empty
+        if (entry.sequence.load(memory_order_acquire) != pos + 1) break;
+
+        switch (entry.op)
+        {
+            case MINDYD_SUBMIT:
+                if (entry.phase < 2)
+                {
+                    pending[entry.phase] += entry.count;
+                    client.frames[entry.phase].fetch_add(entry.count, memory_order_relaxed);
+                }
+                break;
+
+            case MINDYD_REFRESH:
+                refresh = true;
+                break;
+
+            case MINDYD_CLEAR_ERRORS:
+                latchedErrors = 0;
+                refresh = true;
+                break;
+        }
+
+        // Make the entry available to the client on its next lap around the ring
+        entry.sequence.store(pos + MINDYD_RING_ENTRIES, memory_order_release);
+        ++pos;
+        ++count;
+    }
+
+    client.head.store(pos, memory_order_relaxed);
+    return count;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reapClients() - Frees the slots of clients that have detached or died
+//=================================================================================================
+void reapClients(bool checkPids)
+{
+    for (uint32_t i = 0; i < MINDYD_MAX_CLIENTS; ++i)
+    {
+        mindydClient_t& client = Shared->client[i];
+
+        uint32_t owner = client.owner.load(memory_order_acquire);
+        if (owner == 0) continue;
+
+        bool gone = client.detaching.load(memory_order_acquire);
+        if (!gone && checkPids) gone = kill(owner, 0) < 0 && errno == ESRCH;
+        if (!gone) continue;
+
+        // Only free the slot once everything the client queued has been submitted.  A client
+        // that died may have claimed an entry that it never filled, so don't wait for "tail"
+        uint64_t head = client.head.load(memory_order_relaxed);
+        if (client.ring[head & (MINDYD_RING_ENTRIES - 1)].sequence.load(memory_order_acquire) == head + 1) continue;
+
+        if (verbose)
+        {
+            printf("Client %u (pid %u) %s after %lu + %lu frames\n", i, owner,
+                   client.detaching ? "detached" : "died", client.frames[0].load(),
+                   client.frames[1].load());
+        }
+
+        resetSlot(client);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// serve() - Sweeps the client rings, rings the doorbells and publishes the status until we're
+//           told to stop
+//=================================================================================================
+void serve()
+{
+    auto     lastStatus = steady_clock::now();
+    auto     lastReap   = lastStatus;
+    uint32_t idleSweeps = 0;
+    uint32_t owners[MINDYD_MAX_CLIENTS] = {};
+
+    while (true)
+    {
+        uint64_t pending[2] = {0, 0};
+        uint32_t drained[MINDYD_MAX_CLIENTS];
+        uint32_t total   = 0;
+        bool     refresh = false;
+
+        // Collect every client's requests
+        for (uint32_t i = 0; i < MINDYD_MAX_CLIENTS; ++i)
+        {
+            mindydClient_t& client = Shared->client[i];
+            uint32_t owner = client.owner.load(memory_order_acquire);
+
+            if (verbose && owner && owner != owners[i]) printf("Client %u is pid %u\n", i, owner);
+            owners[i] = owner;
+
+            drained[i] = owner ? drainClient(client, pending, refresh) : 0;
+            total += drained[i];
+        }
+
+        // Ring each phase's doorbell once.  A single write can't hold more than CMindy::MAX_FRAME_ADD frames
+        for (uint32_t phase = 0; phase < 2; ++phase)
+        {
+            uint64_t remaining = pending[phase];
+            while (remaining)
+            {
+                uint32_t chunk = (remaining > CMindy::MAX_FRAME_ADD) ? CMindy::MAX_FRAME_ADD : (uint32_t)remaining;
+                Mindy.addLocalFrameCounter(phase, chunk);
+                remaining -= chunk;
+            }
+        }
+
+        // Publish the status if a client asked for it or it's due
+        auto now = steady_clock::now();
+        if (refresh || now - lastStatus >= microseconds(statusUs))
+        {
+            publishStatus();
+            lastStatus = now;
+        }
+
+        // Tell each client that its requests have been handled
+        for (uint32_t i = 0; i < MINDYD_MAX_CLIENTS; ++i)
+        {
+            mindydClient_t& client = Shared->client[i];
+            if (drained[i]) client.completed.store(client.head.load(memory_order_relaxed), memory_order_release);
+        }
+
+        // Free the slots of clients that have gone, checking for dead ones every 100 ms
+        bool checkPids = now - lastReap >= milliseconds(100);
+        if (checkPids) lastReap = now;
+        reapClients(checkPids);
+
+        if (total)
+        {
+            idleSweeps = 0;
+            continue;
+        }
+
+        // Once we've been told to stop and every ring is empty, we're done
+        if (stopping) break;
+
+        // Spin for a while, then start sleeping between sweeps
+        if (++idleSweeps < 1000)
+            _mm_pause();
+        else
+            this_thread::sleep_for(microseconds(idleUs));
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// onSignal() - Tells the main loop to finish up
+//=================================================================================================
+void onSignal(int)
+{
+    stopping = 1;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// execute() - Takes ownership of the card and serves clients until we're told to stop
+//=================================================================================================
+void execute()
+{
+    if (emulate)
+    {
+        Emulator.start();
+        Mindy.initEmulated(Emulator);
+        Mindy.setFrameSize(0x10000);
+        Mindy.setPacketSize(4096);
+        Mindy.setPacketsPerGroup(1);
+        Mindy.setHostFrameDataSize(16 * 0x8000);
+        Mindy.setHostMetaDataSize(16 * 128);
+        Mindy.clearLocalFrameCounters();
+    }
+    else
+        Mindy.init(device);
+
+    // Log a line at a time, even when stdout is a file
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    createShared();
+    publishStatus();
+
+    signal(SIGINT,  onSignal);
+    signal(SIGTERM, onSignal);
+
+    printf("mindyd serving %s (pid %u)\n", shmName.c_str(), getpid());
+    fflush(stdout);
+
+    serve();
+
+    shm_unlink(shmName.c_str());
+    munmap(Shared, sizeof(mindydShared_t));
+    Shared = nullptr;
+}
+//=================================================================================================
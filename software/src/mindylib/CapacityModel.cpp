@@ -0,0 +1,215 @@
+//=================================================================================================
+// CapacityModel.cpp - Predicts the throughput of a Mindy configuration without running it
+//=================================================================================================
+#include <cmath>
+#include <stdexcept>
+#include "CapacityModel.h"
+#include "throwRuntime.h"
+
+using namespace std;
+
+// The metadata record that's fetched and sent with each frame
+static const uint32_t METADATA_BYTES = 128;
+
+// The Ethernet, IP, UDP and RDMX headers of an RDMX packet, which rdmx_xmit sends as a beat of
+// its own, and the bytes on the wire that aren't in the packet (FCS, preamble, inter-packet gap)
+static const uint32_t HEADER_BYTES   = 64;
+static const uint32_t FRAMING_BYTES  = 4 + 20;
+
+// A write of the remote frame counter is a minimum-size Ethernet packet
+static const uint32_t FC_WIRE_BYTES  = 64 + 20;
+
+
+//=================================================================================================
+// linkShares() - Works out what fraction of the packets the ping-ponger sends on each link
+//=================================================================================================
+static void linkShares(const CapacityModel::config_t& config, double share[2])
+{
+    switch (config.policy)
+    {
+        // Alternating needs both links and a whole number of groups in each half-frame
+        case CMindy::STEER_ALTERNATE:
+        {
+            uint32_t packets = config.frameSize / config.packetSize;
+            uint32_t group   = config.packetsPerGroup;
+            if (config.links != 3) throwRuntime("STEER_ALTERNATE needs both links");
+            if (group == 0 || packets % (2 * group))
+                throwRuntime("A frame of %u packets can't be split into groups of %u", packets, group);
+            share[0] = share[1] = 0.5;
+            break;
+        }
+
+        // Adaptive steering splits the packets evenly between the usable links
+        case CMindy::STEER_ADAPTIVE:
+            if ((config.links & 3) == 0) throwRuntime("No link is usable");
+            share[0] = ((config.links & 3) == 3) ? 0.5 : (config.links & 1);
+            share[1] = 1 - share[0];
+            break;
+
+        // Weighted steering splits them by weight.  A link with no weight isn't used
+        case CMindy::STEER_WEIGHTED:
+        {
+            double w0 = (config.links & 1) ? config.linkWeights[0] : 0;
+            double w1 = (config.links & 2) ? config.linkWeights[1] : 0;
+            if (w0 + w1 == 0) throwRuntime("No usable link has any weight");
+            share[0] = w0 / (w0 + w1);
+            share[1] = w1 / (w0 + w1);
+            break;
+        }
+
+        default:
+            throwRuntime("Unknown steering policy %u", config.policy);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// predict() - Works out how long each stage is busy with each frame, and from that the most
+//             frames per second the card can carry
+//=================================================================================================
+CapacityModel::result_t CapacityModel::predict(const config_t& config, double framesPerSec)
+{
+    uint32_t frameSize  = config.frameSize;
+    uint32_t packetSize = config.packetSize;
+
+    // The same checks the card and CMindy make
+    if (frameSize < 4096 || (frameSize & (frameSize - 1)))
+        throwRuntime("frame size %u isn't a power of 2 of at least 4096", frameSize);
+
+    if (packetSize == 0 || packetSize % 64 || packetSize > params_.maxPacketSize)
+        throwRuntime("packet size %u isn't a multiple of 64 no larger than %u", packetSize,
+                     params_.maxPacketSize);
+
+    if (frameSize % packetSize)
+        throwRuntime("packet size %u doesn't divide the frame size evenly", packetSize);
+
+    uint32_t packets = frameSize / packetSize;
+    double   beat    = params_.pcieBits / 8;
+
+    // In delta mode, only the packets that changed are fetched and sent, and each one is
+    // fetched in bursts of its own
+    double   sent   = packets;
+    double   bursts = (double)frameSize / params_.burstBytes;
+    if (config.deltaMode)
+    {
+        if (config.policy == CMindy::STEER_ALTERNATE) throwRuntime("Delta mode can't use STEER_ALTERNATE");
+        if (packets > 512 || (frameSize / 2) % packetSize)
+            throwRuntime("Delta mode needs no more than 512 packets and a whole number per semiphase");
+        sent   = max(1.0, round(packets * config.deltaDirty));
+        bursts = sent * ceil((double)packetSize / params_.burstBytes);
+    }
+    double dataBytes = sent * packetSize;
+
+    double share[2];
+    linkShares(config, share);
+
+    // Every frame sends its metadata on both links, and a frame-counter write every
+    // "fcCoalesce" frames, or every frame when the streams take turns
+    double fcWrites = (config.streams > 1 || config.fcCoalesce <= 1) ? 1.0 : 1.0 / config.fcCoalesce;
+
+    result_t result;
+    result.targetFramesPerSec = framesPerSec;
+
+    // Reading the frame and its metadata from host RAM
+    double pcieBps = params_.pcieGBps * 1e9;
+    result.stages.push_back({"PCIe read", (dataBytes + METADATA_BYTES) / pcieBps
+                           + bursts * params_.burstOverheadNs * 1e-9 + params_.fetchOverheadUs * 1e-6, 0});
+
+    // Moving it through data_fetch a beat at a time
+    result.stages.push_back({"data_fetch", ceil((dataBytes + METADATA_BYTES) / beat) / params_.clockHz, 0});
+
+    for (uint32_t link = 0; link < 2; ++link)
+    {
+        if (share[link] == 0) continue;
+
+        double linkPackets = sent * share[link];
+        double dataBeats   = linkPackets * ceil(packetSize / beat);
+        double mdBeats     = METADATA_BYTES / beat;
+        string suffix      = " " + to_string(link);
+
+        // The rdmx_shim writes the packets, the metadata and the frame counter
+        result.stages.push_back({"rdmx_shim" + suffix, (dataBeats + mdBeats + fcWrites) / params_.clockHz, 0});
+
+        // The rdmx_xmit puts a header beat in front of each of those packets
+        double xmitBeats = dataBeats + linkPackets + mdBeats + 1 + 2 * fcWrites;
+        result.stages.push_back({"rdmx_xmit" + suffix, xmitBeats / params_.cmacClockHz, 0});
+
+        // And the link carries them with their framing
+        double wireBytes = linkPackets * (packetSize + HEADER_BYTES + FRAMING_BYTES)
+                         + (METADATA_BYTES + HEADER_BYTES + FRAMING_BYTES)
+                         + fcWrites * FC_WIRE_BYTES;
+        result.stages.push_back({"link" + suffix, wireBytes * 8 / (params_.linkGbps * 1e9), 0});
+    }
+
+    // The stages are pipelined, so the slowest one sets the pace
+    double slowest = 0;
+    for (auto& stage : result.stages)
+    {
+        stage.utilization = stage.secondsPerFrame * framesPerSec;
+        if (stage.secondsPerFrame > slowest)
+        {
+            slowest           = stage.secondsPerFrame;
+            result.bottleneck = stage.name;
+        }
+    }
+
+    result.maxFramesPerSec = 1 / slowest;
+    result.maxGBps         = result.maxFramesPerSec * frameSize / 1e9;
+    result.fits            = framesPerSec < result.maxFramesPerSec;
+    return result;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// impliedPcieGBps() - Works backwards from a measured frame rate to the host read bandwidth,
+//                     assuming the PCIe read was the bottleneck
+//=================================================================================================
+double CapacityModel::impliedPcieGBps(const config_t& config, double measuredFramesPerSec)
+{
+    if (measuredFramesPerSec <= 0) throwRuntime("bad parameter on impliedPcieGBps()");
+
+    // The PCIe read stage is "bytes / bandwidth + fixed", so predict it at two bandwidths
+    // and solve for the one that gives the measured time
+    params_t saved = params_;
+    params_.pcieGBps = 1;
+    double atOne = predict(config).stages[0].secondsPerFrame;
+    params_.pcieGBps = 2;
+    double atTwo = predict(config).stages[0].secondsPerFrame;
+    params_ = saved;
+
+    double perByte = 2 * (atOne - atTwo);
+    double fixed   = atOne - perByte;
+    double seconds = 1 / measuredFramesPerSec - fixed;
+    return (seconds > 0) ? perByte / seconds : 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// readConfig() - Returns the configuration the card is set up with now
+//=================================================================================================
+CapacityModel::config_t CapacityModel::readConfig(CMindy& mindy)
+{
+    config_t config;
+    uint32_t timeoutUs;
+
+    config.frameSize       = mindy.getFrameSize();
+    config.packetSize      = mindy.getPacketSize();
+    config.packetsPerGroup = mindy.getPacketsPerGroup();
+    config.policy          = mindy.getSteeringPolicy();
+    config.links           = mindy.getQsfpStatus() & mindy.getLinkEnable() & 3;
+    config.deltaMode       = mindy.getDeltaMode();
+    mindy.getFrameCounterCoalescing(&config.fcCoalesce, &timeoutUs);
+
+    uint32_t weights = mindy.read32(MindyReg::RS_LINK_WEIGHTS::offset);
+    config.linkWeights[0] = weights & 0xFF;
+    config.linkWeights[1] = (weights >> 8) & 0xFF;
+
+    // STEER_ALTERNATE uses both links whether they're enabled or not
+    if (config.policy == CMindy::STEER_ALTERNATE) config.links = mindy.getQsfpStatus() & 3;
+
+    return config;
+}
+//=================================================================================================
@@ -0,0 +1,121 @@
+//=================================================================================================
+// CapacityModel.h - Predicts the throughput of a Mindy configuration without running it
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mindy.h"
+
+/*
+    The model follows a frame through each stage of the card and works out how long each stage
+    is busy with it.  The stages are pipelined, so the card can't carry more frames per second
+    than the reciprocal of the slowest stage, which is the bottleneck:
+
+        PCIe read       data_fetch reads the frame from host RAM through the XDMA in bursts of
+                        AXI_BURST_SIZE bytes (one burst per packet in delta mode), plus the
+                        128-byte metadata record, at the sustained read bandwidth of the host
+        data_fetch      The same bytes, one PCIE_BITS beat per clock
+        rdmx_shim N     The link's share of the packets, one beat per clock, plus the metadata
+                        and the frame-counter writes
+        rdmx_xmit N     The same packets with a 64-byte RDMX header beat in front of each, at
+                        the CMAC's clock
+        link N          The same packets on the wire: the payload, the 64 bytes of Ethernet,
+                        IP, UDP and RDMX header, the FCS, the preamble and the inter-packet gap
+
+    The packets are divided between the links the way the ping-ponger steers them, and every
+    frame sends its metadata and (every "fcCoalesce" frames) a frame-counter write on both
+    links.  When the card carries more than one stream, the rdmx_shims write the frame counter
+    each time the stream changes, so coalescing is assumed to save nothing.
+
+    The fixed parameters of the RTL (params_t) default to the values in the source; the read
+    bandwidth of the host is the one number that has to come from a measurement.  Comparing
+    a prediction against StreamTuner::measure() on the same configuration (see "mindyctl
+    model -measure") is how to check the model, and when the PCIe read is the bottleneck,
+    how to find the bandwidth (see impliedPcieGBps()).
+
+    The model hasn't been checked against the hardware yet.  MindyEmulator is built on the same
+    kind of throughput model, so a prediction that agrees with a measurement of an emulated
+    card says only that the two models are consistent, not that either one is right.
+
+        CapacityModel model;
+        auto config = CapacityModel::readConfig(Mindy);
+        auto result = model.predict(config, 2000);
+        printf("%s limits us to %.0f frames/s\n", result.bottleneck.c_str(), result.maxFramesPerSec);
+*/
+
+class CapacityModel
+{
+public:
+
+    // The fixed characteristics of the RTL, the host and the network
+    struct params_t
+    {
+        double      clockHz         = 250e6;        // Clock of data_fetch and the rdmx_shims
+        double      cmacClockHz     = 322.265625e6; // Clock of rdmx_xmit's output side
+        uint32_t    pcieBits        = 512;          // PCIE_BITS in data_fetch
+        uint32_t    burstBytes      = 2048;         // AXI_BURST_SIZE in data_fetch
+        double      pcieGBps        = 12.0;         // Sustained XDMA read bandwidth from host RAM
+        double      burstOverheadNs = 0;            // Extra cost of each burst, on hosts that
+                                                    // are slower at short reads
+        double      fetchOverheadUs = 1.0;          // Per-frame cost of the metadata read
+        double      linkGbps        = 100.0;        // Line rate of each QSFP link
+        uint32_t    maxPacketSize   = 16384;        // Largest PACKET_SIZE the card supports
+    };
+
+    // The configuration of the card being modeled
+    struct config_t
+    {
+        uint32_t    frameSize       = 4 * 1024 * 1024;
+        uint32_t    packetSize      = 8192;
+        uint32_t    packetsPerGroup = 1;
+        CMindy::steerPolicy_t policy = CMindy::STEER_ALTERNATE;
+        uint32_t    linkWeights[2]  = {1, 1};       // Only used by STEER_WEIGHTED
+        uint32_t    links           = 3;            // Links that are up and enabled
+        uint32_t    fcCoalesce      = 1;            // Frames per remote frame-counter write
+        uint32_t    streams         = 1;            // Streams taking turns on the card
+        double      deltaDirty      = 1.0;          // In delta mode, the fraction of packets sent
+        bool        deltaMode       = false;
+    };
+
+    // How busy one stage of the card is with each frame
+    struct stage_t
+    {
+        std::string name;
+        double      secondsPerFrame;
+        double      utilization;        // At the target rate, or 0 if there isn't one
+    };
+
+    // The prediction for a configuration
+    struct result_t
+    {
+        std::vector<stage_t> stages;
+        std::string bottleneck;         // The name of the slowest stage
+        double      maxFramesPerSec;
+        double      maxGBps;            // Frame data delivered per second at maxFramesPerSec
+        double      targetFramesPerSec; // 0 if there's no target
+        bool        fits;               // True if the target rate is less than the maximum
+    };
+
+    // Constructors, for the default parameters or the specified ones
+    CapacityModel() {}
+    CapacityModel(const params_t& params) : params_(params) {}
+
+    // Predicts the maximum frame rate of a configuration, and whether it can sustain
+    // "framesPerSec" (if it isn't 0).  Throws if the card couldn't run the configuration
+    result_t    predict(const config_t& config, double framesPerSec = 0);
+
+    // Returns the read bandwidth that would make the PCIe read stage of "config" take exactly
+    // as long as a frame did when measured at "measuredFramesPerSec"
+    double      impliedPcieGBps(const config_t& config, double measuredFramesPerSec);
+
+    // Returns the configuration the card is set up with now.  "streams" is left at 1
+    static config_t readConfig(CMindy& mindy);
+
+    // Returns the parameters of the model
+    const params_t& params() {return params_;}
+
+protected:
+
+    params_t    params_;
+};
@@ -0,0 +1,266 @@
+//=================================================================================================
+// DescriptorRing.cpp - Builds the scatter-gather descriptor rings that Mindy fetches frames through
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <stdexcept>
+#include <atomic>
+#include <sys/mman.h>
+#include "DescriptorRing.h"
+#include "throwRuntime.h"
+using namespace std;
+
+// The size of a host memory page
+static const uint32_t PAGE_BYTES = 4096;
+
+// The largest semiphase we support is one whose page-list fits into a single page
+static const uint32_t MAX_SEMIPHASE_PAGES = PAGE_BYTES / sizeof(uint64_t);
+
+// Size of the metadata record that Mindy fetches for every frame
+static const uint32_t METADATA_BYTES = 128;
+
+//=================================================================================================
+// pin() - Locks a buffer into RAM and touches every page of it so that every page has a
+//         physical address before we ask for it
+//=================================================================================================
+void DescriptorRing::pin(void* buffer, size_t size)
+{
+    // Lock the buffer into RAM
+    if (mlock(buffer, size) < 0) throwRuntime("mlock failed on %p for size 0x%lx", buffer, size);
+
+    // Ask the kernel not to back this buffer with transparent huge-pages that it may
+    // later want to split or collapse
+    madvise(buffer, size, MADV_NOHUGEPAGE);
+
+    // Touch every page of the buffer so it is faulted in
+    volatile uint8_t* p = (volatile uint8_t*)buffer;
+    for (size_t offset = 0; offset < size; offset += PAGE_BYTES) p[offset] = p[offset];
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// getPhysPages() - Fills "result" with the physical address of each page in a buffer
+//
+// Passed: buffer    = Page-aligned userspace address
+//         pageCount = The number of pages to look up
+//         result    = Where to store the physical address of each page
+//=================================================================================================
+void DescriptorRing::getPhysPages(const void* buffer, size_t pageCount, uint64_t* result)
+{
+    // Each entry in /proc/self/pagemap is 64 bits, one entry per virtual page
+    off_t offset = ((uintptr_t)buffer / PAGE_BYTES) * sizeof(uint64_t);
+
+    // Fetch the entries for all of the pages in a single read
+    ssize_t byteCount = pageCount * sizeof(uint64_t);
+    if (pread(pagemap_, result, byteCount, offset) != byteCount)
+        throwRuntime("Can't read /proc/self/pagemap");
+
+    // Convert each pagemap entry into a physical address
+    for (size_t i = 0; i < pageCount; ++i)
+    {
+        // Bit 63 = "page present", bits 0 thru 54 are the page-frame number
+        uint64_t entry = result[i];
+        uint64_t pfn   = entry & ((1ULL << 55) - 1);
+
+        // If the page isn't present or we aren't privileged enough to see the PFN, complain
+        if ((entry >> 63) == 0 || pfn == 0)
+            throwRuntime("No physical page for %p (is the buffer pinned?)", (uint8_t*)buffer + i * PAGE_BYTES);
+
+        result[i] = pfn * PAGE_BYTES;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// getPhysAddr() - Returns the physical address of a byte of memory
+//=================================================================================================
+uint64_t DescriptorRing::getPhysAddr(const void* ptr)
+{
+    uint64_t physPage;
+
+    // Find the address of the page that contains the byte
+    uintptr_t virtPage = (uintptr_t)ptr & ~(uintptr_t)(PAGE_BYTES - 1);
+
+    // Look up the physical address of that page
+    getPhysPages((const void*)virtPage, 1, &physPage);
+
+    // And add in the offset of the byte within the page
+    return physPage + ((uintptr_t)ptr & (PAGE_BYTES - 1));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// init() - Allocates the descriptor rings and page-lists, and programs Mindy to use them
+//
+// Mindy must already have been told the frame size
+//=================================================================================================
+void DescriptorRing::init(CMindy& mindy)
+{
+    // If we're already initialized, release our resources
+    close();
+
+    // Keep track of the Mindy that we're building descriptors for
+    mindy_ = &mindy;
+
+    // Find out how large a semiphase is
+    uint32_t frameSize = mindy.getFrameSize();
+    semiphaseBytes_ = frameSize / 2;
+    semiphasePages_ = (semiphaseBytes_ + PAGE_BYTES - 1) / PAGE_BYTES;
+
+    // Make sure the frame size is one we can describe
+    if (frameSize < 4096 || (frameSize & (frameSize - 1)))
+        throwRuntime("Frame size %u is not a power of 2 >= 4096", frameSize);
+    if (semiphasePages_ > MAX_SEMIPHASE_PAGES)
+        throwRuntime("Frame size %u is too large for scatter-gather mode", frameSize);
+
+    // We need /proc/self/pagemap to translate virtual addresses to physical addresses
+    pagemap_ = ::open("/proc/self/pagemap", O_RDONLY);
+    if (pagemap_ < 0) throwRuntime("Can't open /proc/self/pagemap");
+
+    // Each phase needs a page for the ring and a page for each of its page-lists
+    const size_t pagesPerPhase = 1 + 2 * ENTRIES;
+    memorySize_ = 2 * pagesPerPhase * PAGE_BYTES;
+
+    // Allocate the memory for both phases
+    void* ptr = mmap(0, memorySize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) throwRuntime("Can't allocate 0x%lx bytes for descriptor rings", memorySize_);
+    memory_ = (uint8_t*)ptr;
+
+    // Make sure every page of it is resident and stays resident
+    memset(memory_, 0, memorySize_);
+    pin(memory_, memorySize_);
+
+    // Carve up the memory into rings and page-lists, and look up their physical addresses
+    for (int phase = 0; phase < 2; ++phase)
+    {
+        ring_t&  ring = ring_[phase];
+        uint8_t* base = memory_ + phase * pagesPerPhase * PAGE_BYTES;
+        ring.desc     = (descriptor_t*)base;
+        ring.pageList = (uint64_t*)(base + PAGE_BYTES);
+        ring.descPhys = getPhysAddr(ring.desc);
+
+        for (uint32_t slot = 0; slot < ENTRIES; ++slot)
+        {
+            ring.pageListPhys[slot][0] = getPhysAddr(base + (1 + 2*slot + 0) * PAGE_BYTES);
+            ring.pageListPhys[slot][1] = getPhysAddr(base + (1 + 2*slot + 1) * PAGE_BYTES);
+        }
+    }
+
+    // Our sequence numbers start over at the same place Mindy's do
+    reset();
+
+    // Point Mindy at the descriptor rings and turn on scatter-gather mode
+    mindy.setHostDescRingAddr(0, ring_[0].descPhys);
+    mindy.setHostDescRingAddr(1, ring_[1].descPhys);
+    mindy.setHostDescRingSize(ENTRIES * sizeof(descriptor_t));
+    mindy.setDescriptorMode(true);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reset() - Starts the rings over at slot 0 and sequence number 1.  Mindy does the same
+//           thing when it is reset by CMindy::clearLocalFrameCounters()
+//=================================================================================================
+void DescriptorRing::reset()
+{
+    for (auto& ring : ring_)
+    {
+        // Make sure there are no descriptors in the ring that Mindy might mistake for valid
+        if (memory_) memset(ring.desc, 0, ENTRIES * sizeof(descriptor_t));
+        ring.slot     = 0;
+        ring.sequence = 1;
+        ring.fetched  = 0;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// post() - Fills in the next descriptor in the ring for the specified phase
+//
+// Passed: phase      = 0 or 1
+//         semiphase0 = 4K aligned buffer containing the first half of the frame
+//         semiphase1 = 4K aligned buffer containing the second half of the frame
+//         metadata   = 128-byte aligned, 128-byte metadata record
+//
+// Returns: false if every descriptor in the ring is still waiting for Mindy to fetch its frame
+//=================================================================================================
+bool DescriptorRing::post(uint32_t phase, const void* semiphase0, const void* semiphase1, const void* metadata)
+{
+    if (memory_ == nullptr) throwRuntime("DescriptorRing::post() called before init()");
+    if (phase > 1) throwRuntime("bad parameter on DescriptorRing::post()");
+
+    // Check the alignment of the caller's buffers
+    if (((uintptr_t)semiphase0 | (uintptr_t)semiphase1) & (PAGE_BYTES - 1))
+        throwRuntime("Semiphase buffers must be 4K aligned");
+    if ((uintptr_t)metadata & (METADATA_BYTES - 1))
+        throwRuntime("Metadata records must be %u-byte aligned", METADATA_BYTES);
+
+    // Get a handy reference to the ring for this phase
+    ring_t& ring = ring_[phase];
+
+    // The number of descriptors we've posted is one less than the next sequence number.  If
+    // the last fetched-frame count we read says the ring is full, find out where Mindy is now
+    uint32_t posted = ring.sequence - 1;
+    if (posted - ring.fetched >= ENTRIES)
+    {
+        ring.fetched = mindy_->getFetchedFrameCount(phase);
+        if (posted - ring.fetched >= ENTRIES) return false;
+    }
+
+    // Find the page-lists that belong to this descriptor slot
+    uint64_t* pageList0 = ring.pageList + (2*ring.slot + 0) * MAX_SEMIPHASE_PAGES;
+    uint64_t* pageList1 = ring.pageList + (2*ring.slot + 1) * MAX_SEMIPHASE_PAGES;
+
+    // Fill in the page-lists with the physical address of every page of the frame
+    getPhysPages(semiphase0, semiphasePages_, pageList0);
+    getPhysPages(semiphase1, semiphasePages_, pageList1);
+
+    // Fill in the descriptor.  The sequence number must be written last
+    descriptor_t& desc = ring.desc[ring.slot];
+    desc.mdAddr      = getPhysAddr(metadata);
+    desc.pageList[0] = ring.pageListPhys[ring.slot][0];
+    desc.pageList[1] = ring.pageListPhys[ring.slot][1];
+    atomic_thread_fence(memory_order_release);
+    desc.sequence    = ring.sequence;
+
+    // Make sure the descriptor is in RAM before anyone rings Mindy's doorbell
+    atomic_thread_fence(memory_order_release);
+
+    // And advance to the next descriptor
+    ring.sequence++;
+    if (++ring.slot == ENTRIES) ring.slot = 0;
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// submit() - Posts a descriptor and tells Mindy to fetch the frame it describes
+//=================================================================================================
+bool DescriptorRing::submit(uint32_t phase, const void* semiphase0, const void* semiphase1, const void* metadata)
+{
+    if (!post(phase, semiphase0, semiphase1, metadata)) return false;
+    mindy_->incrementLocalFrameCounter(phase);
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// close() - Releases the memory that holds the rings and page-lists
+//=================================================================================================
+void DescriptorRing::close()
+{
+    if (memory_) munmap(memory_, memorySize_);
+    if (pagemap_ >= 0) ::close(pagemap_);
+    memory_  = nullptr;
+    pagemap_ = -1;
+    mindy_   = nullptr;
+}
+//=================================================================================================
@@ -0,0 +1,109 @@
+//=================================================================================================
+// DescriptorRing.h - Builds the scatter-gather descriptor rings that Mindy fetches frames through
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "mindy.h"
+
+/*
+    In scatter-gather mode, Mindy doesn't fetch frames from physically contiguous HFD/HMD
+    buffers.  Instead, each phase has a ring of 64-byte descriptors in host RAM, and each
+    descriptor points to the metadata record and to a page-list for each semiphase.  A
+    page-list is an array of the physical addresses of the 4K pages of a semiphase.
+
+    This means frames can live in ordinary (pinned) user-space memory:
+
+        - Each semiphase buffer must be 4K aligned and FRAME_SIZE/2 bytes long
+        - Each 128-byte metadata record must be 128-byte aligned
+        - Every buffer must be pinned (see pin()) before it is posted
+
+    A ring holds ENTRIES descriptors per phase.  A descriptor can't be reused until Mindy
+    has fetched the frame it describes, so post() and submit() return false, without
+    touching the ring, when ENTRIES frames of that phase are still waiting to be fetched.
+
+    Note: mlock() keeps pages resident, but the kernel can still migrate them during
+    memory compaction unless vm.compact_unevictable_allowed = 0
+*/
+
+class DescriptorRing
+{
+public:
+
+    // The number of descriptors in the ring for each phase.  A ring is exactly one 4K page
+    static const uint32_t ENTRIES = 64;
+
+    // Default constructor
+    DescriptorRing() {};
+
+    // Destructor
+    ~DescriptorRing() {close();}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    DescriptorRing (const DescriptorRing&) = delete;
+    DescriptorRing& operator= (const DescriptorRing&) = delete;
+
+    // Allocates the rings and page-lists, and switches Mindy into scatter-gather mode
+    void    init(CMindy& mindy);
+
+    // Locks a buffer into RAM and faults in every page of it
+    static void pin(void* buffer, size_t size);
+
+    // Fills in the next descriptor for the specified phase.  Returns false if the ring is full
+    bool    post(uint32_t phase, const void* semiphase0, const void* semiphase1, const void* metadata);
+
+    // Posts a descriptor and then tells Mindy to fetch that frame.  Returns false if the ring is full
+    bool    submit(uint32_t phase, const void* semiphase0, const void* semiphase1, const void* metadata);
+
+    // Call this after CMindy::clearLocalFrameCounters() to re-synchronize with Mindy
+    void    reset();
+
+    // Releases the rings and page-lists
+    void    close();
+
+protected:
+
+    // This is the layout of a descriptor in host RAM, as Mindy expects to find it
+    struct descriptor_t
+    {
+        uint64_t    mdAddr;
+        uint64_t    pageList[2];
+        uint32_t    sequence;
+        uint8_t     reserved[36];
+    };
+
+    // Each phase has a ring of descriptors and two page-lists per descriptor
+    struct ring_t
+    {
+        descriptor_t* desc;
+        uint64_t*     pageList;
+        uint64_t      descPhys;
+        uint64_t      pageListPhys[ENTRIES][2];
+        uint32_t      slot;
+        uint32_t      sequence;
+        uint32_t      fetched;
+    };
+
+    // Fills "result" with the physical address of each 4K page in a buffer
+    void        getPhysPages(const void* buffer, size_t pageCount, uint64_t* result);
+
+    // Returns the physical address of a single byte of memory
+    uint64_t    getPhysAddr(const void* ptr);
+
+    // The Mindy device that we're building descriptors for
+    CMindy*     mindy_ = nullptr;
+
+    // The host-RAM that holds the two rings and all of their page-lists
+    uint8_t*    memory_ = nullptr;
+    size_t      memorySize_ = 0;
+
+    // Number of bytes in a semiphase, and the number of 4K pages in a semiphase
+    uint32_t    semiphaseBytes_ = 0;
+    uint32_t    semiphasePages_ = 0;
+
+    // File descriptor for /proc/self/pagemap
+    int         pagemap_ = -1;
+
+    // One ring per phase
+    ring_t      ring_[2];
+};
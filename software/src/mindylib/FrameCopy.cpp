@@ -0,0 +1,303 @@
+//=================================================================================================
+// FrameCopy.cpp - Cache-bypassing routines for copying frames into (and filling) DMA buffers
+//=================================================================================================
+#include <cstring>
+#include <stdexcept>
+#include <immintrin.h>
+#include "FrameCopy.h"
+#include "throwRuntime.h"
+using namespace std;
+
+// Size of a cache-line, and of a line of the test pattern
+static const size_t LINE_BYTES = 64;
+
+//=================================================================================================
+// copyHead() - Copies with ordinary stores until "dst" is aligned to "alignment".  Adjusts dst,
+//              src, and bytes to account for what was copied
+//=================================================================================================
+static void copyHead(uint8_t*& dst, const uint8_t*& src, size_t& bytes, size_t alignment)
+{
+    size_t misalignment = (uintptr_t)dst & (alignment - 1);
+    if (misalignment == 0) return;
+
+    size_t count = alignment - misalignment;
+    if (count > bytes) count = bytes;
+    memcpy(dst, src, count);
+    dst   += count;
+    src   += count;
+    bytes -= count;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// streamCopySse2() - Streaming copy using 16-byte stores.  Every x86-64 CPU has SSE2
+//=================================================================================================
+static void streamCopySse2(void* dstBuffer, const void* srcBuffer, size_t bytes)
+{
+    uint8_t*       dst = (uint8_t*)dstBuffer;
+    const uint8_t* src = (const uint8_t*)srcBuffer;
+
+    copyHead(dst, src, bytes, 16);
+
+    while (bytes >= 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src +  0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+        _mm_stream_si128((__m128i*)(dst +  0), a);
+        _mm_stream_si128((__m128i*)(dst + 16), b);
+        _mm_stream_si128((__m128i*)(dst + 32), c);
+        _mm_stream_si128((__m128i*)(dst + 48), d);
+        src   += 64;
+        dst   += 64;
+        bytes -= 64;
+    }
+
+    memcpy(dst, src, bytes);
+    _mm_sfence();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// streamCopyAvx2() - Streaming copy using 32-byte stores
+//=================================================================================================
+__attribute__((target("avx2")))
+static void streamCopyAvx2(void* dstBuffer, const void* srcBuffer, size_t bytes)
+{
+    uint8_t*       dst = (uint8_t*)dstBuffer;
+    const uint8_t* src = (const uint8_t*)srcBuffer;
+
+    copyHead(dst, src, bytes, 32);
+
+    while (bytes >= 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src +  0));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + 96));
+        _mm256_stream_si256((__m256i*)(dst +  0), a);
+        _mm256_stream_si256((__m256i*)(dst + 32), b);
+        _mm256_stream_si256((__m256i*)(dst + 64), c);
+        _mm256_stream_si256((__m256i*)(dst + 96), d);
+        src   += 128;
+        dst   += 128;
+        bytes -= 128;
+    }
+
+    memcpy(dst, src, bytes);
+    _mm_sfence();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// streamCopyAvx512() - Streaming copy using 64-byte (full cache-line) stores
+//=================================================================================================
+__attribute__((target("avx512f")))
+static void streamCopyAvx512(void* dstBuffer, const void* srcBuffer, size_t bytes)
+{
+    uint8_t*       dst = (uint8_t*)dstBuffer;
+    const uint8_t* src = (const uint8_t*)srcBuffer;
+
+    copyHead(dst, src, bytes, 64);
+
+    while (bytes >= 256)
+    {
+        __m512i a = _mm512_loadu_si512(src +   0);
+        __m512i b = _mm512_loadu_si512(src +  64);
+        __m512i c = _mm512_loadu_si512(src + 128);
+        __m512i d = _mm512_loadu_si512(src + 192);
+        _mm512_stream_si512((__m512i*)(dst +   0), a);
+        _mm512_stream_si512((__m512i*)(dst +  64), b);
+        _mm512_stream_si512((__m512i*)(dst + 128), c);
+        _mm512_stream_si512((__m512i*)(dst + 192), d);
+        src   += 256;
+        dst   += 256;
+        bytes -= 256;
+    }
+
+    memcpy(dst, src, bytes);
+    _mm_sfence();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// fillSse2() - Writes "lines" lines of the test pattern with 16-byte streaming stores
+//=================================================================================================
+static void fillSse2(uint8_t* dst, size_t lines, uint32_t counter, uint32_t frameNumber, uint32_t phase)
+{
+    __m128i head = _mm_set_epi32(0, phase, frameNumber, counter);
+    __m128i one  = _mm_set_epi32(0, 0, 0, 1);
+    __m128i zero = _mm_setzero_si128();
+
+    while (lines--)
+    {
+        _mm_stream_si128((__m128i*)(dst +  0), head);
+        _mm_stream_si128((__m128i*)(dst + 16), zero);
+        _mm_stream_si128((__m128i*)(dst + 32), zero);
+        _mm_stream_si128((__m128i*)(dst + 48), zero);
+        head = _mm_add_epi32(head, one);
+        dst += LINE_BYTES;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// fillAvx2() - Writes "lines" lines of the test pattern with 32-byte streaming stores
+//=================================================================================================
+__attribute__((target("avx2")))
+static void fillAvx2(uint8_t* dst, size_t lines, uint32_t counter, uint32_t frameNumber, uint32_t phase)
+{
+    __m256i head = _mm256_set_epi32(0, 0, 0, 0, 0, phase, frameNumber, counter);
+    __m256i one  = _mm256_set_epi32(0, 0, 0, 0, 0, 0, 0, 1);
+    __m256i zero = _mm256_setzero_si256();
+
+    while (lines--)
+    {
+        _mm256_stream_si256((__m256i*)(dst +  0), head);
+        _mm256_stream_si256((__m256i*)(dst + 32), zero);
+        head = _mm256_add_epi32(head, one);
+        dst += LINE_BYTES;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// fillAvx512() - Writes "lines" lines of the test pattern with 64-byte streaming stores
+//=================================================================================================
+__attribute__((target("avx512f")))
+static void fillAvx512(uint8_t* dst, size_t lines, uint32_t counter, uint32_t frameNumber, uint32_t phase)
+{
+    __m512i line = _mm512_set_epi32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, phase, frameNumber, counter);
+    __m512i one  = _mm512_set_epi32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1);
+
+    while (lines--)
+    {
+        _mm512_stream_si512((__m512i*)dst, line);
+        line = _mm512_add_epi32(line, one);
+        dst += LINE_BYTES;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// The implementation we use is chosen once, at program startup, based on what the CPU has
+//=================================================================================================
+typedef void (*copyFunc_t)(void*, const void*, size_t);
+typedef void (*fillFunc_t)(uint8_t*, size_t, uint32_t, uint32_t, uint32_t);
+
+static struct dispatch_t
+{
+    copyFunc_t  copy;
+    fillFunc_t  fill;
+    const char* name;
+
+    dispatch_t()
+    {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            copy = streamCopyAvx512;
+            fill = fillAvx512;
+            name = "AVX-512";
+        }
+        else if (__builtin_cpu_supports("avx2"))
+        {
+            copy = streamCopyAvx2;
+            fill = fillAvx2;
+            name = "AVX2";
+        }
+        else
+        {
+            copy = streamCopySse2;
+            fill = fillSse2;
+            name = "SSE2";
+        }
+    }
+} dispatch;
+//=================================================================================================
+
+
+//=================================================================================================
+// streamCopy() - Copies a buffer with streaming stores
+//=================================================================================================
+void streamCopy(void* dst, const void* src, size_t bytes)
+{
+    dispatch.copy(dst, src, bytes);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// splitFrame() - Copies the first half of a frame into semiphase0 and the second half into
+//                semiphase1
+//=================================================================================================
+void splitFrame(void* semiphase0, void* semiphase1, const void* frame, size_t frameBytes)
+{
+    size_t semiphaseBytes = frameBytes / 2;
+    dispatch.copy(semiphase0, frame, semiphaseBytes);
+    dispatch.copy(semiphase1, (const uint8_t*)frame + semiphaseBytes, semiphaseBytes);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// fillPattern() - Fills both semiphases of a frame with the test pattern.  The line counter
+//                 continues from the end of semiphase 0 into semiphase 1
+//=================================================================================================
+void fillPattern(void* semiphase0, void* semiphase1, size_t semiphaseBytes,
+                 uint32_t frameNumber, uint32_t phase, uint32_t firstData)
+{
+    if (((uintptr_t)semiphase0 | (uintptr_t)semiphase1 | semiphaseBytes) & (LINE_BYTES - 1))
+        throwRuntime("fillPattern() requires 64-byte aligned buffers and sizes");
+
+    size_t lines = semiphaseBytes / LINE_BYTES;
+    dispatch.fill((uint8_t*)semiphase0, lines, firstData,         frameNumber, phase);
+    dispatch.fill((uint8_t*)semiphase1, lines, firstData + lines, frameNumber, phase);
+    _mm_sfence();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// checkPattern() - Counts the lines of a frame that don't match the test pattern
+//=================================================================================================
+size_t checkPattern(const void* frame, size_t frameBytes, uint32_t frameNumber,
+                    uint32_t phase, uint32_t firstData)
+{
+    const uint8_t* p = (const uint8_t*)frame;
+    size_t lines     = frameBytes / LINE_BYTES;
+    size_t errors    = 0;
+
+    uint32_t expected[LINE_BYTES / 4] = {0};
+    expected[1] = frameNumber;
+    expected[2] = phase;
+
+    for (size_t i = 0; i < lines; ++i)
+    {
+        expected[0] = firstData + i;
+        if (memcmp(p, expected, LINE_BYTES)) ++errors;
+        p += LINE_BYTES;
+    }
+
+    return errors;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// streamCopyImpl() - Returns the name of the instruction set in use
+//=================================================================================================
+const char* streamCopyImpl()
+{
+    return dispatch.name;
+}
+//=================================================================================================
@@ -0,0 +1,42 @@
+//=================================================================================================
+// FrameCopy.h - Cache-bypassing routines for copying frames into (and filling) DMA buffers
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Frame data that is written into the host frame-data buffers is read out by Mindy over PCIe
+    and never touched by the CPU again.  Writing it with ordinary stores drags every destination
+    cache-line into the cache and evicts the caller's working set.  The routines here write
+    with non-temporal (streaming) stores, using AVX-512 or AVX2 when the CPU has them.
+
+    Every routine ends with a store fence, so the data is globally visible by the time the
+    routine returns and the frame counter may be written immediately afterwards.
+
+    The test pattern is the host equivalent of the one that src/temp/fill_ram.v writes: every
+    64-byte line of a frame begins with a 32-bit counter that increments from line to line.
+    So that a receiver can tell which frame a line came from, the second 32-bit word of each
+    line is the frame number and the third is the phase.  The remainder of the line is zero.
+*/
+
+// The first value of the test-pattern counter, the same as fill_ram.v's default
+const uint32_t PATTERN_FIRST_DATA = 0xC0000000;
+
+// Copies a buffer using streaming stores
+void        streamCopy(void* dst, const void* src, size_t bytes);
+
+// Copies a contiguous frame into its two semiphase buffers using streaming stores
+void        splitFrame(void* semiphase0, void* semiphase1, const void* frame, size_t frameBytes);
+
+// Fills a frame's two semiphase buffers with the test pattern, using streaming stores
+void        fillPattern(void* semiphase0, void* semiphase1, size_t semiphaseBytes,
+                        uint32_t frameNumber, uint32_t phase, uint32_t firstData = PATTERN_FIRST_DATA);
+
+// Checks a contiguous frame against the test pattern.  Returns the number of 64-byte lines
+// that don't match
+size_t      checkPattern(const void* frame, size_t frameBytes, uint32_t frameNumber,
+                         uint32_t phase, uint32_t firstData = PATTERN_FIRST_DATA);
+
+// Returns the name of the instruction set the streaming routines are using
+const char* streamCopyImpl();
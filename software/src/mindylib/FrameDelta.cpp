@@ -0,0 +1,215 @@
+//=================================================================================================
+// FrameDelta.cpp - Dirty-packet bitmaps for Mindy's delta mode
+//=================================================================================================
+#include <cstring>
+#include <stdexcept>
+#include <immintrin.h>
+#include "FrameDelta.h"
+#include "throwRuntime.h"
+using namespace std;
+
+// Packets are always a whole number of these
+static const size_t LINE_BYTES = 64;
+
+//=================================================================================================
+// differsSse2() - Returns true if two buffers differ.  "bytes" is a multiple of 64
+//=================================================================================================
+static bool differsSse2(const uint8_t* a, const uint8_t* b, size_t bytes)
+{
+    for (; bytes; bytes -= LINE_BYTES, a += LINE_BYTES, b += LINE_BYTES)
+    {
+        __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a +  0)), _mm_loadu_si128((const __m128i*)(b +  0)));
+        __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + 16)), _mm_loadu_si128((const __m128i*)(b + 16)));
+        __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + 32)), _mm_loadu_si128((const __m128i*)(b + 32)));
+        __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(a + 48)), _mm_loadu_si128((const __m128i*)(b + 48)));
+        __m128i eq = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+        if (_mm_movemask_epi8(eq) != 0xFFFF) return true;
+    }
+
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// differsAvx2() - Returns true if two buffers differ, comparing 32 bytes at a time
+//=================================================================================================
+__attribute__((target("avx2")))
+static bool differsAvx2(const uint8_t* a, const uint8_t* b, size_t bytes)
+{
+    for (; bytes; bytes -= LINE_BYTES, a += LINE_BYTES, b += LINE_BYTES)
+    {
+        __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a +  0)), _mm256_loadu_si256((const __m256i*)(b +  0)));
+        __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + 32)), _mm256_loadu_si256((const __m256i*)(b + 32)));
+        __m256i x  = _mm256_or_si256(x0, x1);
+        if (!_mm256_testz_si256(x, x)) return true;
+    }
+
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// differsAvx512() - Returns true if two buffers differ, comparing a cache-line at a time
+//=================================================================================================
+__attribute__((target("avx512f")))
+static bool differsAvx512(const uint8_t* a, const uint8_t* b, size_t bytes)
+{
+    for (; bytes; bytes -= LINE_BYTES, a += LINE_BYTES, b += LINE_BYTES)
+    {
+        if (_mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a), _mm512_loadu_si512(b))) return true;
+    }
+
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// The implementation we use is chosen once, at program startup, based on what the CPU has
+//=================================================================================================
+typedef bool (*differsFunc_t)(const uint8_t*, const uint8_t*, size_t);
+
+static struct dispatch_t
+{
+    differsFunc_t   differs;
+    const char*     name;
+
+    dispatch_t()
+    {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            differs = differsAvx512;
+            name    = "AVX-512";
+        }
+        else if (__builtin_cpu_supports("avx2"))
+        {
+            differs = differsAvx2;
+            name    = "AVX2";
+        }
+        else
+        {
+            differs = differsSse2;
+            name    = "SSE2";
+        }
+    }
+} dispatch;
+//=================================================================================================
+
+
+//=================================================================================================
+// setup() - Sets the frame and packet sizes and forgets the previous frames
+//=================================================================================================
+void DeltaEncoder::setup(size_t frameBytes, size_t packetBytes)
+{
+    if (packetBytes == 0 || packetBytes % LINE_BYTES)
+        throwRuntime("DeltaEncoder::setup(): %zu isn't a multiple of 64", packetBytes);
+
+    if (frameBytes == 0 || (frameBytes / 2) % packetBytes)
+        throwRuntime("DeltaEncoder::setup(): a semiphase isn't a whole number of %zu-byte packets",
+                     packetBytes);
+
+    if (frameBytes / packetBytes > DELTA_MAX_PACKETS)
+        throwRuntime("DeltaEncoder::setup(): a frame can't have more than %u packets", DELTA_MAX_PACKETS);
+
+    frameBytes_  = frameBytes;
+    packetBytes_ = packetBytes;
+    packets_     = frameBytes / packetBytes;
+    flagged_     = 0;
+    encoded_     = 0;
+
+    for (int phase = 0; phase < 2; ++phase) previous_[phase].assign(frameBytes, 0);
+    reset();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// encode() - Writes the bitmap of the packets that changed since the previous frame of this
+//            phase into the metadata record, and remembers the frame
+//=================================================================================================
+uint32_t DeltaEncoder::encode(uint32_t phase, void* metadata, const void* semiphase0,
+                              const void* semiphase1)
+{
+    if (phase > 1 || packets_ == 0) throwRuntime("bad call to DeltaEncoder::encode()");
+
+    uint8_t  bitmap[DELTA_BITMAP_BYTES] = {0};
+    uint8_t* previous = previous_[phase].data();
+    uint32_t count    = 0;
+    size_t   half     = packets_ / 2;
+
+    for (uint32_t packet = 0; packet < packets_; ++packet)
+    {
+        const uint8_t* base = (const uint8_t*)((packet < half) ? semiphase0 : semiphase1);
+        const uint8_t* data = base + (packet % half) * packetBytes_;
+        uint8_t*       prev = previous + packet * packetBytes_;
+
+        if (valid_[phase] && !dispatch.differs(data, prev, packetBytes_)) continue;
+
+        memcpy(prev, data, packetBytes_);
+        bitmap[packet / 8] |= 1 << (packet % 8);
+        ++count;
+    }
+
+    // A frame with no changes is still sent, as packet 0
+    if (count == 0)
+    {
+        bitmap[0] = 1;
+        count     = 1;
+    }
+
+    memcpy((uint8_t*)metadata + DELTA_BITMAP_OFFSET, bitmap, sizeof(bitmap));
+
+    valid_[phase] = true;
+    flagged_ += count;
+    encoded_ += packets_;
+    return count;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// isDirty() - Returns true if a packet is flagged in a metadata record's bitmap
+//=================================================================================================
+bool DeltaEncoder::isDirty(const void* metadata, uint32_t packet)
+{
+    if (packet >= DELTA_MAX_PACKETS) return false;
+    const uint8_t* bitmap = (const uint8_t*)metadata + DELTA_BITMAP_OFFSET;
+    return (bitmap[packet / 8] >> (packet % 8)) & 1;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// applyDelta() - Copies the packets that were sent from a received frame into a full copy of
+//                the frame
+//=================================================================================================
+void DeltaEncoder::applyDelta(void* frame, const void* received, const void* metadata,
+                              size_t frameBytes, size_t packetBytes)
+{
+    if (packetBytes == 0) throwRuntime("bad parameter on DeltaEncoder::applyDelta()");
+
+    size_t packets = frameBytes / packetBytes;
+    if (packets > DELTA_MAX_PACKETS) packets = DELTA_MAX_PACKETS;
+
+    for (uint32_t packet = 0; packet < packets; ++packet)
+    {
+        if (!isDirty(metadata, packet)) continue;
+        size_t offset = packet * packetBytes;
+        memcpy((uint8_t*)frame + offset, (const uint8_t*)received + offset, packetBytes);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// impl() - Returns the name of the instruction set in use
+//=================================================================================================
+const char* DeltaEncoder::impl()
+{
+    return dispatch.name;
+}
+//=================================================================================================
@@ -0,0 +1,101 @@
+//=================================================================================================
+// FrameDelta.h - Dirty-packet bitmaps for Mindy's delta mode
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+    In delta mode (see CMindy::setDeltaMode()), Mindy fetches and sends only the packets of a
+    frame that have changed since the previous frame of the same phase.  The sender says which
+    ones those are with a bitmap in the first 64 bytes of the frame's 128-byte metadata record:
+
+        Offset  Size  Contents
+        ------  ----  -------------------------------------------------------------
+            0    64   Bit N (bit N % 8 of byte N / 8) is set if packet N changed
+
+    A "packet" is PACKET_SIZE bytes of the frame, so a frame may have at most 512 of them and
+    each semiphase must hold a whole number of them.  Each packet that's sent is written at its
+    usual offset in the receiver's frame-data ring, and the metadata record (bitmap included)
+    is delivered unchanged, so the rest of the record (bytes 64 thru 127) is still available to
+    the application, FrameStamper and metadata stamping.
+
+    DeltaEncoder runs on the sender.  It keeps a private copy of the last frame it encoded for
+    each phase, compares each new frame against it a packet at a time (using AVX-512 or AVX2
+    when the CPU has them) and writes the bitmap:
+
+        DeltaEncoder encoder;
+        encoder.setup(frameBytes, packetBytes);
+        ...fill the frame's semiphase buffers...
+        encoder.encode(phase, metadata, semiphase0, semiphase1);
+        stamper.stamp(phase, metadata, semiphase0, semiphase1, frameBytes / 2);   // If in use
+
+    The first frame of each phase (and the first after reset()) is sent in full.  A frame with
+    no changes is sent as packet 0 alone, as the card would do anyway, so that it's still
+    delivered.
+
+    On the receiver, the packets of a frame land in whatever ring slot the frame was assigned,
+    and only the changed ones are written.  A receiver whose frame-data ring holds exactly one
+    frame sees a complete frame in it after every frame counter update.  Otherwise, applyDelta()
+    copies the changed packets out of the slot into the receiver's own copy of the frame.
+    DeltaEncoder doesn't do any locking; use one instance per producer thread.
+*/
+
+// The offset and size of the dirty-packet bitmap within the metadata record
+const size_t   DELTA_BITMAP_OFFSET = 0;
+const size_t   DELTA_BITMAP_BYTES  = 64;
+
+// The most packets a frame can have in delta mode
+const uint32_t DELTA_MAX_PACKETS   = DELTA_BITMAP_BYTES * 8;
+
+
+//=================================================================================================
+// DeltaEncoder - Writes the dirty-packet bitmap of each frame into its metadata record
+//=================================================================================================
+class DeltaEncoder
+{
+public:
+
+    // Sets the frame and packet sizes, and forgets the previous frames.  "packetBytes" must
+    // be a multiple of 64 that divides each semiphase evenly, into no more than 512 packets
+    void        setup(size_t frameBytes, size_t packetBytes);
+
+    // Compares a frame against the previous frame of the same phase, writes the bitmap into
+    // its metadata record, and remembers the frame for next time
+    //
+    // Returns: The number of packets flagged in the bitmap (always at least 1)
+    uint32_t    encode(uint32_t phase, void* metadata, const void* semiphase0, const void* semiphase1);
+
+    // Makes the next frame of each phase be sent in full
+    void        reset() {valid_[0] = valid_[1] = false;}
+
+    // Returns the number of packets flagged and the number of packets encoded, since setup()
+    uint64_t    packetsFlagged() {return flagged_;}
+    uint64_t    packetsEncoded() {return encoded_;}
+
+    // Returns true if packet "packet" is flagged in a metadata record's bitmap
+    static bool isDirty(const void* metadata, uint32_t packet);
+
+    // Copies the packets flagged in "metadata" from a frame that was just received into a
+    // complete copy of the frame
+    static void applyDelta(void* frame, const void* received, const void* metadata,
+                           size_t frameBytes, size_t packetBytes);
+
+    // Returns the name of the instruction set the comparisons are using
+    static const char* impl();
+
+protected:
+
+    size_t      frameBytes_  = 0;
+    size_t      packetBytes_ = 0;
+    uint32_t    packets_     = 0;
+
+    // The previous frame of each phase, and whether we have one
+    std::vector<uint8_t> previous_[2];
+    bool        valid_[2]    = {false, false};
+
+    uint64_t    flagged_     = 0;
+    uint64_t    encoded_     = 0;
+};
+//=================================================================================================
@@ -0,0 +1,167 @@
+//=================================================================================================
+// FrameIntegrity.cpp - End-to-end integrity checking of Mindy frames
+//=================================================================================================
+#include <cstring>
+#include <stdexcept>
+#include "FrameIntegrity.h"
+#include "crc32c.h"
+#include "throwRuntime.h"
+using namespace std;
+
+// This is the layout of the integrity trailer in the metadata record
+struct trailer_t
+{
+    uint32_t    sequence;
+    uint32_t    frameCrc;
+    uint32_t    magic;
+    uint32_t    metadataCrc;
+};
+static_assert(INTEGRITY_TRAILER_OFFSET + sizeof(trailer_t) == METADATA_RECORD_BYTES);
+
+// The metadata CRC covers every byte in front of it except Mindy's 8-byte timestamp
+static const size_t METADATA_CRC_BYTES = METADATA_RECORD_BYTES - sizeof(uint32_t);
+static const size_t METADATA_STAMP_END = METADATA_STAMP_OFFSET + sizeof(uint64_t);
+static_assert(METADATA_STAMP_END == INTEGRITY_TRAILER_OFFSET);
+
+//=================================================================================================
+// metadataCrc() - Computes the CRC of a metadata record, skipping the field that Mindy stamps
+//=================================================================================================
+static uint32_t metadataCrc(const void* metadata)
+{
+    const uint8_t* p = (const uint8_t*)metadata;
+    uint32_t crc = crc32c(p, METADATA_STAMP_OFFSET);
+    return crc32c(p + METADATA_STAMP_END, METADATA_CRC_BYTES - METADATA_STAMP_END, crc);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stamp() - Fills in the integrity trailer of a metadata record
+//=================================================================================================
+uint32_t FrameStamper::stamp(uint32_t phase, void* metadata, const void* semiphase0,
+                             const void* semiphase1, size_t semiphaseBytes)
+{
+    if (phase > 1) throwRuntime("bad parameter on FrameStamper::stamp()");
+
+    trailer_t trailer;
+
+    // Compute the CRC of the entire frame
+    uint32_t crc = crc32c(semiphase0, semiphaseBytes);
+    crc = crc32c(semiphase1, semiphaseBytes, crc);
+
+    // Fill in everything but the metadata CRC
+    trailer.sequence = ++sequence_[phase];
+    trailer.frameCrc = crc;
+    trailer.magic    = INTEGRITY_MAGIC;
+    memcpy((uint8_t*)metadata + INTEGRITY_TRAILER_OFFSET, &trailer, sizeof(trailer));
+
+    // And finally, the CRC of the metadata record itself
+    trailer.metadataCrc = metadataCrc(metadata);
+    memcpy((uint8_t*)metadata + METADATA_CRC_BYTES, &trailer.metadataCrc, sizeof(uint32_t));
+
+    return trailer.sequence;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// verify() - Verifies a frame whose data is contiguous in memory
+//=================================================================================================
+FrameVerifier::result_t FrameVerifier::verify(uint32_t phase, const void* metadata,
+                                              const void* frameData, size_t frameBytes)
+{
+    return verify(phase, metadata, &frameData, &frameBytes, 1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// verify() - Verifies a frame whose data arrived in pieces
+//=================================================================================================
+FrameVerifier::result_t FrameVerifier::verify(uint32_t phase, const void* metadata,
+                                              const void* const* pieces,
+                                              const size_t* pieceBytes, size_t pieceCount)
+{
+    if (phase > 1) throwRuntime("bad parameter on FrameVerifier::verify()");
+
+    // Compute the CRC of the frame data, one piece at a time
+    uint32_t crc = 0;
+    for (size_t i = 0; i < pieceCount; ++i) crc = crc32c(pieces[i], pieceBytes[i], crc);
+
+    // And check it against the trailer
+    return check(phase, metadata, crc);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// check() - Checks the integrity trailer of a metadata record and counts the result
+//=================================================================================================
+FrameVerifier::result_t FrameVerifier::check(uint32_t phase, const void* metadata, uint32_t frameCrc)
+{
+    trailer_t trailer;
+    counts_t& counts = counts_[phase];
+
+    // Fetch the trailer from the metadata record
+    memcpy(&trailer, (const uint8_t*)metadata + INTEGRITY_TRAILER_OFFSET, sizeof(trailer));
+
+    // If this metadata record was never stamped, we can't check anything
+    if (trailer.magic != INTEGRITY_MAGIC)
+    {
+        counts.badMagic++;
+        return BAD_MAGIC;
+    }
+
+    // If the metadata record is corrupted, we can't trust anything else in the trailer
+    if (metadataCrc(metadata) != trailer.metadataCrc)
+    {
+        counts.metadataCrc++;
+        return METADATA_CRC;
+    }
+
+    // The frame we expect after this one is the one that follows it, regardless of outcome
+    uint32_t expected = expected_[phase];
+    expected_[phase]  = trailer.sequence + 1;
+
+    // Make sure the frame data is intact
+    if (frameCrc != trailer.frameCrc)
+    {
+        counts.frameCrc++;
+        return FRAME_CRC;
+    }
+
+    // Make sure no frames went missing in front of this one
+    if (trailer.sequence != expected)
+    {
+        counts.sequenceGaps++;
+        int32_t missing = (int32_t)(trailer.sequence - expected);
+        if (missing > 0) counts.framesMissing += missing;
+        return SEQUENCE_GAP;
+    }
+
+    counts.framesOk++;
+    return FRAME_OK;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// getErrorCount() - Returns the total number of errors of any kind for one phase
+//=================================================================================================
+uint64_t FrameVerifier::getErrorCount(uint32_t phase)
+{
+    const counts_t& counts = counts_[phase & 1];
+    return counts.badMagic + counts.metadataCrc + counts.frameCrc + counts.sequenceGaps;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reset() - Clears the counts and expects sequence number 1 next on both phases
+//=================================================================================================
+void FrameVerifier::reset()
+{
+    expected_[0] = expected_[1] = 1;
+    memset(counts_, 0, sizeof(counts_));
+}
+//=================================================================================================
@@ -0,0 +1,130 @@
+//=================================================================================================
+// FrameIntegrity.h - End-to-end integrity checking of Mindy frames
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/*
+    When integrity mode is in use, the sender stamps the last 16 bytes of each frame's 128-byte
+    metadata record with an integrity trailer:
+
+        Offset  Size  Contents
+        ------  ----  -------------------------------------------------------------
+          112     4   Per-phase sequence number (the first frame of a phase is 1)
+          116     4   CRC-32C of the frame data (semiphase 0 followed by semiphase 1)
+          120     4   INTEGRITY_MAGIC
+          124     4   CRC-32C of metadata bytes 0 thru 103 and 112 thru 123
+
+    Mindy delivers the metadata record to the receivers unchanged, except that when metadata
+    stamping is enabled it overwrites bytes 104 thru 111 with the card timestamp of the frame
+    counter write.  Those bytes are therefore left out of the metadata CRC.  Stamping the stream
+    ID as well overwrites byte 103, which the CRC covers, so it can't be used with integrity
+    mode (the stream ID is also in the RDMX header of every packet).  A receiver that has
+    reassembled a frame can prove it arrived intact and in order.  The first 104 bytes of the
+    metadata record remain available to the application.
+
+    FrameStamper runs on the sender, FrameVerifier runs on the receiver.  Neither does any
+    locking; use one instance per thread.
+*/
+
+// The metadata record that Mindy fetches for each frame
+const size_t   METADATA_RECORD_BYTES = 128;
+
+// The offset of the integrity trailer within the metadata record
+const size_t   INTEGRITY_TRAILER_OFFSET = 112;
+
+// The offset of the timestamp Mindy stamps into the metadata record
+const size_t   METADATA_STAMP_OFFSET = 104;
+
+// Identifies a metadata record as having an integrity trailer
+const uint32_t INTEGRITY_MAGIC = 0x4D494E44;
+
+
+//=================================================================================================
+// FrameStamper - Stamps a sequence number and CRCs into each metadata record
+//=================================================================================================
+class FrameStamper
+{
+public:
+
+    // Stamps the integrity trailer into a frame's metadata record
+    //
+    // Passed: phase          = 0 or 1
+    //         metadata       = The 128-byte metadata record for the frame
+    //         semiphase0     = The first half of the frame
+    //         semiphase1     = The second half of the frame
+    //         semiphaseBytes = The size of each semiphase (i.e., half the frame size)
+    //
+    // Returns: The sequence number that was stamped
+    uint32_t    stamp(uint32_t phase, void* metadata, const void* semiphase0,
+                      const void* semiphase1, size_t semiphaseBytes);
+
+    // Starts both phases over at sequence number 1
+    void        reset() {sequence_[0] = sequence_[1] = 0;}
+
+protected:
+
+    // The most recent sequence number we stamped for each phase
+    uint32_t    sequence_[2] = {0, 0};
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// FrameVerifier - Checks the integrity trailer of each frame that arrives at a receiver
+//=================================================================================================
+class FrameVerifier
+{
+public:
+
+    // These are the possible outcomes of verifying a frame
+    enum result_t
+    {
+        FRAME_OK,           // The frame arrived intact and in order
+        BAD_MAGIC,          // The metadata record has no integrity trailer
+        METADATA_CRC,       // The metadata record was corrupted
+        FRAME_CRC,          // The frame data was corrupted
+        SEQUENCE_GAP        // The frame is intact but one or more frames before it are missing
+    };
+
+    // Error counts for a single phase
+    struct counts_t
+    {
+        uint64_t    framesOk;
+        uint64_t    badMagic;
+        uint64_t    metadataCrc;
+        uint64_t    frameCrc;
+        uint64_t    sequenceGaps;
+        uint64_t    framesMissing;
+    };
+
+    // Verifies a frame whose data is contiguous in memory
+    result_t    verify(uint32_t phase, const void* metadata, const void* frameData, size_t frameBytes);
+
+    // Verifies a frame whose data was received in several pieces.  The pieces must be listed
+    // in the order in which they appear in the frame
+    result_t    verify(uint32_t phase, const void* metadata, const void* const* pieces,
+                       const size_t* pieceBytes, size_t pieceCount);
+
+    // Returns the counts for one phase
+    counts_t    getCounts(uint32_t phase) {return counts_[phase & 1];}
+
+    // Returns the total number of errors (of any kind) for one phase
+    uint64_t    getErrorCount(uint32_t phase);
+
+    // Clears the counts and starts both phases over at sequence number 1
+    void        reset();
+
+protected:
+
+    // Checks the trailer of a metadata record whose frame has the specified CRC
+    result_t    check(uint32_t phase, const void* metadata, uint32_t frameCrc);
+
+    // The sequence number we expect next, for each phase
+    uint32_t    expected_[2] = {1, 1};
+
+    // Counts for each phase
+    counts_t    counts_[2] = {};
+};
+//=================================================================================================
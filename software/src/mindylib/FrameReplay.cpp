@@ -0,0 +1,426 @@
+//=================================================================================================
+// FrameReplay.cpp - Streams recorded frames from disk through Mindy, and records received frames
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include "FrameReplay.h"
+#include "FrameCopy.h"
+#include "IoRing.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// The size of a metadata record in the host meta-data buffers
+static const uint32_t METADATA_BYTES = 128;
+
+// What each io_uring request of a frame is for.  It's stored in the low bits of "userData"
+enum {IO_HEADER, IO_SEMIPHASE0, IO_SEMIPHASE1, IO_FRAME, IO_KINDS};
+
+
+//=================================================================================================
+// openRecording() - Opens a recording with O_DIRECT if the file system allows it, and through
+//                   the page cache if it doesn't
+//=================================================================================================
+static int openRecording(const string& filename, int flags, bool* direct)
+{
+    int fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+    *direct = (fd >= 0);
+
+    if (fd < 0 && errno == EINVAL) fd = open(filename.c_str(), flags, 0644);
+    if (fd < 0) throwRuntime("Can't open %s: %s", filename.c_str(), strerror(errno));
+    return fd;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// alignedBuffer_t - A block of RECORD_ALIGN aligned memory that frees itself
+//=================================================================================================
+struct alignedBuffer_t
+{
+    alignedBuffer_t(size_t bytes)
+    {
+        ptr = (uint8_t*)aligned_alloc(RECORD_ALIGN, bytes);
+        if (ptr == nullptr) throwRuntime("Out of memory");
+        memset(ptr, 0, bytes);
+    }
+    ~alignedBuffer_t() {free(ptr);}
+    uint8_t* ptr;
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// fileCloser_t - Closes a file descriptor when it goes out of scope
+//=================================================================================================
+struct fileCloser_t
+{
+    ~fileCloser_t() {if (fd >= 0) close(fd);}
+    int fd;
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// checkIo() - Throws if an io_uring request didn't transfer all of its bytes
+//=================================================================================================
+static void checkIo(int32_t result, uint32_t expected, const char* what)
+{
+    if (result < 0) throwRuntime("%s failed: %s", what, strerror(-result));
+    if ((uint32_t)result != expected) throwRuntime("%s was short: %d of %u bytes", what, result, expected);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// replay() - Plays a recording through the card
+//=================================================================================================
+FrameReplayer::stats_t FrameReplayer::replay(const string& filename, const buffers_t& buffers,
+                                             const config_t& config)
+{
+    using clock = steady_clock;
+
+    if (config.depth == 0 || config.batch == 0 || config.loops == 0)
+        throwRuntime("FrameReplayer: depth, batch and loops must be non-zero");
+
+    stats_t stats = {};
+
+    fileCloser_t file = {openRecording(filename, O_RDONLY, &stats.direct)};
+
+    // Read and check the recording header
+    alignedBuffer_t block(RECORD_ALIGN);
+    if (pread(file.fd, block.ptr, RECORD_ALIGN, 0) != RECORD_ALIGN)
+        throwRuntime("%s is too short to be a recording", filename.c_str());
+    recordingHeader_t header;
+    memcpy(&header, block.ptr, sizeof header);
+
+    if (memcmp(header.magic, RECORDING_MAGIC, sizeof RECORDING_MAGIC) || header.version != RECORDING_VERSION)
+        throwRuntime("%s isn't a version %u recording", filename.c_str(), RECORDING_VERSION);
+
+    uint32_t frameSize = mindy_.getFrameSize();
+    if (header.frameSize != frameSize)
+        throwRuntime("%s has %u-byte frames, but the card is using %u", filename.c_str(),
+                     header.frameSize, frameSize);
+
+    uint32_t semiphase = frameSize / 2;
+    if (semiphase % RECORD_ALIGN) throwRuntime("Frames must be at least %u bytes to replay", 2 * RECORD_ALIGN);
+    if (header.frameCount == 0) throwRuntime("%s has no frames", filename.c_str());
+
+    uint64_t frameStride = RECORD_ALIGN + frameSize;
+    uint64_t hfdBytes    = mindy_.getHostFrameDataSize();
+    uint64_t hmdBytes    = mindy_.getHostMetaDataSize();
+
+    // Find out where the card is in its buffers, and how many frames each phase can hold
+    CMindy::ringState_t ring[2] = {mindy_.getRingState(0), mindy_.getRingState(1)};
+    uint32_t capacity = hfdBytes / semiphase;
+    if (capacity > hmdBytes / METADATA_BYTES) capacity = hmdBytes / METADATA_BYTES;
+
+    // The frames that have been assigned a slot in the host buffers, per phase, and the
+    // frames of each phase that have been read but whose doorbell hasn't been rung yet
+    uint32_t assigned[2] = {0, 0};
+    uint32_t fetched[2]  = {ring[0].fetched, ring[1].fetched};
+    uint32_t unrung[2]   = {0, 0};
+
+    // One frame in the pipeline, in the order they appear in the recording
+    struct job_t
+    {
+        uint32_t    phase;
+        uint64_t    hfdOffs, hmdOffs;
+        uint32_t    reads;          // Reads that haven't completed
+        bool        headerDone;     // The frame header has arrived
+        bool        slotted;        // The frame has been assigned its slot
+    };
+    deque<job_t> jobs;
+    uint64_t     frontSeq = 0;
+
+    // The frame headers are read into these, one per pipeline entry
+    alignedBuffer_t headers((size_t)config.depth * RECORD_ALIGN);
+    auto headerOf = [&](uint64_t seq) {return headers.ptr + (seq % config.depth) * RECORD_ALIGN;};
+
+    IoRing io;
+    io.open(config.depth * 3);
+
+    uint64_t totalFrames = header.frameCount * config.loops;
+    uint64_t started     = 0;
+    auto     linkBytes   = [&]() {return mindy_.getLinkStats(0).bytes + mindy_.getLinkStats(1).bytes;};
+    uint64_t wireStart   = linkBytes();
+    auto     startTime   = clock::now();
+
+    // Rings the doorbell for the frames of a phase that are ready
+    auto ringDoorbell = [&](uint32_t phase)
+    {
+        if (unrung[phase] == 0) return;
+        mindy_.addLocalFrameCounter(phase, unrung[phase]);
+        unrung[phase] = 0;
+        ++stats.doorbells;
+    };
+
+    while (stats.frames < totalFrames)
+    {
+        // Start reading the headers of as many frames as the pipeline can hold
+        while (jobs.size() < config.depth && started < totalFrames)
+        {
+            uint64_t seq = started++;
+            uint64_t pos = RECORD_ALIGN + (seq % header.frameCount) * frameStride;
+            jobs.push_back({0, 0, 0, 1, false, false});
+            io.prepRead(file.fd, headerOf(seq), RECORD_ALIGN, pos, seq * IO_KINDS + IO_HEADER);
+        }
+
+        // In recording order, give each frame whose header has arrived the next slot of its
+        // phase, as long as the card has freed one, and start reading its frame data
+        bool blockedOnCard = false;
+        for (uint64_t i = 0; i < jobs.size(); ++i)
+        {
+            job_t& job = jobs[i];
+            if (job.slotted) continue;
+            if (!job.headerDone) break;
+
+            uint32_t phase = job.phase;
+            uint32_t owned = ring[phase].submitted + assigned[phase] - fetched[phase];
+            if (owned >= capacity)
+            {
+                fetched[phase] = mindy_.getFetchedFrameCount(phase);
+                owned = ring[phase].submitted + assigned[phase] - fetched[phase];
+            }
+            if (owned >= capacity)
+            {
+                blockedOnCard = true;
+                break;
+            }
+
+            uint64_t seq = frontSeq + i;
+            uint64_t pos = RECORD_ALIGN + (seq % header.frameCount) * frameStride + RECORD_ALIGN;
+
+            job.hfdOffs = ring[phase].nextHfdOffset;
+            job.hmdOffs = ring[phase].nextHmdOffset;
+            job.reads   = 2;
+            job.slotted = true;
+            ++assigned[phase];
+
+            ring[phase].nextHfdOffset = (job.hfdOffs + semiphase) % hfdBytes;
+            ring[phase].nextHmdOffset = (job.hmdOffs + METADATA_BYTES) % hmdBytes;
+
+            io.prepRead(file.fd, buffers.hfd[phase][0] + job.hfdOffs, semiphase, pos,
+                        seq * IO_KINDS + IO_SEMIPHASE0);
+            io.prepRead(file.fd, buffers.hfd[phase][1] + job.hfdOffs, semiphase, pos + semiphase,
+                        seq * IO_KINDS + IO_SEMIPHASE1);
+        }
+
+        // Hand the frames at the front of the pipeline that have completely arrived to the card
+        while (!jobs.empty() && jobs.front().slotted && jobs.front().reads == 0)
+        {
+            job_t& job = jobs.front();
+            frameHeader_t* fh = (frameHeader_t*)headerOf(frontSeq);
+            streamCopy(buffers.hmd[job.phase] + job.hmdOffs, fh->metadata, METADATA_BYTES);
+
+            if (++unrung[job.phase] >= config.batch) ringDoorbell(job.phase);
+
+            jobs.pop_front();
+            ++frontSeq;
+            ++stats.frames;
+        }
+
+        // If the pipeline has stalled, don't sit on frames that are ready to go
+        if (jobs.empty() || !jobs.front().slotted || jobs.front().reads)
+        {
+            ringDoorbell(0);
+            ringDoorbell(1);
+        }
+
+        // If we're waiting on the card and not on the disk, give it a moment
+        if (blockedOnCard && io.inFlight() == 0)
+        {
+            ++stats.cardStalls;
+            this_thread::sleep_for(microseconds(10));
+            continue;
+        }
+
+        // Send the reads to the kernel, and wait for at least one to complete
+        io.submit(io.inFlight() ? 1 : 0);
+
+        uint64_t userData;
+        int32_t  result;
+        while (io.reap(&userData, &result))
+        {
+            uint64_t seq  = userData / IO_KINDS;
+            job_t&   job  = jobs[seq - frontSeq];
+
+            if (userData % IO_KINDS == IO_HEADER)
+            {
+                checkIo(result, RECORD_ALIGN, "Reading a frame header");
+                frameHeader_t* fh = (frameHeader_t*)headerOf(seq);
+                if (fh->phase > 1) throwRuntime("Frame %lu of %s has phase %u", seq % header.frameCount,
+                                                filename.c_str(), fh->phase);
+                job.phase      = fh->phase;
+                job.headerDone = true;
+                job.reads      = 0;
+            }
+            else
+            {
+                checkIo(result, semiphase, "Reading frame data");
+                --job.reads;
+            }
+
+            stats.diskBytes += result;
+        }
+    }
+
+    ringDoorbell(0);
+    ringDoorbell(1);
+
+    // Wait for the card to fetch and send everything we submitted
+    auto deadline = clock::now() + seconds(10);
+    for (uint32_t phase = 0; phase < 2; ++phase)
+    {
+        uint32_t target = ring[phase].submitted + assigned[phase];
+        while (mindy_.getFetchedFrameCount(phase) != target)
+        {
+            if (clock::now() > deadline) throwRuntime("The card stopped fetching phase %u frames", phase);
+            this_thread::sleep_for(microseconds(10));
+        }
+    }
+
+    uint64_t expected = stats.frames * frameSize;
+    while (linkBytes() - wireStart < expected && clock::now() < deadline)
+        this_thread::sleep_for(microseconds(10));
+
+    stats.wireBytes = linkBytes() - wireStart;
+    stats.seconds   = duration<double>(clock::now() - startTime).count();
+    stats.diskGBps  = stats.diskBytes / stats.seconds / 1e9;
+    stats.wireGBps  = stats.wireBytes / stats.seconds / 1e9;
+    return stats;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// record() - Writes the frames arriving at a receiver into a recording
+//=================================================================================================
+FrameRecorder::stats_t FrameRecorder::record(const string& filename, const source_t& source,
+                                             const config_t& config)
+{
+    using clock = steady_clock;
+
+    uint32_t frameSize = config.frameSize;
+
+    if (frameSize == 0 || (frameSize / 2) % RECORD_ALIGN)
+        throwRuntime("Frames must be a multiple of %u bytes to record", 2 * RECORD_ALIGN);
+    if ((uintptr_t)source.frameData % RECORD_ALIGN)
+        throwRuntime("The receiver's frame-data ring must be %u-byte aligned", RECORD_ALIGN);
+    if (source.frameDataBytes % frameSize || source.frameDataBytes < 2ULL * frameSize)
+        throwRuntime("The receiver's frame-data ring must hold a whole number (at least 2) of frames");
+    if (source.metaDataBytes % METADATA_BYTES || source.metaDataBytes == 0)
+        throwRuntime("The receiver's meta-data ring must be a multiple of %u bytes", METADATA_BYTES);
+    if (config.frames == 0 || config.depth == 0 || config.phase > 1)
+        throwRuntime("FrameRecorder: bad frames, depth or phase");
+
+    stats_t stats = {};
+
+    fileCloser_t file = {openRecording(filename, O_WRONLY | O_CREAT | O_TRUNC, &stats.direct)};
+
+    // The header says there are no frames until we're done
+    alignedBuffer_t block(RECORD_ALIGN);
+    recordingHeader_t header;
+    memcpy(header.magic, RECORDING_MAGIC, sizeof header.magic);
+    header.version    = RECORDING_VERSION;
+    header.frameSize  = frameSize;
+    header.frameCount = 0;
+    memcpy(block.ptr, &header, sizeof header);
+    if (pwrite(file.fd, block.ptr, RECORD_ALIGN, 0) != RECORD_ALIGN)
+        throwRuntime("Can't write %s: %s", filename.c_str(), strerror(errno));
+
+    uint64_t ringFrames  = source.frameDataBytes / frameSize;
+    uint64_t mdFrames    = source.metaDataBytes / METADATA_BYTES;
+    uint64_t frameStride = RECORD_ALIGN + frameSize;
+
+    // Each frame in flight has a header block and two outstanding writes
+    alignedBuffer_t headers((size_t)config.depth * RECORD_ALIGN);
+    deque<uint32_t> writes;
+    uint64_t        frontSeq = 0;
+
+    IoRing io;
+    io.open(config.depth * 2);
+
+    // We start with the next frame to arrive
+    uint32_t first     = *source.frameCounter;
+    uint64_t started   = 0;
+    auto     startTime = clock::now();
+    auto     lastFrame = startTime;
+
+    while (stats.frames < config.frames)
+    {
+        uint32_t arrived = *source.frameCounter - first;
+        if (arrived > started) lastFrame = clock::now();
+
+        // Start writing every frame that has arrived, as far as the pipeline allows
+        while (started < arrived && started < config.frames && writes.size() < config.depth)
+        {
+            uint64_t seq  = started++;
+            uint64_t abs  = first + seq;
+            uint8_t* hdr  = headers.ptr + (seq % config.depth) * RECORD_ALIGN;
+            uint64_t pos  = RECORD_ALIGN + seq * frameStride;
+
+            frameHeader_t* fh = (frameHeader_t*)hdr;
+            fh->phase    = config.phase;
+            fh->reserved = 0;
+            fh->sequence = seq;
+            memcpy(fh->metadata, source.metaData + (abs % mdFrames) * METADATA_BYTES, METADATA_BYTES);
+
+            io.prepWrite(file.fd, hdr, RECORD_ALIGN, pos, seq * IO_KINDS + IO_HEADER);
+            io.prepWrite(file.fd, source.frameData + (abs % ringFrames) * frameSize, frameSize,
+                         pos + RECORD_ALIGN, seq * IO_KINDS + IO_FRAME);
+            writes.push_back(2);
+        }
+
+        if (io.inFlight() == 0)
+        {
+            if (duration<double>(clock::now() - lastFrame).count() > config.timeout)
+                throwRuntime("No frame arrived for %.1f seconds", config.timeout);
+            this_thread::yield();
+            continue;
+        }
+
+        io.submit(1);
+
+        uint64_t userData;
+        int32_t  result;
+        while (io.reap(&userData, &result))
+        {
+            uint64_t seq = userData / IO_KINDS;
+            checkIo(result, (userData % IO_KINDS == IO_HEADER) ? RECORD_ALIGN : frameSize, "Writing a frame");
+            --writes[seq - frontSeq];
+            stats.diskBytes += result;
+        }
+
+        // Retire the frames at the front that are on disk, making sure the receiver didn't
+        // start overwriting them while we were writing them out
+        while (!writes.empty() && writes.front() == 0)
+        {
+            uint32_t lead = *source.frameCounter - (first + (uint32_t)frontSeq);
+            if (lead >= ringFrames)
+                throwRuntime("Frame %lu was overwritten before it was recorded", frontSeq);
+            writes.pop_front();
+            ++frontSeq;
+            ++stats.frames;
+        }
+    }
+
+    // Now that every frame is on disk, the header can say how many there are
+    header.frameCount = stats.frames;
+    memcpy(block.ptr, &header, sizeof header);
+    if (pwrite(file.fd, block.ptr, RECORD_ALIGN, 0) != RECORD_ALIGN || fdatasync(file.fd))
+        throwRuntime("Can't write %s: %s", filename.c_str(), strerror(errno));
+
+    stats.seconds  = duration<double>(clock::now() - startTime).count();
+    stats.diskGBps = stats.diskBytes / stats.seconds / 1e9;
+    return stats;
+}
+//=================================================================================================
@@ -0,0 +1,158 @@
+//=================================================================================================
+// FrameReplay.h - Streams recorded frames from disk through Mindy, and records received frames
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <string>
+#include "mindy.h"
+
+/*
+    A recording is a file of frames, laid out so that every read and write can be done with
+    O_DIRECT straight to or from the DMA buffers:
+
+        Offset 0        : recordingHeader_t, padded to RECORD_ALIGN bytes
+        Then, per frame : frameHeader_t (phase and 128-byte metadata), padded to RECORD_ALIGN
+                          bytes, followed by FRAME_SIZE bytes of frame data (semiphase 0, then
+                          semiphase 1)
+
+    Because each semiphase is read straight into a host frame-data buffer, FRAME_SIZE / 2 must
+    be a multiple of RECORD_ALIGN, i.e., the frame size must be at least 8192.
+
+    FrameReplayer reads a recording with io_uring into the next semiphase slots of the host
+    frame-data buffers, copies each frame's metadata into the host meta-data buffer, and rings
+    the frame counters, "batch" frames per doorbell.  Up to "depth" frames are being read from
+    disk at once.  It starts wherever the card already is in its buffers (see
+    CMindy::getRingState()), so the card doesn't have to be reset first, and it never lets the
+    card's buffers overrun.  The frames of each phase are submitted in the order they appear in
+    the recording.
+
+    The host buffers must be memory that O_DIRECT can DMA into (e.g., a hugetlbfs mapping
+    of the reserved buffers rather than a /dev/mem mapping).  If the file system doesn't
+    support O_DIRECT, the file is read through the page cache instead and "direct" is false
+    in the statistics.
+
+    FrameRecorder is the receiving side.  It watches the receiver's frame counter and writes
+    each frame from the receiver's frame-data ring (whole frames, FRAME_SIZE bytes apart, as
+    the rdmx_shims write them in steered mode) and meta-data ring into a recording.
+
+    Example:
+
+        FrameReplayer replayer(Mindy);
+        auto stats = replayer.replay("capture.rec", buffers, FrameReplayer::config_t());
+        printf("%.2f GB/s from disk, %.2f GB/s on the wire\n", stats.diskGBps, stats.wireGBps);
+*/
+
+// The alignment of everything in a recording
+const uint32_t RECORD_ALIGN = 4096;
+
+// The magic number at the start of a recording
+const char RECORDING_MAGIC[8] = {'M', 'I', 'N', 'D', 'Y', 'R', 'E', 'C'};
+
+// The first block of a recording
+struct recordingHeader_t
+{
+    char        magic[8];           // "MINDYREC"
+    uint32_t    version;            // RECORDING_VERSION
+    uint32_t    frameSize;          // Bytes of frame data per frame
+    uint64_t    frameCount;         // Number of frames in the recording
+};
+
+// The block in front of each frame of a recording
+struct frameHeader_t
+{
+    uint32_t    phase;              // The phase the frame was (or will be) sent as
+    uint32_t    reserved;
+    uint64_t    sequence;           // The frame's position in the recording, starting at 0
+    uint8_t     metadata[128];      // The frame's metadata record
+};
+
+const uint32_t RECORDING_VERSION = 1;
+
+
+//=================================================================================================
+// FrameReplayer - Plays a recording through Mindy
+//=================================================================================================
+class FrameReplayer
+{
+public:
+
+    // The userspace addresses of the host frame-data and meta-data buffers
+    struct buffers_t
+    {
+        uint8_t*    hfd[2][2];      // Indexed by [phase][semiphase]
+        uint8_t*    hmd[2];         // Indexed by phase
+    };
+
+    struct config_t
+    {
+        uint32_t    depth = 16;     // Frames being read from disk at once
+        uint32_t    batch = 4;      // Frames per doorbell
+        uint32_t    loops = 1;      // Number of times to play the recording
+    };
+
+    struct stats_t
+    {
+        uint64_t    frames;         // Frames submitted to the card
+        uint64_t    diskBytes;      // Bytes read from the recording
+        uint64_t    wireBytes;      // Frame-data bytes the card sent on its links
+        uint64_t    doorbells;      // Number of doorbell writes
+        uint64_t    cardStalls;     // Times we had to wait for the card to free a slot
+        double      seconds;        // From the first read until the card sent the last frame
+        double      diskGBps;
+        double      wireGBps;
+        bool        direct;         // True if the recording was read with O_DIRECT
+    };
+
+    // Constructor
+    FrameReplayer(CMindy& mindy) : mindy_(mindy) {}
+
+    // Plays a recording.  Returns once the card has sent every frame
+    stats_t     replay(const std::string& filename, const buffers_t& buffers, const config_t& config);
+
+protected:
+
+    CMindy&     mindy_;
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// FrameRecorder - Records the frames arriving at a receiver
+//=================================================================================================
+class FrameRecorder
+{
+public:
+
+    // Where the receiver's buffers are, in our address space
+    struct source_t
+    {
+        const uint8_t*           frameData;         // Frame-data ring, 4K aligned
+        uint64_t                 frameDataBytes;    // A multiple of the frame size
+        const uint8_t*           metaData;          // Meta-data ring
+        uint64_t                 metaDataBytes;     // A multiple of 128
+        const volatile uint32_t* frameCounter;      // The receiver's frame counter
+    };
+
+    struct config_t
+    {
+        uint32_t    frameSize = 0;      // Must match the card's frame size
+        uint32_t    phase     = 0;      // Recorded as the phase of every frame
+        uint64_t    frames    = 0;      // Number of frames to record
+        uint32_t    depth     = 16;     // Frames being written to disk at once
+        double      timeout   = 5.0;    // Give up if no frame arrives for this many seconds
+    };
+
+    struct stats_t
+    {
+        uint64_t    frames;             // Frames written to the recording
+        uint64_t    diskBytes;          // Bytes written to the recording
+        double      seconds;
+        double      diskGBps;
+        bool        direct;             // True if the recording was written with O_DIRECT
+    };
+
+    // Records "config.frames" frames, starting with the next one to arrive.  Throws if a
+    // frame is overwritten by the receiver before it has been written to disk
+    stats_t     record(const std::string& filename, const source_t& source, const config_t& config);
+};
+//=================================================================================================
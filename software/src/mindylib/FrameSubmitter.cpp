@@ -0,0 +1,241 @@
+//=================================================================================================
+// FrameSubmitter.cpp - Lock-free, multi-producer frame submission for Mindy
+//=================================================================================================
+#include <stdexcept>
+#include "FrameSubmitter.h"
+#include "throwRuntime.h"
+using namespace std;
+
+//=================================================================================================
+// Constructor - Marks every slot in the ring as being available to producers
+//=================================================================================================
+FrameSubmitter::FrameSubmitter()
+{
+    for (uint32_t i = 0; i < CAPACITY; ++i) ring_[i].sequence.store(i, memory_order_relaxed);
+
+    tail_        = 0;
+    head_        = 0;
+    wakeup_      = 0;
+    sleeping_    = false;
+    stopping_    = false;
+    frames_[0]   = 0;
+    frames_[1]   = 0;
+    doorbells_   = 0;
+    maxDepth_    = 0;
+    lastBatch_   = 0;
+    maxBatch_    = 0;
+    fullRetries_ = 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// start() - Starts the doorbell thread
+//=================================================================================================
+void FrameSubmitter::start(CMindy& mindy)
+{
+    if (thread_.joinable()) throwRuntime("FrameSubmitter::start() called twice");
+
+    mindy_    = &mindy;
+    stopping_ = false;
+    thread_   = thread(&FrameSubmitter::doorbellThread, this);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stop() - Tells the doorbell thread to submit whatever is left in the ring and exit
+//=================================================================================================
+void FrameSubmitter::stop()
+{
+    if (!thread_.joinable()) return;
+
+    stopping_ = true;
+    wakeup_.fetch_add(1);
+    wakeup_.notify_one();
+    thread_.join();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// trySubmit() - Pushes a token into the ring
+//
+// Returns: false if the ring was full
+//=================================================================================================
+bool FrameSubmitter::trySubmit(uint32_t phase, uint32_t count)
+{
+    if (phase > 1) throwRuntime("bad parameter on FrameSubmitter::trySubmit()");
+
+    // Submitting zero frames is a no-op
+    if (count == 0) return true;
+
+    // Claim a slot at the tail of the ring
+    uint64_t pos = tail_.load(memory_order_relaxed);
+    while (true)
+    {
+        slot_t&  slot = ring_[pos & (CAPACITY - 1)];
+        uint64_t seq  = slot.sequence.load(memory_order_acquire);
+        int64_t  diff = (int64_t)(seq - pos);
+
+        // If this slot is free, try to claim it.  On failure, "pos" is reloaded for us
+        if (diff == 0)
+        {
+            if (tail_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        }
+
+        // If the slot still holds a token from a lap ago, the ring is full
+        else if (diff < 0) return false;
+
+        // Otherwise, some other producer beat us to this slot
+        else pos = tail_.load(memory_order_relaxed);
+    }
+
+    // Fill in the slot and hand it to the doorbell thread
+    slot_t& slot = ring_[pos & (CAPACITY - 1)];
+    slot.phase   = phase;
+    slot.count   = count;
+    slot.sequence.store(pos + 1, memory_order_release);
+
+    // If the doorbell thread is asleep, wake it up.  The fence pairs with the one in
+    // doorbellThread() so that either it sees our token or we see that it's asleep
+    atomic_thread_fence(memory_order_seq_cst);
+    if (sleeping_.load(memory_order_relaxed))
+    {
+        wakeup_.fetch_add(1);
+        wakeup_.notify_one();
+    }
+
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// submit() - Pushes a token into the ring, waiting for room if the ring is full
+//=================================================================================================
+void FrameSubmitter::submit(uint32_t phase, uint32_t count)
+{
+    while (!trySubmit(phase, count))
+    {
+        fullRetries_.fetch_add(1, memory_order_relaxed);
+        this_thread::yield();
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// pop() - Removes the token at the head of the ring
+//
+// Returns: false if the ring is empty
+//=================================================================================================
+bool FrameSubmitter::pop(uint32_t* phase, uint32_t* count)
+{
+    uint64_t pos  = head_.load(memory_order_relaxed);
+    slot_t&  slot = ring_[pos & (CAPACITY - 1)];
+
+    // If the producer that claimed this slot hasn't filled it yet, the ring is empty
+    if (slot.sequence.load(memory_order_acquire) != pos + 1) return false;
+
+    // Fetch the token
+    *phase = slot.phase;
+    *count = slot.count;
+
+    // Make the slot available to producers on their next lap around the ring
+    slot.sequence.store(pos + CAPACITY, memory_order_release);
+    head_.store(pos + 1, memory_order_relaxed);
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// doorbellThread() - Drains the ring, coalescing all of the tokens for each phase into a single
+//                    doorbell write
+//=================================================================================================
+void FrameSubmitter::doorbellThread()
+{
+    uint32_t phase, count;
+
+    while (true)
+    {
+        uint64_t pending[2] = {0, 0};
+        uint32_t batch = 0;
+
+        // Keep track of the deepest the ring has been
+        uint32_t depth = (uint32_t)(tail_.load(memory_order_relaxed) - head_.load(memory_order_relaxed));
+        if (depth > maxDepth_.load(memory_order_relaxed)) maxDepth_.store(depth, memory_order_relaxed);
+
+        // Drain the ring, adding up the number of frames for each phase
+        while (batch < CAPACITY && pop(&phase, &count))
+        {
+            pending[phase] += count;
+            ++batch;
+        }
+
+        // Ring the doorbell once for each phase that has frames to submit.  A single doorbell
+        // write can't hold more than CMindy::MAX_FRAME_ADD frames
+        for (phase = 0; phase < 2; ++phase)
+        {
+            uint64_t remaining = pending[phase];
+            while (remaining)
+            {
+                uint32_t chunk = (remaining > CMindy::MAX_FRAME_ADD) ? CMindy::MAX_FRAME_ADD : (uint32_t)remaining;
+                mindy_->addLocalFrameCounter(phase, chunk);
+                doorbells_.fetch_add(1, memory_order_relaxed);
+                remaining -= chunk;
+            }
+            frames_[phase].fetch_add(pending[phase], memory_order_relaxed);
+        }
+
+        // Record the batch size
+        if (batch)
+        {
+            lastBatch_.store(batch, memory_order_relaxed);
+            if (batch > maxBatch_.load(memory_order_relaxed)) maxBatch_.store(batch, memory_order_relaxed);
+            continue;
+        }
+
+        // If we've been told to stop and the ring is empty, we're done
+        if (stopping_) break;
+
+        // The ring was empty.  Go to sleep until a producer wakes us up
+        uint32_t ticket = wakeup_.load();
+        sleeping_.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        // If a token arrived while we were deciding to sleep, don't sleep after all
+        uint64_t pos = head_.load(memory_order_relaxed);
+        if (ring_[pos & (CAPACITY - 1)].sequence.load(memory_order_acquire) == pos + 1 || stopping_)
+        {
+            sleeping_.store(false, memory_order_relaxed);
+            continue;
+        }
+
+        wakeup_.wait(ticket);
+        sleeping_.store(false, memory_order_relaxed);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// getStats() - Returns a snapshot of the queue and doorbell statistics
+//=================================================================================================
+FrameSubmitter::stats_t FrameSubmitter::getStats()
+{
+    stats_t stats;
+
+    stats.frames[0]   = frames_[0].load(memory_order_relaxed);
+    stats.frames[1]   = frames_[1].load(memory_order_relaxed);
+    stats.doorbells   = doorbells_.load(memory_order_relaxed);
+    stats.depth       = (uint32_t)(tail_.load(memory_order_relaxed) - head_.load(memory_order_relaxed));
+    stats.maxDepth    = maxDepth_.load(memory_order_relaxed);
+    stats.lastBatch   = lastBatch_.load(memory_order_relaxed);
+    stats.maxBatch    = maxBatch_.load(memory_order_relaxed);
+    stats.fullRetries = fullRetries_.load(memory_order_relaxed);
+
+    return stats;
+}
+//=================================================================================================
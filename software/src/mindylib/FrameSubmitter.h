@@ -0,0 +1,120 @@
+//=================================================================================================
+// FrameSubmitter.h - Lock-free, multi-producer frame submission for Mindy
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include "mindy.h"
+
+/*
+    Any number of producer threads call submit() to tell Mindy that a frame is ready.  Each
+    call pushes a token into a lock-free, bounded, multi-producer/single-consumer ring.  A
+    single "doorbell" thread drains the ring, adds up the tokens for each phase, and rings
+    Mindy's doorbell with one CMindy::addLocalFrameCounter() per phase per batch.
+
+    Frames of a given phase are always submitted to Mindy in the order in which submit()
+    was called for them.
+
+    Tokens only count frames; they don't say where in the host buffers a frame is.  Producers
+    that work that out for themselves must stop submitting around CMindy::commitConfig(),
+    which restarts every ring at offset 0, and resync from the ring state it returns.
+
+    Example:
+
+        FrameSubmitter submitter;
+        submitter.start(Mindy);
+
+        // From any thread...
+        submitter.submit(phase);
+
+        // When finished
+        submitter.stop();
+*/
+
+class FrameSubmitter
+{
+public:
+
+    // The number of tokens the ring can hold.  Must be a power of 2
+    static constexpr uint32_t CAPACITY = 4096;
+
+    // Statistics about the queue and about the doorbell batches
+    struct stats_t
+    {
+        uint64_t    frames[2];      // Total frames submitted to Mindy, per phase
+        uint64_t    doorbells;      // Total number of doorbell writes
+        uint32_t    depth;          // Number of tokens in the ring right now
+        uint32_t    maxDepth;       // Largest ring depth the doorbell thread has seen
+        uint32_t    lastBatch;      // Number of tokens drained in the most recent batch
+        uint32_t    maxBatch;       // Largest number of tokens drained in one batch
+        uint64_t    fullRetries;    // Number of times a producer found the ring full
+    };
+
+    // Default constructor
+    FrameSubmitter();
+
+    // Destructor
+    ~FrameSubmitter() {stop();}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    FrameSubmitter (const FrameSubmitter&) = delete;
+    FrameSubmitter& operator= (const FrameSubmitter&) = delete;
+
+    // Starts the doorbell thread
+    void        start(CMindy& mindy);
+
+    // Submits every token still in the ring, then stops the doorbell thread
+    void        stop();
+
+    // Queues "count" frames for the specified phase.  If the ring is full, this waits
+    void        submit(uint32_t phase, uint32_t count = 1);
+
+    // Same as submit(), but returns false instead of waiting if the ring is full
+    bool        trySubmit(uint32_t phase, uint32_t count = 1);
+
+    // Returns a snapshot of the statistics
+    stats_t     getStats();
+
+protected:
+
+    // A slot in the ring.  "sequence" tells producers and the consumer whose turn it is
+    struct alignas(64) slot_t
+    {
+        std::atomic<uint64_t>   sequence;
+        uint32_t                phase;
+        uint32_t                count;
+    };
+
+    // Removes a token from the ring.  Only the doorbell thread calls this
+    bool        pop(uint32_t* phase, uint32_t* count);
+
+    // This is the doorbell thread
+    void        doorbellThread();
+
+    // The Mindy we're submitting frames to
+    CMindy*     mindy_ = nullptr;
+
+    // The ring of tokens
+    slot_t      ring_[CAPACITY];
+
+    // Producers claim slots at the tail, the doorbell thread drains them from the head
+    alignas(64) std::atomic<uint64_t> tail_;
+    alignas(64) std::atomic<uint64_t> head_;
+
+    // The doorbell thread sleeps on this when the ring is empty
+    alignas(64) std::atomic<uint32_t> wakeup_;
+    std::atomic<bool>                 sleeping_;
+    std::atomic<bool>                 stopping_;
+
+    // Statistics
+    std::atomic<uint64_t>   frames_[2];
+    std::atomic<uint64_t>   doorbells_;
+    std::atomic<uint32_t>   maxDepth_;
+    std::atomic<uint32_t>   lastBatch_;
+    std::atomic<uint32_t>   maxBatch_;
+    std::atomic<uint64_t>   fullRetries_;
+
+    // The doorbell thread itself
+    std::thread thread_;
+};
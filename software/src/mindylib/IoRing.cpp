@@ -0,0 +1,179 @@
+//=================================================================================================
+// IoRing.cpp - A minimal io_uring wrapper for streaming file reads and writes
+//=================================================================================================
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "IoRing.h"
+#include "throwRuntime.h"
+
+using namespace std;
+
+
+//=================================================================================================
+// Accessors for the ring indices that the kernel shares with us
+//=================================================================================================
+static inline uint32_t loadAcquire(uint32_t* p)            {return __atomic_load_n(p, __ATOMIC_ACQUIRE);}
+static inline void     storeRelease(uint32_t* p, uint32_t v) {__atomic_store_n(p, v, __ATOMIC_RELEASE);}
+//=================================================================================================
+
+
+//=================================================================================================
+// open() - Creates the ring and maps its submission and completion queues into our space
+//=================================================================================================
+void IoRing::open(uint32_t entries)
+{
+    if (fd_ >= 0) throwRuntime("IoRing::open() called twice");
+
+    io_uring_params params;
+    memset(&params, 0, sizeof params);
+
+    fd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd_ < 0) throwRuntime("io_uring_setup failed: %s", strerror(errno));
+
+    entries_   = params.sq_entries;
+    sqMapSize_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cqMapSize_ = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+    sqesSize_  = params.sq_entries * sizeof(io_uring_sqe);
+
+    // On newer kernels, both rings live in a single mapping
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && cqMapSize_ > sqMapSize_) sqMapSize_ = cqMapSize_;
+
+    sqMap_ = mmap(0, sqMapSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sqMap_ == MAP_FAILED) {sqMap_ = nullptr; close(); throwRuntime("Can't map the io_uring SQ");}
+
+    if (single)
+        cqMap_ = sqMap_;
+    else
+    {
+        cqMap_ = mmap(0, cqMapSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cqMap_ == MAP_FAILED) {cqMap_ = nullptr; close(); throwRuntime("Can't map the io_uring CQ");}
+    }
+
+    void* sqes = mmap(0, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {close(); throwRuntime("Can't map the io_uring SQEs");}
+    sqes_ = (io_uring_sqe*)sqes;
+
+    uint8_t* sq = (uint8_t*)sqMap_;
+    sqHead_  = (uint32_t*)(sq + params.sq_off.head);
+    sqTail_  = (uint32_t*)(sq + params.sq_off.tail);
+    sqMask_  = (uint32_t*)(sq + params.sq_off.ring_mask);
+    sqArray_ = (uint32_t*)(sq + params.sq_off.array);
+
+    uint8_t* cq = (uint8_t*)cqMap_;
+    cqHead_  = (uint32_t*)(cq + params.cq_off.head);
+    cqTail_  = (uint32_t*)(cq + params.cq_off.tail);
+    cqMask_  = (uint32_t*)(cq + params.cq_off.ring_mask);
+    cqes_    = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    toSubmit_ = 0;
+    inFlight_ = 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// close() - Unmaps the queues and destroys the ring
+//=================================================================================================
+void IoRing::close()
+{
+    if (sqes_)  munmap(sqes_, sqesSize_);
+    if (cqMap_ && cqMap_ != sqMap_) munmap(cqMap_, cqMapSize_);
+    if (sqMap_) munmap(sqMap_, sqMapSize_);
+    if (fd_ >= 0) ::close(fd_);
+
+    sqes_  = nullptr;
+    cqMap_ = nullptr;
+    sqMap_ = nullptr;
+    fd_    = -1;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// prep() - Fills in the next submission-queue entry
+//=================================================================================================
+void IoRing::prep(uint8_t opcode, int fd, const void* buffer, uint32_t bytes, uint64_t offset,
+                  uint64_t userData)
+{
+    if (fd_ < 0) throwRuntime("IoRing used before open()");
+    if (inFlight_ == entries_) throwRuntime("IoRing: more than %u requests in flight", entries_);
+
+    uint32_t tail  = *sqTail_ + toSubmit_;
+    uint32_t index = tail & *sqMask_;
+
+    io_uring_sqe& sqe = sqes_[index];
+    memset(&sqe, 0, sizeof sqe);
+    sqe.opcode    = opcode;
+    sqe.fd        = fd;
+    sqe.addr      = (uint64_t)buffer;
+    sqe.len       = bytes;
+    sqe.off       = offset;
+    sqe.user_data = userData;
+
+    sqArray_[index] = index;
+    ++toSubmit_;
+    ++inFlight_;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// prepRead() / prepWrite() - Queue a read into (or a write from) "buffer" at a file offset
+//=================================================================================================
+void IoRing::prepRead(int fd, void* buffer, uint32_t bytes, uint64_t offset, uint64_t userData)
+{
+    prep(IORING_OP_READ, fd, buffer, bytes, offset, userData);
+}
+
+void IoRing::prepWrite(int fd, const void* buffer, uint32_t bytes, uint64_t offset, uint64_t userData)
+{
+    prep(IORING_OP_WRITE, fd, buffer, bytes, offset, userData);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// submit() - Publishes the queued entries and enters the kernel
+//=================================================================================================
+void IoRing::submit(uint32_t minComplete)
+{
+    if (toSubmit_ == 0 && minComplete == 0) return;
+
+    // Make the new entries visible to the kernel
+    storeRelease(sqTail_, *sqTail_ + toSubmit_);
+
+    uint32_t flags = minComplete ? IORING_ENTER_GETEVENTS : 0;
+    while (true)
+    {
+        int rc = syscall(__NR_io_uring_enter, fd_, toSubmit_, minComplete, flags, nullptr, 0);
+        if (rc >= 0) break;
+        if (errno != EINTR) throwRuntime("io_uring_enter failed: %s", strerror(errno));
+    }
+
+    toSubmit_ = 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reap() - Removes one completion from the completion queue
+//=================================================================================================
+bool IoRing::reap(uint64_t* userData, int32_t* result)
+{
+    uint32_t head = *cqHead_;
+    if (head == loadAcquire(cqTail_)) return false;
+
+    io_uring_cqe& cqe = cqes_[head & *cqMask_];
+    *userData = cqe.user_data;
+    *result   = cqe.res;
+
+    storeRelease(cqHead_, head + 1);
+    --inFlight_;
+    return true;
+}
+//=================================================================================================
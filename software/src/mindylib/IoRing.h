@@ -0,0 +1,94 @@
+//=================================================================================================
+// IoRing.h - A minimal io_uring wrapper for streaming file reads and writes
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <linux/io_uring.h>
+
+/*
+    This talks to the kernel's io_uring interface directly (there's no dependency on liburing).
+    It supports exactly what the replay and record engines need: queueing reads and writes at
+    explicit file offsets, submitting them with a single system call, and reaping completions.
+
+    Every request carries a 64-bit "userData" that comes back with its completion.  The
+    caller must not have more than "entries" requests queued or in flight at once.
+
+    Example:
+
+        IoRing ring;
+        ring.open(32);
+        ring.prepRead(fd, buffer, 4096, 0, 1234);
+        ring.submit(1);
+        ring.reap(&userData, &result);      // result = bytes read, or -errno
+*/
+
+class IoRing
+{
+public:
+
+    // Default constructor
+    IoRing() {};
+
+    // Destructor
+    ~IoRing() {close();}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    IoRing (const IoRing&) = delete;
+    IoRing& operator= (const IoRing&) = delete;
+
+    // Creates the ring.  "entries" is rounded up to a power of 2 by the kernel
+    void        open(uint32_t entries);
+
+    // Destroys the ring
+    void        close();
+
+    // Queue a read or a write.  Nothing is sent to the kernel until submit()
+    void        prepRead (int fd, void* buffer, uint32_t bytes, uint64_t offset, uint64_t userData);
+    void        prepWrite(int fd, const void* buffer, uint32_t bytes, uint64_t offset, uint64_t userData);
+
+    // Hands the queued requests to the kernel, and waits until at least "minComplete"
+    // completions are available
+    void        submit(uint32_t minComplete = 0);
+
+    // Removes one completion.  Returns false if there isn't one
+    bool        reap(uint64_t* userData, int32_t* result);
+
+    // Returns the number of requests that have been queued but not reaped
+    uint32_t    inFlight() {return inFlight_;}
+
+protected:
+
+    // Fills in the next submission-queue entry
+    void        prep(uint8_t opcode, int fd, const void* buffer, uint32_t bytes, uint64_t offset,
+                     uint64_t userData);
+
+    // The file descriptor of the ring
+    int         fd_ = -1;
+
+    // The submission and completion rings, as mapped from the kernel
+    void*       sqMap_ = nullptr;
+    void*       cqMap_ = nullptr;
+    size_t      sqMapSize_ = 0;
+    size_t      cqMapSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t      sqesSize_ = 0;
+
+    // Pointers into the mapped rings
+    uint32_t*   sqHead_;
+    uint32_t*   sqTail_;
+    uint32_t*   sqMask_;
+    uint32_t*   sqArray_;
+    uint32_t*   cqHead_;
+    uint32_t*   cqTail_;
+    uint32_t*   cqMask_;
+    io_uring_cqe* cqes_;
+
+    // Entries we've queued that the kernel hasn't been told about yet
+    uint32_t    toSubmit_ = 0;
+
+    // The number of entries in the submission ring
+    uint32_t    entries_ = 0;
+
+    // Requests queued but not yet reaped
+    uint32_t    inFlight_ = 0;
+};
@@ -0,0 +1,405 @@
+//=================================================================================================
+// LatencyTrace.cpp - Per-frame latency measurement, from the doorbell to the remote FC write
+//=================================================================================================
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <x86intrin.h>
+#include "LatencyTrace.h"
+#include "throwRuntime.h"
+using namespace std;
+
+// The trace entries carry a 47-bit timestamp and a 16-bit frame sequence number
+static const uint64_t STAMP_MASK    = (1ULL << 47) - 1;
+static const uint32_t SEQUENCE_SLOTS = 1 << 16;
+
+// A frame has been completely traced when all of these bits are set in frame_t::seen
+static const uint8_t  ALL_SEEN = (1 << CMindy::TRACE_POINTS) - 1;
+
+//=================================================================================================
+// bucketOf() - Returns the index of the bucket that holds "value".  Values below 2*SUB_COUNT
+//              get a bucket each, above that each power of two gets SUB_COUNT buckets
+//=================================================================================================
+uint32_t LatencyHistogram::bucketOf(uint64_t value)
+{
+    if (value < 2 * SUB_COUNT) return (uint32_t)value;
+    uint32_t shift = 63 - __builtin_clzll(value) - SUB_BITS;
+    return shift * SUB_COUNT + (uint32_t)(value >> shift);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// highestIn() - Returns the largest value that maps to the specified bucket
+//=================================================================================================
+uint64_t LatencyHistogram::highestIn(uint32_t bucket)
+{
+    if (bucket < 2 * SUB_COUNT) return bucket;
+    uint32_t shift = bucket / SUB_COUNT - 1;
+    uint64_t base  = bucket % SUB_COUNT + SUB_COUNT;
+    return (base << shift) + ((1ULL << shift) - 1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reset() - Clears all recorded values
+//=================================================================================================
+void LatencyHistogram::reset()
+{
+    buckets_.assign(BUCKETS, 0);
+    count_ = sum_ = max_ = 0;
+    min_   = UINT64_MAX;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// record() - Records a single value
+//=================================================================================================
+void LatencyHistogram::record(uint64_t value)
+{
+    buckets_[bucketOf(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_) min_ = value;
+    if (value > max_) max_ = value;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// percentile() - Returns the value at the given percentile
+//=================================================================================================
+uint64_t LatencyHistogram::percentile(double p) const
+{
+    if (count_ == 0) return 0;
+    if (p > 100.0) p = 100.0;
+
+    // This is the number of values that must be at or below the one we return
+    uint64_t target = (uint64_t)ceil(p / 100.0 * count_);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKETS; ++i)
+    {
+        seen += buckets_[i];
+        if (seen >= target) return (highestIn(i) < max_) ? highestIn(i) : max_;
+    }
+
+    return max_;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// writePercentiles() - Writes the percentile distribution in HdrHistogram's text format.  As
+//                      in HdrHistogram, there are 5 reporting steps per halving of the distance
+//                      to 100%, so the tail is reported in ever finer detail
+//=================================================================================================
+void LatencyHistogram::writePercentiles(FILE* file, double scale) const
+{
+    const uint32_t TICKS_PER_HALF_DISTANCE = 5;
+
+    fprintf(file, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    if (count_ == 0) return;
+
+    double p = 0.0;
+    while (true)
+    {
+        uint64_t value  = percentile(p);
+        uint32_t bucket = bucketOf(value);
+        uint64_t total  = 0;
+        for (uint32_t i = 0; i <= bucket; ++i) total += buckets_[i];
+
+        // Once we've reported the largest value, report it as the 100th percentile and stop
+        if (total >= count_ || p >= 100.0)
+        {
+            fprintf(file, "%12.3f %2.12f %10lu\n", max_ / scale, 1.0, count_);
+            break;
+        }
+
+        fprintf(file, "%12.3f %2.12f %10lu %14.2f\n", value / scale, p / 100.0, total, 100.0 / (100.0 - p));
+
+        double halvings = floor(log2(100.0 / (100.0 - p))) + 1;
+        p += 100.0 / (TICKS_PER_HALF_DISTANCE * pow(2.0, halvings));
+    }
+
+    fprintf(file, "#[Mean    = %12.3f, Max         = %12.3f]\n", mean() / scale, max_ / scale);
+    fprintf(file, "#[Total count    = %12lu]\n", count_);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// Constructor
+//=================================================================================================
+LatencyTracer::LatencyTracer(CMindy& mindy) : mindy_(mindy)
+{
+    maxEvents_ = 100000;
+    frame_.resize(SEQUENCE_SLOTS);
+    tsc0_ = card0_ = 0;
+    nextSequence_ = 1;
+    nsPerTsc_ = nsPerCardTick_ = 1.0;
+    memset(&stats_, 0, sizeof(stats_));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reset() - Clears all state.  The frame sequence number in Mindy starts at 1 after a reset
+//=================================================================================================
+void LatencyTracer::reset()
+{
+    memset(frame_.data(), 0, frame_.size() * sizeof(frame_t));
+    memset(&stats_, 0, sizeof(stats_));
+    for (auto& h : histogram_) h.reset();
+    events_.clear();
+    nextSequence_ = 1;
+
+    // Throw away anything left over in the trace FIFOs
+    for (int point = 0; point < CMindy::TRACE_POINTS; ++point)
+    {
+        trace_.clear();
+        mindy_.readTrace((CMindy::tracePoint_t)point, trace_);
+    }
+
+    calibrate();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// calibrate() - Takes a pair of (TSC, card timestamp) readings "milliseconds" apart, and
+//               uses them to compute the rate of both clocks and the offset between them
+//=================================================================================================
+void LatencyTracer::calibrate(uint32_t milliseconds)
+{
+    using clock = chrono::steady_clock;
+
+    // Reads the card timestamp, and returns the TSC midway through the read.  The tightest
+    // of several readings is the most accurate
+    auto sample = [&](uint64_t& tsc, uint64_t& card)
+    {
+        uint64_t bestWindow = UINT64_MAX;
+        for (int i = 0; i < 16; ++i)
+        {
+            uint64_t before = __rdtsc();
+            uint64_t stamp  = mindy_.getCardTimestamp();
+            uint64_t after  = __rdtsc();
+            if (after - before < bestWindow)
+            {
+                bestWindow = after - before;
+                tsc  = before + (after - before) / 2;
+                card = stamp;
+            }
+        }
+    };
+
+    uint64_t tsc1, card1, tsc2, card2;
+
+    auto start = clock::now();
+    sample(tsc1, card1);
+    this_thread::sleep_for(chrono::milliseconds(milliseconds));
+    sample(tsc2, card2);
+    double elapsedNs = chrono::duration<double, nano>(clock::now() - start).count();
+
+    if (tsc2 == tsc1 || card2 == card1) throwRuntime("LatencyTracer: card timestamp isn't running");
+
+    tsc0_          = tsc1;
+    card0_         = card1;
+    nsPerTsc_      = elapsedNs / (double)(tsc2 - tsc1);
+    nsPerCardTick_ = (double)(tsc2 - tsc1) * nsPerTsc_ / (double)(card2 - card1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// submit() - Rings the doorbell for one frame and remembers when we did it
+//
+// Returns: The new value of the local frame counter
+//=================================================================================================
+uint32_t LatencyTracer::submit(uint32_t phase)
+{
+    frame_t& frame = frame_[nextSequence_++];
+
+    // If a frame that used this slot 65536 frames ago never completed, give up on it
+    if (frame.seen != 0 && frame.seen != ALL_SEEN) stats_.framesAbandoned++;
+
+    frame.seen  = 0;
+    frame.phase = phase;
+    frame.host  = __rdtsc();
+
+    return mindy_.incrementLocalFrameCounter(phase);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// unwrap() - Trace entries carry the low 47 bits of the timestamp.  This returns the most
+//            recent 64-bit timestamp (not after "now") whose low 47 bits match
+//=================================================================================================
+uint64_t LatencyTracer::unwrap(uint64_t stamp, uint64_t now)
+{
+    uint64_t result = (now & ~STAMP_MASK) | (stamp & STAMP_MASK);
+    if (result > now) result -= (STAMP_MASK + 1);
+    return result;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// collect() - Drains the trace FIFOs and matches entries to the frames they belong to
+//=================================================================================================
+void LatencyTracer::collect()
+{
+    // Any entry we read was recorded before this moment
+    uint64_t now = mindy_.getCardTimestamp();
+
+    for (int point = 0; point < CMindy::TRACE_POINTS; ++point)
+    {
+        trace_.clear();
+        mindy_.readTrace((CMindy::tracePoint_t)point, trace_);
+
+        for (uint64_t entry : trace_)
+        {
+            uint16_t sequence = entry >> 48;
+            frame_t& frame    = frame_[sequence];
+
+            // If this frame wasn't submitted by us, there's nothing to match it to
+            if (frame.host == 0)
+            {
+                stats_.entriesUnmatched++;
+                continue;
+            }
+
+            frame.card[point] = unwrap(entry, now);
+            frame.seen |= (1 << point);
+            if (frame.seen == ALL_SEEN) complete(sequence, frame);
+        }
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// complete() - Records the latencies of a frame for which every trace point has been seen
+//=================================================================================================
+void LatencyTracer::complete(uint16_t sequence, frame_t& frame)
+{
+    event_t event;
+    event.sequence = sequence;
+    event.phase    = frame.phase;
+
+    // ns[0] is the doorbell, ns[1..4] are the trace points in the order they occur
+    event.ns[0] = tscToNs(frame.host);
+    for (int point = 0; point < CMindy::TRACE_POINTS; ++point)
+        event.ns[point + 1] = cardToNs(frame.card[point]);
+
+    // Record the duration of each stage.  The doorbell stage is the only one that spans
+    // both clocks, so it's the only one that can (slightly) come out negative
+    for (int stage = DOORBELL; stage < TOTAL; ++stage)
+    {
+        double ns = event.ns[stage + 1] - event.ns[stage];
+        histogram_[stage].record(ns > 0 ? (uint64_t)ns : 0);
+    }
+    double total = event.ns[CMindy::TRACE_POINTS] - event.ns[0];
+    histogram_[TOTAL].record(total > 0 ? (uint64_t)total : 0);
+
+    if (events_.size() < maxEvents_) events_.push_back(event);
+
+    stats_.framesComplete++;
+
+    // Mark the slot as "complete but not awaiting anything"
+    frame.host = 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// getStats() - Returns statistics about the tracing itself
+//=================================================================================================
+LatencyTracer::stats_t LatencyTracer::getStats()
+{
+    stats_.entriesLost = 0;
+    for (int point = 0; point < CMindy::TRACE_POINTS; ++point)
+        stats_.entriesLost += mindy_.getTraceLost((CMindy::tracePoint_t)point);
+
+    return stats_;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stageName() - Returns the name of a stage
+//=================================================================================================
+const char* LatencyTracer::stageName(stage_t stage)
+{
+    static const char* name[] = {"doorbell", "fetch", "transmit", "fc_write", "total"};
+    return (stage < STAGES) ? name[stage] : "unknown";
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// writeHistograms() - Writes a summary line and the percentile distribution of each stage
+//=================================================================================================
+void LatencyTracer::writeHistograms(FILE* file)
+{
+    for (int stage = DOORBELL; stage < STAGES; ++stage)
+    {
+        const LatencyHistogram& h = histogram_[stage];
+        fprintf(file, "# %-9s frames=%lu min=%.3fus p50=%.3fus p99=%.3fus p99.9=%.3fus max=%.3fus\n",
+                stageName((stage_t)stage), h.count(), h.min() / 1e3, h.percentile(50) / 1e3,
+                h.percentile(99) / 1e3, h.percentile(99.9) / 1e3, h.max() / 1e3);
+        h.writePercentiles(file, 1000.0);
+        fprintf(file, "\n");
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// writeChromeTrace() - Writes each completed frame as a set of "complete" events.  Each phase
+//                      is a process, and each stage is a thread within it
+//=================================================================================================
+void LatencyTracer::writeChromeTrace(string filename)
+{
+    FILE* ofile = fopen(filename.c_str(), "w");
+    if (ofile == nullptr) throwRuntime("Can't create %s", filename.c_str());
+
+    fprintf(ofile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    // Name the processes and threads
+    const char* separator = "";
+    for (int phase = 0; phase < 2; ++phase)
+    {
+        fprintf(ofile, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%i,\"args\":{\"name\":\"phase %i\"}}",
+                separator, phase, phase);
+        separator = ",\n";
+        for (int stage = DOORBELL; stage < TOTAL; ++stage)
+            fprintf(ofile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+                    phase, stage, stageName((stage_t)stage));
+    }
+
+    // Timestamps are microseconds since the first doorbell in the file
+    double origin = events_.empty() ? 0 : events_[0].ns[0];
+
+    for (auto& event : events_)
+    {
+        for (int stage = DOORBELL; stage < TOTAL; ++stage)
+        {
+            double ts  = (event.ns[stage] - origin) / 1e3;
+            double dur = (event.ns[stage + 1] - event.ns[stage]) / 1e3;
+            fprintf(ofile, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%i,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"frame\":%u}}", stageName((stage_t)stage), event.phase, stage,
+                    ts, dur < 0 ? 0 : dur, event.sequence);
+        }
+    }
+
+    fprintf(ofile, "\n]}\n");
+    fclose(ofile);
+}
+//=================================================================================================
@@ -0,0 +1,191 @@
+//=================================================================================================
+// LatencyTrace.h - Per-frame latency measurement, from the doorbell to the remote FC write
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "mindy.h"
+
+/*
+    Mindy keeps a free-running timestamp counter, and records a timestamp for every frame at
+    four points in the design (see CMindy::tracePoint_t).  Each trace entry carries a frame
+    sequence number that starts at 1 when Mindy is reset and increments once per frame, so
+    the entries from the four trace points can be matched up with each other.
+
+    LatencyTracer adds a fifth point: the host TSC at the moment the doorbell was rung.  The
+    card's clock is calibrated against the TSC by reading the card timestamp between two
+    TSC reads; the host time of a card event is accurate to about half a PCIe round-trip.
+
+    The stages of a frame's life are:
+
+        DOORBELL - Host rang the doorbell         --> frame_counters accepted the command
+        FETCH    - Command accepted               --> first beat of frame data arrived
+        TRANSMIT - First beat arrived             --> last packet left the ping-ponger
+        FC_WRITE - Last packet left ping-ponger   --> both rdmx_shims wrote the frame counter
+        TOTAL    - Host rang the doorbell         --> both rdmx_shims wrote the frame counter
+
+    Every frame must be submitted through LatencyTracer::submit() (and nothing else may write
+    the local frame counters) or the host and card sequence numbers won't line up.  collect()
+    must be called before 65536 frames are outstanding, and the trace FIFOs in Mindy hold 256
+    entries each, so call it often.
+
+    Example:
+
+        LatencyTracer tracer(Mindy);
+        tracer.reset();
+
+        // For each frame...
+        tracer.submit(phase);
+        tracer.collect();
+
+        tracer.writeHistograms(stdout);
+        tracer.writeChromeTrace("frames.json");
+*/
+
+
+//=================================================================================================
+// LatencyHistogram - A log-linear histogram of nanosecond values, in the style of HdrHistogram
+//
+// Values are recorded with a relative error of less than 1/64, over the entire 64-bit range
+//=================================================================================================
+class LatencyHistogram
+{
+public:
+
+    LatencyHistogram() {reset();}
+
+    // Records a single value
+    void        record(uint64_t value);
+
+    // Clears all recorded values
+    void        reset();
+
+    // Returns the value at the given percentile (0.0 thru 100.0)
+    uint64_t    percentile(double p) const;
+
+    // Simple statistics
+    uint64_t    count() const {return count_;}
+    uint64_t    min()   const {return count_ ? min_ : 0;}
+    uint64_t    max()   const {return max_;}
+    double      mean()  const {return count_ ? (double)sum_ / count_ : 0.0;}
+
+    // Writes the percentile distribution in the HdrHistogram ".hgrm" text format, with
+    // values scaled by 1/scale (i.e., pass 1000 to report microseconds)
+    void        writePercentiles(FILE* file, double scale = 1.0) const;
+
+protected:
+
+    // Each power of two is split into this many linear sub-buckets
+    static const uint32_t SUB_BITS    = 6;
+    static const uint32_t SUB_COUNT   = 1 << SUB_BITS;
+    static const uint32_t BUCKETS     = (64 - SUB_BITS) * SUB_COUNT + SUB_COUNT;
+
+    // Maps a value to its bucket, and a bucket to the highest value it holds
+    static uint32_t bucketOf(uint64_t value);
+    static uint64_t highestIn(uint32_t bucket);
+
+    std::vector<uint64_t>   buckets_;
+    uint64_t                count_, sum_, min_, max_;
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// LatencyTracer - Correlates Mindy's trace points with the host's doorbell writes
+//=================================================================================================
+class LatencyTracer
+{
+public:
+
+    enum stage_t {DOORBELL, FETCH, TRANSMIT, FC_WRITE, TOTAL, STAGES};
+
+    // Statistics about the tracing itself
+    struct stats_t
+    {
+        uint64_t    framesComplete;     // Frames for which every trace point was seen
+        uint64_t    framesAbandoned;    // Frames still incomplete when their slot was reused
+        uint64_t    entriesUnmatched;   // Entries for frames that weren't submitted via submit()
+        uint32_t    entriesLost;        // Entries Mindy discarded because a FIFO was full
+    };
+
+    // Constructor.  Doesn't touch the hardware; call reset() before submitting frames
+    LatencyTracer(CMindy& mindy);
+
+    // Clears all state and re-calibrates.  Call this right after Mindy has been reset
+    void        reset();
+
+    // Measures the relationship between the TSC and the card's timestamp counter
+    void        calibrate(uint32_t milliseconds = 100);
+
+    // Rings the doorbell for one frame, recording the TSC when it was done
+    uint32_t    submit(uint32_t phase);
+
+    // Drains Mindy's trace FIFOs and records the latency of every frame that is complete
+    void        collect();
+
+    // Fetch the histogram for a stage
+    const LatencyHistogram& histogram(stage_t stage) const {return histogram_[stage];}
+
+    // Returns statistics about the tracing itself
+    stats_t     getStats();
+
+    // Returns the name of a stage
+    static const char* stageName(stage_t stage);
+
+    // Writes a summary and the percentile distribution of every stage, in microseconds
+    void        writeHistograms(FILE* file);
+
+    // Writes every completed frame as a Chrome trace-event file (chrome://tracing, Perfetto)
+    void        writeChromeTrace(std::string filename);
+
+    // The maximum number of frames kept for writeChromeTrace()
+    void        setMaxEvents(size_t count) {maxEvents_ = count;}
+
+protected:
+
+    // The timestamps for one frame. "card[]" is in card ticks, "host" is in TSC ticks
+    struct frame_t
+    {
+        uint64_t    host;
+        uint64_t    card[CMindy::TRACE_POINTS];
+        uint8_t     phase;
+        uint8_t     seen;
+    };
+
+    // A completed frame, in nanoseconds since calibration
+    struct event_t
+    {
+        uint16_t    sequence;
+        uint8_t     phase;
+        double      ns[CMindy::TRACE_POINTS + 1];
+    };
+
+    // Converts a card timestamp or a TSC value to nanoseconds since calibration
+    double      cardToNs(uint64_t card) {return (double)(int64_t)(card - card0_) * nsPerCardTick_;}
+    double      tscToNs (uint64_t tsc)  {return (double)(int64_t)(tsc - tsc0_) * nsPerTsc_;}
+
+    // Extends a 47-bit trace timestamp to 64 bits
+    uint64_t    unwrap(uint64_t stamp, uint64_t now);
+
+    // Called when every trace point of a frame has been seen
+    void        complete(uint16_t sequence, frame_t& frame);
+
+    CMindy&                 mindy_;
+
+    // One slot for every possible value of the 16-bit frame sequence number
+    std::vector<frame_t>    frame_;
+    uint16_t                nextSequence_;
+
+    // The calibration
+    uint64_t                tsc0_, card0_;
+    double                  nsPerTsc_, nsPerCardTick_;
+
+    LatencyHistogram        histogram_[STAGES];
+    std::vector<event_t>    events_;
+    size_t                  maxEvents_;
+    stats_t                 stats_;
+    std::vector<uint64_t>   trace_;
+};
+//=================================================================================================
@@ -0,0 +1,176 @@
+//=================================================================================================
+// LinkMonitor.cpp - Watches the QSFP links and the latched errors from a background thread
+//=================================================================================================
+#include <cstdio>
+#include <stdexcept>
+#include "LinkMonitor.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+
+
+//=================================================================================================
+// start() - Takes the first sample, so that status() is valid on return, then starts sampling
+//           in the background
+//=================================================================================================
+void LinkMonitor::start(const config_t& config)
+{
+    if (thread_.joinable()) throwRuntime("LinkMonitor::start() called twice");
+
+    if (config.minIntervalUs == 0 || config.maxIntervalUs < config.minIntervalUs)
+        throwRuntime("LinkMonitor: bad sampling intervals");
+
+    config_    = config;
+    healthy_   = STATUS_RUNNING | (config.expectedLinks & STATUS_LINKS_MASK);
+    startTime_ = steady_clock::now();
+    stopping_  = false;
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        history_.clear();
+        stats_ = {};
+    }
+
+    // An expected link that's down when we start is reported as having dropped
+    links_  = config.expectedLinks & STATUS_LINKS_MASK;
+    status_ = STATUS_RUNNING | links_;
+    sample();
+
+    thread_ = thread(&LinkMonitor::monitorThread, this);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stop() - Stops the monitor thread.  The status word keeps its last value, without the
+//          "running" bit
+//=================================================================================================
+void LinkMonitor::stop()
+{
+    if (!thread_.joinable()) return;
+
+    stopping_ = true;
+    thread_.join();
+
+    status_.fetch_and(~STATUS_RUNNING);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// takeErrors() - Returns the error bits that have been latched since the last call
+//=================================================================================================
+uint32_t LinkMonitor::takeErrors()
+{
+    uint32_t old = status_.fetch_and(~STATUS_ERROR_MASK);
+    return (old & STATUS_ERROR_MASK) >> STATUS_ERROR_SHIFT;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// history() - Returns a copy of the event history
+//=================================================================================================
+vector<LinkMonitor::event_t> LinkMonitor::history()
+{
+    lock_guard<mutex> lock(mutex_);
+    return vector<event_t>(history_.begin(), history_.end());
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// getStats() - Returns a copy of the counters
+//=================================================================================================
+LinkMonitor::stats_t LinkMonitor::getStats()
+{
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// monitorThread() - Samples the card, quickly while things are changing and more and more
+//                   slowly while they aren't
+//=================================================================================================
+void LinkMonitor::monitorThread()
+{
+    uint32_t intervalUs = config_.minIntervalUs;
+
+    while (!stopping_)
+    {
+        this_thread::sleep_for(microseconds(intervalUs));
+
+        if (sample())
+            intervalUs = config_.minIntervalUs;
+        else
+            intervalUs = min(intervalUs * 2, config_.maxIntervalUs);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// sample() - Reads the QSFP status and the latched errors, updates the status word, and
+//            reports whatever has changed
+//
+// Latched errors are cleared on the card as soon as they're seen.  Only the bits that were read
+// are cleared, so an error that latches between the read and the clear is seen next time
+//=================================================================================================
+bool LinkMonitor::sample()
+{
+    uint32_t links  = mindy_.getQsfpStatus() & STATUS_LINKS_MASK;
+    uint32_t errors = mindy_.getErrorStatus();
+    if (errors) mindy_.clearErrorStatus(errors);
+
+    // Fold the new state into the status word, keeping errors the application hasn't taken
+    uint32_t errorBits = (errors << STATUS_ERROR_SHIFT) & STATUS_ERROR_MASK;
+    uint32_t old = status_.load(memory_order_relaxed);
+    while (!status_.compare_exchange_weak(old, (old & STATUS_ERROR_MASK) | errorBits | links
+                                               | STATUS_RUNNING));
+
+    // Report each link that changed, then the errors
+    uint32_t changed = links ^ links_;
+    links_ = links;
+
+    for (uint32_t link = 0; link < 8; ++link)
+    {
+        if (changed & (1 << link)) report((links & (1 << link)) ? LINK_UP : LINK_DOWN, link, links);
+    }
+
+    if (errors) report(ERROR_LATCHED, errors, links);
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        ++stats_.samples;
+    }
+
+    return changed || errors;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// report() - Adds an event to the history and passes it to every callback
+//=================================================================================================
+void LinkMonitor::report(eventType_t type, uint32_t detail, uint32_t links)
+{
+    event_t event;
+    event.type    = type;
+    event.detail  = detail;
+    event.links   = links;
+    event.seconds = duration<double>(steady_clock::now() - startTime_).count();
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        history_.push_back(event);
+        while (history_.size() > config_.historySize) history_.pop_front();
+        if (type == LINK_DOWN)     ++stats_.linkDrops;
+        if (type == ERROR_LATCHED) ++stats_.errors;
+    }
+
+    for (auto& callback : callbacks_) callback(event);
+}
+//=================================================================================================
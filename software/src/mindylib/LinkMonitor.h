@@ -0,0 +1,150 @@
+//=================================================================================================
+// LinkMonitor.h - Watches the QSFP links and the latched errors from a background thread
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include "mindy.h"
+
+/*
+    Reading the QSFP status or the error status is a PCIe round trip.  Rather than have a
+    producer do that for every frame, LinkMonitor does it from a thread of its own and keeps
+    the result in a single atomic word, so that checking the health of the card costs a load
+    from the producer's own cache:
+
+        LinkMonitor monitor(Mindy);
+        monitor.onEvent([](const LinkMonitor::event_t& event) {...});
+        monitor.start();
+
+        while (producing)
+        {
+            if (!monitor.healthy()) handleTrouble(monitor.status());
+            ...
+        }
+
+    The monitor samples quickly ("minIntervalUs") after anything has changed and backs off
+    toward "maxIntervalUs" while nothing does.  When it finds an error latched in status_mgr
+    it clears it on the card, so that the next one can be seen, and keeps it in the status
+    word until the application calls takeErrors().
+
+    Every change is recorded as an event, kept in a short history and passed to the callbacks.
+    Callbacks run on the monitor's thread, so they must be quick and mustn't call stop().
+*/
+
+class LinkMonitor
+{
+public:
+
+    // The layout of the status word
+    static constexpr uint32_t STATUS_LINKS_MASK  = 0x000000FF;  // As from getQsfpStatus()
+    static constexpr uint32_t STATUS_ERROR_SHIFT = 8;           // Latched errors since takeErrors()
+    static constexpr uint32_t STATUS_ERROR_MASK  = 0x00FFFF00;
+    static constexpr uint32_t STATUS_RUNNING     = 0x80000000;  // The monitor is sampling
+
+    enum eventType_t
+    {
+        LINK_DOWN,          // A link that was up went down
+        LINK_UP,            // A link that was down came up
+        ERROR_LATCHED       // The card latched an error (see CMindy::errorBits_t)
+    };
+
+    struct event_t
+    {
+        eventType_t type;
+        uint32_t    detail;         // The link number, or the error bits
+        uint32_t    links;          // The QSFP status after the event
+        double      seconds;        // Since the monitor started
+    };
+
+    struct config_t
+    {
+        uint32_t    minIntervalUs = 100;    // Sampling interval just after a change
+        uint32_t    maxIntervalUs = 10000;  // Sampling interval once things are quiet
+        uint32_t    expectedLinks = 3;      // The links that must be up to be healthy
+        uint32_t    historySize   = 256;    // Events kept in the history
+    };
+
+    struct stats_t
+    {
+        uint64_t    samples;        // Times the card was sampled
+        uint64_t    linkDrops;      // LINK_DOWN events
+        uint64_t    errors;         // ERROR_LATCHED events
+    };
+
+    using callback_t = std::function<void(const event_t& event)>;
+
+    // Constructor
+    LinkMonitor(CMindy& mindy) : mindy_(mindy) {}
+
+    // Destructor
+    ~LinkMonitor() {stop();}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    LinkMonitor (const LinkMonitor&) = delete;
+    LinkMonitor& operator= (const LinkMonitor&) = delete;
+
+    // Registers a callback.  Call this before start()
+    void        onEvent(callback_t callback) {callbacks_.push_back(callback);}
+
+    // Takes the first sample, then starts the monitor thread
+    void        start() {start(config_t());}
+    void        start(const config_t& config);
+
+    // Stops the monitor thread
+    void        stop();
+
+    // Returns the status word.  This doesn't touch the card
+    uint32_t    status() {return status_.load(std::memory_order_relaxed);}
+
+    // Returns true if the expected links are up and no error has been latched
+    bool        healthy() {return status() == healthy_;}
+
+    // Returns the error bits latched since the last call, and forgets them
+    uint32_t    takeErrors();
+
+    // Returns the most recent events, oldest first
+    std::vector<event_t> history();
+
+    // Returns counts of what the monitor has seen
+    stats_t     getStats();
+
+protected:
+
+    // Samples the card every so often until "stopping_" is set
+    void        monitorThread();
+
+    // Reads the card once, and reports any changes.  Returns true if anything changed
+    bool        sample();
+
+    // Records an event and passes it to the callbacks
+    void        report(eventType_t type, uint32_t detail, uint32_t links);
+
+    CMindy&     mindy_;
+    config_t    config_;
+
+    // The status word, and the value it has when all is well
+    std::atomic<uint32_t> status_ {0};
+    uint32_t    healthy_ = 0;
+
+    // The QSFP status as of the last sample
+    uint32_t    links_ = 0;
+
+    std::vector<callback_t> callbacks_;
+
+    // The event history, and the counters.  "mutex_" guards both
+    std::deque<event_t> history_;
+    stats_t     stats_ {};
+    std::mutex  mutex_;
+
+    // When we started, for timestamping events
+    std::chrono::steady_clock::time_point startTime_;
+
+    std::thread thread_;
+    std::atomic<bool> stopping_ {false};
+};
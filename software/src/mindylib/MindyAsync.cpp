@@ -0,0 +1,296 @@
+//=================================================================================================
+// MindyAsync.cpp - A single-threaded, coroutine based API for submitting frames to Mindy
+//=================================================================================================
+#include <poll.h>
+#include <time.h>
+#include <stdexcept>
+#include <algorithm>
+#include "MindyAsync.h"
+#include "throwRuntime.h"
+using namespace std;
+
+//=================================================================================================
+// Task::operator=() - Move assignment.  Destroys whatever coroutine we already owned
+//=================================================================================================
+Task& Task::operator= (Task&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        if (handle_) handle_.destroy();
+        handle_ = rhs.handle_;
+        rhs.handle_ = nullptr;
+    }
+    return *this;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// Task::await_resume() - Called in the awaiting coroutine when the Task finishes.  If the Task
+//                        threw an exception, it gets re-thrown in the awaiting coroutine
+//=================================================================================================
+void Task::await_resume()
+{
+    if (handle_ && handle_.promise().exception)
+        rethrow_exception(handle_.promise().exception);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// ~CMindyReactor() - Destroys any Tasks that never finished.  Destroying a Task also destroys
+//                    any Task that it was awaiting
+//=================================================================================================
+CMindyReactor::~CMindyReactor()
+{
+    for (auto h : tasks_) h.destroy();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// spawn() - Takes ownership of a Task and schedules it to start running
+//=================================================================================================
+void CMindyReactor::spawn(Task&& task)
+{
+    Task::handle_t h = task.release();
+    if (h == nullptr) return;
+    tasks_.push_back(h);
+    ready_.push_back(h);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// run() - Runs the event loop until every Task has finished
+//=================================================================================================
+void CMindyReactor::run()
+{
+    while (runOnce());
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// runOnce() - Resumes every coroutine that is ready to run, then waits (for no longer than
+//             "timeout") for another coroutine to become ready.
+//
+// Returns: false if there are no unfinished Tasks, otherwise true
+//=================================================================================================
+bool CMindyReactor::runOnce(duration_t timeout)
+{
+    // Resume every coroutine that is ready to run.  Any of them may make others ready
+    while (!ready_.empty())
+    {
+        coroutine_handle<> h = ready_.front();
+        ready_.pop_front();
+        h.resume();
+    }
+
+    // Clean up the Tasks that have finished
+    reapTasks();
+    if (tasks_.empty()) return false;
+
+    // If we have frames in flight, we can't wait any longer than the frame-poll interval
+    if (!frameWaiters_[0].empty() || !frameWaiters_[1].empty())
+        timeout = min(timeout, framePollInterval_);
+
+    // If we have timers running, we don't want to wait past the earliest one
+    auto now = clock_type::now();
+    for (auto& timer : timers_)
+    {
+        auto remaining = chrono::duration_cast<duration_t>(timer.deadline - now);
+        timeout = min(timeout, max(remaining, duration_t(0)));
+    }
+
+    // Wait for file descriptors to become ready, or for the timeout to expire
+    pollIo(timeout);
+
+    // Find out which frames have been fetched and which timers have expired
+    pollFrames();
+    pollTimers();
+
+    // Tell the caller that there is still work to do
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// inFlight() - Returns the number of frames of a phase that have been submitted to Mindy but
+//              not yet fetched
+//=================================================================================================
+uint32_t CMindyReactor::inFlight(uint32_t phase)
+{
+    return mindy_.getLocalFrameCounter(phase) - mindy_.getFetchedFrameCount(phase);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// submitFrame() - Rings Mindy's doorbell for the next frame of the specified phase.  The frame
+//                 has been submitted as soon as this returns; awaiting the result suspends the
+//                 caller until Mindy has fetched the frame
+//=================================================================================================
+CMindyReactor::FrameAwaiter CMindyReactor::submitFrame(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on submitFrame()");
+    uint32_t frameNumber = mindy_.incrementLocalFrameCounter(phase);
+    return {*this, phase, frameNumber};
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// waitReadable() / waitWritable() - Return an awaitable that completes when a file descriptor
+//                                   becomes readable or writable.  The co_await expression
+//                                   evaluates to the "revents" that poll() reported
+//=================================================================================================
+CMindyReactor::IoAwaiter CMindyReactor::waitReadable(int fd)
+{
+    return {*this, fd, POLLIN};
+}
+
+CMindyReactor::IoAwaiter CMindyReactor::waitWritable(int fd)
+{
+    return {*this, fd, POLLOUT};
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// isFetched() - Returns true if the most recently polled "frames fetched" counter shows that
+//               the specified frame has been fetched.
+//
+// The comparison is done so that it still works after the 32-bit counters wrap around
+//=================================================================================================
+bool CMindyReactor::isFetched(uint32_t phase, uint32_t frameNumber)
+{
+    return (int32_t)(fetched_[phase] - frameNumber) >= 0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// addFrameWaiter() - Records that a coroutine is waiting for a frame to be fetched
+//=================================================================================================
+void CMindyReactor::addFrameWaiter(uint32_t phase, uint32_t frameNumber, coroutine_handle<> h)
+{
+    frameWaiters_[phase].push_back({frameNumber, h});
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// pollFrames() - Reads the "frames fetched" counter of any phase that has frames in flight, and
+//                makes every coroutine whose frame has been fetched ready to run
+//=================================================================================================
+void CMindyReactor::pollFrames()
+{
+    for (uint32_t phase = 0; phase < 2; ++phase)
+    {
+        auto& waiters = frameWaiters_[phase];
+
+        // If nobody is waiting on this phase, don't bother reading the counter
+        if (waiters.empty()) continue;
+
+        // Find out how many frames Mindy has fetched
+        fetched_[phase] = mindy_.getFetchedFrameCount(phase);
+
+        // Move every waiter whose frame has been fetched to the ready-queue
+        auto it = waiters.begin();
+        while (it != waiters.end())
+        {
+            if (isFetched(phase, it->frameNumber))
+            {
+                ready_.push_back(it->handle);
+                it = waiters.erase(it);
+            }
+            else ++it;
+        }
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// pollTimers() - Makes every coroutine whose timer has expired ready to run
+//=================================================================================================
+void CMindyReactor::pollTimers()
+{
+    auto now = clock_type::now();
+
+    auto it = timers_.begin();
+    while (it != timers_.end())
+    {
+        if (it->deadline <= now)
+        {
+            ready_.push_back(it->handle);
+            it = timers_.erase(it);
+        }
+        else ++it;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// pollIo() - Waits up to "timeout" for any of the file descriptors that coroutines are waiting
+//            on to become ready, and makes those coroutines ready to run
+//=================================================================================================
+void CMindyReactor::pollIo(duration_t timeout)
+{
+    // If there is already work to do, we don't wait at all
+    if (!ready_.empty()) timeout = duration_t(0);
+
+    // Build the list of file descriptors to wait on
+    vector<pollfd> fds;
+    for (auto& waiter : io_) fds.push_back({waiter.fd, waiter.events, 0});
+
+    // Convert the timeout to a timespec
+    timespec ts;
+    ts.tv_sec  = timeout.count() / 1000000;
+    ts.tv_nsec = (timeout.count() % 1000000) * 1000;
+
+    // Wait for something to happen.  With no file descriptors, this is simply a sleep
+    int count = ppoll(fds.data(), fds.size(), &ts, nullptr);
+    if (count <= 0) return;
+
+    // Make every coroutine whose file descriptor is ready able to run
+    for (size_t i = 0, j = 0; i < fds.size(); ++i)
+    {
+        if (fds[i].revents)
+        {
+            *io_[j].revents = fds[i].revents;
+            ready_.push_back(io_[j].handle);
+            io_.erase(io_.begin() + j);
+        }
+        else ++j;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reapTasks() - Destroys the Tasks that have finished.  If any of them exited with an exception,
+//               the first such exception is re-thrown once all of them have been cleaned up
+//=================================================================================================
+void CMindyReactor::reapTasks()
+{
+    exception_ptr exception;
+
+    auto it = tasks_.begin();
+    while (it != tasks_.end())
+    {
+        if (it->done())
+        {
+            if (!exception) exception = it->promise().exception;
+            it->destroy();
+            it = tasks_.erase(it);
+        }
+        else ++it;
+    }
+
+    if (exception) rethrow_exception(exception);
+}
+//=================================================================================================
@@ -0,0 +1,240 @@
+//=================================================================================================
+// MindyAsync.h - A single-threaded, coroutine based API for submitting frames to Mindy
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <deque>
+#include <vector>
+#include "mindy.h"
+
+/*
+    This is an asynchronous layer on top of CMindy.  A CMindyReactor runs any number of
+    coroutines (Tasks) on a single thread.  A Task can:
+
+        co_await reactor.submitFrame(phase)   - Rings Mindy's doorbell immediately, then
+                                                resumes once Mindy has fetched the frame
+        co_await reactor.sleepFor(duration)   - Resumes after the duration has elapsed
+        co_await reactor.waitReadable(fd)     - Resumes when the file descriptor is readable
+        co_await reactor.waitWritable(fd)     - Resumes when the file descriptor is writable
+        co_await someOtherTask()              - Runs another Task to completion
+
+    Frame completion is detected by polling Mindy's "frames fetched" counters, so while there
+    are frames in flight, the reactor never sleeps for longer than its frame-poll interval.
+
+    Example:
+
+        Task producer(CMindyReactor& reactor, uint32_t phase)
+        {
+            for (int i=0; i<1000; ++i)
+            {
+                prepareFrame(phase, i);
+                co_await reactor.submitFrame(phase);
+            }
+        }
+
+        CMindyReactor reactor(Mindy);
+        reactor.spawn(producer(reactor, 0));
+        reactor.spawn(producer(reactor, 1));
+        reactor.run();
+
+    Don't call CMindy::clearLocalFrameCounters() while frames are in flight, or the frames
+    that are waiting to be fetched will never complete.
+*/
+
+
+//=================================================================================================
+// Task - The return type of a coroutine that runs on a CMindyReactor
+//=================================================================================================
+class Task
+{
+public:
+
+    struct promise_type
+    {
+        // When this Task finishes, this is the coroutine that is waiting on it
+        std::coroutine_handle<> continuation;
+
+        // If the Task throws an exception, this is it
+        std::exception_ptr exception;
+
+        // When the Task finishes, resume whoever was waiting on it
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept {return false;}
+            void await_resume() noexcept {}
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                auto next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+        };
+
+        Task                get_return_object() {return Task(handle_t::from_promise(*this));}
+        std::suspend_always initial_suspend() noexcept {return {};}
+        FinalAwaiter        final_suspend() noexcept {return {};}
+        void                return_void() {}
+        void                unhandled_exception() {exception = std::current_exception();}
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    // Tasks can be moved but not copied
+    Task(Task&& rhs) noexcept : handle_(rhs.handle_) {rhs.handle_ = nullptr;}
+    Task& operator= (Task&& rhs) noexcept;
+    Task (const Task&) = delete;
+    Task& operator= (const Task&) = delete;
+
+    // Destroys the coroutine if we still own it
+    ~Task() {if (handle_) handle_.destroy();}
+
+    // Awaiting a Task starts it running and resumes the caller when it finishes
+    bool    await_ready() {return handle_ == nullptr || handle_.done();}
+    void    await_resume();
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller)
+    {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+
+    // Gives up ownership of the coroutine
+    handle_t release() {auto h = handle_; handle_ = nullptr; return h;}
+
+protected:
+
+    explicit Task(handle_t h) : handle_(h) {}
+
+    handle_t handle_;
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// CMindyReactor - Runs Tasks, and resumes them when the events they are waiting for occur
+//=================================================================================================
+class CMindyReactor
+{
+public:
+
+    using clock_type = std::chrono::steady_clock;
+    using duration_t = std::chrono::microseconds;
+
+    // The reactor drives frames through this instance of Mindy
+    CMindyReactor(CMindy& mindy) : mindy_(mindy) {}
+
+    // Destroys any Tasks that haven't finished
+    ~CMindyReactor();
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    CMindyReactor (const CMindyReactor&) = delete;
+    CMindyReactor& operator= (const CMindyReactor&) = delete;
+
+    // Hands a Task to the reactor.  It will start running the next time the reactor runs
+    void    spawn(Task&& task);
+
+    // Runs until every Task has finished.  If a Task throws, the exception is re-thrown here
+    void    run();
+
+    // Performs a single pass of the event loop, waiting at most "timeout" for something to
+    // happen.  Returns false when there are no Tasks left
+    bool    runOnce(duration_t timeout = duration_t(1000));
+
+    // While frames are in flight, this is how often Mindy's completion counters are polled
+    void    setFramePollInterval(duration_t interval) {framePollInterval_ = interval;}
+
+    // Returns the number of frames of a phase that have been submitted but not yet fetched
+    uint32_t inFlight(uint32_t phase);
+
+    //---------------------------------------------------------------------------------------------
+    // Awaitable that rings the doorbell for a frame and completes when Mindy has fetched it
+    //---------------------------------------------------------------------------------------------
+    struct FrameAwaiter
+    {
+        CMindyReactor& reactor;
+        uint32_t       phase;
+        uint32_t       frameNumber;
+
+        bool     await_ready() {return reactor.isFetched(phase, frameNumber);}
+        void     await_suspend(std::coroutine_handle<> h) {reactor.addFrameWaiter(phase, frameNumber, h);}
+        uint32_t await_resume() {return frameNumber;}
+    };
+
+    //---------------------------------------------------------------------------------------------
+    // Awaitable that completes after a period of time has elapsed
+    //---------------------------------------------------------------------------------------------
+    struct TimerAwaiter
+    {
+        CMindyReactor&         reactor;
+        clock_type::time_point deadline;
+
+        bool    await_ready() {return clock_type::now() >= deadline;}
+        void    await_suspend(std::coroutine_handle<> h) {reactor.timers_.push_back({deadline, h});}
+        void    await_resume() {}
+    };
+
+    //---------------------------------------------------------------------------------------------
+    // Awaitable that completes when a file descriptor is readable or writable
+    //---------------------------------------------------------------------------------------------
+    struct IoAwaiter
+    {
+        CMindyReactor& reactor;
+        int            fd;
+        short          events;
+        short          revents = 0;
+
+        bool    await_ready() {return false;}
+        void    await_suspend(std::coroutine_handle<> h) {reactor.io_.push_back({fd, events, &revents, h});}
+        short   await_resume() {return revents;}
+    };
+
+    // Writes to the frame counter right away.  co_await the result to wait for the fetch
+    FrameAwaiter submitFrame(uint32_t phase);
+
+    // co_await these to suspend the calling Task
+    TimerAwaiter sleepFor(duration_t duration) {return {*this, clock_type::now() + duration};}
+    IoAwaiter    waitReadable(int fd);
+    IoAwaiter    waitWritable(int fd);
+
+protected:
+
+    struct frameWaiter_t {uint32_t frameNumber; std::coroutine_handle<> handle;};
+    struct timerEntry_t  {clock_type::time_point deadline; std::coroutine_handle<> handle;};
+    struct ioWaiter_t    {int fd; short events; short* revents; std::coroutine_handle<> handle;};
+
+    // Returns true if Mindy has fetched the specified frame (as of the last poll)
+    bool    isFetched(uint32_t phase, uint32_t frameNumber);
+
+    // Records that a coroutine is waiting for a frame to be fetched
+    void    addFrameWaiter(uint32_t phase, uint32_t frameNumber, std::coroutine_handle<> h);
+
+    // Each of these moves coroutines whose event has occured onto the ready-queue
+    void    pollFrames();
+    void    pollTimers();
+    void    pollIo(duration_t timeout);
+
+    // Destroys finished Tasks and re-throws the first exception any of them threw
+    void    reapTasks();
+
+    // The Mindy device we're submitting frames to
+    CMindy&     mindy_;
+
+    // How often to check for fetched frames while frames are in flight
+    duration_t  framePollInterval_ = duration_t(20);
+
+    // The most recently polled values of the "frames fetched" counters
+    uint32_t    fetched_[2] = {0, 0};
+
+    // Tasks that have been spawned and haven't finished
+    std::vector<Task::handle_t> tasks_;
+
+    // Coroutines that are ready to be resumed
+    std::deque<std::coroutine_handle<>> ready_;
+
+    // Coroutines waiting for something to happen
+    std::vector<frameWaiter_t> frameWaiters_[2];
+    std::vector<timerEntry_t>  timers_;
+    std::vector<ioWaiter_t>    io_;
+};
+//=================================================================================================
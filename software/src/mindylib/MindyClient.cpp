@@ -0,0 +1,274 @@
+//=================================================================================================
+// MindyClient.cpp - Submits frames to a card that's owned by mindyd
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <immintrin.h>
+#include "MindyClient.h"
+#include "throwRuntime.h"
+
+using namespace std;
+
+
+//=================================================================================================
+// attach() - Maps mindyd's shared memory and claims a free client slot
+//=================================================================================================
+void MindyClient::attach(const string& shmName)
+{
+    if (shared_) throwRuntime("MindyClient::attach() called twice");
+
+    int fd = shm_open(shmName.c_str(), O_RDWR, 0);
+    if (fd < 0) throwRuntime("Can't open %s (is mindyd running?): %s", shmName.c_str(), strerror(errno));
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(mindydShared_t))
+    {
+        close(fd);
+        throwRuntime("%s isn't mindyd's shared memory", shmName.c_str());
+    }
+
+    void* map = mmap(nullptr, sizeof(mindydShared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) throwRuntime("Can't map %s: %s", shmName.c_str(), strerror(errno));
+
+    auto shared = (mindydShared_t*)map;
+
+    if (shared->magic.load(memory_order_acquire) != MINDYD_MAGIC || shared->version != MINDYD_VERSION)
+    {
+        munmap(map, sizeof(mindydShared_t));
+        throwRuntime("%s isn't a version %u mindyd", shmName.c_str(), MINDYD_VERSION);
+    }
+
+    // Claim the first free slot
+    uint32_t pid = getpid();
+    for (uint32_t i = 0; i < shared->maxClients; ++i)
+    {
+        uint32_t expected = 0;
+        if (shared->client[i].owner.compare_exchange_strong(expected, pid, memory_order_acquire))
+        {
+            shared_ = shared;
+            slot_   = &shared->client[i];
+            return;
+        }
+    }
+
+    uint32_t maxClients = shared->maxClients;
+    munmap(map, sizeof(mindydShared_t));
+    throwRuntime("mindyd already has %u clients", maxClients);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// detach() - Tells mindyd we're finished with our slot, and unmaps the shared memory
+//=================================================================================================
+void MindyClient::detach()
+{
+    if (shared_ == nullptr) return;
+
+    // mindyd sends anything still in the ring, then frees the slot
+    slot_->detaching.store(1, memory_order_release);
+
+    munmap(shared_, sizeof(mindydShared_t));
+    shared_ = nullptr;
+    slot_   = nullptr;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// push() - Pushes a request into our ring
+//
+// Returns: false if the ring was full
+//=================================================================================================
+bool MindyClient::push(mindydOp_t op, uint32_t phase, uint32_t count, uint64_t* position)
+{
+    if (slot_ == nullptr) throwRuntime("MindyClient isn't attached");
+
+    const uint32_t mask = MINDYD_RING_ENTRIES - 1;
+
+    // Claim an entry at the tail of the ring
+    uint64_t pos = slot_->tail.load(memory_order_relaxed);
+    while (true)
+    {
+        mindydRequest_t& entry = slot_->ring[pos & mask];
+        uint64_t seq  = entry.sequence.load(memory_order_acquire);
+        int64_t  diff = (int64_t)(seq - pos);
+
+        // If this entry is free, try to claim it.  On failure, "pos" is reloaded for us
+        if (diff == 0)
+        {
+            if (slot_->tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+        }
+
+        // If the entry still holds a request from a lap ago, the ring is full
+        else if (diff < 0) return false;
+
+        // Otherwise, another of our threads beat us to this entry
+        else pos = slot_->tail.load(memory_order_relaxed);
+    }
+
+    // Fill in the entry and hand it to mindyd
+    mindydRequest_t& entry = slot_->ring[pos & mask];
+    entry.op    = op;
+    entry.phase = phase;
+    entry.count = count;
+    entry.sequence.store(pos + 1, memory_order_release);
+
+    *position = pos;
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// waitFor() - Waits until mindyd has finished with the request at "position"
+//=================================================================================================
+void MindyClient::waitFor(uint64_t position)
+{
+    for (uint32_t spins = 0; slot_->completed.load(memory_order_acquire) <= position; ++spins)
+    {
+        if (spins < 1000)
+            _mm_pause();
+        else
+        {
+            if ((spins & 0xFFF) == 0 && !daemonRunning()) throwRuntime("mindyd has stopped");
+            this_thread::yield();
+        }
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// trySubmit() - Queues frames for mindyd to submit
+//
+// Returns: false if the ring was full
+//=================================================================================================
+bool MindyClient::trySubmit(uint32_t phase, uint32_t count)
+{
+    if (phase > 1) throwRuntime("bad parameter on MindyClient::trySubmit()");
+
+    // Submitting zero frames is a no-op
+    if (count == 0) return true;
+
+    uint64_t position;
+    return push(MINDYD_SUBMIT, phase, count, &position);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// submit() - Queues frames for mindyd to submit, waiting for room if the ring is full
+//=================================================================================================
+void MindyClient::submit(uint32_t phase, uint32_t count)
+{
+    for (uint32_t tries = 1; !trySubmit(phase, count); ++tries)
+    {
+        if ((tries & 0xFFF) == 0 && !daemonRunning()) throwRuntime("mindyd has stopped");
+        this_thread::yield();
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// flush() - Waits until mindyd has handled every request we've made so far
+//=================================================================================================
+void MindyClient::flush()
+{
+    if (slot_ == nullptr) throwRuntime("MindyClient isn't attached");
+
+    uint64_t tail = slot_->tail.load(memory_order_relaxed);
+    if (tail) waitFor(tail - 1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// status() - Reads the status that mindyd last published
+//=================================================================================================
+MindyClient::status_t MindyClient::status()
+{
+    if (shared_ == nullptr) throwRuntime("MindyClient isn't attached");
+
+    mindydStatus_t& shared = shared_->status;
+    status_t        result;
+
+    // If mindyd was publishing while we read, read it again
+    while (true)
+    {
+        uint32_t before = shared.sequence.load(memory_order_acquire);
+        if (before & 1)
+        {
+            _mm_pause();
+            continue;
+        }
+
+        result.qsfpStatus   = shared.qsfpStatus.load(memory_order_relaxed);
+        result.errors       = shared.errors.load(memory_order_relaxed);
+        result.submitted[0] = shared.submitted[0].load(memory_order_relaxed);
+        result.submitted[1] = shared.submitted[1].load(memory_order_relaxed);
+        result.fetched[0]   = shared.fetched[0].load(memory_order_relaxed);
+        result.fetched[1]   = shared.fetched[1].load(memory_order_relaxed);
+        result.updates      = shared.updates.load(memory_order_relaxed);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (shared.sequence.load(memory_order_relaxed) == before) return result;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// refreshStatus() - Has mindyd read the card's status, then returns it
+//=================================================================================================
+MindyClient::status_t MindyClient::refreshStatus()
+{
+    uint64_t position;
+    while (!push(MINDYD_REFRESH, 0, 0, &position)) this_thread::yield();
+    waitFor(position);
+    return status();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// clearErrors() - Has mindyd forget the errors it has seen
+//=================================================================================================
+void MindyClient::clearErrors()
+{
+    uint64_t position;
+    while (!push(MINDYD_CLEAR_ERRORS, 0, 0, &position)) this_thread::yield();
+    waitFor(position);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// framesSubmitted() - Returns how many of our frames mindyd has submitted for a phase
+//=================================================================================================
+uint64_t MindyClient::framesSubmitted(uint32_t phase)
+{
+    if (slot_ == nullptr || phase > 1) throwRuntime("bad call to MindyClient::framesSubmitted()");
+    return slot_->frames[phase].load(memory_order_relaxed);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// daemonRunning() - Returns true if the process that created the shared memory still exists
+//=================================================================================================
+bool MindyClient::daemonRunning()
+{
+    if (shared_ == nullptr) return false;
+    return kill(shared_->daemonPid, 0) == 0 || errno == EPERM;
+}
+//=================================================================================================
@@ -0,0 +1,99 @@
+//=================================================================================================
+// MindyClient.h - Submits frames to a card that's owned by mindyd
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <string>
+#include "MindyShared.h"
+
+/*
+    A process that doesn't own the card talks to mindyd through shared memory instead of
+    mapping BAR 0.  It needs no privileges beyond access to the shared-memory object, and
+    submitting a frame is a store into the process's own request ring: no system call, and no
+    read-modify-write of a frame counter that another process might be racing with.
+
+    MindyClient is thread-safe: any thread of the process may call submit().  Frames of a
+    phase are handed to the card in the order submit() was called for them.  mindyd only
+    serializes the doorbells; processes that share a phase must still agree on which host
+    buffers each of them fills.
+
+    Example:
+
+        MindyClient client;
+        client.attach();
+
+        // Fill a frame's host buffers, then...
+        client.submit(phase);
+
+        auto status = client.status();
+        if (status.errors) client.clearErrors();
+
+        client.detach();
+*/
+
+class MindyClient
+{
+public:
+
+    // A snapshot of the card's status, as published by mindyd
+    struct status_t
+    {
+        uint32_t    qsfpStatus;     // Bit N = 1 means QSFP_N is up
+        uint32_t    errors;         // Errors latched since a client cleared them
+        uint32_t    submitted[2];   // The local frame counters
+        uint32_t    fetched[2];     // The frames-fetched counters
+        uint64_t    updates;        // Number of times mindyd has published the status
+    };
+
+    // Default constructor
+    MindyClient() {}
+
+    // Destructor
+    ~MindyClient() {detach();}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    MindyClient (const MindyClient&) = delete;
+    MindyClient& operator= (const MindyClient&) = delete;
+
+    // Connects to mindyd and claims a client slot
+    void        attach(const std::string& shmName = MINDYD_SHM_NAME);
+
+    // Gives the slot back.  Anything already submitted is still sent
+    void        detach();
+
+    // Queues "count" frames for the specified phase.  If the ring is full, this waits
+    void        submit(uint32_t phase, uint32_t count = 1);
+
+    // Same as submit(), but returns false instead of waiting if the ring is full
+    bool        trySubmit(uint32_t phase, uint32_t count = 1);
+
+    // Waits until mindyd has rung the doorbell for everything we've submitted
+    void        flush();
+
+    // Returns the status that mindyd last published.  This doesn't involve mindyd at all
+    status_t    status();
+
+    // Asks mindyd to read the card's status now, and returns it
+    status_t    refreshStatus();
+
+    // Asks mindyd to forget the latched errors, and waits until it has
+    void        clearErrors();
+
+    // Returns the number of frames mindyd has submitted for us, per phase
+    uint64_t    framesSubmitted(uint32_t phase);
+
+    // Returns true if the daemon that created the shared memory is still running
+    bool        daemonRunning();
+
+protected:
+
+    // Pushes a request.  Returns false if the ring is full, otherwise fills in its position
+    bool        push(mindydOp_t op, uint32_t phase, uint32_t count, uint64_t* position);
+
+    // Waits until mindyd has finished with the request at "position"
+    void        waitFor(uint64_t position);
+
+    // The shared-memory segment, and our slot in it
+    mindydShared_t* shared_ = nullptr;
+    mindydClient_t* slot_   = nullptr;
+};
@@ -0,0 +1,529 @@
+//=================================================================================================
+// MindyEmulator.cpp - A software model of Mindy, for running CMindy without the hardware
+//=================================================================================================
+#include <stdexcept>
+#include <chrono>
+#include "MindyEmulator.h"
+#include "MindyRegs.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace MindyReg;
+
+// Registers that come in one-per-phase (or one-per-link) sets
+using FrameCtr    = RegArray<FC_FRAME_CTR_0, FC_FRAME_CTR_1>;
+using FrameAdd    = RegArray<FC_FRAME_ADD_0, FC_FRAME_ADD_1>;
+using Fetched     = RegArray<DF_FETCHED0, DF_FETCHED1>;
+using Issued      = RegArray<DF_ISSUED0, DF_ISSUED1>;
+using HfdOffs     = RegArray<DF_HFD0_OFFS, DF_HFD1_OFFS>;
+using HmdOffs     = RegArray<DF_HMD0_OFFS, DF_HMD1_OFFS>;
+using LinkPackets = RegArray<RS_LINK0_PACKETS, RS_LINK1_PACKETS>;
+using LinkBytes   = RegArray<RS_LINK0_BYTES, RS_LINK1_BYTES>;
+using CmacPackets = RegArray<SM_LINK0_TX_PACKETS, SM_LINK1_TX_PACKETS>;
+using CmacBytes   = RegArray<SM_LINK0_TX_BYTES, SM_LINK1_TX_BYTES>;
+
+// The card's clock frequency, which is the rate of the timestamp counter
+static const double CLOCK_HZ = 250e6;
+
+// The largest packet the card can send, and the per-packet bytes on the wire that aren't
+// payload (preamble and inter-packet gap, Ethernet, IP, UDP and RDMX headers, FCS)
+static const uint32_t MAX_PACKET_SIZE = 16384;
+static const uint32_t WIRE_OVERHEAD   = 20 + 14 + 20 + 8 + 22 + 4;
+
+// The bytes on the wire, per link, of the metadata packet of each frame and of a write of
+// the remote frame counter (a minimum-size Ethernet packet)
+static const uint32_t MD_PACKET       = 128 + WIRE_OVERHEAD;
+static const uint32_t FC_PACKET       = 64 + 20;
+
+// The CMAC counts a packet's bytes without the preamble and inter-packet gap
+static const uint32_t PREAMBLE_IPG    = 20;
+
+// How often the emulated card looks at its registers
+static const auto POLL_INTERVAL = microseconds(20);
+
+// The number of streams the emulated card carries
+static const uint32_t STREAMS = 4;
+
+// The depth, in beats, of the emulated card's frame-data FIFO (FD_FIFO_DEPTH in mindy_if)
+static const uint32_t FD_FIFO_DEPTH = 4096;
+
+// Returns the offset of one phase of one stream in FC_STREAM_CTR and DF_STREAM_FETCHED
+static uint32_t tableOffset(uint32_t stream, uint32_t phase) {return (stream * 2 + phase) * 4;}
+
+
+//=================================================================================================
+// Constructor - Creates the emulated BAR 0 in its power-on state
+//=================================================================================================
+MindyEmulator::MindyEmulator() : regs_(BAR0_SIZE / 4)
+{
+    linksUp_  = 3;
+    stopping_ = false;
+    resetCard();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// start() - Starts (or restarts) the emulated card
+//=================================================================================================
+void MindyEmulator::start(const model_t& model)
+{
+    stop();
+
+    if (model.pcieGBps <= 0 || model.linkGbps <= 0)
+        throwRuntime("MindyEmulator::start(): bandwidths must be positive");
+
+    model_    = model;
+    linksUp_  = model.linksUp;
+    stopping_ = false;
+    resetCard();
+
+    thread_ = thread(&MindyEmulator::cardThread, this);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stop() - Stops the emulated card
+//=================================================================================================
+void MindyEmulator::stop()
+{
+    if (!thread_.joinable()) return;
+
+    stopping_ = true;
+    thread_.join();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// latchError() - Sets bits in the latched error status.  They stay set until CMindy clears them
+//=================================================================================================
+void MindyEmulator::latchError(uint32_t bits)
+{
+    uint32_t& reg = regs_[MindyReg::SM_ERR_STATUS::offset / 4];
+    atomic_ref<uint32_t>(reg).fetch_or(bits);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// addFrames() - Submits frames by adding to a frame counter directly.  The card thread adds the
+//               frame-add registers in the same way, so neither can lose the other's frames
+//=================================================================================================
+uint32_t MindyEmulator::addFrames(uint32_t phase, uint32_t count)
+{
+    uint32_t& reg = regs_[FrameCtr::offset(phase) / 4];
+    return atomic_ref<uint32_t>(reg).fetch_add(count) + count;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// resetCard() - Clears every register, then sets the ones that have a power-on value
+//=================================================================================================
+void MindyEmulator::resetCard()
+{
+    unsigned char* bar0 = this->bar0();
+
+    // These are the card's writes, not the host's, even though they're on the host's thread
+    bool cardSide = MindyReg::cardSide;
+    MindyReg::cardSide = true;
+
+    for (auto& reg : regs_) reg = 0;
+
+    RS_LINK_WEIGHTS::write(bar0, 0x0101);
+    RS_LINK_ENABLE::write(bar0, 3);
+    RS_PACKETS_PER_FRAME::write(bar0, 1);
+    RS_MAX_PACKET_SIZE::write(bar0, MAX_PACKET_SIZE);
+    RS_FC_COALESCE::write(bar0, 1);
+    DF_MODULE_REV::write(bar0, 10);
+    FC_MODULE_REV::write(bar0, 4);
+    FC_STREAMS::write(bar0, STREAMS);
+    FC_STREAM_WEIGHTS::write(bar0, 0x11111111);
+    SM_FD_FIFO_DEPTH::write(bar0, FD_FIFO_DEPTH);
+
+    MindyReg::cardSide = cardSide;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// frameSeconds() - Returns how long the card will take to send one frame and fills in how many
+//                  of its packets go to each link.  Returns 0 if the card would stall instead
+//=================================================================================================
+double MindyEmulator::frameSeconds(uint32_t linkPackets[2], uint32_t stream)
+{
+    unsigned char* bar0 = this->bar0();
+
+    uint32_t frameSize   = RS_FRAME_SIZE::read(bar0);
+    uint32_t packetSize  = RS_PACKET_SIZE::read(bar0);
+    uint32_t group       = RS_PACKETS_PER_GROUP::read(bar0);
+    uint32_t policy      = RS_STEER_POLICY::read(bar0);
+    uint32_t weights     = RS_LINK_WEIGHTS::read(bar0);
+    uint32_t usable      = linksUp_ & RS_LINK_ENABLE::read(bar0);
+    bool     descMode    = (DF_DESC_CTRL::read(bar0) & 1) && stream == 0;
+    bool     deltaMode   = (DF_DELTA_CTRL::read(bar0) & 1) && !descMode;
+    uint64_t hfdBytes    = DF_HFD_BYTES::read(bar0);
+    uint32_t fcFrames    = RS_FC_COALESCE::read(bar0);
+
+    // The card can't packetize the frame
+    if (packetSize == 0 || packetSize % 64 || packetSize > MAX_PACKET_SIZE) return 0;
+    if (frameSize == 0  || frameSize % packetSize) return 0;
+
+    // The frame would overrun the host's frame-data buffers
+    if (!descMode && hfdBytes < frameSize / 2) return 0;
+
+    uint32_t packets = frameSize / packetSize;
+
+    // In delta mode, only the packets that changed are fetched and sent, and the rdmx_shims
+    // can only place them if the frame is steered
+    if (deltaMode)
+    {
+        if (policy == 0 || packets > 512 || (frameSize / 2) % packetSize) return 0;
+        packets = (uint32_t)(packets * model_.deltaDirty + 0.5);
+        if (packets == 0) packets = 1;
+    }
+
+    // Figure out what share of the packets go to each link
+    double share[2];
+    switch (policy)
+    {
+        // Alternating needs both links and a whole number of groups in each half-frame
+        case 0:
+            if (linksUp_ != 3 || group == 0 || packets % (2 * group)) return 0;
+            share[0] = share[1] = 0.5;
+            break;
+
+        // Adaptive steering splits the packets evenly between the usable links
+        case 1:
+            if (usable == 0) return 0;
+            share[0] = (usable == 3) ? 0.5 : (usable & 1);
+            share[1] = 1 - share[0];
+            break;
+
+        // Weighted steering splits them by weight.  A link with no weight isn't used
+        case 2:
+        {
+            double w0 = (usable & 1) ? (weights & 0xFF) : 0;
+            double w1 = (usable & 2) ? ((weights >> 8) & 0xFF) : 0;
+            if (w0 + w1 == 0) return 0;
+            share[0] = w0 / (w0 + w1);
+            share[1] = w1 / (w0 + w1);
+            break;
+        }
+
+        default:
+            return 0;
+    }
+
+    linkPackets[0] = (uint32_t)(packets * share[0] + 0.5);
+    linkPackets[1] = packets - linkPackets[0];
+
+    // Fetching the frame from host RAM
+    double fetch = (double)packets * packetSize / (model_.pcieGBps * 1e9) + model_.fetchOverheadUs * 1e-6;
+
+    // The metadata, and this frame's share of the frame-counter writes
+    double trailer = MD_PACKET + (double)FC_PACKET / (fcFrames ? fcFrames : 1);
+
+    // Sending it on the busiest link
+    double transmit = 0;
+    for (int link = 0; link < 2; ++link)
+    {
+        double wireBytes = linkPackets[link] * (double)(packetSize + WIRE_OVERHEAD) + trailer;
+        double wire      = wireBytes * 8 / (model_.linkGbps * 1e9);
+        double handling  = linkPackets[link] * model_.packetOverheadNs * 1e-9;
+        double busy      = (wire > handling) ? wire : handling;
+        if (busy > transmit) transmit = busy;
+    }
+
+    // Fetching and transmitting are pipelined
+    return (fetch > transmit) ? fetch : transmit;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// cardThread() - Plays the part of the card until stop() is called
+//
+// Frames are issued the way frame_counters issues them: the streams that have frames pending
+// take turns of up to their weight in frames, and within a stream the phases alternate when
+// both have frames pending.  A frame that's pending when the previous one finishes starts
+// immediately, so the card runs back-to-back no matter how often we poll.
+//=================================================================================================
+void MindyEmulator::cardThread()
+{
+    unsigned char* bar0 = this->bar0();
+
+    // Keep an MmioRecorder from logging the card's own register accesses
+    MindyReg::cardSide = true;
+
+    uint32_t fetched[STREAMS][2] = {};
+    uint64_t hfdOffs[2]     = {0, 0};
+    uint64_t hmdOffs[2]     = {0, 0};
+    uint64_t linkPackets[2] = {0, 0};
+    uint64_t linkBytes[2]   = {0, 0};
+    uint64_t cmacPackets[2] = {0, 0};
+    uint64_t cmacBytes[2]   = {0, 0};
+    uint32_t lastCtr0       = 0;
+    uint32_t lastPhase[STREAMS];
+    uint32_t curStream      = 0;
+    uint32_t credit         = 0;
+    for (auto& phase : lastPhase) phase = 1;
+
+    // Frame-counter writes, those saved by coalescing, and the frames whose count each
+    // rdmx_shim hasn't written yet (and since when, and for which stream)
+    uint64_t fcUpdates      = 0;
+    uint64_t fcSaved        = 0;
+    uint32_t fcOwed         = 0;
+    double   fcOwedSince    = 0;
+    uint32_t fcStream       = 0;
+
+    // The packets fetched and skipped in delta mode
+    uint64_t deltaSent      = 0;
+    uint64_t deltaSkipped   = 0;
+
+    // The frame in flight
+    bool     busy           = false;
+    bool     busyDelta      = false;
+    uint32_t busyStream     = 0;
+    uint32_t busyPhase      = 0;
+    uint32_t busyPackets[2] = {0, 0};
+    double   doneAt         = 0;
+    double   lastDone       = 0;
+    double   lastPoll       = 0;
+
+    auto startTime = steady_clock::now();
+
+    while (!stopping_)
+    {
+        double now = duration<double>(steady_clock::now() - startTime).count();
+
+        FC_TIMESTAMP::write(bar0, (uint64_t)(now * CLOCK_HZ));
+        SM_QSFP_STATUS::write(bar0, linksUp_);
+
+        // Writing 0 to frame counter 0 resets the data path, and the counters of every stream
+        uint32_t ctr0 = FrameCtr::read(bar0, 0);
+        if (ctr0 < lastCtr0)
+        {
+            FrameCtr::write(bar0, 1, 0);
+            for (uint32_t stream = 0; stream < STREAMS; ++stream)
+            {
+                for (uint32_t phase = 0; phase < 2; ++phase)
+                {
+                    fetched[stream][phase] = 0;
+                    FC_STREAM_CTR::write(bar0 + tableOffset(stream, phase), 0);
+                    DF_STREAM_FETCHED::write(bar0 + tableOffset(stream, phase), 0);
+                }
+            }
+            for (int i = 0; i < 2; ++i)
+            {
+                linkPackets[i] = linkBytes[i] = hfdOffs[i] = hmdOffs[i] = 0;
+                Fetched::write(bar0, i, 0);
+                Issued::write(bar0, i, 0);
+                HfdOffs::write(bar0, i, 0);
+                HmdOffs::write(bar0, i, 0);
+                LinkPackets::write(bar0, i, 0);
+                LinkBytes::write(bar0, i, 0);
+            }
+            fcUpdates = fcSaved = fcOwed = 0;
+            RS_FC_UPDATES::write(bar0, 0);
+            RS_FC_SAVED::write(bar0, 0);
+            deltaSent = deltaSkipped = 0;
+            DF_DELTA_SENT::write(bar0, 0);
+            DF_DELTA_SKIPPED::write(bar0, 0);
+            busy = false;
+        }
+        lastCtr0 = ctr0;
+
+        // Add anything that was written to the frame-add registers to the frame counters.
+        // Counter 0 has to be compared with what we made it, or a clear right after these
+        // frames would look like no change at all on the next pass
+        for (uint32_t phase = 0; phase < 2; ++phase)
+        {
+            uint32_t& reg = regs_[FrameAdd::offset(phase) / 4];
+            uint32_t  add = atomic_ref<uint32_t>(reg).exchange(0);
+            if (add)
+            {
+                uint32_t value = addFrames(phase, add);
+                if (phase == 0 && value > lastCtr0) lastCtr0 = value;
+            }
+            FC_STREAM_CTR::write(bar0 + tableOffset(0, phase), FrameCtr::read(bar0, phase));
+        }
+
+        // Keep the derived registers up to date
+        uint32_t frameSize  = RS_FRAME_SIZE::read(bar0);
+        uint32_t packetSize = RS_PACKET_SIZE::read(bar0);
+        uint32_t fcFrames   = RS_FC_COALESCE::read(bar0);
+        double   fcTimeout  = RS_FC_TIMEOUT::read(bar0) * 1e-6;
+        RS_PACKETS_PER_FRAME::write(bar0, packetSize ? frameSize / packetSize : 1);
+
+        while (true)
+        {
+            // If the frame in flight isn't done yet, there's nothing more to do for now
+            if (busy && now < doneAt) break;
+
+            // If the frame in flight is done, account for it.  The model issues and fetches
+            // a frame all at once, and advances the ring offsets the way data_fetch does
+            if (busy)
+            {
+                // The count owed to another stream's receiver is written before this frame's
+                bool fcSwitch = fcOwed && busyStream != fcStream;
+                if (fcSwitch)
+                {
+                    fcUpdates += 2;
+                    fcOwed     = 0;
+                }
+                fcStream = busyStream;
+
+                // Each rdmx_shim writes the frame counter if it's due, the way rdmx_shim does
+                bool fcDue = (fcOwed + 1 >= fcFrames) || (fcOwed && fcTimeout && doneAt - fcOwedSince >= fcTimeout);
+                if (fcDue)
+                {
+                    fcUpdates += 2;
+                    fcOwed     = 0;
+                }
+                else
+                {
+                    fcSaved += 2;
+                    if (fcOwed++ == 0) fcOwedSince = doneAt;
+                }
+                RS_FC_UPDATES::write(bar0, fcUpdates);
+                RS_FC_SAVED::write(bar0, fcSaved);
+
+                // Only stream 0's ring offsets and issued counts are kept (see MindyEmulator.h)
+                uint32_t done = ++fetched[busyStream][busyPhase];
+                DF_STREAM_FETCHED::write(bar0 + tableOffset(busyStream, busyPhase), done);
+                if (busyStream == 0)
+                {
+                    uint64_t& hfd = hfdOffs[busyPhase];
+                    uint64_t& hmd = hmdOffs[busyPhase];
+                    hfd = (hfd + frameSize / 2 < DF_HFD_BYTES::read(bar0)) ? hfd + frameSize / 2 : 0;
+                    hmd = (hmd + 128 < DF_HMD_BYTES::read(bar0)) ? hmd + 128 : 0;
+                    HfdOffs::write(bar0, busyPhase, hfd);
+                    HmdOffs::write(bar0, busyPhase, hmd);
+                    Issued::write(bar0, busyPhase, done);
+                    Fetched::write(bar0, busyPhase, done);
+                }
+
+                uint32_t fcWrites = (fcDue ? 1 : 0) + (fcSwitch ? 1 : 0);
+                for (int link = 0; link < 2; ++link)
+                {
+                    linkPackets[link] += busyPackets[link];
+                    linkBytes[link]   += (uint64_t)busyPackets[link] * packetSize;
+                    cmacPackets[link] += busyPackets[link] + 1 + fcWrites;
+                    cmacBytes[link]   += (uint64_t)busyPackets[link] * (packetSize + WIRE_OVERHEAD - PREAMBLE_IPG)
+                                       + (MD_PACKET - PREAMBLE_IPG) + fcWrites * (FC_PACKET - PREAMBLE_IPG);
+                    LinkPackets::write(bar0, link, linkPackets[link]);
+                    LinkBytes::write(bar0, link, linkBytes[link]);
+                }
+                if (busyDelta)
+                {
+                    uint32_t sent = busyPackets[0] + busyPackets[1];
+                    deltaSent    += sent;
+                    deltaSkipped += frameSize / packetSize - sent;
+                    DF_DELTA_SENT::write(bar0, deltaSent);
+                    DF_DELTA_SKIPPED::write(bar0, deltaSkipped);
+                }
+
+                busy     = false;
+                lastDone = doneAt;
+            }
+
+            // A configuration commit lands between frames, and restarts the rings.  We claim it
+            // with bit 31 so that CMindy can't cancel it while we're restarting them, and clear
+            // "pending" only once we have
+            uint32_t& commit = regs_[DF_CFG_COMMIT::offset / 4];
+            uint32_t  expected = 1;
+            if (atomic_ref<uint32_t>(commit).compare_exchange_strong(expected, 0x80000001))
+            {
+                for (int i = 0; i < 2; ++i)
+                {
+                    hfdOffs[i] = hmdOffs[i] = 0;
+                    HfdOffs::write(bar0, i, 0);
+                    HmdOffs::write(bar0, i, 0);
+                }
+                atomic_ref<uint32_t>(commit).store(0);
+            }
+
+            // Find the frames each stream has pending.  Stream 0's counters are mirrored into
+            // the table, and the other streams' are only in the table
+            uint32_t pending[STREAMS][2];
+            for (uint32_t stream = 0; stream < STREAMS; ++stream)
+                for (uint32_t phase = 0; phase < 2; ++phase)
+                    pending[stream][phase] = FC_STREAM_CTR::read(bar0 + tableOffset(stream, phase))
+                                           - fetched[stream][phase];
+
+            // The current stream keeps its turn while it has credit and frames pending.  After
+            // that the turn goes to the next stream that has frames pending
+            auto hasPending = [&](uint32_t stream) {return pending[stream][0] || pending[stream][1];};
+            if (!(credit && hasPending(curStream)))
+            {
+                for (uint32_t i = 1; i <= STREAMS; ++i)
+                {
+                    uint32_t stream = (curStream + i) % STREAMS;
+                    if (!hasPending(stream)) continue;
+                    uint32_t weight = (FC_STREAM_WEIGHTS::read(bar0) >> (stream * 4)) & 0xF;
+                    curStream = stream;
+                    credit    = weight ? weight : 1;
+                    break;
+                }
+            }
+            if (!hasPending(curStream)) break;
+
+            // Decide which phase of the stream gets the next frame
+            uint32_t pending0 = pending[curStream][0];
+            uint32_t pending1 = pending[curStream][1];
+            bool     issue0   = pending0 && (pending1 == 0 || lastPhase[curStream] == 1);
+
+            // If the configuration would stall the card, the frame just sits there
+            double seconds = frameSeconds(busyPackets, curStream);
+            if (seconds == 0) break;
+
+            // The frame became pending no later than our previous look at the registers
+            double start = (lastDone > lastPoll) ? lastDone : lastPoll;
+
+            busy       = true;
+            busyStream = curStream;
+            busyPhase  = issue0 ? 0 : 1;
+            busyDelta  = (DF_DELTA_CTRL::read(bar0) & 1) && !(curStream == 0 && (DF_DESC_CTRL::read(bar0) & 1));
+            lastPhase[curStream] = busyPhase;
+            doneAt     = start + seconds;
+            --credit;
+        }
+
+        // A frame count that has waited too long is written between frames
+        if (fcOwed && fcTimeout && now - fcOwedSince >= fcTimeout)
+        {
+            fcUpdates += 2;
+            fcOwed     = 0;
+            RS_FC_UPDATES::write(bar0, fcUpdates);
+            for (int link = 0; link < 2; ++link)
+            {
+                cmacPackets[link] += 1;
+                cmacBytes[link]   += FC_PACKET - PREAMBLE_IPG;
+            }
+        }
+
+        // The emulated host's reads never stall, so the frame-data FIFO never fills or runs
+        // dry, and a write that restarts its telemetry just leaves it at 0
+        if (SM_FD_FIFO_HIGH::read(bar0)) SM_FD_FIFO_HIGH::write(bar0, 0);
+
+        // Take a snapshot of the CMAC statistics if asked to.  Nothing is ever received and
+        // the links are perfect, so only the TX packet and byte counters move
+        if (SM_LINK_SNAPSHOT::read(bar0))
+        {
+            for (int link = 0; link < 2; ++link)
+            {
+                CmacPackets::write(bar0, link, cmacPackets[link]);
+                CmacBytes::write(bar0, link, cmacBytes[link]);
+            }
+            SM_LINK_SNAPSHOT::write(bar0, 0);
+        }
+
+        lastPoll = now;
+        this_thread::sleep_for(POLL_INTERVAL);
+    }
+}
+//=================================================================================================
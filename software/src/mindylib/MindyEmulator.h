@@ -0,0 +1,127 @@
+//=================================================================================================
+// MindyEmulator.h - A software model of Mindy, for running CMindy without the hardware
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+    The emulator provides a block of ordinary memory laid out like Mindy's BAR 0, and a thread
+    that plays the part of the card: it watches the frame counters, "fetches" and "transmits"
+    frames at the rate given by a simple throughput model, and updates the frames-fetched
+    counters, the per-link packet and byte counters, the timestamp and the other read-only
+    registers.  CMindy talks to it exactly as it talks to the hardware:
+
+        MindyEmulator device;
+        device.start();
+        Mindy.initEmulated(device);
+
+    Like the hardware, the emulator stops fetching frames when it's configured in a way the
+    RTL can't handle (a packet size that isn't a multiple of 64, a frame that isn't a whole
+    number of packets, a frame that doesn't split evenly into ping-pong groups, a host
+    frame-data buffer smaller than a semiphase, or no usable link).  Writing 0 to frame
+    counter 0 resets it, as it does the card.
+
+    The model is deliberately simple: fetching and transmitting are pipelined, so a frame
+    takes the longer of its PCIe fetch time and its time on the busiest link.  It's good for
+    exercising software and for comparing configurations, not for predicting absolute numbers.
+
+    The frame-add registers are emulated by polling.  CMindy knows when it's talking to the
+    emulator and adds to them atomically rather than storing to them, so no doorbell is lost
+    between polls.  Trace FIFOs are always empty.  A staged configuration (see beginConfig()
+    in mindy.h) isn't held back: the emulator sees each write at once, but it only uses the
+    configuration between frames, and a commit restarts the rings at the next frame boundary
+    as the card does.  Since it's never waiting for the pipeline to drain, a commit can only be
+    cancelled in the moment before the emulator's next poll, and a cancelled one leaves the
+    new configuration in use.  The emulated card's own register accesses
+    aren't seen by an MmioRecorder (see MmioTrace.h); only CMindy's are.
+
+    The emulator carries four streams (see CMindyStream in mindy.h) and schedules them the way
+    the card does, but it doesn't bank registers by stream: CMindy keeps the buffer and ring
+    addresses of the other streams itself, and the emulator keeps ring offsets and issued
+    counts for stream 0 only.
+
+    The emulator can't see the host's buffers, so in delta mode (see FrameDelta.h) it doesn't
+    read the bitmaps.  Instead, model_t::deltaDirty says what fraction of each frame's packets
+    changed, and only those are fetched and sent.
+
+    The emulated card has a frame-data FIFO (see CMindy::getFdFifoStats()), but since the
+    emulated host's reads never stall, its level, high-water mark and underrun counts stay 0.
+*/
+
+class MindyEmulator
+{
+public:
+
+    // The characteristics of the emulated host, card and network
+    struct model_t
+    {
+        double      pcieGBps        = 12.0;     // Sustained DMA read bandwidth from host RAM
+        double      fetchOverheadUs = 1.0;      // Per-frame cost of fetching the metadata
+        double      linkGbps        = 100.0;    // Line rate of each QSFP link
+        double      packetOverheadNs = 8.0;     // Per-packet cost in the rdmx_shim and rdmx_xmit
+        uint32_t    linksUp         = 3;        // Bit N = 1 means QSFP_N is up and aligned
+        double      deltaDirty      = 1.0;      // In delta mode, the fraction of packets sent
+    };
+
+    // The size of the emulated BAR 0
+    static const uint32_t BAR0_SIZE = 0x10000;
+
+    // Default constructor
+    MindyEmulator();
+
+    // Destructor
+    ~MindyEmulator() {stop();}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    MindyEmulator (const MindyEmulator&) = delete;
+    MindyEmulator& operator= (const MindyEmulator&) = delete;
+
+    // Starts (or restarts) the emulated card with the default model, or the specified one
+    void            start() {start(model_t());}
+    void            start(const model_t& model);
+
+    // Stops the emulated card
+    void            stop();
+
+    // Changes which links are up, as if a cable had been connected or disconnected
+    void            setLinksUp(uint32_t mask) {linksUp_ = mask;}
+
+    // Latches error bits (see CMindy::errorBits_t), as if the card had detected a fault
+    void            latchError(uint32_t bits);
+
+    // Adds "count" to a phase's frame counter, as a write to its frame-add register would, and
+    // returns the value the counter took on as a result.  This is safe to call from any thread
+    uint32_t        addFrames(uint32_t phase, uint32_t count);
+
+    // Returns the userspace address of the emulated BAR 0
+    unsigned char*  bar0() {return (unsigned char*)regs_.data();}
+
+protected:
+
+    // The thread that plays the part of the card
+    void            cardThread();
+
+    // Puts the emulated card back into its power-on state
+    void            resetCard();
+
+    // Returns how long the card will take to send one frame of a stream with the current
+    // configuration, and how many of the frame's packets go to each link.  Returns 0 if the configuration
+    // would keep the card from sending frames at all
+    double          frameSeconds(uint32_t linkPackets[2], uint32_t stream = 0);
+
+    // The registers of BAR 0
+    std::vector<uint32_t>   regs_;
+
+    // The model we're emulating
+    model_t                 model_;
+
+    // The links that are up.  This can be changed while the card is running
+    std::atomic<uint32_t>   linksUp_;
+
+    // The emulated card runs in this thread until "stopping_" is set
+    std::thread             thread_;
+    std::atomic<bool>       stopping_;
+};
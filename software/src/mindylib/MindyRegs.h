@@ -0,0 +1,168 @@
+//=================================================================================================
+// MindyRegs.h - Compile-time register map and typed MMIO accessors for Mindy
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <atomic>
+
+/*
+    Every register in mindy_regs.def becomes a type in namespace MindyReg, named after its
+    block and register:
+
+        MindyReg::FC_FRAME_ADD_0::write(bar0, 1);
+        uint64_t addr = MindyReg::DF_HMD0_ADDR::read(bar0);
+
+    The offset and width of each register are template parameters, so every access compiles
+    to a single load or store at a constant offset from BAR 0.
+
+    Registers that differ only by phase (or semiphase) are grouped with RegArray:
+
+        using FrameAdd = MindyReg::RegArray<MindyReg::FC_FRAME_ADD_0, MindyReg::FC_FRAME_ADD_1>;
+        FrameAdd::at<1>::write(bar0, n);        // Phase known at compile time
+        FrameAdd::write(bar0, phase, n);        // Phase known at run time, no branches
+
+    Accesses are volatile, and each one is a compiler barrier: ordinary stores that appear
+    before a register write in the source (e.g., to a metadata record) are issued before it.
+    BAR 0 is mapped uncached, so x86 doesn't reorder the stores once they're issued.  Data
+    written with streaming stores still needs an sfence (see FrameCopy.h).
+
+    Every access is made up of 32-bit loads and stores through load32() and store32().  While
+    an MmioRecorder is running (see MmioTrace.h), they also report each load and store to it;
+    otherwise the only cost is testing a pointer that is almost always null.
+*/
+
+namespace MindyReg
+{
+    // Keeps the compiler from moving memory accesses across a register access
+    inline void compilerBarrier() {asm volatile("" ::: "memory");}
+
+    // Called after every register load or store while MMIO tracing is on
+    using mmioTap_t = void (*)(volatile uint32_t* address, uint32_t value, bool isWrite);
+    inline std::atomic<mmioTap_t> mmioTap {nullptr};
+
+    // Set by a thread that plays the part of the card (see MindyEmulator.h).  Its accesses
+    // aren't the host's, so they aren't reported to the tap
+    inline thread_local bool cardSide = false;
+
+    // Reports an access to the MMIO tap, if there is one
+    inline void tapAccess(volatile uint32_t* address, uint32_t value, bool isWrite)
+    {
+        mmioTap_t tap = mmioTap.load(std::memory_order_relaxed);
+        if (tap && !cardSide) [[unlikely]] tap(address, value, isWrite);
+    }
+
+    // A single 32-bit register load or store
+    inline uint32_t load32(unsigned char* address)
+    {
+        volatile uint32_t* reg = (volatile uint32_t*)address;
+        uint32_t value = *reg;
+        tapAccess(reg, value, false);
+        return value;
+    }
+
+    inline void store32(unsigned char* address, uint32_t value)
+    {
+        volatile uint32_t* reg = (volatile uint32_t*)address;
+        *reg = value;
+        tapAccess(reg, value, true);
+    }
+
+    //=============================================================================================
+    // Reg - A single 32-bit or 64-bit register at a fixed offset in BAR 0
+    //=============================================================================================
+    template <uint32_t Offset, uint32_t Width = 32>
+    struct Reg
+    {
+        static_assert(Width == 32 || Width == 64, "registers are 32 or 64 bits wide");
+        static_assert((Offset & 3) == 0, "registers must be 32-bit aligned");
+
+        using value_t = std::conditional_t<Width == 64, uint64_t, uint32_t>;
+
+        static constexpr uint32_t offset = Offset;
+        static constexpr uint32_t width  = Width;
+
+        // Returns the value of the register.  A 64-bit register is read upper half first,
+        // since for some registers reading the upper half latches the lower half
+        static value_t read(unsigned char* bar0)
+        {
+            compilerBarrier();
+            if constexpr (Width == 32)
+                return load32(bar0 + Offset);
+            else
+            {
+                uint64_t hi = load32(bar0 + Offset + 0);
+                uint64_t lo = load32(bar0 + Offset + 4);
+                return (hi << 32) | lo;
+            }
+        }
+
+        // Writes a value to the register.  A 64-bit register is written upper half first
+        static void write(unsigned char* bar0, value_t value)
+        {
+            compilerBarrier();
+            if constexpr (Width == 32)
+                store32(bar0 + Offset, value);
+            else
+            {
+                store32(bar0 + Offset + 0, value >> 32);
+                store32(bar0 + Offset + 4, value & 0xFFFFFFFF);
+            }
+            compilerBarrier();
+        }
+    };
+    //=============================================================================================
+
+
+    //=============================================================================================
+    // RegArray - A set of identical registers that are evenly spaced in BAR 0
+    //=============================================================================================
+    template <class First, class... Rest>
+    struct RegArray
+    {
+        static constexpr uint32_t count  = 1 + sizeof...(Rest);
+        static constexpr uint32_t width  = First::width;
+        static constexpr uint32_t offsets[] = {First::offset, Rest::offset...};
+        static constexpr uint32_t stride = count > 1 ? offsets[1] - offsets[0] : 0;
+
+        // Make sure the registers really are evenly spaced and all the same width
+        static constexpr bool isUniform()
+        {
+            for (uint32_t i = 1; i < count; ++i)
+                if (offsets[i] != offsets[0] + i * stride) return false;
+            return ((Rest::width == width) && ...);
+        }
+        static_assert(isUniform(), "RegArray registers must be evenly spaced and the same width");
+
+        using value_t = typename First::value_t;
+
+        // The register at a compile-time index
+        template <uint32_t index>
+        using at = std::enable_if_t<(index < count), Reg<First::offset + index * stride, width>>;
+
+        // The offset of the register at a run-time index
+        static uint32_t offset(uint32_t index) {return First::offset + index * stride;}
+
+        // Read or write the register at a run-time index.  The index must be less than "count"
+        static value_t read(unsigned char* bar0, uint32_t index)
+        {
+            return First::read(bar0 + index * stride);
+        }
+
+        static void write(unsigned char* bar0, uint32_t index, value_t value)
+        {
+            First::write(bar0 + index * stride, value);
+        }
+    };
+    //=============================================================================================
+
+
+    // Define the base address of each block and a type for each register
+    #define REGMAP_BLOCK(block, base, module, directory) \
+        constexpr uint32_t block##_BASE = base;
+    #define REGMAP_REG(block, name, index, width, access, description) \
+        using block##_##name = Reg<block##_BASE + (index) * 4, width>;
+    #include "mindy_regs.def"
+    #undef REGMAP_BLOCK
+    #undef REGMAP_REG
+}
@@ -0,0 +1,105 @@
+//=================================================================================================
+// MindyShared.h - The shared-memory interface between mindyd and its clients
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <atomic>
+
+/*
+    mindyd owns the card.  It creates a POSIX shared-memory object (named MINDYD_SHM_NAME
+    unless told otherwise) laid out as a mindydShared_t:
+
+        - A header that identifies the daemon
+        - The card's status, which the daemon publishes under a sequence lock
+        - One slot per client, each holding a bounded ring of requests
+
+    A client claims a free slot by swapping its PID into "owner", then pushes requests into
+    that slot's ring.  The ring is multi-producer/single-consumer (any thread of the client
+    may push, only the daemon pops) and works exactly like FrameSubmitter's: each entry's
+    "sequence" says whose turn it is.  Neither side makes a system call to pass a request.
+
+    The daemon adds up the frames in the SUBMIT requests from every client and rings each
+    phase's doorbell once per sweep.  After the doorbells it sets each client's "completed"
+    to the position of the last request it has processed, so a client can tell when its
+    frames have been handed to the card.
+
+    A client that exits without detaching is noticed by the daemon, which submits whatever
+    the client left in its ring and frees the slot.
+
+    Everything in the segment is either written once before it's published or accessed
+    through std::atomic, which is lock-free (and so address-free) for these sizes.
+*/
+
+// The default name of the shared-memory object
+const char MINDYD_SHM_NAME[] = "/mindyd";
+
+// The magic number at the start of the segment
+const uint32_t MINDYD_MAGIC = 0x4D494E44;      // "MIND"
+
+// Bump this whenever the layout changes
+const uint32_t MINDYD_VERSION = 1;
+
+// The most clients that can be attached at once
+const uint32_t MINDYD_MAX_CLIENTS = 16;
+
+// The number of requests a client ring can hold.  Must be a power of 2
+const uint32_t MINDYD_RING_ENTRIES = 1024;
+
+// What a request asks the daemon to do
+enum mindydOp_t : uint32_t
+{
+    MINDYD_SUBMIT,          // Add "count" to the frame counter of "phase"
+    MINDYD_REFRESH,         // Read the card's status now and publish it
+    MINDYD_CLEAR_ERRORS     // Forget the latched errors
+};
+
+// One entry of a client's request ring
+struct alignas(64) mindydRequest_t
+{
+    std::atomic<uint64_t>   sequence;
+    mindydOp_t              op;
+    uint32_t                phase;
+    uint32_t                count;
+};
+
+// The card's status, as last published by the daemon.  "sequence" is odd while the daemon
+// is writing the rest; a reader retries until it sees the same even value before and after
+struct alignas(64) mindydStatus_t
+{
+    std::atomic<uint32_t>   sequence;
+    std::atomic<uint32_t>   qsfpStatus;     // As from CMindy::getQsfpStatus()
+    std::atomic<uint32_t>   errors;         // Errors latched since a client cleared them
+    std::atomic<uint32_t>   submitted[2];   // The local frame counters
+    std::atomic<uint32_t>   fetched[2];     // The frames-fetched counters
+    std::atomic<uint64_t>   updates;        // Incremented by every publish
+};
+
+// One client's slot
+struct alignas(64) mindydClient_t
+{
+    std::atomic<uint32_t>   owner;          // The PID of the client, or 0 if the slot is free
+    std::atomic<uint32_t>   detaching;      // Set by the client when it's finished
+
+    // Requests are pushed at "tail" and popped at "head"
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint64_t> head;
+
+    // The number of requests the daemon has finished with
+    alignas(64) std::atomic<uint64_t> completed;
+
+    // The frames the daemon has submitted for this client, per phase
+    std::atomic<uint64_t>   frames[2];
+
+    mindydRequest_t         ring[MINDYD_RING_ENTRIES];
+};
+
+// The whole shared-memory segment
+struct mindydShared_t
+{
+    std::atomic<uint32_t>   magic;          // MINDYD_MAGIC, written last at startup
+    uint32_t                version;        // MINDYD_VERSION
+    uint32_t                daemonPid;
+    uint32_t                maxClients;     // MINDYD_MAX_CLIENTS
+    mindydStatus_t          status;
+    mindydClient_t          client[MINDYD_MAX_CLIENTS];
+};
@@ -0,0 +1,356 @@
+//=================================================================================================
+// MmioTrace.cpp - Records every register access made to Mindy, and replays the recording
+//=================================================================================================
+#include <x86intrin.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include "MmioTrace.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// The recorder that the tap is logging to
+atomic<MmioRecorder*> MmioRecorder::active_ {nullptr};
+
+// Incremented by every MmioRecorder::start()
+atomic<uint64_t> MmioRecorder::generation_ {0};
+
+// The number of threads inside MmioRecorder::tap()
+atomic<uint32_t> MmioRecorder::inTap_ {0};
+
+// The calling thread's ring, and the generation of the recording it belongs to
+static thread_local void*    myRing       = nullptr;
+static thread_local uint64_t myGeneration = 0;
+
+
+//=================================================================================================
+// wallNs() - Returns the steady clock, in nanoseconds
+//=================================================================================================
+static double wallNs()
+{
+    return duration<double, nano>(steady_clock::now().time_since_epoch()).count();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// start() - Opens the log and starts logging every access to the card
+//=================================================================================================
+void MmioRecorder::start(const string& filename, CMindy& mindy, const config_t& config)
+{
+    if (file_) throwRuntime("MmioRecorder::start() called twice");
+
+    if (config.ringRecords == 0 || (config.ringRecords & (config.ringRecords - 1)))
+        throwRuntime("MmioRecorder: ring size %u isn't a power of 2", config.ringRecords);
+
+    if (mindy.bar0() == nullptr) throwRuntime("MmioRecorder: Mindy isn't initialized");
+
+    // The header is rewritten with the real numbers when we stop
+    FILE* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) throwRuntime("Can't create %s: %s", filename.c_str(), strerror(errno));
+
+    mmioLogHeader_t header {};
+    if (fwrite(&header, sizeof header, 1, file) != 1)
+    {
+        fclose(file);
+        throwRuntime("Can't write %s", filename.c_str());
+    }
+
+    // There can only be one recorder at a time
+    MmioRecorder* expected = nullptr;
+    if (!active_.compare_exchange_strong(expected, this))
+    {
+        fclose(file);
+        throwRuntime("Another MmioRecorder is already recording");
+    }
+
+    file_         = file;
+    config_       = config;
+    bar0_         = mindy.bar0();
+    written_      = 0;
+    writeFailed_  = false;
+    stopping_     = false;
+    myGeneration_ = ++generation_;
+    rings_.clear();
+
+    tsc0_ = __rdtsc();
+    ns0_  = wallNs();
+
+    thread_ = thread(&MmioRecorder::flushThread, this);
+
+    // From here on, every access is logged
+    MindyReg::mmioTap = &MmioRecorder::tap;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stop() - Stops logging, writes out whatever is still in the rings, and completes the header
+//=================================================================================================
+MmioRecorder::stats_t MmioRecorder::stop()
+{
+    if (file_ == nullptr) return {};
+
+    // Stop logging.  A thread that enters tap() from here on finds no recorder, so once the
+    // threads that are already inside it have left, nothing can touch the rings
+    MindyReg::mmioTap = nullptr;
+    active_ = nullptr;
+    while (inTap_.load() != 0) this_thread::yield();
+
+    stopping_ = true;
+    thread_.join();
+    drain();
+
+    double   elapsedNs = wallNs() - ns0_;
+    uint64_t ticks     = __rdtsc() - tsc0_;
+
+    mmioLogHeader_t header {};
+    memcpy(header.magic, MMIO_LOG_MAGIC, sizeof header.magic);
+    header.version  = MMIO_LOG_VERSION;
+    header.threads  = rings_.size();
+    header.nsPerTsc = ticks ? elapsedNs / ticks : 0;
+    header.records  = written_;
+    for (auto& ring : rings_) header.dropped += ring->dropped;
+
+    bool ok = !writeFailed_;
+    if (ok) ok = fseek(file_, 0, SEEK_SET) == 0 && fwrite(&header, sizeof header, 1, file_) == 1;
+    if (fclose(file_) != 0) ok = false;
+    file_ = nullptr;
+    rings_.clear();
+
+    if (!ok) throwRuntime("MmioRecorder: the log couldn't be written");
+
+    return {header.records, header.dropped, header.threads};
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// tap() - Logs one access into the calling thread's ring.  This runs on the caller's thread,
+//         right after the access, so it must be cheap and must never block
+//=================================================================================================
+void MmioRecorder::tap(volatile uint32_t* address, uint32_t value, bool isWrite)
+{
+    uint64_t tsc = __rdtsc();
+
+    // Tell stop() we're in here before looking for the recorder, and that we've left on the
+    // way out, whichever way that is
+    struct inTapGuard_t
+    {
+        inTapGuard_t()  {inTap_.fetch_add(1);}
+        ~inTapGuard_t() {inTap_.fetch_sub(1, memory_order_release);}
+    } guard;
+
+    MmioRecorder* self = active_.load();
+    if (self == nullptr) return;
+
+    // Ignore accesses to anything but the card we're recording
+    uint64_t offset = (unsigned char*)address - self->bar0_;
+    if (offset >= MMIO_OFFSET_LIMIT) return;
+
+    // The first access a thread makes in a recording creates its ring
+    if (myGeneration != self->myGeneration_)
+    {
+        myRing       = self->addThread();
+        myGeneration = self->myGeneration_;
+    }
+
+    threadRing_t* ring = (threadRing_t*)myRing;
+    if (ring == nullptr) return;
+
+    uint64_t head = ring->head.load(memory_order_relaxed);
+    uint64_t size = ring->records.size();
+
+    // If the ring looks full, see how far the flush thread has gotten
+    if (head - ring->tailCache >= size)
+    {
+        ring->tailCache = ring->tail.load(memory_order_acquire);
+        if (head - ring->tailCache >= size)
+        {
+            ring->dropped.store(ring->dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    mmioRecord_t& record = ring->records[head & (size - 1)];
+    record.tsc    = tsc;
+    record.access = offset | (ring->index << 24) | (isWrite ? 0x80000000 : 0);
+    record.value  = value;
+
+    ring->head.store(head + 1, memory_order_release);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// addThread() - Creates a ring for the calling thread
+//=================================================================================================
+MmioRecorder::threadRing_t* MmioRecorder::addThread()
+{
+    lock_guard<mutex> lock(ringsMutex_);
+
+    if (rings_.size() == MMIO_MAX_THREADS) return nullptr;
+
+    auto ring = make_unique<threadRing_t>();
+    ring->records.resize(config_.ringRecords);
+    ring->index = rings_.size();
+    rings_.push_back(move(ring));
+    return rings_.back().get();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// drain() - Moves everything in the rings to the file
+//=================================================================================================
+void MmioRecorder::drain()
+{
+    {
+        lock_guard<mutex> lock(ringsMutex_);
+
+        for (auto& ring : rings_)
+        {
+            uint64_t tail = ring->tail.load(memory_order_relaxed);
+            uint64_t head = ring->head.load(memory_order_acquire);
+            uint64_t mask = ring->records.size() - 1;
+
+            for (; tail != head; ++tail) buffer_.push_back(ring->records[tail & mask]);
+
+            ring->tail.store(tail, memory_order_release);
+        }
+    }
+
+    if (buffer_.empty()) return;
+
+    if (fwrite(buffer_.data(), sizeof(mmioRecord_t), buffer_.size(), file_) != buffer_.size())
+        writeFailed_ = true;
+
+    written_ += buffer_.size();
+    buffer_.clear();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// flushThread() - Drains the rings periodically until we're told to stop
+//=================================================================================================
+void MmioRecorder::flushThread()
+{
+    while (!stopping_)
+    {
+        this_thread::sleep_for(milliseconds(config_.flushMs));
+        drain();
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// load() - Reads a log, and puts its records in the order they happened
+//=================================================================================================
+void MmioReplayer::load(const string& filename)
+{
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) throwRuntime("Can't open %s: %s", filename.c_str(), strerror(errno));
+
+    mmioLogHeader_t header;
+    bool ok = fread(&header, sizeof header, 1, file) == 1;
+    if (ok && memcmp(header.magic, MMIO_LOG_MAGIC, sizeof header.magic) != 0) ok = false;
+    if (!ok)
+    {
+        fclose(file);
+        throwRuntime("%s isn't an MMIO log", filename.c_str());
+    }
+
+    if (header.version != MMIO_LOG_VERSION)
+    {
+        fclose(file);
+        throwRuntime("%s is version %u of the MMIO log format", filename.c_str(), header.version);
+    }
+
+    vector<mmioRecord_t> records(header.records);
+    size_t count = fread(records.data(), sizeof(mmioRecord_t), records.size(), file);
+    fclose(file);
+    if (count != records.size()) throwRuntime("%s is truncated", filename.c_str());
+
+    // Each thread's records are already in order, so a stable sort keeps them that way
+    stable_sort(records.begin(), records.end(), [](const mmioRecord_t& a, const mmioRecord_t& b)
+    {
+        return a.tsc < b.tsc;
+    });
+
+    header_  = header;
+    records_ = move(records);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// recordNs() - Returns the time of a record, relative to the first record in the log
+//=================================================================================================
+double MmioReplayer::recordNs(const mmioRecord_t& record)
+{
+    if (records_.empty()) return 0;
+    return (double)(record.tsc - records_[0].tsc) * header_.nsPerTsc;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// replay() - Re-issues the accesses in the log against "mindy", at "config.speed" times the
+//            original pace
+//=================================================================================================
+MmioReplayer::stats_t MmioReplayer::replay(CMindy& mindy, const config_t& config,
+                                           mismatch_t onMismatch)
+{
+    using MindyReg::FC_FRAME_ADD_0;
+    using MindyReg::FC_FRAME_ADD_1;
+
+    stats_t stats {};
+
+    double startNs = wallNs();
+
+    for (auto& record : records_)
+    {
+        // Wait until it's time for this access.  Sleep through long gaps, spin through short ones
+        if (config.speed > 0)
+        {
+            double dueNs = startNs + recordNs(record) / config.speed;
+            while (true)
+            {
+                double remaining = dueNs - wallNs();
+                if (remaining <= 0) break;
+                if (remaining > 200000) this_thread::sleep_for(nanoseconds((int64_t)remaining - 100000));
+            }
+        }
+
+        uint32_t offset = record.offset();
+
+        if (record.isWrite())
+        {
+            // Frame-add writes go through CMindy, so that an emulated card doesn't lose any
+            if      (offset == FC_FRAME_ADD_0::offset) mindy.addLocalFrameCounter(0, record.value);
+            else if (offset == FC_FRAME_ADD_1::offset) mindy.addLocalFrameCounter(1, record.value);
+            else    mindy.write32(offset, record.value);
+            ++stats.writes;
+        }
+        else if (config.reads)
+        {
+            uint32_t actual = mindy.read32(offset);
+            ++stats.reads;
+            if (actual != record.value)
+            {
+                ++stats.mismatches;
+                if (onMismatch) onMismatch(record, actual);
+            }
+        }
+    }
+
+    stats.seconds = (wallNs() - startNs) / 1e9;
+    return stats;
+}
+//=================================================================================================
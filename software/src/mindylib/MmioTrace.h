@@ -0,0 +1,229 @@
+//=================================================================================================
+// MmioTrace.h - Records every register access made to Mindy, and replays the recording
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <functional>
+#include "mindy.h"
+
+/*
+    MmioRecorder logs every 32-bit load and store that CMindy (and anything else that uses
+    MindyRegs.h) makes to BAR 0, with the TSC at the time of the access.  A 64-bit access is
+    logged as the two 32-bit accesses that the card actually sees, upper half first.
+
+    Each thread that touches the card logs into a ring of its own, without locks or system
+    calls: the cost of an access is an rdtsc and a 16-byte store, a few tens of nanoseconds,
+    which is less than the MMIO store itself.  A background thread drains the rings into the log file every few
+    milliseconds.  If a thread outruns it and fills its ring, the accesses that don't fit are
+    counted rather than logged, and the count is saved in the log's header.
+
+    MmioReplayer loads a log, merges the threads' accesses into TSC order, and re-issues them
+    against a card (or a MindyEmulator) at the original pace, a multiple of it, or as fast as
+    possible.  Reads are re-issued too, since reading some registers has side effects; the
+    value read is compared with the logged value, and mismatches are counted.
+
+    The TSC must be invariant and synchronized across cores, as it is on any recent x86.
+
+    Only one MmioRecorder can be recording at a time.  A thread that's in the middle of an
+    access when stop() is called may lose that one access, and the recorder must not be
+    destroyed while another thread could still be touching the card.
+
+    Example:
+
+        MmioRecorder recorder;
+        recorder.start("mmio.log", Mindy);
+        ...                                 // Run the application as usual
+        recorder.stop();
+
+        MmioReplayer replayer;
+        replayer.load("mmio.log");
+        auto stats = replayer.replay(Mindy, MmioReplayer::config_t());
+*/
+
+// The magic number at the start of a log
+const char MMIO_LOG_MAGIC[8] = {'M', 'I', 'N', 'D', 'Y', 'M', 'I', 'O'};
+
+const uint32_t MMIO_LOG_VERSION = 1;
+
+// Accesses at or beyond this offset from BAR 0 aren't Mindy's, and aren't logged
+const uint32_t MMIO_OFFSET_LIMIT = 1 << 24;
+
+// The most threads that a single recording can log.  The rest aren't logged
+const uint32_t MMIO_MAX_THREADS = 128;
+
+// One logged access
+struct mmioRecord_t
+{
+    uint64_t    tsc;                // The TSC just after the access
+    uint32_t    access;             // Bits 23:0 = BAR 0 offset, 30:24 = thread, 31 = write
+    uint32_t    value;              // The value written or read
+
+    uint32_t    offset()  const {return access & (MMIO_OFFSET_LIMIT - 1);}
+    uint32_t    thread()  const {return (access >> 24) & 0x7F;}
+    bool        isWrite() const {return (access >> 31) != 0;}
+};
+
+// The first block of a log.  The records follow it, grouped by thread but otherwise unsorted
+struct mmioLogHeader_t
+{
+    char        magic[8];           // "MINDYMIO"
+    uint32_t    version;            // MMIO_LOG_VERSION
+    uint32_t    threads;            // Number of threads that made accesses
+    double      nsPerTsc;           // Nanoseconds per TSC tick
+    uint64_t    records;            // Number of records in the log
+    uint64_t    dropped;            // Accesses not logged because a ring was full
+};
+
+
+//=================================================================================================
+// MmioRecorder - Logs register accesses to a file
+//=================================================================================================
+class MmioRecorder
+{
+public:
+
+    struct config_t
+    {
+        uint32_t    ringRecords = 65536;    // Per-thread ring size.  Must be a power of 2
+        uint32_t    flushMs     = 10;       // How often the rings are drained to the file
+    };
+
+    struct stats_t
+    {
+        uint64_t    records;                // Accesses written to the log
+        uint64_t    dropped;                // Accesses that didn't fit in a ring
+        uint32_t    threads;                // Threads that made accesses
+    };
+
+    // Default constructor
+    MmioRecorder() {}
+
+    // Destructor.  Finishes the log if we're still recording
+    ~MmioRecorder() {try {stop();} catch (...) {}}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    MmioRecorder (const MmioRecorder&) = delete;
+    MmioRecorder& operator= (const MmioRecorder&) = delete;
+
+    // Starts logging the register accesses made to "mindy" by every thread
+    void        start(const std::string& filename, CMindy& mindy) {start(filename, mindy, config_t());}
+    void        start(const std::string& filename, CMindy& mindy, const config_t& config);
+
+    // Stops logging, and finishes writing the log.  Throws if the log couldn't be written
+    stats_t     stop();
+
+    // Returns true while we're recording
+    bool        recording() {return file_ != nullptr;}
+
+protected:
+
+    // The ring that one thread logs its accesses into.  Only that thread advances "head",
+    // and only the flush thread advances "tail"
+    struct threadRing_t
+    {
+        std::vector<mmioRecord_t>   records;
+        std::atomic<uint64_t>       head {0};
+        std::atomic<uint64_t>       tail {0};
+        std::atomic<uint64_t>       dropped {0};
+        uint64_t                    tailCache = 0;      // The producer's copy of "tail"
+        uint32_t                    index;
+    };
+
+    // Installed as MindyReg::mmioTap while we're recording
+    static void tap(volatile uint32_t* address, uint32_t value, bool isWrite);
+
+    // Creates the ring for the calling thread.  Returns nullptr if there are too many threads
+    threadRing_t* addThread();
+
+    // Writes everything that's in the rings to the file
+    void        drain();
+
+    // Drains the rings every "flushMs" until "stopping_" is set
+    void        flushThread();
+
+    // The recorder that "tap" logs to
+    static std::atomic<MmioRecorder*> active_;
+
+    // Incremented by every start(), so that a thread knows when its ring is stale
+    static std::atomic<uint64_t> generation_;
+
+    // The number of threads that are inside tap().  stop() waits for this to reach 0 before
+    // it frees the rings
+    static std::atomic<uint32_t> inTap_;
+
+    config_t    config_;
+    unsigned char* bar0_ = nullptr;
+    FILE*       file_ = nullptr;
+    uint64_t    myGeneration_ = 0;
+
+    // The rings, one per thread.  "ringsMutex_" guards the list, not the rings
+    std::vector<std::unique_ptr<threadRing_t>> rings_;
+    std::mutex  ringsMutex_;
+
+    // Records waiting to be written
+    std::vector<mmioRecord_t> buffer_;
+    uint64_t    written_ = 0;
+
+    // Set by the flush thread if the log couldn't be written
+    std::atomic<bool> writeFailed_ {false};
+
+    // The TSC and the wall clock when recording started, for computing nsPerTsc
+    uint64_t    tsc0_ = 0;
+    double      ns0_  = 0;
+
+    std::thread thread_;
+    std::atomic<bool> stopping_ {false};
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// MmioReplayer - Re-issues the register accesses in a log
+//=================================================================================================
+class MmioReplayer
+{
+public:
+
+    struct config_t
+    {
+        double      speed = 1.0;            // 2.0 = twice the original pace, 0 = flat out
+        bool        reads = true;           // Re-issue the reads as well as the writes
+    };
+
+    struct stats_t
+    {
+        uint64_t    writes;
+        uint64_t    reads;
+        uint64_t    mismatches;             // Reads that didn't return the logged value
+        double      seconds;
+    };
+
+    // Called for each read that doesn't return the logged value
+    using mismatch_t = std::function<void(const mmioRecord_t& record, uint32_t actual)>;
+
+    // Loads a log, and sorts its records into TSC order
+    void        load(const std::string& filename);
+
+    // The log, once it's loaded
+    const mmioLogHeader_t&           header()  {return header_;}
+    const std::vector<mmioRecord_t>& records() {return records_;}
+
+    // Returns the time of a record, in nanoseconds from the first record in the log
+    double      recordNs(const mmioRecord_t& record);
+
+    // Re-issues the log against "mindy"
+    stats_t     replay(CMindy& mindy, const config_t& config, mismatch_t onMismatch = nullptr);
+
+protected:
+
+    mmioLogHeader_t           header_ {};
+    std::vector<mmioRecord_t> records_;
+};
+//=================================================================================================
@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include "PciDevice.h"
+#include "throwRuntime.h"
 using namespace std;
 
 #define c(s) s.c_str()
@@ -51,22 +52,6 @@ public:
 
 
 
-//=================================================================================================
-// throwRuntime() - Throws a runtime exception
-//=================================================================================================
-static void throwRuntime(const char* fmt, ...)
-{
-    char buffer[1024];
-    va_list ap;
-    va_start(ap, fmt);
-    vsprintf(buffer, fmt, ap);
-    va_end(ap);
-
-    throw runtime_error(buffer);
-}
-//=================================================================================================
-
-
 //=================================================================================================
 // run() - Runs a shell command and returns it's output as a vector of lines
 //=================================================================================================
@@ -297,19 +282,14 @@ std::vector<PciDevice::resource_t> PciDevice::getResourceList(std::string device
 
 
 //=================================================================================================
-// open() - Opens a connection to the specified PCIe device
+// findDeviceDir() - Returns the sysfs directory of the specified PCIe device
 //
 // Passed: deviceStr = The vendorID:deviceID of the PCIe device we're looking for
 //         deviceDir = Name of the file-system directory where PCI device information can
 //                     be found.   If empty-string, a sensible default is used
 //=================================================================================================
-void PciDevice::open(string deviceStr, string deviceDir)
+string PciDevice::findDeviceDir(string deviceStr, string deviceDir)
 {
-    string  dirName;
-
-    // We have not yet found the device that we're looking for
-    bool found = false;
-
     // Get a const char* to the name of the device
     const char* device = deviceStr.c_str();    
 
@@ -321,9 +301,6 @@ void PciDevice::open(string deviceStr, string deviceDir)
     if (p == nullptr) throwRuntime("Malformed device ID %s", device);
     int deviceID = strtoul(p+1, nullptr, 16);
 
-    // If we already have a PCIe device mapped, unmap it
-    close();
-
     // If the caller didn't specify a device-directory, use the default
     if (deviceDir.empty()) deviceDir = "/sys/bus/pci/devices";
 
@@ -334,7 +311,7 @@ void PciDevice::open(string deviceStr, string deviceDir)
         if (!entry.is_directory()) continue;
 
         // Fetch the name of the directory that we're about to examine
-        dirName = entry.path().string();
+        string dirName = entry.path().string();
 
         // Fetch the vendor ID and device ID of this device
         int thisVendorID = getIntegerFromFile(dirName + "/vendor");
@@ -342,15 +319,30 @@ void PciDevice::open(string deviceStr, string deviceDir)
 
         // If this vendor ID and device ID match the caller's, we have found 
         // the droid we're looking for.
-        if (thisVendorID == vendorID && thisDeviceID == deviceID)
-        {
-            found = true;
-            break;
-        }
+        if (thisVendorID == vendorID && thisDeviceID == deviceID) return dirName;
     }
 
     // If we couldn't find a device with that vendor ID and device ID, complain
-    if (!found) throwRuntime("No PCI device found for vendor=0x%X, device=0x%X", vendorID, deviceID);
+    throwRuntime("No PCI device found for vendor=0x%X, device=0x%X", vendorID, deviceID);
+    return "";
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// open() - Opens a connection to the specified PCIe device
+//
+// Passed: deviceStr = The vendorID:deviceID of the PCIe device we're looking for
+//         deviceDir = Name of the file-system directory where PCI device information can
+//                     be found.   If empty-string, a sensible default is used
+//=================================================================================================
+void PciDevice::open(string deviceStr, string deviceDir)
+{
+    // If we already have a PCIe device mapped, unmap it
+    close();
+
+    // Find the sysfs directory of the device
+    string dirName = findDeviceDir(deviceStr, deviceDir);
 
     // Fetch the physical address and size of each resource (i.e. BAR) that our device supports
     resource_ = getResourceList(dirName);
@@ -12,6 +12,9 @@ public:
     // Performs a PCI hot-reset of the specified device
     static void hotReset(std::string device);
 
+    // Returns the sysfs directory of a <vendorID:deviceID>.  Throws if there's no such device
+    static std::string findDeviceDir(std::string device, std::string deviceDir = "");
+
     // Default constructor
     PciDevice() {};
 
@@ -0,0 +1,665 @@
+//=================================================================================================
+// RdmxCapture.cpp - Reads pcap/pcapng captures of RDMX traffic and rebuilds Mindy's frames
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <stdexcept>
+#include "RdmxCapture.h"
+#include "throwRuntime.h"
+using namespace std;
+
+// Magic numbers of a pcap file, as read in our byte order
+static const uint32_t PCAP_MAGIC_US         = 0xA1B2C3D4;
+static const uint32_t PCAP_MAGIC_NS         = 0xA1B23C4D;
+static const uint32_t PCAP_HEADER_BYTES     = 24;
+static const uint32_t PCAP_RECORD_BYTES     = 16;
+
+// pcapng block types, and the byte-order magic of a section header
+static const uint32_t PCAPNG_SHB            = 0x0A0D0D0A;
+static const uint32_t PCAPNG_IDB            = 0x00000001;
+static const uint32_t PCAPNG_PB             = 0x00000002;
+static const uint32_t PCAPNG_SPB            = 0x00000003;
+static const uint32_t PCAPNG_EPB            = 0x00000006;
+static const uint32_t PCAPNG_BYTE_ORDER     = 0x1A2B3C4D;
+
+// The if_tsresol option of an interface description block
+static const uint16_t PCAPNG_IF_TSRESOL     = 9;
+
+// The only link type we decode
+static const uint32_t LINKTYPE_ETHERNET     = 1;
+
+// The Ethernet types we know
+static const uint16_t ETHERTYPE_IPV4        = 0x0800;
+static const uint16_t ETHERTYPE_VLAN        = 0x8100;
+static const uint16_t ETHERTYPE_QINQ        = 0x88A8;
+
+// The bytes of an RDMX header that follow the UDP header: magic, address, stream, reserved
+static const uint32_t RDMX_FIELDS_BYTES     = 22;
+
+// The size of a meta-data record, and of a frame-counter write
+static const uint32_t METADATA_BYTES        = 128;
+static const uint32_t FRAME_COUNTER_BYTES   = 4;
+
+// The most links a frame_t can say it was seen on
+static const uint32_t MAX_FRAME_LINKS       = 32;
+
+
+//=================================================================================================
+// be16(), be32(), be64() - Read big-endian fields of a packet
+//=================================================================================================
+static inline uint16_t be16(const uint8_t* p) {return (p[0] << 8) | p[1];}
+static inline uint32_t be32(const uint8_t* p) {return ((uint32_t)be16(p) << 16) | be16(p + 2);}
+static inline uint64_t be64(const uint8_t* p) {return ((uint64_t)be32(p) << 32) | be32(p + 4);}
+//=================================================================================================
+
+
+//=================================================================================================
+// decodeRdmx() - Decodes the headers of an RDMX packet, the way rdmx_monitor does
+//=================================================================================================
+bool decodeRdmx(const uint8_t* data, uint32_t capLen, rdmxPacket_t& rdmx)
+{
+    if (capLen < 14) return false;
+
+    // Skip over up to two VLAN tags
+    uint32_t offset = 12;
+    uint16_t type   = be16(data + offset);
+    for (int tags = 0; tags < 2 && (type == ETHERTYPE_VLAN || type == ETHERTYPE_QINQ); ++tags)
+    {
+        offset += 4;
+        if (offset + 2 > capLen) return false;
+        type = be16(data + offset);
+    }
+    if (type != ETHERTYPE_IPV4) return false;
+
+    // The IPv4 header, which must carry UDP
+    const uint8_t* ip = data + offset + 2;
+    uint32_t ipOffset = ip - data;
+    if (ipOffset + 20 > capLen || (ip[0] >> 4) != 4 || ip[9] != 17) return false;
+
+    uint32_t ipHeader = (ip[0] & 0xF) * 4;
+    uint32_t ipLength = be16(ip + 2);
+    if (ipHeader < 20 || ipLength < ipHeader + 8 + RDMX_FIELDS_BYTES) return false;
+
+    // The UDP header, and the RDMX fields up to the stream ID
+    const uint8_t* udp    = ip + ipHeader;
+    const uint8_t* fields = udp + 8;
+    if ((fields - data) + 11 > capLen || be16(fields) != RDMX_MAGIC) return false;
+
+    memcpy(rdmx.dstMac, data,     6);
+    memcpy(rdmx.srcMac, data + 6, 6);
+    rdmx.srcIp         = be32(ip + 12);
+    rdmx.dstIp         = be32(ip + 16);
+    rdmx.srcPort       = be16(udp);
+    rdmx.dstPort       = be16(udp + 2);
+    rdmx.address       = be64(fields + 2);
+    rdmx.stream        = fields[10];
+    rdmx.payloadLen    = ipLength - ipHeader - 8 - RDMX_FIELDS_BYTES;
+    rdmx.payloadOffset = ipOffset + ipHeader + 8 + RDMX_FIELDS_BYTES;
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// get16(), get32() - Read fields of the capture file, in the file's byte order
+//=================================================================================================
+uint16_t PcapReader::get16(const uint8_t* p)
+{
+    uint16_t value;
+    memcpy(&value, p, sizeof value);
+    return swapped_ ? __builtin_bswap16(value) : value;
+}
+
+uint32_t PcapReader::get32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof value);
+    return swapped_ ? __builtin_bswap32(value) : value;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// open() - Maps a capture into memory and reads its file header
+//=================================================================================================
+void PcapReader::open(const string& filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throwRuntime("Can't open %s: %s", filename.c_str(), strerror(errno));
+
+    struct stat sb;
+    fstat(fd, &sb);
+    size_ = sb.st_size;
+    if (size_ < PCAP_HEADER_BYTES)
+    {
+        ::close(fd);
+        throwRuntime("%s is too short to be a capture", filename.c_str());
+    }
+
+    void* ptr = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) throwRuntime("Can't map %s: %s", filename.c_str(), strerror(errno));
+    map_ = (const uint8_t*)ptr;
+
+    // We read it once, front to back, so the kernel should read well ahead of us and can
+    // drop the pages we've finished with
+    madvise(ptr, size_, MADV_SEQUENTIAL);
+
+    uint32_t magic;
+    memcpy(&magic, map_, sizeof magic);
+
+    // pcapng starts with a section header, whose type reads the same in either byte order
+    if (magic == PCAPNG_SHB)
+    {
+        pcapng_ = true;
+        pos_    = 0;
+        return;
+    }
+
+    pcapng_ = false;
+    switch (magic)
+    {
+        case PCAP_MAGIC_US:                     swapped_ = false; nsPerUnit_ = 1000; break;
+        case PCAP_MAGIC_NS:                     swapped_ = false; nsPerUnit_ = 1;    break;
+        case __builtin_bswap32(PCAP_MAGIC_US):  swapped_ = true;  nsPerUnit_ = 1000; break;
+        case __builtin_bswap32(PCAP_MAGIC_NS):  swapped_ = true;  nsPerUnit_ = 1;    break;
+        default:
+            close();
+            throwRuntime("%s isn't a pcap or pcapng capture", filename.c_str());
+    }
+
+    // The low 16 bits of the last field are the link type
+    uint32_t linkType = get32(map_ + 20) & 0xFFFF;
+    if (linkType != LINKTYPE_ETHERNET)
+    {
+        close();
+        throwRuntime("%s has link type %u, not Ethernet", filename.c_str(), linkType);
+    }
+
+    pos_ = PCAP_HEADER_BYTES;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// close() - Unmaps the capture
+//=================================================================================================
+void PcapReader::close()
+{
+    if (map_) munmap((void*)map_, size_);
+    map_     = nullptr;
+    size_    = 0;
+    pos_     = 0;
+    skipped_ = 0;
+    ifaces_.clear();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// next() - Fetches the next Ethernet packet
+//=================================================================================================
+bool PcapReader::next(capturedPacket_t& packet)
+{
+    if (map_ == nullptr) return false;
+    return pcapng_ ? nextPcapng(packet) : nextPcap(packet);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// nextPcap() - Fetches the next packet of a pcap file.  A record cut short by the end of the
+//              file (a capture that was still being written) ends the capture
+//=================================================================================================
+bool PcapReader::nextPcap(capturedPacket_t& packet)
+{
+    if (pos_ + PCAP_RECORD_BYTES > size_) return false;
+
+    const uint8_t* record = map_ + pos_;
+    uint32_t capLen = get32(record + 8);
+    if (pos_ + PCAP_RECORD_BYTES + capLen > size_) return false;
+
+    packet.ns      = get32(record) * 1000000000ULL + (uint64_t)get32(record + 4) * nsPerUnit_;
+    packet.data    = record + PCAP_RECORD_BYTES;
+    packet.capLen  = capLen;
+    packet.wireLen = get32(record + 12);
+    packet.iface   = 0;
+
+    pos_ += PCAP_RECORD_BYTES + capLen;
+    return true;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// readSectionHeader() - Starts a new pcapng section, which sets the byte order and has
+//                       interfaces of its own
+//=================================================================================================
+void PcapReader::readSectionHeader()
+{
+    uint32_t order;
+    memcpy(&order, map_ + pos_ + 8, sizeof order);
+
+    if      (order == PCAPNG_BYTE_ORDER)                   swapped_ = false;
+    else if (order == __builtin_bswap32(PCAPNG_BYTE_ORDER)) swapped_ = true;
+    else throwRuntime("pcapng section header at offset %lu has a bad byte-order magic", pos_);
+
+    ifaces_.clear();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// readInterface() - Records the link type and timestamp resolution of a pcapng interface
+//=================================================================================================
+void PcapReader::readInterface(const uint8_t* body, uint32_t bodyLen)
+{
+    iface_t iface = {0, 1000000};
+    if (bodyLen >= 8) iface.linkType = get16(body);
+
+    // The options are code, length, value padded to 4 bytes, ending with code 0
+    for (uint32_t offset = 8; offset + 4 <= bodyLen;)
+    {
+        uint16_t code   = get16(body + offset);
+        uint16_t length = get16(body + offset + 2);
+        if (code == 0 || offset + 4 + length > bodyLen) break;
+
+        // The resolution is 10^-N seconds, or 2^-N if the top bit is set
+        if (code == PCAPNG_IF_TSRESOL && length >= 1)
+        {
+            uint8_t  value = body[offset + 4];
+            uint32_t power = value & 0x7F;
+            uint64_t units = 1;
+            if (value & 0x80)
+                units = (power < 64) ? (1ULL << power) : 0;
+            else if (power <= 19)
+                while (power--) units *= 10;
+            else
+                units = 0;
+            if (units) iface.unitsPerSec = units;
+        }
+
+        offset += 4 + ((length + 3) & ~3);
+    }
+
+    ifaces_.push_back(iface);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// nextPcapng() - Fetches the next packet of a pcapng file, reading the blocks that describe
+//                the sections and interfaces on the way
+//=================================================================================================
+bool PcapReader::nextPcapng(capturedPacket_t& packet)
+{
+    while (pos_ + 12 <= size_)
+    {
+        const uint8_t* block = map_ + pos_;
+
+        // The byte order of a section header's length is only known once we've read it
+        uint32_t type = get32(block);
+        if (type == PCAPNG_SHB) readSectionHeader();
+
+        uint32_t blockLen = get32(block + 4);
+        if (blockLen < 12 || (blockLen & 3))
+            throwRuntime("pcapng block at offset %lu has a bad length (%u)", pos_, blockLen);
+        if (pos_ + blockLen > size_) return false;
+
+        const uint8_t* body    = block + 8;
+        uint32_t       bodyLen = blockLen - 12;
+        pos_ += blockLen;
+
+        uint32_t ifaceId, capLen, wireLen, dataOffset;
+        uint64_t units;
+
+        switch (type)
+        {
+            case PCAPNG_IDB:
+                readInterface(body, bodyLen);
+                continue;
+
+            // The enhanced packet block (and its obsolete predecessor) has a 64-bit timestamp
+            case PCAPNG_EPB:
+            case PCAPNG_PB:
+                if (bodyLen < 20) {++skipped_; continue;}
+                ifaceId    = (type == PCAPNG_EPB) ? get32(body) : get16(body);
+                units      = ((uint64_t)get32(body + 4) << 32) | get32(body + 8);
+                capLen     = get32(body + 12);
+                wireLen    = get32(body + 16);
+                dataOffset = 20;
+                break;
+
+            // The simple packet block has no timestamp and is always on the first interface
+            case PCAPNG_SPB:
+                if (bodyLen < 4) {++skipped_; continue;}
+                ifaceId    = 0;
+                units      = 0;
+                wireLen    = get32(body);
+                capLen     = min(wireLen, bodyLen - 4);
+                dataOffset = 4;
+                break;
+
+            default:
+                continue;
+        }
+
+        // Both cases above made sure the body is at least "dataOffset" bytes, and the
+        // captured length is compared with what's left so that a huge one can't wrap around
+        if (ifaceId >= ifaces_.size() || ifaces_[ifaceId].linkType != LINKTYPE_ETHERNET
+        ||  capLen > bodyLen - dataOffset)
+        {
+            ++skipped_;
+            continue;
+        }
+
+        uint64_t perSec = ifaces_[ifaceId].unitsPerSec;
+        packet.ns      = (units / perSec) * 1000000000ULL
+                       + (uint64_t)((unsigned __int128)(units % perSec) * 1000000000ULL / perSec);
+        packet.data    = body + dataOffset;
+        packet.capLen  = capLen;
+        packet.wireLen = wireLen;
+        packet.iface   = ifaceId;
+        return true;
+    }
+
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// addRegion() - Adds a region of the receiver's memory
+//=================================================================================================
+void RdmxAnalyzer::addRegion(kind_t kind, uint64_t base, uint64_t size)
+{
+    if (kind == UNKNOWN || size == 0) throwRuntime("bad parameter on RdmxAnalyzer::addRegion()");
+    regions_.push_back({kind, base, size});
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// kindName() - Returns the name of a kind of packet
+//=================================================================================================
+const char* RdmxAnalyzer::kindName(kind_t kind)
+{
+    switch (kind)
+    {
+        case FRAME_DATA:    return "frame data";
+        case META_DATA:     return "meta-data";
+        case FRAME_COUNTER: return "frame counter";
+        default:            return "unknown";
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// classify() - Works out what a packet writes to on the receiver, from the region its target
+//              address is in or, if there are no regions, from its size
+//=================================================================================================
+RdmxAnalyzer::kind_t RdmxAnalyzer::classify(const rdmxPacket_t& rdmx, const region_t** region)
+{
+    *region = nullptr;
+
+    if (regions_.empty())
+    {
+        if (rdmx.payloadLen == METADATA_BYTES)      return META_DATA;
+        if (rdmx.payloadLen == FRAME_COUNTER_BYTES) return FRAME_COUNTER;
+        return FRAME_DATA;
+    }
+
+    for (auto& r : regions_)
+    {
+        if (rdmx.address >= r.base && rdmx.address - r.base < r.size)
+        {
+            *region = &r;
+            return r.kind;
+        }
+    }
+
+    return UNKNOWN;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// findLink() - Returns the index of the link a packet came in on, adding it if it's new
+//=================================================================================================
+uint32_t RdmxAnalyzer::findLink(const rdmxPacket_t& rdmx, uint32_t iface, uint64_t ns)
+{
+    uint64_t key = 0;
+    memcpy(&key, rdmx.srcMac, 6);
+    key |= (uint64_t)iface << 48;
+
+    // Traffic usually comes in runs from the same link
+    if (lastLink_ < state_.size() && state_[lastLink_].key == key) return lastLink_;
+
+    for (uint32_t i = 0; i < state_.size(); ++i)
+    {
+        if (state_[i].key == key) return lastLink_ = i;
+    }
+
+    link_t link;
+    memcpy(link.srcMac, rdmx.srcMac, 6);
+    link.srcIp   = rdmx.srcIp;
+    link.iface   = iface;
+    link.firstNs = ns;
+    links_.push_back(link);
+
+    linkState_t state;
+    state.key           = key;
+    state.intervalStart = ns;
+    state_.push_back(state);
+
+    return lastLink_ = state_.size() - 1;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// add() - Decodes one packet and accounts for it
+//=================================================================================================
+void RdmxAnalyzer::add(const capturedPacket_t& packet)
+{
+    rdmxPacket_t rdmx;
+    if (!decodeRdmx(packet.data, packet.capLen, rdmx) || (port_ && rdmx.dstPort != port_))
+    {
+        ++otherPackets_;
+        return;
+    }
+
+    uint64_t     ns    = packet.ns;
+    uint32_t     index = findLink(rdmx, packet.iface, ns);
+    link_t&      link  = links_[index];
+    linkState_t& state = state_[index];
+
+    // Time on the link with nothing on it
+    if (link.packets && ns > link.lastNs)
+    {
+        uint64_t idle = ns - link.lastNs;
+        if (idle > gapNs_) ++link.idleGaps;
+        if (idle > link.maxIdleNs)
+        {
+            link.maxIdleNs   = idle;
+            link.maxIdleAtNs = ns;
+        }
+    }
+
+    // The rate over each interval, for the peak
+    if (ns - state.intervalStart >= rateIntervalNs_)
+    {
+        double gbps = state.intervalBytes * 8.0 / (ns - state.intervalStart);
+        if (gbps > link.peakGbps) link.peakGbps = gbps;
+        state.intervalStart = ns;
+        state.intervalBytes = 0;
+    }
+    state.intervalBytes += packet.wireLen;
+
+    ++link.packets;
+    link.wireBytes    += packet.wireLen;
+    link.payloadBytes += rdmx.payloadLen;
+    link.lastNs        = ns;
+
+    if (rdmx.payloadLen >= sizes_.size()) sizes_.resize(rdmx.payloadLen + 1);
+    ++sizes_[rdmx.payloadLen];
+
+    const region_t* region;
+    kind_t kind = classify(rdmx, &region);
+    ++link.kindPackets[kind];
+
+    if (kind == UNKNOWN) return;
+
+    if (rdmx.stream >= state.streams.size()) state.streams.resize(rdmx.stream + 1);
+    linkStream_t& ls      = state.streams[rdmx.stream];
+    linkFrame_t&  current = ls.current;
+    uint64_t      address = rdmx.address;
+
+    switch (kind)
+    {
+        // Frame data belongs to the frame the next meta-data completes
+        case FRAME_DATA:
+            if (current.packets == 0) current.firstFdNs = ns;
+            else if (address < ls.lastFdAddress && !(region && address == region->base))
+            {
+                ++current.reordered;
+                ++link.reordered;
+            }
+            current.lastFdNs = ns;
+            current.bytes   += rdmx.payloadLen;
+            ++current.packets;
+            ls.lastFdAddress = address;
+            break;
+
+        // Meta-data completes the frame.  Without a region, a lower address is taken to
+        // be the ring wrapping around
+        case META_DATA:
+            if (ls.nextMdAddress && address != ls.nextMdAddress)
+            {
+                bool wrapped = region ? (address == region->base) : (address < ls.nextMdAddress);
+                if (!wrapped) ++link.mdSkips;
+            }
+            ls.nextMdAddress = address + METADATA_BYTES;
+            if (region && ls.nextMdAddress >= region->base + region->size) ls.nextMdAddress = region->base;
+
+            current.ordinal   = ls.frames.size() + 1;
+            current.mdNs      = ns;
+            current.mdAddress = address;
+            ls.frames.push_back(current);
+            current = {};
+            ls.lastFdAddress = 0;
+            break;
+
+        // The frame counter numbers the frames this link has completed.  We need the
+        // payload for that, which a capture of the headers alone doesn't have
+        case FRAME_COUNTER:
+        {
+            if (rdmx.payloadOffset + 4 > packet.capLen) break;
+
+            uint32_t count;
+            memcpy(&count, packet.data + rdmx.payloadOffset, sizeof count);
+
+            uint64_t ordinal = ls.frames.size();
+            int64_t  offset  = (int64_t)count - (int64_t)ordinal;
+            if (ls.offsetKnown && offset != ls.offset) ++link.fcJumps;
+            ls.offset      = offset;
+            ls.offsetKnown = true;
+            ls.fcWrites.push_back({ordinal, count, ns});
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// finish() - Numbers each link's frames from its frame-counter writes, and merges the links'
+//            halves of each frame into one timeline
+//=================================================================================================
+void RdmxAnalyzer::finish()
+{
+    frames_.clear();
+    shortFrames_ = 0;
+
+    size_t streams = 0;
+    for (auto& state : state_) streams = max(streams, state.streams.size());
+
+    for (uint32_t stream = 0; stream < streams; ++stream)
+    {
+        map<uint64_t, frame_t>  merged;
+        map<uint64_t, uint64_t> fcFirst;
+
+        for (uint32_t index = 0; index < state_.size(); ++index)
+        {
+            if (stream >= state_[index].streams.size()) continue;
+            linkStream_t& ls = state_[index].streams[stream];
+
+            // A frame is numbered by the first frame-counter write after it, or if there
+            // isn't one, by the last write before it.  With no writes at all, the frames
+            // are numbered from 1
+            int64_t offset = ls.fcWrites.empty() ? 0
+                           : (int64_t)ls.fcWrites.back().count - (int64_t)ls.fcWrites.back().ordinal;
+            size_t  fc     = ls.fcWrites.size();
+
+            for (size_t f = ls.frames.size(); f-- > 0;)
+            {
+                const linkFrame_t& lf = ls.frames[f];
+                while (fc > 0 && ls.fcWrites[fc - 1].ordinal >= lf.ordinal)
+                {
+                    --fc;
+                    offset = (int64_t)ls.fcWrites[fc].count - (int64_t)ls.fcWrites[fc].ordinal;
+                }
+
+                uint64_t number = lf.ordinal + offset;
+                auto     it     = merged.try_emplace(number, frame_t{}).first;
+                frame_t& frame  = it->second;
+
+                frame.stream = stream;
+                frame.number = number;
+                if (lf.packets)
+                {
+                    if (frame.firstFdNs == 0 || lf.firstFdNs < frame.firstFdNs) frame.firstFdNs = lf.firstFdNs;
+                    if (lf.lastFdNs > frame.lastFdNs) frame.lastFdNs = lf.lastFdNs;
+                }
+                if (lf.mdNs > frame.mdNs) frame.mdNs = lf.mdNs;
+                if (frame.links == 0) frame.mdAddress = lf.mdAddress;
+                frame.packets   += lf.packets;
+                frame.bytes     += lf.bytes;
+                frame.reordered += lf.reordered;
+                if (index < MAX_FRAME_LINKS) frame.links |= 1U << index;
+            }
+
+            for (auto& write : ls.fcWrites)
+            {
+                auto it = fcFirst.find(write.count);
+                if (it == fcFirst.end() || write.ns < it->second) fcFirst[write.count] = write.ns;
+            }
+        }
+
+        // The first frame may have started before the capture did, so it isn't short
+        bool first = true;
+        for (auto& entry : merged)
+        {
+            frame_t& frame = entry.second;
+            auto it = fcFirst.find(frame.number);
+            frame.fcNs = (it == fcFirst.end()) ? 0 : it->second;
+
+            if (frameSize_ && frame.bytes < frameSize_ && !first) ++shortFrames_;
+            first = false;
+
+            frames_.push_back(frame);
+        }
+    }
+}
+//=================================================================================================
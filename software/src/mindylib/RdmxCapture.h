@@ -0,0 +1,322 @@
+//=================================================================================================
+// RdmxCapture.h - Reads pcap/pcapng captures of RDMX traffic and rebuilds Mindy's frames
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+    rdmx_monitor breaks the headers of the packets an rdmx_xmit sends into ILA fields, which is
+    only any use with the card on the bench.  This module does the same for a capture of the
+    traffic (from a tap switch, or tcpdump on the receiver) and goes on to rebuild the frames.
+
+    PcapReader maps a capture into memory and walks its packets in place, without copying
+    them, so a multi-GB capture is read at the speed the page cache (or the disk) can deliver
+    it.  It reads pcap, in either byte order and with microsecond or nanosecond timestamps,
+    and pcapng, with any number of interfaces and sections.  Packets that aren't Ethernet are
+    skipped.
+
+    decodeRdmx() decodes the headers of an RDMX packet, as built by rdmx_xmit_be:
+
+        Offset  Size  Contents
+        ------  ----  -------------------------------------------------------------
+            0    14   Ethernet: destination MAC, source MAC, type 0x0800
+           14    20   IPv4, protocol 17
+           34     8   UDP
+           42     2   RDMX magic number, 0x0122
+           44     8   Target address, where the payload is written on the receiver
+           52     1   Stream ID (when the card carries more than one stream)
+           53    11   Reserved
+           64   ...   Payload
+
+    All of the fields are big-endian.  An 802.1Q tag after the source MAC (which a tap switch
+    may add) is skipped.  The sizes are taken from the IP header rather than from the
+    capture, so a capture that kept only the first 64 bytes of each packet is enough.
+
+    RdmxAnalyzer sorts the packets by link (source MAC, and pcapng interface) and by kind,
+    from the region of the receiver's memory they're written to: frame data (the RFD ring),
+    meta-data (the RMD ring) or the frame counter (RFC).  Without regions, a 128-byte payload
+    is taken to be meta-data and a 4-byte one a frame counter, which is right unless the
+    packet size is 128.  Each rdmx_shim writes the packets of a frame, then its meta-data,
+    then (unless coalesced) the frame counter, so on each link and stream:
+
+        - The frame-data packets since the previous meta-data belong to the frame that the
+          next meta-data completes
+        - A frame counter carries the number of the last frame completed, which numbers the
+          frames on that link.  A change in the difference between the count and the number
+          of meta-data seen means frames were lost (or the capture dropped packets)
+        - Frame data is written at increasing addresses within a frame.  An address lower than
+          the one before it (other than a wrap to the start of the ring) is out of order
+        - Meta-data goes to consecutive 128-byte slots.  A skipped slot is a lost meta-data
+
+    The links' halves of each frame are then matched up by frame number, so each frame gets
+    a timeline: its first and last frame-data packet, the meta-data on each link, and the
+    frame counter.  Gaps are reported two ways: idle time on a link longer than a threshold,
+    and frames with fewer frame-data bytes than the frame size.
+
+        PcapReader reader;
+        reader.open("tap.pcapng");
+
+        RdmxAnalyzer analyzer;
+        analyzer.addRegion(RdmxAnalyzer::FRAME_DATA, 0x100000000, 0x40000000);
+        analyzer.setFrameSize(4 * 1024 * 1024);
+
+        capturedPacket_t packet;
+        while (reader.next(packet)) analyzer.add(packet);
+        analyzer.finish();
+
+        for (auto& frame : analyzer.frames()) ...
+
+    Neither class does any locking.
+*/
+
+// The RDMX magic number, and the bytes of header in front of the payload
+const uint16_t RDMX_MAGIC        = 0x0122;
+const uint32_t RDMX_HEADER_BYTES = 64;
+
+// One packet, as found in a capture
+struct capturedPacket_t
+{
+    uint64_t        ns;             // Time of capture, in nanoseconds since the epoch
+    const uint8_t*  data;           // The bytes that were captured, in the mapped file
+    uint32_t        capLen;         // The number of bytes that were captured
+    uint32_t        wireLen;        // The length of the packet on the wire
+    uint32_t        iface;          // The pcapng interface (0 for pcap)
+};
+
+// The fields of an RDMX packet's headers that we use
+struct rdmxPacket_t
+{
+    uint8_t         dstMac[6];
+    uint8_t         srcMac[6];
+    uint32_t        srcIp, dstIp;
+    uint16_t        srcPort, dstPort;
+    uint64_t        address;        // Target address
+    uint8_t         stream;
+    uint32_t        payloadLen;     // From the IP header
+    uint32_t        payloadOffset;  // Where the payload starts in the packet
+};
+
+// Decodes an RDMX packet.  Returns false if the packet isn't one
+bool decodeRdmx(const uint8_t* data, uint32_t capLen, rdmxPacket_t& rdmx);
+
+
+//=================================================================================================
+// PcapReader - Walks the packets of a pcap or pcapng file, mapped into memory
+//=================================================================================================
+class PcapReader
+{
+public:
+
+    ~PcapReader() {close();}
+
+    // Maps a capture and checks that it's one.  Throws on error
+    void        open(const std::string& filename);
+
+    // Unmaps the capture.  The packets returned by next() are no longer valid
+    void        close();
+
+    // Fetches the next Ethernet packet.  Returns false at the end of the capture
+    bool        next(capturedPacket_t& packet);
+
+    // Returns the size of the capture, and how far into it we've read
+    uint64_t    size()     {return size_;}
+    uint64_t    position() {return pos_;}
+
+    // Returns "pcap" or "pcapng"
+    const char* format()   {return pcapng_ ? "pcapng" : "pcap";}
+
+    // Returns the number of packets skipped because they weren't Ethernet or were truncated
+    uint64_t    skipped()  {return skipped_;}
+
+protected:
+
+    // A pcapng interface: its link type, and timestamp units per second
+    struct iface_t
+    {
+        uint16_t    linkType;
+        uint64_t    unitsPerSec;
+    };
+
+    bool        nextPcap(capturedPacket_t& packet);
+    bool        nextPcapng(capturedPacket_t& packet);
+    void        readSectionHeader();
+    void        readInterface(const uint8_t* body, uint32_t bodyLen);
+
+    uint32_t    get32(const uint8_t* p);
+    uint16_t    get16(const uint8_t* p);
+
+    const uint8_t* map_     = nullptr;
+    uint64_t    size_       = 0;
+    uint64_t    pos_        = 0;
+    bool        pcapng_     = false;
+    bool        swapped_    = false;    // The file's byte order isn't ours
+    uint32_t    nsPerUnit_  = 1000;     // pcap: 1000 for microseconds, 1 for nanoseconds
+    uint64_t    skipped_    = 0;
+
+    // The interfaces of the current pcapng section
+    std::vector<iface_t> ifaces_;
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// RdmxAnalyzer - Rebuilds the frames in a capture of RDMX traffic and gathers statistics
+//=================================================================================================
+class RdmxAnalyzer
+{
+public:
+
+    // What a packet writes to on the receiver
+    enum kind_t {FRAME_DATA, META_DATA, FRAME_COUNTER, UNKNOWN};
+
+    // Statistics for one link
+    struct link_t
+    {
+        uint8_t     srcMac[6];
+        uint32_t    srcIp;
+        uint32_t    iface;
+        uint64_t    packets        = 0;
+        uint64_t    wireBytes      = 0;     // Whole packets, as on the wire without FCS
+        uint64_t    payloadBytes   = 0;
+        uint64_t    kindPackets[4] = {0};   // By kind_t
+        uint64_t    firstNs        = 0;
+        uint64_t    lastNs         = 0;
+        double      peakGbps       = 0;     // Over any one interval of "rateIntervalNs"
+        uint64_t    maxIdleNs      = 0;     // The longest time between two packets...
+        uint64_t    maxIdleAtNs    = 0;     // ...and when it ended
+        uint64_t    idleGaps       = 0;     // Times between packets longer than "gapNs"
+        uint64_t    reordered      = 0;     // Frame data written below the previous address
+        uint64_t    mdSkips        = 0;     // Meta-data that didn't go to the next slot
+        uint64_t    fcJumps        = 0;     // Frame counts that disagree with the frames seen
+
+        double      seconds() const {return (lastNs - firstNs) * 1e-9;}
+        double      gbps() const {return seconds() > 0 ? wireBytes * 8 / seconds() / 1e9 : 0;}
+    };
+
+    // The timeline of one frame, put together from all of the links
+    struct frame_t
+    {
+        uint8_t     stream;
+        uint64_t    number;         // From the frame counter, or counted from the start
+        uint64_t    firstFdNs;      // First frame-data packet on any link (0 if none)
+        uint64_t    lastFdNs;       // Last frame-data packet on any link
+        uint64_t    mdNs;           // Last meta-data to arrive
+        uint64_t    fcNs;           // First frame-counter write with this count (0 if none)
+        uint64_t    mdAddress;      // Where the meta-data was written
+        uint32_t    packets;        // Frame-data packets, on all links
+        uint64_t    bytes;          // Frame-data bytes, on all links
+        uint32_t    reordered;      // Frame-data packets out of order
+        uint32_t    links;          // Bitmap of the links (by index) that sent meta-data
+    };
+
+    // Where on the receiver a kind of packet is written
+    struct region_t
+    {
+        kind_t      kind;
+        uint64_t    base;
+        uint64_t    size;
+    };
+
+    // Adds a region of the receiver's memory.  Add one for each ring (and each stream's
+    // rings); a frame counter's region is 4 bytes
+    void        addRegion(kind_t kind, uint64_t base, uint64_t size);
+
+    // Sets the frame size, so frames that are short of data can be counted (0 = don't)
+    void        setFrameSize(uint64_t bytes) {frameSize_ = bytes;}
+
+    // Sets the time between two packets on a link that counts as a gap (default 100 us)
+    void        setGapThreshold(uint64_t ns) {gapNs_ = ns;}
+
+    // Sets the interval that a link's peak rate is measured over (default 1 ms)
+    void        setRateInterval(uint64_t ns) {rateIntervalNs_ = ns;}
+
+    // Only count packets sent to this UDP port (0 = any)
+    void        setPort(uint16_t port) {port_ = port;}
+
+    // Decodes one packet and accounts for it
+    void        add(const capturedPacket_t& packet);
+
+    // Matches up the frames from the links.  Call once, after the last add()
+    void        finish();
+
+    // The results
+    const std::vector<link_t>&   links()  const {return links_;}
+    const std::vector<frame_t>&  frames() const {return frames_;}
+
+    // The number of packets with each payload length (indexed by length)
+    const std::vector<uint64_t>& sizes()  const {return sizes_;}
+
+    // Packets that weren't RDMX (or went to another port)
+    uint64_t    otherPackets() const {return otherPackets_;}
+
+    // Frames with less frame data than the frame size
+    uint64_t    shortFrames() const {return shortFrames_;}
+
+    // Returns the name of a kind of packet
+    static const char* kindName(kind_t kind);
+
+protected:
+
+    // A frame as seen on one link
+    struct linkFrame_t
+    {
+        uint64_t    ordinal;        // Meta-data seen on this link and stream before this one
+        uint64_t    firstFdNs;
+        uint64_t    lastFdNs;
+        uint64_t    mdNs;
+        uint64_t    mdAddress;
+        uint32_t    packets;
+        uint64_t    bytes;
+        uint32_t    reordered;
+    };
+
+    // A frame-counter write, and how many meta-data had been seen before it
+    struct fcWrite_t
+    {
+        uint64_t    ordinal;
+        uint64_t    count;
+        uint64_t    ns;
+    };
+
+    // Where one link is in one stream
+    struct linkStream_t
+    {
+        std::vector<linkFrame_t> frames;
+        std::vector<fcWrite_t>   fcWrites;
+        linkFrame_t current        = {};
+        uint64_t    lastFdAddress  = 0;
+        uint64_t    nextMdAddress  = 0;     // 0 = not known yet
+        bool        offsetKnown    = false;
+        int64_t     offset         = 0;     // Frame count minus ordinal
+    };
+
+    // Where one link is, apart from its statistics
+    struct linkState_t
+    {
+        uint64_t    key;
+        uint64_t    intervalStart  = 0;
+        uint64_t    intervalBytes  = 0;
+        std::vector<linkStream_t> streams;
+    };
+
+    uint32_t    findLink(const rdmxPacket_t& rdmx, uint32_t iface, uint64_t ns);
+    kind_t      classify(const rdmxPacket_t& rdmx, const region_t** region);
+
+    std::vector<region_t>       regions_;
+    uint64_t    frameSize_      = 0;
+    uint64_t    gapNs_          = 100000;
+    uint64_t    rateIntervalNs_ = 1000000;
+    uint16_t    port_           = 0;
+
+    std::vector<link_t>         links_;
+    std::vector<linkState_t>    state_;
+    uint32_t    lastLink_       = 0;
+
+    std::vector<frame_t>        frames_;
+    std::vector<uint64_t>       sizes_;
+    uint64_t    otherPackets_   = 0;
+    uint64_t    shortFrames_    = 0;
+};
+//=================================================================================================
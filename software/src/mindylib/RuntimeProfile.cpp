@@ -0,0 +1,392 @@
+//=================================================================================================
+// RuntimeProfile.cpp - Sets up a low-jitter environment for the threads that feed the card
+//=================================================================================================
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdarg>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include "RuntimeProfile.h"
+#include "PciDevice.h"
+#include "throwRuntime.h"
+
+// Older C libraries don't know about this one (Linux 5.14)
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+using namespace std;
+
+
+//=================================================================================================
+// readLine() - Returns the first line of a file, or an empty string if it can't be read
+//=================================================================================================
+static string readLine(const string& filename)
+{
+    string line;
+    ifstream file(filename);
+    if (file.is_open()) getline(file, line);
+    return line;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// selected() - Returns the [bracketed] choice from a sysfs file such as
+//              "always [madvise] never"
+//=================================================================================================
+static string selected(const string& line)
+{
+    size_t open  = line.find('[');
+    size_t close = line.find(']');
+    if (open == string::npos || close == string::npos || close < open) return line;
+    return line.substr(open + 1, close - open - 1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// intersect() - Returns the CPUs that are in both lists
+//=================================================================================================
+static vector<int> intersect(const vector<int>& a, const vector<int>& b)
+{
+    vector<int> result;
+    for (int cpu : a)
+    {
+        if (find(b.begin(), b.end(), cpu) != b.end()) result.push_back(cpu);
+    }
+    return result;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// cpuListStr() - Formats a list of CPUs as a string, "none" if it's empty
+//=================================================================================================
+static string cpuListStr(const vector<int>& cpus)
+{
+    if (cpus.empty()) return "none";
+
+    string result;
+    for (size_t i = 0; i < cpus.size(); ++i)
+    {
+        // Collapse runs of consecutive CPUs into "first-last"
+        size_t last = i;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) ++last;
+
+        if (!result.empty()) result += ',';
+        result += to_string(cpus[i]);
+        if (last > i) result += '-' + to_string(cpus[last]);
+        i = last;
+    }
+    return result;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseCpuList() - Parses a sysfs CPU list such as "0-3,8,10-11".  Anything that isn't a
+//                  list (e.g. "(null)") is taken to mean no CPUs
+//=================================================================================================
+vector<int> RuntimeProfile::parseCpuList(const string& list)
+{
+    vector<int> result;
+    const char* p = list.c_str();
+
+    while (*p)
+    {
+        if (*p < '0' || *p > '9') return {};
+
+        char* end;
+        int first = strtol(p, &end, 10);
+        int last  = first;
+        if (*end == '-') last = strtol(end + 1, &end, 10);
+        for (int cpu = first; cpu <= last; ++cpu) result.push_back(cpu);
+
+        p = end;
+        if (*p == ',') ++p;
+        else if (*p && *p != '\n') return {};
+        else break;
+    }
+
+    return result;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// examine() - Finds out what the machine is doing, without changing anything
+//=================================================================================================
+RuntimeProfile::systemInfo_t RuntimeProfile::examine(const string& pcieID)
+{
+    systemInfo_t info;
+
+    // The CPUs we're allowed to run on
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &mask)) info.allowed.push_back(cpu);
+        }
+    }
+
+    // The CPUs the kernel keeps other work away from
+    info.isolated = parseCpuList(readLine("/sys/devices/system/cpu/isolated"));
+    info.nohzFull = parseCpuList(readLine("/sys/devices/system/cpu/nohz_full"));
+
+    // The CPUs near the card.  Not finding the card isn't an error; we just can't prefer them
+    if (!pcieID.empty())
+    {
+        try
+        {
+            info.cardDir = PciDevice::findDeviceDir(pcieID);
+        }
+        catch (const exception&) {}
+    }
+
+    if (!info.cardDir.empty())
+    {
+        info.cardCpus = parseCpuList(readLine(info.cardDir + "/local_cpulist"));
+        string node   = readLine(info.cardDir + "/numa_node");
+        if (!node.empty()) info.cardNode = strtol(node.c_str(), nullptr, 10);
+    }
+
+    // How transparent huge pages are being handled
+    info.thpEnabled = selected(readLine("/sys/kernel/mm/transparent_hugepage/enabled"));
+    info.thpDefrag  = selected(readLine("/sys/kernel/mm/transparent_hugepage/defrag"));
+
+    string compact = readLine("/proc/sys/vm/compact_unevictable_allowed");
+    if (!compact.empty()) info.compactUnevictable = strtol(compact.c_str(), nullptr, 10);
+
+    return info;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// warn() - Records a failure, or throws it if we're strict
+//=================================================================================================
+void RuntimeProfile::warn(const char* fmt, ...)
+{
+    char buffer[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+
+    if (config_.strict) throw runtime_error(buffer);
+
+    lock_guard<mutex> lock(mutex_);
+    warnings_.push_back(buffer);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// warnings() - Returns a copy of the warnings so far
+//=================================================================================================
+vector<string> RuntimeProfile::warnings()
+{
+    lock_guard<mutex> lock(mutex_);
+    return warnings_;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// setup() - Examines the machine, locks our memory and chooses the CPUs for real-time threads
+//=================================================================================================
+void RuntimeProfile::setup(const config_t& config)
+{
+    if (config.priority > 99) throwRuntime("RuntimeProfile: SCHED_FIFO priority must be 0-99");
+
+    config_ = config;
+    info_   = examine(config.pcieID);
+    nextCpu_ = 0;
+
+    // Lock everything we have now and everything we map from here on
+    if (config.lockMemory && !memoryLocked_)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+            memoryLocked_ = true;
+        else
+            warn("mlockall() failed: %s", strerror(errno));
+    }
+
+    // Isolated CPUs near the card are best.  They needn't be in our affinity mask, because
+    // isolcpus takes them out of everyone's default mask
+    vector<int> nearCard = info_.cardCpus.empty() ? info_.allowed
+                                                  : intersect(info_.allowed, info_.cardCpus);
+    vector<int> isolated = info_.cardCpus.empty() ? info_.isolated
+                                                  : intersect(info_.isolated, info_.cardCpus);
+
+    if (!isolated.empty())
+        cpus_ = isolated;
+    else if (!nearCard.empty())
+        cpus_ = nearCard;
+    else
+        cpus_ = info_.allowed;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// prepareBuffer() - Locks a DMA buffer into memory, keeps THP away from it, and faults in
+//                   every page so the producer never takes a fault on it
+//
+// Call this before the card starts using the buffer: pages that can't be populated by the
+// kernel are faulted in by writing each one's first byte back to itself
+//=================================================================================================
+void RuntimeProfile::prepareBuffer(void* address, size_t bytes)
+{
+    if (address == nullptr || bytes == 0) return;
+
+    // madvise() and mlock() want a page-aligned range
+    uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+    uintptr_t start    = (uintptr_t)address & ~(pageSize - 1);
+    uintptr_t end      = ((uintptr_t)address + bytes + pageSize - 1) & ~(pageSize - 1);
+    void*     base     = (void*)start;
+    size_t    length   = end - start;
+
+    // Keep khugepaged from collapsing (and so copying) these pages behind our back.  Hugetlbfs
+    // and device mappings refuse this, and THP doesn't touch them anyway
+    if (madvise(base, length, MADV_NOHUGEPAGE) < 0 && errno != EINVAL)
+        warn("madvise(MADV_NOHUGEPAGE) failed: %s", strerror(errno));
+
+    if (mlock(base, length) < 0) warn("mlock() of %zu bytes failed: %s", length, strerror(errno));
+
+    // Fault in every page, writable
+    if (madvise(base, length, MADV_POPULATE_WRITE) == 0) return;
+
+    for (uintptr_t page = start; page < end; page += pageSize)
+    {
+        volatile uint8_t* p = (volatile uint8_t*)page;
+        *p = *p;
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// enterRealtime() - Pins the calling thread to the next chosen CPU and applies the
+//                   SCHED_FIFO priority
+//
+// Returns: The CPU the thread was pinned to, or -1 if it wasn't
+//=================================================================================================
+int RuntimeProfile::enterRealtime()
+{
+    int cpu = -1;
+
+    if (config_.pinThreads && !cpus_.empty())
+    {
+        cpu = cpus_[nextCpu_++ % cpus_.size()];
+
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpu, &mask);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+        if (rc)
+        {
+            warn("Can't pin thread to CPU %d: %s", cpu, strerror(rc));
+            cpu = -1;
+        }
+    }
+
+    if (config_.priority)
+    {
+        sched_param param = {};
+        param.sched_priority = config_.priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc) warn("Can't set SCHED_FIFO priority %u: %s", config_.priority, strerror(rc));
+    }
+
+    return cpu;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// measureJitter() - Wakes the calling thread every "periodUs" for "seconds" and records how
+//                   late each wake-up was, in nanoseconds
+//=================================================================================================
+LatencyHistogram RuntimeProfile::measureJitter(double seconds, uint32_t periodUs)
+{
+    if (periodUs == 0) throwRuntime("RuntimeProfile::measureJitter(): period can't be 0");
+
+    LatencyHistogram histogram;
+    const int64_t period = (int64_t)periodUs * 1000;
+    uint64_t wakeups = (uint64_t)(seconds * 1e6 / periodUs);
+
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    for (uint64_t i = 0; i < wakeups; ++i)
+    {
+        deadline.tv_nsec += period;
+        while (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t late = (now.tv_sec - deadline.tv_sec) * 1000000000LL
+                     + (now.tv_nsec - deadline.tv_nsec);
+        histogram.record(late > 0 ? late : 0);
+    }
+
+    return histogram;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// report() - Prints the system information, the choices made, and anything that will keep
+//            the producer threads from being bounded
+//=================================================================================================
+void RuntimeProfile::report(FILE* file)
+{
+    fprintf(file, "Allowed CPUs   : %s\n", cpuListStr(info_.allowed).c_str());
+    fprintf(file, "isolcpus       : %s\n", cpuListStr(info_.isolated).c_str());
+    fprintf(file, "nohz_full      : %s\n", cpuListStr(info_.nohzFull).c_str());
+
+    if (info_.cardDir.empty())
+        fprintf(file, "Card           : not found\n");
+    else
+        fprintf(file, "Card           : %s, NUMA node %d, CPUs %s\n", info_.cardDir.c_str(),
+                info_.cardNode, cpuListStr(info_.cardCpus).c_str());
+
+    fprintf(file, "THP            : enabled=%s defrag=%s\n", info_.thpEnabled.c_str(),
+            info_.thpDefrag.c_str());
+    fprintf(file, "Memory locked  : %s\n", memoryLocked_ ? "yes" : "no");
+    fprintf(file, "Real-time CPUs : %s\n", cpuListStr(cpus_).c_str());
+    fprintf(file, "SCHED_FIFO     : %s\n", config_.priority ? to_string(config_.priority).c_str()
+                                                             : "off");
+
+    // The things we can't fix from here
+    if (intersect(cpus_, info_.isolated).empty())
+        fprintf(file, "Note: none of the real-time CPUs are in isolcpus\n");
+
+    if (intersect(cpus_, info_.nohzFull).size() != cpus_.size())
+        fprintf(file, "Note: not all of the real-time CPUs are in nohz_full\n");
+
+    if (info_.thpDefrag == "always")
+        fprintf(file, "Note: THP defrag=always can stall page faults in other threads\n");
+
+    if (info_.compactUnevictable == 1)
+        fprintf(file, "Note: vm.compact_unevictable_allowed=1 lets compaction move locked pages\n");
+
+    for (auto& warning : warnings()) fprintf(file, "Warning: %s\n", warning.c_str());
+}
+//=================================================================================================
@@ -0,0 +1,119 @@
+//=================================================================================================
+// RuntimeProfile.h - Sets up a low-jitter environment for the threads that feed the card
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include "LatencyTrace.h"
+
+/*
+    A producer that rings the doorbell on a schedule is only as steady as the kernel lets it
+    be.  Page faults, migration to a busy CPU, preemption by ordinary tasks and THP compaction
+    all show up as late doorbells.  RuntimeProfile removes the ones a process can remove by
+    itself and reports on the ones that need the kernel command line:
+
+        RuntimeProfile profile;
+        RuntimeProfile::config_t config;
+        config.priority = 80;
+        profile.setup(config);                      // mlockall(), chooses CPUs near the card
+        profile.prepareBuffer(buffer, bytes);       // For every DMA buffer we write into
+        profile.report(stdout);
+
+        thread producer([&]()
+        {
+            profile.enterRealtime();                // Pin to a chosen CPU, go SCHED_FIFO
+            ...
+        });
+
+    CPUs are chosen from those local to the card's NUMA node, preferring the ones that are
+    in "isolcpus".  Each call to enterRealtime() takes the next CPU in the list, wrapping if
+    there are more threads than CPUs.
+
+    Things that fail for lack of privilege (mlockall() over RLIMIT_MEMLOCK, SCHED_FIFO without
+    CAP_SYS_NICE) are recorded in warnings() rather than thrown, unless "strict" is set.  A
+    producer that can't get real-time priority still works; it just isn't bounded.
+
+    measureJitter() is a cyclictest-style probe: it wakes the calling thread on a fixed period
+    and records how late each wake-up was.  Run it from a thread after enterRealtime() to see
+    the worst case that thread can expect.
+*/
+
+class RuntimeProfile
+{
+public:
+
+    struct config_t
+    {
+        bool        lockMemory = true;          // mlockall(MCL_CURRENT | MCL_FUTURE)
+        uint32_t    priority   = 0;             // SCHED_FIFO priority 1-99, 0 = leave it be
+        bool        pinThreads = true;          // Pin each thread entering real-time to a CPU
+        std::string pcieID     = "10ee:903f";   // The card whose CPUs we want, "" = any
+        bool        strict     = false;         // Throw rather than warn when something fails
+    };
+
+    // What we found out about the machine
+    struct systemInfo_t
+    {
+        std::vector<int>    allowed;            // CPUs this process may run on
+        std::vector<int>    isolated;           // CPUs in "isolcpus"
+        std::vector<int>    nohzFull;           // CPUs in "nohz_full"
+        std::vector<int>    cardCpus;           // CPUs local to the card, empty if unknown
+        int                 cardNode = -1;      // The card's NUMA node, -1 if unknown
+        std::string         cardDir;            // The card's sysfs directory
+        std::string         thpEnabled;         // "always", "madvise" or "never"
+        std::string         thpDefrag;
+        int                 compactUnevictable = -1;  // vm.compact_unevictable_allowed
+    };
+
+    // Constructor
+    RuntimeProfile() {}
+
+    // No copy or assignment constructor - objects of this class can't be copied
+    RuntimeProfile (const RuntimeProfile&) = delete;
+    RuntimeProfile& operator= (const RuntimeProfile&) = delete;
+
+    // Examines the machine, locks our memory and chooses the CPUs for real-time threads
+    void    setup() {setup(config_t());}
+    void    setup(const config_t& config);
+
+    // Locks a DMA buffer into memory, keeps THP away from it and faults in every page
+    void    prepareBuffer(void* address, size_t bytes);
+
+    // Pins the calling thread to the next chosen CPU and applies the SCHED_FIFO priority.
+    // Returns the CPU, or -1 if the thread wasn't pinned
+    int     enterRealtime();
+
+    // Wakes every "periodUs" for "seconds" and records how late each wake-up was, in ns
+    LatencyHistogram measureJitter(double seconds, uint32_t periodUs = 1000);
+
+    // Prints the system information, the choices made and the warnings
+    void    report(FILE* file);
+
+    // Examines the machine without changing anything
+    static systemInfo_t examine(const std::string& pcieID);
+
+    // Parses a sysfs CPU list such as "0-3,8,10-11"
+    static std::vector<int> parseCpuList(const std::string& list);
+
+    const systemInfo_t&             info()     {return info_;}
+    const std::vector<int>&         cpus()     {return cpus_;}
+    std::vector<std::string>        warnings();
+    bool                            memoryLocked() {return memoryLocked_;}
+
+protected:
+
+    // Records a failure, or throws it if we're strict
+    void    warn(const char* fmt, ...);
+
+    config_t                    config_;
+    systemInfo_t                info_;
+    std::vector<int>            cpus_;
+    std::vector<std::string>    warnings_;
+    bool                        memoryLocked_ = false;
+    std::atomic<uint32_t>       nextCpu_{0};
+    std::mutex                  mutex_;         // Guards warnings_
+};
@@ -0,0 +1,242 @@
+//=================================================================================================
+// StreamTuner.cpp - Finds the frame, packet, group and buffer sizes that give the best throughput
+//=================================================================================================
+#include <cstdio>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "StreamTuner.h"
+#include "throwRuntime.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// The size of a metadata record in the host meta-data buffers
+static const uint32_t METADATA_SIZE = 128;
+
+// The part of each measurement that's spent warming up rather than measuring
+static const double WARMUP_FRACTION = 0.2;
+
+
+//=================================================================================================
+// apply() - Configures the card for the specified point
+//=================================================================================================
+void StreamTuner::apply(const point_t& point, uint32_t mtu)
+{
+    uint32_t frameSize = point.frameSize;
+
+    if (frameSize < 4096 || (frameSize & (frameSize - 1)))
+        throwRuntime("frame size %u isn't a power of 2 of at least 4096", frameSize);
+
+    if (point.packetsPerGroup == 0 || point.ringFrames == 0)
+        throwRuntime("packets-per-group and ring-frames must be non-zero");
+
+    // The packet size is checked against the frame size, so set the frame size first
+    mindy_.setFrameSize(frameSize);
+    mindy_.setPacketSize(point.packetSize, mtu);
+    mindy_.setPacketsPerGroup(point.packetsPerGroup);
+
+    // Each host frame-data buffer holds one semiphase of every frame in the ring
+    mindy_.setHostFrameDataSize((uint64_t)point.ringFrames * frameSize / 2);
+    mindy_.setHostMetaDataSize((uint64_t)point.ringFrames * METADATA_SIZE);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// measure() - Measures the sustained throughput of a single point
+//=================================================================================================
+StreamTuner::result_t StreamTuner::measure(const point_t& point, double seconds, uint32_t mtu)
+{
+    using clock = steady_clock;
+
+    result_t result = {point, false, 0, 0, ""};
+
+    try
+    {
+        apply(point, mtu);
+    }
+    catch(const std::exception& e)
+    {
+        result.error = e.what();
+        return result;
+    }
+
+    // Reset the card and give it a moment to come out of reset
+    mindy_.clearLocalFrameCounters();
+    this_thread::sleep_for(milliseconds(2));
+
+    uint32_t submitted[2] = {0, 0};
+    uint32_t fetched[2]   = {0, 0};
+    uint32_t startFrames  = 0;
+    double   startTime    = 0;
+    double   elapsed      = 0;
+    bool     warmedUp     = false;
+    auto     start        = clock::now();
+
+    // Keep both phases' frame-data buffers full for the duration of the measurement
+    while (elapsed < seconds)
+    {
+        bool submittedAny = false;
+
+        for (uint32_t phase = 0; phase < 2; ++phase)
+        {
+            fetched[phase] = mindy_.getFetchedFrameCount(phase);
+            while (submitted[phase] - fetched[phase] < point.ringFrames)
+            {
+                mindy_.incrementLocalFrameCounter(phase);
+                ++submitted[phase];
+                submittedAny = true;
+            }
+        }
+
+        elapsed = duration<double>(clock::now() - start).count();
+
+        if (!warmedUp && elapsed >= seconds * WARMUP_FRACTION)
+        {
+            warmedUp    = true;
+            startFrames = fetched[0] + fetched[1];
+            startTime   = elapsed;
+        }
+
+        if (!submittedAny) this_thread::yield();
+    }
+
+    uint32_t frames = fetched[0] + fetched[1] - startFrames;
+    result.framesPerSec = frames / (elapsed - startTime);
+    result.gbPerSec     = result.framesPerSec * point.frameSize / 1e9;
+
+    // Wait for every frame we submitted to be fetched and sent
+    uint64_t expected = (uint64_t)(submitted[0] + submitted[1]) * point.frameSize;
+    uint64_t sent     = 0;
+    auto     deadline = clock::now() + milliseconds(100) + duration<double>(seconds);
+    while (true)
+    {
+        fetched[0] = mindy_.getFetchedFrameCount(0);
+        fetched[1] = mindy_.getFetchedFrameCount(1);
+        sent       = mindy_.getLinkStats(0).bytes + mindy_.getLinkStats(1).bytes;
+
+        bool allFetched = (fetched[0] == submitted[0] && fetched[1] == submitted[1]);
+        bool allSent    = (sent == expected);
+        if ((allFetched && allSent) || clock::now() > deadline) break;
+
+        this_thread::sleep_for(milliseconds(1));
+    }
+
+    char buffer[200];
+    if (fetched[0] != submitted[0] || fetched[1] != submitted[1])
+        sprintf(buffer, "stalled: %u of %u frames were fetched", fetched[0] + fetched[1],
+                submitted[0] + submitted[1]);
+    else if (sent != expected)
+        sprintf(buffer, "%lu of %lu bytes were sent", sent, expected);
+    else if (mindy_.getErrorStatus())
+        sprintf(buffer, "error status 0x%08X", mindy_.getErrorStatus());
+    else if (mindy_.getDescriptorErrors())
+        sprintf(buffer, "%u descriptor errors", mindy_.getDescriptorErrors());
+    else
+        buffer[0] = 0;
+
+    result.error = buffer;
+    result.ok    = result.error.empty();
+    return result;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// tune() - Sweeps the parameters in three stages, and returns the best error-free point
+//=================================================================================================
+StreamTuner::result_t StreamTuner::tune(const limits_t& limits, progress_t progress)
+{
+    result_t best = {{0, 0, 0, 0}, false, 0, 0, "no point could be measured"};
+
+    uint32_t maxPacket = mindy_.getMaxPacketSize(limits.mtu);
+
+    // Measures a list of points, keeping track of the best one
+    auto sweep = [&](const vector<point_t>& points)
+    {
+        for (auto& point : points)
+        {
+            result_t result = measure(point, limits.secondsPerPoint, limits.mtu);
+            if (progress) progress(result);
+            if (result.ok && (!best.ok || result.gbPerSec > best.gbPerSec)) best = result;
+        }
+    };
+
+    // The number of frames that fit in the host frame-data buffers, within the limits
+    auto ringFrames = [&](uint32_t frameSize, uint32_t wanted)
+    {
+        uint64_t fit = limits.maxHostFrameDataBytes / (frameSize / 2);
+        if (wanted > limits.maxRingFrames) wanted = limits.maxRingFrames;
+        return (uint32_t)(fit < wanted ? fit : wanted);
+    };
+
+    // Stage 1 : Frame size and packet size.  Each half-frame needs at least one packet
+    vector<point_t> points;
+    for (uint64_t frame = limits.minFrameSize; frame <= limits.maxFrameSize; frame *= 2)
+    {
+        uint32_t ring = ringFrames(frame, 4);
+        if (ring == 0) continue;
+        for (uint32_t packet = limits.minPacketSize; packet <= maxPacket && packet <= frame / 2; packet *= 2)
+            points.push_back({(uint32_t)frame, packet, 1, ring});
+    }
+    sweep(points);
+    if (!best.ok) return best;
+
+    // Stage 2 : Packets per group.  Each half-frame must be a whole number of groups
+    points.clear();
+    point_t base = best.point;
+    uint32_t halfFramePackets = base.frameSize / base.packetSize / 2;
+    for (uint32_t group = 2; group <= limits.maxPacketsPerGroup && group <= halfFramePackets; group *= 2)
+        points.push_back({base.frameSize, base.packetSize, group, base.ringFrames});
+    sweep(points);
+
+    // Stage 3 : The number of frames in the host frame-data buffers
+    points.clear();
+    base = best.point;
+    uint32_t maxRing = ringFrames(base.frameSize, limits.maxRingFrames);
+    for (uint32_t ring = 1; ring <= maxRing; ring *= 2)
+        if (ring != base.ringFrames)
+            points.push_back({base.frameSize, base.packetSize, base.packetsPerGroup, ring});
+    sweep(points);
+
+    // Leave the card configured for the best point
+    apply(best.point, limits.mtu);
+    return best;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// saveProfile() - Writes a result as a configuration script for "mindyctl apply"
+//=================================================================================================
+void StreamTuner::saveProfile(const result_t& result, const string& filename)
+{
+    const point_t& point = result.point;
+
+    FILE* ofile = fopen(filename.c_str(), "w");
+    if (ofile == nullptr) throwRuntime("Can't create %s", filename.c_str());
+
+    fprintf(ofile, "#==============================================================================\n");
+    fprintf(ofile, "# Stream profile written by the stream tuner.  Load with \"mindyctl apply\"\n");
+    fprintf(ofile, "#\n");
+    fprintf(ofile, "# Measured: %.2f GB/s, %.1f frames/s, %s\n", result.gbPerSec, result.framesPerSec,
+            result.ok ? "error-free" : result.error.c_str());
+    fprintf(ofile, "#==============================================================================\n");
+    fprintf(ofile, "\n");
+    fprintf(ofile, "# Number of bytes that are in a single frame\n");
+    fprintf(ofile, "RS_FRAME_SIZE = %u\n\n", point.frameSize);
+    fprintf(ofile, "# Number of bytes in a packet being sent to the receiver\n");
+    fprintf(ofile, "RS_PACKET_SIZE = %u\n\n", point.packetSize);
+    fprintf(ofile, "# Number of packets in a ping-pong group\n");
+    fprintf(ofile, "RS_PACKETS_PER_GROUP = %u\n\n", point.packetsPerGroup);
+    fprintf(ofile, "# Sizes of the host buffers: %u frames each\n", point.ringFrames);
+    fprintf(ofile, "DF_HFD_BYTES = %lu\n", (uint64_t)point.ringFrames * point.frameSize / 2);
+    fprintf(ofile, "DF_HMD_BYTES = %lu\n\n", (uint64_t)point.ringFrames * METADATA_SIZE);
+    fprintf(ofile, "# Make sure the configuration took\n");
+    fprintf(ofile, "expect RS_PACKET_SIZE %u\n", point.packetSize);
+
+    fclose(ofile);
+}
+//=================================================================================================
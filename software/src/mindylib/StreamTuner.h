@@ -0,0 +1,96 @@
+//=================================================================================================
+// StreamTuner.h - Finds the frame, packet, group and buffer sizes that give the best throughput
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <string>
+#include <functional>
+#include "mindy.h"
+
+/*
+    The tuner measures the sustained throughput of the card for a series of configurations
+    and keeps the best one that ran without errors.  It works the same way against the
+    hardware and against MindyEmulator.
+
+    At each point it configures the card, resets it, and then keeps each host frame-data
+    buffer full by ringing the frame counters whenever the card has fetched a frame.  The
+    throughput is measured from the frames-fetched counters after a short warm-up.  A point
+    is error-free if every frame is fetched once we stop submitting, every fetched byte was
+    sent on a link, and the card reports no errors.
+
+    The sweep is done in three stages, each starting from the best point so far:
+
+        1. Every power-of-2 frame size and packet size, with 1 packet per group
+        2. Every power-of-2 group size
+        3. Every power-of-2 number of frames in the host frame-data buffers
+
+    The tuner only changes the sizes.  The buffer addresses, the remote buffers and the
+    steering policy must already be set up, and each host frame-data buffer must be at least
+    "maxHostFrameDataBytes" long.
+
+    Example:
+
+        StreamTuner tuner(Mindy);
+        auto best = tuner.tune(StreamTuner::limits_t());
+        StreamTuner::saveProfile(best, "best.cfg");     // Load with "mindyctl apply best.cfg"
+*/
+
+class StreamTuner
+{
+public:
+
+    // One combination of the stream parameters
+    struct point_t
+    {
+        uint32_t    frameSize;          // Bytes in a frame.  A power of 2
+        uint32_t    packetSize;         // Bytes of payload in an RDMX packet
+        uint32_t    packetsPerGroup;    // Packets in a ping-pong group
+        uint32_t    ringFrames;         // Frames that fit in the host frame-data buffers
+    };
+
+    // The outcome of measuring one point
+    struct result_t
+    {
+        point_t     point;
+        bool        ok;                 // True if the point ran without errors
+        double      framesPerSec;
+        double      gbPerSec;
+        std::string error;              // Why the point failed, if it did
+    };
+
+    // The range of the sweep
+    struct limits_t
+    {
+        uint32_t    minFrameSize          = 4096;
+        uint32_t    maxFrameSize          = 4 * 1024 * 1024;
+        uint32_t    minPacketSize         = 1024;
+        uint32_t    mtu                   = CMindy::DEFAULT_MTU;
+        uint32_t    maxPacketsPerGroup    = 64;
+        uint32_t    maxRingFrames         = 16;
+        uint64_t    maxHostFrameDataBytes = 256 * 1024 * 1024;
+        double      secondsPerPoint       = 0.25;
+    };
+
+    // Called with the result of each point as it's measured
+    using progress_t = std::function<void(const result_t&)>;
+
+    // Constructor
+    StreamTuner(CMindy& mindy) : mindy_(mindy) {}
+
+    // Configures the card for the specified point.  Throws if the card can't run it
+    void        apply(const point_t& point, uint32_t mtu = CMindy::DEFAULT_MTU);
+
+    // Measures the throughput of a single point
+    result_t    measure(const point_t& point, double seconds, uint32_t mtu = CMindy::DEFAULT_MTU);
+
+    // Sweeps the parameters and returns the best error-free point.  If no point was
+    // error-free, the returned result has "ok" set to false
+    result_t    tune(const limits_t& limits, progress_t progress = nullptr);
+
+    // Writes a result as a "mindyctl apply" configuration script
+    static void saveProfile(const result_t& result, const std::string& filename);
+
+protected:
+
+    CMindy&     mindy_;
+};
@@ -0,0 +1,251 @@
+//=================================================================================================
+// crc32c.cpp - CRC-32C (Castagnoli) routines
+//
+// The hardware implementation runs three independent CRC32 instruction streams over adjacent
+// blocks of the buffer so that the 3-cycle latency of the instruction is hidden, then merges
+// the three CRCs with a GF(2) polynomial multiply
+//=================================================================================================
+#include <cstring>
+#include <nmmintrin.h>
+#include "crc32c.h"
+
+// The CRC-32C polynomial, bit-reflected
+static const uint32_t POLY = 0x82F63B78;
+
+// The size of each of the three blocks that are CRC'd in parallel
+static const size_t LONG_BLOCK  = 8192;
+static const size_t SHORT_BLOCK = 256;
+
+//=================================================================================================
+// These tables are built once, at program startup
+//=================================================================================================
+static struct tables_t
+{
+    // Byte-at-a-time lookup table for the software implementation
+    uint32_t byteTable[8][256];
+
+    // x^(2^n) mod POLY, for building "shift by N bytes" operators
+    uint32_t x2nTable[32];
+
+    // Operators that shift a CRC over LONG_BLOCK and SHORT_BLOCK zero bytes
+    uint32_t longShift, shortShift;
+
+    // True if the CPU has the SSE4.2 CRC32 instruction
+    bool     hasSse42;
+
+    tables_t();
+} tables;
+//=================================================================================================
+
+
+//=================================================================================================
+// multModP() - Multiplies two polynomials modulo POLY (both are bit-reflected)
+//=================================================================================================
+static uint32_t multModP(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31, p = 0;
+
+    while (true)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// x8nModP() - Returns x^(8*n) mod POLY.  Multiplying a CRC by this is the same as running n
+//             zero bytes through it
+//=================================================================================================
+static uint32_t x8nModP(size_t n)
+{
+    uint32_t p = 1u << 31;
+    int      k = 3;
+
+    while (n)
+    {
+        if (n & 1) p = multModP(tables.x2nTable[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// tables_t() - Builds the lookup tables
+//=================================================================================================
+tables_t::tables_t()
+{
+    // Build the table for the byte-at-a-time software CRC
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; ++k) crc = (crc & 1) ? (crc >> 1) ^ POLY : crc >> 1;
+        byteTable[0][n] = crc;
+    }
+
+    // Extend it so the software CRC can process 8 bytes at a time
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t crc = byteTable[0][n];
+        for (int k = 1; k < 8; ++k)
+        {
+            crc = byteTable[0][crc & 0xFF] ^ (crc >> 8);
+            byteTable[k][n] = crc;
+        }
+    }
+
+    // x^1, x^2, x^4, x^8, etc
+    uint32_t p = 1u << 30;
+    x2nTable[0] = p;
+    for (int n = 1; n < 32; ++n) x2nTable[n] = p = multModP(p, p);
+
+    // The operators for merging the three parallel CRCs
+    longShift  = x8nModP(LONG_BLOCK);
+    shortShift = x8nModP(SHORT_BLOCK);
+
+    // Find out whether the CPU has the CRC32 instruction
+    __builtin_cpu_init();
+    hasSse42 = __builtin_cpu_supports("sse4.2");
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// crc32cSoftware() - Computes a CRC-32C eight bytes at a time with lookup tables
+//=================================================================================================
+uint32_t crc32cSoftware(const void* buffer, size_t length, uint32_t crc)
+{
+    const uint8_t* p = (const uint8_t*)buffer;
+    uint64_t crc64 = ~crc;
+
+    // Process a byte at a time until we're 8-byte aligned
+    while (length && ((uintptr_t)p & 7))
+    {
+        crc64 = tables.byteTable[0][(crc64 ^ *p++) & 0xFF] ^ (crc64 >> 8);
+        length--;
+    }
+
+    // Process 8 bytes at a time
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 ^= word;
+        crc64 = tables.byteTable[7][ crc64        & 0xFF] ^
+                tables.byteTable[6][(crc64 >>  8) & 0xFF] ^
+                tables.byteTable[5][(crc64 >> 16) & 0xFF] ^
+                tables.byteTable[4][(crc64 >> 24) & 0xFF] ^
+                tables.byteTable[3][(crc64 >> 32) & 0xFF] ^
+                tables.byteTable[2][(crc64 >> 40) & 0xFF] ^
+                tables.byteTable[1][(crc64 >> 48) & 0xFF] ^
+                tables.byteTable[0][ crc64 >> 56        ];
+        p      += 8;
+        length -= 8;
+    }
+
+    // Process whatever bytes are left over
+    while (length--) crc64 = tables.byteTable[0][(crc64 ^ *p++) & 0xFF] ^ (crc64 >> 8);
+
+    return ~(uint32_t)crc64;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// crc32cHardware() - Computes a CRC-32C with the SSE4.2 CRC32 instruction, using three
+//                    interleaved streams on long buffers
+//=================================================================================================
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(const void* buffer, size_t length, uint32_t crc)
+{
+    const uint8_t* p = (const uint8_t*)buffer;
+    uint64_t crc0 = ~crc;
+
+    // Process a byte at a time until we're 8-byte aligned
+    while (length && ((uintptr_t)p & 7))
+    {
+        crc0 = _mm_crc32_u8((uint32_t)crc0, *p++);
+        length--;
+    }
+
+    // Process the buffer in groups of three long blocks, then three short blocks
+    const size_t blockSizes[] = {LONG_BLOCK, SHORT_BLOCK};
+    const uint32_t shifts[]   = {tables.longShift, tables.shortShift};
+    for (int i = 0; i < 2; ++i)
+    {
+        const size_t block = blockSizes[i];
+        while (length >= 3 * block)
+        {
+            uint64_t crc1 = 0, crc2 = 0;
+            const uint8_t* end = p + block;
+            do
+            {
+                crc0 = _mm_crc32_u64(crc0, *(const uint64_t*)(p            ));
+                crc1 = _mm_crc32_u64(crc1, *(const uint64_t*)(p +     block));
+                crc2 = _mm_crc32_u64(crc2, *(const uint64_t*)(p + 2 * block));
+                p += 8;
+            } while (p < end);
+
+            // Merge the three CRCs into one
+            crc0 = multModP(shifts[i], (uint32_t)crc0) ^ crc1;
+            crc0 = multModP(shifts[i], (uint32_t)crc0) ^ crc2;
+            p      += 2 * block;
+            length -= 3 * block;
+        }
+    }
+
+    // Process 8 bytes at a time
+    while (length >= 8)
+    {
+        crc0 = _mm_crc32_u64(crc0, *(const uint64_t*)p);
+        p      += 8;
+        length -= 8;
+    }
+
+    // Process whatever bytes are left over
+    while (length--) crc0 = _mm_crc32_u8((uint32_t)crc0, *p++);
+
+    return ~(uint32_t)crc0;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// crc32c() - Computes a CRC-32C using the fastest implementation this CPU supports
+//=================================================================================================
+uint32_t crc32c(const void* buffer, size_t length, uint32_t crc)
+{
+    if (tables.hasSse42) return crc32cHardware(buffer, length, crc);
+    return crc32cSoftware(buffer, length, crc);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// crc32cCombine() - Returns the CRC of two buffers concatenated, given the CRC of each
+//=================================================================================================
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, size_t lengthB)
+{
+    return multModP(x8nModP(lengthB), crcA) ^ crcB;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// crc32cIsHardware() - Returns true if crc32c() is using the SSE4.2 instruction
+//=================================================================================================
+bool crc32cIsHardware()
+{
+    return tables.hasSse42;
+}
+//=================================================================================================
@@ -0,0 +1,20 @@
+//=================================================================================================
+// crc32c.h - CRC-32C (Castagnoli) routines
+//=================================================================================================
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Computes the CRC-32C of a buffer.  To compute the CRC of data that arrives in pieces, pass
+// the CRC of the previous pieces as "crc".  Uses the SSE4.2 CRC32 instruction when the CPU
+// has it, and a table-driven implementation when it doesn't
+uint32_t crc32c(const void* buffer, size_t length, uint32_t crc = 0);
+
+// The table-driven implementation, regardless of what the CPU supports
+uint32_t crc32cSoftware(const void* buffer, size_t length, uint32_t crc = 0);
+
+// Given crcA = crc32c(A) and crcB = crc32c(B), returns crc32c(A followed by B)
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, size_t lengthB);
+
+// Returns true if crc32c() is using the SSE4.2 CRC32 instruction
+bool     crc32cIsHardware();
@@ -1,85 +1,65 @@
 //=========================================================================================================
 // mindy.cpp - An API for the Mindy (Laguna --> Indy) RTL design 
 //=========================================================================================================
-#include <cstdarg>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
 #include "mindy.h"
 #include "PciDevice.h"
+#include "MindyRegs.h"
+#include "MindyEmulator.h"
+#include "FrameDelta.h"
+#include "throwRuntime.h"
 
 using namespace std;
 
 // This is a connection to the PCI bus
 static PciDevice PCI;
 
-static const uint32_t BV_BASE = 0;
-static const uint32_t REG_BUILD_MAJOR = BV_BASE + 0*4;
-static const uint32_t REG_BUILD_MINOR = BV_BASE + 1*4;
-static const uint32_t REG_BUILD_REV   = BV_BASE + 2*4;
-static const uint32_t REG_BUILD_RC    = BV_BASE + 3*4;
-static const uint32_t REG_BUILD_DATE  = BV_BASE + 4*4;
-
-// Addresses of the two frame counters
-const uint32_t REG_FC0 = 0x1004;
-const uint32_t REG_FC1 = 0x1008;     
-
-// Registers registers in the "data fetch" module
-const uint32_t DF_BASE = 0x2000;
-const uint32_t REG_HFD00_ADDR_H = DF_BASE +  1*4;
-const uint32_t REG_HFD00_ADDR_L = DF_BASE +  2*4;
-const uint32_t REG_HFD01_ADDR_H = DF_BASE +  3*4;
-const uint32_t REG_HFD01_ADDR_L = DF_BASE +  4*4;
-const uint32_t REG_HFD10_ADDR_H = DF_BASE +  5*4;
-const uint32_t REG_HFD10_ADDR_L = DF_BASE +  6*4;
-const uint32_t REG_HFD11_ADDR_H = DF_BASE +  7*4;
-const uint32_t REG_HFD11_ADDR_L = DF_BASE +  8*4;
-const uint32_t  REG_HMD0_ADDR_H = DF_BASE +  9*4;
-const uint32_t  REG_HMD0_ADDR_L = DF_BASE + 10*4;
-const uint32_t  REG_HMD1_ADDR_H = DF_BASE + 11*4;
-const uint32_t  REG_HMD1_ADDR_L = DF_BASE + 12*4;
-const uint32_t  REG_HFD_BYTES_H = DF_BASE + 13*4;
-const uint32_t  REG_HFD_BYTES_L = DF_BASE + 14*4;
-const uint32_t  REG_HMD_BYTES_H = DF_BASE + 15*4;
-const uint32_t  REG_HMD_BYTES_L = DF_BASE + 16*4;
-const uint32_t   REG_ABM_ADDR_H = DF_BASE + 17*4;
-const uint32_t   REG_ABM_ADDR_L = DF_BASE + 18*4;
-
-
-// Registers in the "RDMX shim" module
-const uint32_t RS_BASE = 0x4000;
-const uint32_t REG_RFD_ADDR_H        = RS_BASE +  0*4;
-const uint32_t REG_RFD_ADDR_L        = RS_BASE +  1*4;
-const uint32_t REG_RFD_SIZE_H        = RS_BASE +  2*4;
-const uint32_t REG_RFD_SIZE_L        = RS_BASE +  3*4;
-const uint32_t REG_RMD_ADDR_H        = RS_BASE +  4*4;
-const uint32_t REG_RMD_ADDR_L        = RS_BASE +  5*4;
-const uint32_t REG_RMD_SIZE_H        = RS_BASE +  6*4;
-const uint32_t REG_RMD_SIZE_L        = RS_BASE +  7*4;
-const uint32_t REG_RFC_ADDR_H        = RS_BASE +  8*4;
-const uint32_t REG_RFC_ADDR_L        = RS_BASE +  9*4;
-const uint32_t REG_FRAME_SIZE        = RS_BASE + 10*4;
-const uint32_t REG_PACKET_SIZE       = RS_BASE + 11*4;
-const uint32_t REG_PACKETS_PER_GROUP = RS_BASE + 12*4;
-
-
-// Registers in the "status manager" module
-const uint32_t SM_BASE = 0x5000;
-const uint32_t REG_QSFP_STATUS  = SM_BASE + 0*4;
-const uint32_t REG_ERROR_STATUS = SM_BASE + 1*4;
-
-
-//=================================================================================================
-// throwRuntime() - Throws a runtime exception
-//=================================================================================================
-static void throwRuntime(const char* fmt, ...)
+// Every register is described in mindy_regs.def
+using namespace MindyReg;
+
+// Registers that come in one-per-phase (or one-per-semiphase) sets
+using FrameCtr      = RegArray<FC_FRAME_CTR_0, FC_FRAME_CTR_1>;
+using Fetched       = RegArray<DF_FETCHED0, DF_FETCHED1>;
+using Issued        = RegArray<DF_ISSUED0, DF_ISSUED1>;
+using HfdOffs       = RegArray<DF_HFD0_OFFS, DF_HFD1_OFFS>;
+using HmdOffs       = RegArray<DF_HMD0_OFFS, DF_HMD1_OFFS>;
+using HostFrameData = RegArray<DF_HFD00_ADDR, DF_HFD01_ADDR, DF_HFD10_ADDR, DF_HFD11_ADDR>;
+using HostMetaData  = RegArray<DF_HMD0_ADDR, DF_HMD1_ADDR>;
+using HostDescRing  = RegArray<DF_DESC0_ADDR, DF_DESC1_ADDR>;
+using LinkPackets   = RegArray<RS_LINK0_PACKETS, RS_LINK1_PACKETS>;
+using LinkBytes     = RegArray<RS_LINK0_BYTES, RS_LINK1_BYTES>;
+
+// The CMAC statistics, indexed by link
+using CmacTxPackets = RegArray<SM_LINK0_TX_PACKETS, SM_LINK1_TX_PACKETS>;
+using CmacTxBytes   = RegArray<SM_LINK0_TX_BYTES, SM_LINK1_TX_BYTES>;
+using CmacRxPackets = RegArray<SM_LINK0_RX_PACKETS, SM_LINK1_RX_PACKETS>;
+using CmacRxBytes   = RegArray<SM_LINK0_RX_BYTES, SM_LINK1_RX_BYTES>;
+using CmacFecCorr   = RegArray<SM_LINK0_FEC_CORRECTED, SM_LINK1_FEC_CORRECTED>;
+using CmacFecUncorr = RegArray<SM_LINK0_FEC_UNCORRECTED, SM_LINK1_FEC_UNCORRECTED>;
+using CmacBadFcs    = RegArray<SM_LINK0_RX_BAD_FCS, SM_LINK1_RX_BAD_FCS>;
+using CmacRxPause   = RegArray<SM_LINK0_RX_PAUSE, SM_LINK1_RX_PAUSE>;
+using CmacTxPause   = RegArray<SM_LINK0_TX_PAUSE, SM_LINK1_TX_PAUSE>;
+
+// The size of a metadata record in the host meta-data buffers
+static const uint32_t METADATA_BYTES = 128;
+
+// The fields of a write to FC_STREAM_ADD
+static const uint32_t STREAM_ADD_STREAM = 28;
+static const uint32_t STREAM_ADD_PHASE  = 24;
+static const uint32_t STREAM_ADD_COUNT  = 0x00FFFFFF;
+
+// The registers of each trace FIFO, indexed by CMindy::tracePoint_t
+struct traceRegs_t {uint32_t count, entry, lost;};
+static const traceRegs_t traceRegs[CMindy::TRACE_POINTS] =
 {
-    char buffer[1024];
-    va_list ap;
-    va_start(ap, fmt);
-    vsprintf(buffer, fmt, ap);
-    va_end(ap);
-
-    throw runtime_error(buffer);
-}
-//=================================================================================================
+    {FC_TRACE_COUNT::offset,    FC_TRACE::offset,    FC_TRACE_LOST::offset},
+    {DF_TRACE_COUNT::offset,    DF_TRACE::offset,    DF_TRACE_LOST::offset},
+    {RS_PP_TRACE_COUNT::offset, RS_PP_TRACE::offset, RS_PP_TRACE_LOST::offset},
+    {RS_FC_TRACE_COUNT::offset, RS_FC_TRACE::offset, RS_FC_TRACE_LOST::offset}
+};
 
 
 //=================================================================================================
@@ -87,11 +67,7 @@ static void throwRuntime(const char* fmt, ...)
 //=================================================================================================
 void CMindy::write32(uint32_t reg, uint32_t value)
 {
-    // Get a reference to the specified AXI register
-    uint32_t& axiReg = *(uint32_t*)(BAR0_ + reg);
-
-    // Store the specified value into the register
-    axiReg = value;
+    MindyReg::store32(BAR0_ + reg, value);
 }
 //=================================================================================================
 
@@ -101,11 +77,7 @@ void CMindy::write32(uint32_t reg, uint32_t value)
 //=================================================================================================
 uint32_t CMindy::read32(uint32_t reg)
 {
-    // Get a reference to the specified AXI register
-    uint32_t& axiReg = *(uint32_t*)(BAR0_ + reg);
-
-    // Return the value stored in that register
-    return axiReg;
+    return MindyReg::load32(BAR0_ + reg);
 }
 //=================================================================================================
 
@@ -115,12 +87,12 @@ uint32_t CMindy::read32(uint32_t reg)
 //=================================================================================================
 uint64_t CMindy::read64(uint32_t reg)
 {
-    // Get a reference to the specified AXI registers
-    uint32_t& axiRegHi = *(uint32_t*)(BAR0_ + reg + 0);
-    uint32_t& axiRegLo = *(uint32_t*)(BAR0_ + reg + 4);
+    // Read the upper half first: for some registers, that latches the lower half
+    uint64_t hi = MindyReg::load32(BAR0_ + reg + 0);
+    uint64_t lo = MindyReg::load32(BAR0_ + reg + 4);
 
     // Return the 64-bit value to the caller
-    return (((uint64_t)axiRegHi) << 32) | axiRegLo;
+    return (hi << 32) | lo;
 }
 //=================================================================================================
 
@@ -129,13 +101,9 @@ uint64_t CMindy::read64(uint32_t reg)
 //=================================================================================================
 void CMindy::write64(uint32_t reg, uint64_t value)
 {
-    // Get a reference to the specified AXI registers
-    uint32_t& axiRegHi = *(uint32_t*)(BAR0_ + reg + 0);
-    uint32_t& axiRegLo = *(uint32_t*)(BAR0_ + reg + 4);
-
-    // Now write the two 32-bit values
-    axiRegHi = value >> 32;
-    axiRegLo = value & 0xFFFFFFFF;
+    // Write the upper half first, as the typed accessors do
+    MindyReg::store32(BAR0_ + reg + 0, value >> 32);
+    MindyReg::store32(BAR0_ + reg + 4, value & 0xFFFFFFFF);
 }
 //=================================================================================================
 
@@ -154,36 +122,61 @@ void CMindy::init(string pcieID)
 
     // Fetch the PCI address of the first BAR
     PCI0_ = PCI.resourceList()[0].physAddr;
+    emulated_ = false;
+    emulator_ = nullptr;
 
     // If it looks like we need a hot-reset, do so
-    if (read32(REG_BUILD_MAJOR) == 0xFFFFFFFF) PCI.hotReset(pcieID);
+    if (BV_MAJOR::read(BAR0_) == 0xFFFFFFFF) PCI.hotReset(pcieID);
 
     // If we still can't read the module revision after a hot-reset, drop-dead
-    if (read32(REG_BUILD_MAJOR) == 0xFFFFFFFF)
+    if (BV_MAJOR::read(BAR0_) == 0xFFFFFFFF)
         throwRuntime("Can't connect to %s", pcieID.c_str());
 }
 //=================================================================================================
 
 
+//=================================================================================================
+// attach() - Connects to a card that's already running, and reads back where each phase is in
+//            the host buffers, without resetting the card
+//=================================================================================================
+void CMindy::attach(ringState_t state[2], string pcieID)
+{
+    init(pcieID);
+
+    // In scatter-gather mode, the descriptor rings belonged to the process that built them
+    if (getDescriptorMode()) throwRuntime("Can't attach to a card in scatter-gather mode");
+
+    if (getFrameSize() == 0 || getHostFrameDataSize() == 0 || getHostMetaDataSize() == 0)
+        throwRuntime("Can't attach to a card that hasn't been configured");
+
+    state[0] = getRingState(0);
+    state[1] = getRingState(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// initEmulated() - Connects to an emulated card instead of to the hardware
+//=================================================================================================
+void CMindy::initEmulated(MindyEmulator& device)
+{
+    BAR0_ = device.bar0();
+
+    // The emulated card isn't on the PCI bus
+    PCI0_     = 0;
+    emulated_ = true;
+    emulator_ = &device;
+}
+//=================================================================================================
+
+
 //=================================================================================================
 // setHostFrameDataAddress() - Sets the host-PC RAM address where the frame-data buffers are
 //=================================================================================================
 void CMindy::setHostFrameDataAddr(uint32_t phase, uint32_t semiphase, uint64_t address)
 {
-    if      (phase == 0 && semiphase == 0)
-        write64(REG_HFD00_ADDR_H, address);
-    
-    else if (phase == 0 && semiphase == 1)
-        write64(REG_HFD01_ADDR_H, address);
-    
-    else if (phase == 1 && semiphase == 0)
-        write64(REG_HFD10_ADDR_H, address);
-    
-    else if (phase == 1 && semiphase == 1)
-        write64(REG_HFD11_ADDR_H, address);
-    
-    else
-        throwRuntime("bad parameter on setHostFrameDataAddr()");
+    if (phase > 1 || semiphase > 1) throwRuntime("bad parameter on setHostFrameDataAddr()");
+    HostFrameData::write(BAR0_, phase * 2 + semiphase, address);
 }
 //=================================================================================================    
 
@@ -193,23 +186,8 @@ void CMindy::setHostFrameDataAddr(uint32_t phase, uint32_t semiphase, uint64_t a
 //=================================================================================================
 uint64_t CMindy::getHostFrameDataAddr(uint32_t phase, uint32_t semiphase)
 {
-    if (phase == 0 && semiphase == 0)
-        return read64(REG_HFD00_ADDR_H);
-    
-    if (phase == 0 && semiphase == 1)
-        return read64(REG_HFD01_ADDR_H);
-    
-    if (phase == 1 && semiphase == 0)
-        return read64(REG_HFD10_ADDR_H);
-    
-    if (phase == 1 && semiphase == 1)
-        return read64(REG_HFD11_ADDR_H);
-    
-    // If we get here, there was an illegal value for phase or semiphase
-    throwRuntime("bad parameter on getHostFrameDataAddr()");
-
-    // This is just here to keep the compiler happy
-    return 0;
+    if (phase > 1 || semiphase > 1) throwRuntime("bad parameter on getHostFrameDataAddr()");
+    return HostFrameData::read(BAR0_, phase * 2 + semiphase);
 }
 //=================================================================================================    
 
@@ -220,14 +198,8 @@ uint64_t CMindy::getHostFrameDataAddr(uint32_t phase, uint32_t semiphase)
 //=================================================================================================
 void CMindy::setHostMetaDataAddr(uint32_t phase, uint64_t address)
 {
-    if      (phase == 0)
-        write64(REG_HMD0_ADDR_H, address);
-
-    else if (phase == 1)
-        write64(REG_HMD1_ADDR_H, address);
-
-    else
-        throwRuntime("bad parameter on setHostMetaDataAddr()");
+    if (phase > 1) throwRuntime("bad parameter on setHostMetaDataAddr()");
+    HostMetaData::write(BAR0_, phase, address);
 }
 //=================================================================================================    
 
@@ -238,17 +210,8 @@ void CMindy::setHostMetaDataAddr(uint32_t phase, uint64_t address)
 //=================================================================================================
 uint64_t CMindy::getHostMetaDataAddr(uint32_t phase)
 {
-    if (phase == 0)
-        return read64(REG_HMD0_ADDR_H);
-
-    if (phase == 1)
-        return read64(REG_HMD1_ADDR_H);
-    
-    // If we get here, there was an illegal value for "phase"
-    throwRuntime("bad parameter on getHostMetaDataAddr()");
-
-    // This is just here to keep the compiler happy
-    return 0;
+    if (phase > 1) throwRuntime("bad parameter on getHostMetaDataAddr()");
+    return HostMetaData::read(BAR0_, phase);
 }
 //=================================================================================================    
 
@@ -258,7 +221,7 @@ uint64_t CMindy::getHostMetaDataAddr(uint32_t phase)
 //=================================================================================================
 void CMindy::setHostFrameDataSize(uint64_t size)
 {
-    write64(REG_HFD_BYTES_H, size);
+    DF_HFD_BYTES::write(BAR0_, size);
 }
 //=================================================================================================    
 
@@ -268,7 +231,7 @@ void CMindy::setHostFrameDataSize(uint64_t size)
 //=================================================================================================
 uint64_t CMindy::getHostFrameDataSize()
 {
-    return read64(REG_HFD_BYTES_H);
+    return DF_HFD_BYTES::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -278,7 +241,7 @@ uint64_t CMindy::getHostFrameDataSize()
 //=================================================================================================
 void CMindy::setHostMetaDataSize(uint64_t size)
 {
-    write64(REG_HMD_BYTES_H, size);
+    DF_HMD_BYTES::write(BAR0_, size);
 }
 //=================================================================================================    
 
@@ -287,7 +250,7 @@ void CMindy::setHostMetaDataSize(uint64_t size)
 //=================================================================================================
 uint64_t CMindy::getHostMetaDataSize()
 {
-    return read64(REG_HMD_BYTES_H);
+    return DF_HMD_BYTES::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -298,7 +261,7 @@ uint64_t CMindy::getHostMetaDataSize()
 //=================================================================================================    
 void CMindy::setFrameSize(uint32_t size)
 {
-    write32(REG_FRAME_SIZE, size);
+    RS_FRAME_SIZE::write(BAR0_, size);
 }
 //=================================================================================================    
 
@@ -307,7 +270,7 @@ void CMindy::setFrameSize(uint32_t size)
 //=================================================================================================    
 uint32_t CMindy::getFrameSize()
 {
-    return read32(REG_FRAME_SIZE);
+    return RS_FRAME_SIZE::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -317,7 +280,7 @@ uint32_t CMindy::getFrameSize()
 //=================================================================================================
 void CMindy::setHostAbmAddr(uint64_t address)
 {
-    write32(REG_ABM_ADDR_H, address);
+    DF_ABM_ADDR::write(BAR0_, address);
 }
 //=================================================================================================    
 
@@ -327,7 +290,7 @@ void CMindy::setHostAbmAddr(uint64_t address)
 //=================================================================================================
 uint64_t CMindy::getHostAbmAddr()
 {
-    return read64(REG_ABM_ADDR_H);
+    return DF_ABM_ADDR::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -336,9 +299,22 @@ uint64_t CMindy::getHostAbmAddr()
 //=================================================================================================    
 // setPacketSize() - Sets the size of a the payload in an outgoing RDMX frame-data packet
 //=================================================================================================
-void CMindy::setPacketSize(uint32_t size)
+void CMindy::setPacketSize(uint32_t size, uint32_t mtu)
 {
-    write32(REG_PACKET_SIZE, size);
+    uint32_t maxSize   = getMaxPacketSize(mtu);
+    uint32_t frameSize = getFrameSize();
+
+    if (size == 0 || size % 64)
+        throwRuntime("setPacketSize(): %u isn't a multiple of 64", size);
+
+    if (size > maxSize)
+        throwRuntime("setPacketSize(): %u is larger than the max of %u for an MTU of %u",
+                     size, maxSize, mtu);
+
+    if (frameSize && frameSize % size)
+        throwRuntime("setPacketSize(): %u doesn't divide the frame size of %u", size, frameSize);
+
+    RS_PACKET_SIZE::write(BAR0_, size);
 }
 //=================================================================================================    
 
@@ -347,7 +323,34 @@ void CMindy::setPacketSize(uint32_t size)
 //=================================================================================================    
 uint32_t CMindy::getPacketSize()
 {
-    return read32(REG_PACKET_SIZE);
+    return RS_PACKET_SIZE::read(BAR0_);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getMaxPacketSize() - Returns the largest packet size (a multiple of 64) that the card supports
+//                      and that fits in the specified MTU
+//=================================================================================================    
+uint32_t CMindy::getMaxPacketSize(uint32_t mtu)
+{
+    // RTL builds that predate the MAX_PACKET_SIZE register only support up to 8K
+    uint32_t cardMax = RS_MAX_PACKET_SIZE::read(BAR0_);
+    if (cardMax == 0 || cardMax == 0xFFFFFFFF) cardMax = 8192;
+
+    uint32_t mtuMax = (mtu > RDMX_HEADER_BYTES) ? (mtu - RDMX_HEADER_BYTES) & ~63 : 0;
+
+    return (cardMax < mtuMax) ? cardMax : mtuMax;
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getPacketsPerFrame() - Returns the number of packets in a frame, as computed by the card
+//=================================================================================================    
+uint32_t CMindy::getPacketsPerFrame()
+{
+    return RS_PACKETS_PER_FRAME::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -357,7 +360,7 @@ uint32_t CMindy::getPacketSize()
 //=================================================================================================
 void CMindy::setPacketsPerGroup(uint32_t count)
 {
-    write32(REG_PACKETS_PER_GROUP, count);
+    RS_PACKETS_PER_GROUP::write(BAR0_, count);
 }
 //=================================================================================================    
 
@@ -366,7 +369,130 @@ void CMindy::setPacketsPerGroup(uint32_t count)
 //=================================================================================================    
 uint32_t CMindy::getPacketsPerGroup()
 {
-    return read32(REG_PACKETS_PER_GROUP);
+    return RS_PACKETS_PER_GROUP::read(BAR0_);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setSteeringPolicy() - Sets how the ping-ponger distributes packet groups between the links
+//=================================================================================================
+void CMindy::setSteeringPolicy(steerPolicy_t policy, uint32_t weight0, uint32_t weight1)
+{
+    if (policy > STEER_WEIGHTED) throwRuntime("bad policy on setSteeringPolicy()");
+    if (weight0 > 255 || weight1 > 255) throwRuntime("bad weight on setSteeringPolicy()");
+    if (policy == STEER_WEIGHTED && weight0 == 0 && weight1 == 0)
+        throwRuntime("setSteeringPolicy(): at least one weight must be non-zero");
+    if (policy == STEER_ALTERNATE && getDeltaMode())
+        throwRuntime("setSteeringPolicy(): delta mode can't use STEER_ALTERNATE");
+
+    RS_LINK_WEIGHTS::write(BAR0_, (weight1 << 8) | weight0);
+    RS_STEER_POLICY::write(BAR0_, policy);
+}
+//=================================================================================================    
+
+//=================================================================================================    
+// getSteeringPolicy() - Returns the ping-pong steering policy
+//=================================================================================================    
+CMindy::steerPolicy_t CMindy::getSteeringPolicy()
+{
+    return (steerPolicy_t)RS_STEER_POLICY::read(BAR0_);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setLinkEnable() - Sets which links the ping-ponger may use when steering
+//=================================================================================================
+void CMindy::setLinkEnable(uint32_t mask)
+{
+    if (mask == 0 || mask > 3) throwRuntime("bad mask on setLinkEnable()");
+    RS_LINK_ENABLE::write(BAR0_, mask);
+}
+//=================================================================================================    
+
+//=================================================================================================    
+// getLinkEnable() - Returns the mask of links that the ping-ponger may use when steering
+//=================================================================================================    
+uint32_t CMindy::getLinkEnable()
+{
+    return RS_LINK_ENABLE::read(BAR0_);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getLinkStats() - Returns the number of packets and bytes the ping-ponger has sent on a link,
+//                  and the statistics of the link's CMAC
+//
+// The CMAC counters live in the CMAC's clock domains, so we have status_mgr take a snapshot
+// of them and wait for it to finish before reading it
+//=================================================================================================    
+CMindy::linkStats_t CMindy::getLinkStats(uint32_t link)
+{
+    if (link > 1) throwRuntime("bad parameter on getLinkStats()");
+
+    linkStats_t result;
+    result.packets = LinkPackets::read(BAR0_, link);
+    result.bytes   = LinkBytes::read(BAR0_, link);
+
+    // Take the snapshot.  It takes a few CMAC clock cycles on the card, and one poll of the
+    // registers on an emulated card
+    SM_LINK_SNAPSHOT::write(BAR0_, 1);
+    auto     now      = chrono::steady_clock::now();
+    auto     deadline = now + chrono::milliseconds(100);
+    uint32_t busy;
+    while ((busy = SM_LINK_SNAPSHOT::read(BAR0_)) == 1)
+    {
+        now = chrono::steady_clock::now();
+        if (now > deadline) throwRuntime("Timed out waiting for the CMAC statistics");
+    }
+
+    // RTL that predates the CMAC statistics returns all 1s (a decode error) for the register
+    if (busy != 0)
+    {
+        result.cmac      = {};
+        result.perSecond = {};
+        result.seconds   = 0;
+        return result;
+    }
+
+    auto& cmac = result.cmac;
+    cmac.txPackets      = CmacTxPackets::read(BAR0_, link);
+    cmac.txBytes        = CmacTxBytes::read(BAR0_, link);
+    cmac.rxPackets      = CmacRxPackets::read(BAR0_, link);
+    cmac.rxBytes        = CmacRxBytes::read(BAR0_, link);
+    cmac.fecCorrected   = CmacFecCorr::read(BAR0_, link);
+    cmac.fecUncorrected = CmacFecUncorr::read(BAR0_, link);
+    cmac.rxBadFcs       = CmacBadFcs::read(BAR0_, link);
+    cmac.rxPause        = CmacRxPause::read(BAR0_, link);
+    cmac.txPause        = CmacTxPause::read(BAR0_, link);
+
+    // Work out the rates since the previous call.  A counter that went backwards was reset
+    // by the CMAC, and everything it holds is new
+    auto& prev = prevCmac_[link];
+    bool  first = prevCmacTime_[link].time_since_epoch().count() == 0;
+    result.seconds = first ? 0 : chrono::duration<double>(now - prevCmacTime_[link]).count();
+
+    auto rate = [&](uint64_t current, uint64_t previous)
+    {
+        if (result.seconds == 0) return 0.0;
+        return (current >= previous ? current - previous : current) / result.seconds;
+    };
+
+    result.perSecond.txPackets      = rate(cmac.txPackets,      prev.txPackets);
+    result.perSecond.txBytes        = rate(cmac.txBytes,        prev.txBytes);
+    result.perSecond.rxPackets      = rate(cmac.rxPackets,      prev.rxPackets);
+    result.perSecond.rxBytes        = rate(cmac.rxBytes,        prev.rxBytes);
+    result.perSecond.fecCorrected   = rate(cmac.fecCorrected,   prev.fecCorrected);
+    result.perSecond.fecUncorrected = rate(cmac.fecUncorrected, prev.fecUncorrected);
+    result.perSecond.rxBadFcs       = rate(cmac.rxBadFcs,       prev.rxBadFcs);
+    result.perSecond.rxPause        = rate(cmac.rxPause,        prev.rxPause);
+    result.perSecond.txPause        = rate(cmac.txPause,        prev.txPause);
+
+    prev = cmac;
+    prevCmacTime_[link] = now;
+    return result;
 }
 //=================================================================================================    
 
@@ -375,7 +501,7 @@ uint32_t CMindy::getPacketsPerGroup()
 //=================================================================================================    
 void CMindy::setRemoteFrameDataAddr(uint64_t address)
 {
-    write64(REG_RFD_ADDR_H, address);
+    RS_RFD_ADDR::write(BAR0_, address);
 }
 //=================================================================================================    
 
@@ -384,7 +510,7 @@ void CMindy::setRemoteFrameDataAddr(uint64_t address)
 //=================================================================================================    
 uint64_t CMindy::getRemoteFrameDataAddr()
 {
-    return read64(REG_RFD_ADDR_H);
+    return RS_RFD_ADDR::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -395,7 +521,7 @@ uint64_t CMindy::getRemoteFrameDataAddr()
 //=================================================================================================    
 void CMindy::setRemoteMetaDataAddr(uint64_t address)
 {
-    write64(REG_RMD_ADDR_H, address);
+    RS_RMD_ADDR::write(BAR0_, address);
 }
 //=================================================================================================    
 
@@ -405,7 +531,7 @@ void CMindy::setRemoteMetaDataAddr(uint64_t address)
 //=================================================================================================    
 uint64_t CMindy::getRemoteMetaDataAddr()
 {
-    return read64(REG_RMD_ADDR_H);
+    return RS_RMD_ADDR::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -415,7 +541,7 @@ uint64_t CMindy::getRemoteMetaDataAddr()
 //=================================================================================================    
 void CMindy::setRemoteFrameDataSize(uint64_t size)
 {
-    write64(REG_RFD_SIZE_H, size);
+    RS_RFD_SIZE::write(BAR0_, size);
 }
 //=================================================================================================    
 
@@ -425,7 +551,7 @@ void CMindy::setRemoteFrameDataSize(uint64_t size)
 //=================================================================================================    
 uint64_t CMindy::getRemoteFrameDataSize()
 {
-    return read64(REG_RFD_SIZE_H);
+    return RS_RFD_SIZE::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -436,7 +562,7 @@ uint64_t CMindy::getRemoteFrameDataSize()
 //=================================================================================================    
 void CMindy::setRemoteMetaDataSize(uint64_t size)
 {
-    write64(REG_RMD_SIZE_H, size);
+    RS_RMD_SIZE::write(BAR0_, size);
 }
 //=================================================================================================    
 
@@ -445,7 +571,7 @@ void CMindy::setRemoteMetaDataSize(uint64_t size)
 //=================================================================================================    
 uint64_t CMindy::getRemoteMetaDataSize()
 {
-    return read64(REG_RMD_SIZE_H);
+    return RS_RMD_SIZE::read(BAR0_);
 }
 //=================================================================================================    
 
@@ -455,7 +581,7 @@ uint64_t CMindy::getRemoteMetaDataSize()
 //=================================================================================================    
 void CMindy::setRemoteFrameCounterAddr(uint64_t address)
 {
-    write64(REG_RFC_ADDR_H, address);
+    RS_RFC_ADDR::write(BAR0_, address);
 }
 //=================================================================================================    
 
@@ -464,158 +590,950 @@ void CMindy::setRemoteFrameCounterAddr(uint64_t address)
 //=================================================================================================    
 uint64_t CMindy::getRemoteFrameCounterAddr()
 {
-    return read64(REG_RFC_ADDR_H);
+    return RS_RFC_ADDR::read(BAR0_);
 }
 //=================================================================================================    
 
 
 //=================================================================================================    
-// clearLocalFrameCounters() - Clears both local frame counters to zero, and resets the Mindy
-//                             system back to start
+// setFrameCounterCoalescing() - Sets how many frames (and how long) the rdmx_shims may go 
+//                               between writes of the frame counter on the receiver
 //=================================================================================================    
-void CMindy::clearLocalFrameCounters()
+void CMindy::setFrameCounterCoalescing(uint32_t frames, uint32_t timeoutUs)
 {
-    // Only need to clear the first one.  The other frame counter will automatically clear
-    write32(REG_FC0, 0);    
+    if (frames > 0xFFFF || timeoutUs > 0xFFFF) throwRuntime("bad parameter on setFrameCounterCoalescing()");
+
+    // Without a time limit, the receiver could wait forever for the count of a finished frame
+    if (frames > 1 && timeoutUs == 0)
+        throwRuntime("setFrameCounterCoalescing() needs a timeout when frames are coalesced");
+
+    RS_FC_COALESCE::write(BAR0_, frames);
+    RS_FC_TIMEOUT::write(BAR0_, timeoutUs);
 }
 //=================================================================================================    
 
 
 //=================================================================================================    
-// incrementLocalFrameCounter() - Will cause a frame-data, meta-data, and a frame counter to be
-//                                transmitted to the receivers
+// getFrameCounterCoalescing() - Fetches the frame-counter coalescing settings
 //=================================================================================================    
-void CMindy::incrementLocalFrameCounter(uint32_t phase)
+void CMindy::getFrameCounterCoalescing(uint32_t* frames, uint32_t* timeoutUs)
 {
-    uint32_t currentValue = 0;
+    *frames    = RS_FC_COALESCE::read(BAR0_);
+    *timeoutUs = RS_FC_TIMEOUT::read(BAR0_);
+}
+//=================================================================================================    
 
-    if (phase == 0)
-        currentValue = read32(REG_FC0);
-    else if (phase == 1)
-        currentValue = read32(REG_FC1);
-    else
-        throwRuntime("bad parameter on incrementLocalFrameCounter()");
 
-    if (phase == 0)
-        write32(REG_FC0, currentValue + 1);
-    else
-        write32(REG_FC1, currentValue + 1);
+//=================================================================================================    
+// getFrameCounterStats() - Returns the frame-counter writes made, and saved by coalescing
+//=================================================================================================    
+CMindy::fcStats_t CMindy::getFrameCounterStats()
+{
+    return {RS_FC_UPDATES::read(BAR0_), RS_FC_SAVED::read(BAR0_)};
 }
 //=================================================================================================    
 
 
 //=================================================================================================    
-// getLocalFrameCounter() - Returns the value of one of the local frame counters
+// setDeltaMode() - Enables or disables delta mode, in which only the packets that changed since
+//                  the previous frame of a phase are fetched and sent
 //=================================================================================================    
-uint32_t CMindy::getLocalFrameCounter(uint32_t phase)
+void CMindy::setDeltaMode(bool enable)
+{
+    if (enable)
+    {
+        uint32_t frameSize  = getFrameSize();
+        uint32_t packetSize = getPacketSize();
+
+        if (DF_MODULE_REV::read(BAR0_) < 7)
+            throwRuntime("setDeltaMode(): this RTL build doesn't support delta mode");
+
+        if (getDescriptorMode())
+            throwRuntime("setDeltaMode(): delta mode can't be used in scatter-gather mode");
+
+        if (getSteeringPolicy() == STEER_ALTERNATE)
+            throwRuntime("setDeltaMode(): delta mode can't use STEER_ALTERNATE");
+
+        if (packetSize == 0 || frameSize == 0 || (frameSize / 2) % packetSize)
+            throwRuntime("setDeltaMode(): a semiphase must be a whole number of packets");
+
+        if (frameSize / packetSize > DELTA_MAX_PACKETS)
+            throwRuntime("setDeltaMode(): %u packets per frame is more than the limit of %u",
+                         frameSize / packetSize, DELTA_MAX_PACKETS);
+    }
+
+    DF_DELTA_CTRL::write(BAR0_, enable ? 1 : 0);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getDeltaMode() - Returns 'true' if delta mode is enabled
+//=================================================================================================    
+bool CMindy::getDeltaMode()
 {
-    if (phase == 0) return read32(REG_FC0);
-    if (phase == 1) return read32(REG_FC1);
-    throwRuntime("bad parameter on getLocalFrameCounter()");
-    return 0;
+    return (DF_DELTA_CTRL::read(BAR0_) & 1) != 0;
 }
 //=================================================================================================    
 
 
 //=================================================================================================    
-// getFrameCounterPciAddress() - Returns the PCI address of the frame-counter that corresponds to
-//                               the specified phase.
+// getDeltaStats() - Returns the packets fetched and skipped in delta mode
 //=================================================================================================    
-uint64_t CMindy::getFrameCounterPciAddress(uint32_t phase)
+CMindy::deltaStats_t CMindy::getDeltaStats()
 {
-    if (phase == 0) return PCI0_ + REG_FC0;
-    if (phase == 1) return PCI0_ + REG_FC1;
-    throwRuntime("bad parameter on getFrameCounterPciAddress()");
-    return 0;
+    return {DF_DELTA_SENT::read(BAR0_), DF_DELTA_SKIPPED::read(BAR0_)};
 }
 //=================================================================================================    
 
 
+//=================================================================================================    
+// getFdFifoStats() - Returns the telemetry of the elastic frame-data FIFO
+//=================================================================================================    
+CMindy::fdFifoStats_t CMindy::getFdFifoStats()
+{
+    fdFifoStats_t stats;
+    stats.depth         = SM_FD_FIFO_DEPTH::read(BAR0_);
+    stats.level         = SM_FD_FIFO_LEVEL::read(BAR0_);
+    stats.highWater     = SM_FD_FIFO_HIGH::read(BAR0_);
+    stats.underruns     = SM_FD_UNDERRUNS::read(BAR0_);
+    stats.starvedCycles = SM_FD_STARVED::read(BAR0_);
+    return stats;
+}
+//=================================================================================================    
+
 
 //=================================================================================================    
-// getQsfpStatus() - Returns the "connected" status of the QSFP network interfaces
-//
-// Bit 0 : 1 = QSFP_0 is connected, 0 = Not connected
-// Bit 1 : 1 = QSFP_1 is connected, 0 = Not connected
+// clearFdFifoStats() - Restarts the frame-data FIFO's high-water mark and underrun counts
 //=================================================================================================    
-uint32_t CMindy::getQsfpStatus()
+void CMindy::clearFdFifoStats()
 {
-    return read32(REG_QSFP_STATUS);    
+    SM_FD_FIFO_HIGH::write(BAR0_, 0);
 }
 //=================================================================================================    
 
 
 //=================================================================================================    
-// getErrorStatus() - Returns an error-status word.  Non-zero indicates a fault
+// setDescriptorMode() - Enables or disables scatter-gather (descriptor ring) mode
 //=================================================================================================    
-uint32_t CMindy::getErrorStatus()
+void CMindy::setDescriptorMode(bool enable)
 {
-    return read32(REG_ERROR_STATUS);    
+    DF_DESC_CTRL::write(BAR0_, enable ? 1 : 0);
 }
 //=================================================================================================    
 
 
 //=================================================================================================    
-// getRtlDateStr() - Returns a string containing the RTL build date
+// getDescriptorMode() - Returns 'true' if scatter-gather (descriptor ring) mode is enabled
 //=================================================================================================    
-string CMindy::getRtlDateStr()
+bool CMindy::getDescriptorMode()
 {
-    char buffer[100];
-    const char* name[] =
-    {
-        "", "Jan", "Feb", "Mar", "Apr", "May", "Jun",
-        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
-    };
+    return (DF_DESC_CTRL::read(BAR0_) & 1) != 0;
+}
+//=================================================================================================    
 
-    // Fetch the value of the register that contains the build date
-    uint32_t dateBits = read32(REG_BUILD_DATE);
 
-    // Split the dateBits into month, day, year
-    int month =(dateBits >> 24) & 0xFF;
-    int day   =(dateBits >> 16) & 0xFF;
-    int year = (dateBits      ) & 0xFFFF;
+//=================================================================================================
+// setHostDescRingAddr() - Sets the host-PC RAM address of a descriptor ring
+//=================================================================================================
+void CMindy::setHostDescRingAddr(uint32_t phase, uint64_t address)
+{
+    if (phase > 1) throwRuntime("bad parameter on setHostDescRingAddr()");
+    HostDescRing::write(BAR0_, phase, address);
+}
+//=================================================================================================    
 
-    // Ensure that at least the month is legal
-    if (month < 1 || month > 12) return "N/A";
 
-    // Format the date like this: "02-Feb-2024"
-    sprintf(buffer, "%02i-%s-%i", day, name[month], year);
+//=================================================================================================
+// getHostDescRingAddr() - Gets the host-PC RAM address of a descriptor ring
+//=================================================================================================
+uint64_t CMindy::getHostDescRingAddr(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getHostDescRingAddr()");
+    return HostDescRing::read(BAR0_, phase);
+}
+//=================================================================================================    
 
-    // Hand the4 resulting string to the caller
-    return buffer;
+
+//=================================================================================================
+// setHostDescRingSize() - Sets the size (in bytes) of the descriptor rings
+//=================================================================================================
+void CMindy::setHostDescRingSize(uint64_t size)
+{
+    DF_DESC_BYTES::write(BAR0_, size);
+}
+//=================================================================================================    
+
+
+//=================================================================================================
+// getHostDescRingSize() - Gets the size (in bytes) of the descriptor rings
+//=================================================================================================
+uint64_t CMindy::getHostDescRingSize()
+{
+    return DF_DESC_BYTES::read(BAR0_);
 }
 //=================================================================================================    
 
 
+//=================================================================================================
+// getDescriptorErrors() - Returns the number of frames dropped because of a bad descriptor
+//=================================================================================================
+uint32_t CMindy::getDescriptorErrors()
+{
+    return DF_DESC_ERRORS::read(BAR0_);
+}
+//=================================================================================================    
+
 
 //=================================================================================================    
-// getRtlBuildStr() - Returns a string containing the build version of the RTL
+// clearLocalFrameCounters() - Clears both local frame counters to zero, and resets the Mindy
+//                             system back to start
 //=================================================================================================    
-string CMindy::getRtlBuildStr()
+void CMindy::clearLocalFrameCounters()
 {
-    string retVal;
-    char buffer[100];
+    // Only need to clear the first one.  The other frame counter will automatically clear
+    FC_FRAME_CTR_0::write(BAR0_, 0);
+}
+//=================================================================================================    
 
-    // Fetch the components of the build version
-    int major = read32(REG_BUILD_MAJOR);
-    int minor = read32(REG_BUILD_MINOR);
-    int rev   = read32(REG_BUILD_REV  );
-    int rc    = read32(REG_BUILD_RC   );
 
-    // Format the string
-    sprintf(buffer, "%i.%i.%02i", major, minor, rev);
+//=================================================================================================    
+// incrementLocalFrameCounter() - Will cause a frame-data, meta-data, and a frame counter to be
+//                                transmitted to the receivers
+//
+// The frame is submitted through the frame-add register, so this is as safe to call from
+// multiple threads as addLocalFrameCounter().  The frame counter is read back afterwards, so
+// its value includes this frame and any that other threads submitted in the meantime.  The
+// emulator does the add for us and reports the value it produced, so there's nothing to wait for
+//
+// Returns: The new value of the frame counter
+//=================================================================================================    
+uint32_t CMindy::incrementLocalFrameCounter(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on incrementLocalFrameCounter()");
 
-    // Store the buffer we just formatted into our return string
-    retVal = buffer;
+    // The emulated card only sees the frame-add registers when it polls them, so it does the
+    // add on our behalf
+    if (emulated_)
+    {
+        uint32_t& reg = *(uint32_t*)(BAR0_ + FrameAdd::offset(phase));
+        MindyReg::tapAccess((volatile uint32_t*)&reg, 1, true);
+        return emulator_->addFrames(phase, 1);
+    }
 
-    // If this is a release candidate, append that to the return string
-    if (rc)
+    // A read is never passed by the write before it, so this counts our frame
+    FrameAdd::write(BAR0_, phase, 1);
+    return FrameCtr::read(BAR0_, phase);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// addLocalFrameCounter() - Adds "count" to one of the local frame counters, causing "count"
+//                          frames to be transmitted to the receivers.
+//
+// The addition is performed by Mindy itself, so this is safe to call from multiple threads
+// and costs a single PCIe write.  Mindy refuses a count wider than 24 bits
+//=================================================================================================    
+void CMindy::addLocalFrameCounter(uint32_t phase, uint32_t count)
+{
+    if (phase > 1 || count > MAX_FRAME_ADD) throwRuntime("bad parameter on addLocalFrameCounter()");
+
+    // The emulated card polls its frame-add registers, so we do the adding for it
+    if (emulated_)
     {
-        sprintf(buffer, "-rc-%i", rc);
-        retVal = retVal + buffer;
+        uint32_t& reg = *(uint32_t*)(BAR0_ + FrameAdd::offset(phase));
+        atomic_ref<uint32_t>(reg).fetch_add(count);
+        MindyReg::tapAccess((volatile uint32_t*)&reg, count, true);
+        return;
     }
 
-    // Hand the caller the resulting build-version string
-    return retVal;
+    FrameAdd::write(BAR0_, phase, count);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getLocalFrameCounter() - Returns the value of one of the local frame counters
+//=================================================================================================    
+uint32_t CMindy::getLocalFrameCounter(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getLocalFrameCounter()");
+    return FrameCtr::read(BAR0_, phase);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getFetchedFrameCount() - Returns the number of frames of the specified phase that Mindy has
+//                          completely fetched from host RAM since the last reset.
+//
+// When this value reaches the value of the local frame counter for the same phase, every frame
+// that has been submitted for that phase has been fetched, and its buffers can be reused
+//=================================================================================================    
+uint32_t CMindy::getFetchedFrameCount(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getFetchedFrameCount()");
+    return Fetched::read(BAR0_, phase);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// finishRingState() - Checks the counters and ring offsets read back from the card for one phase
+//                     of a stream, and fills in the rest of "state" from them
+//=================================================================================================    
+static void finishRingState(CMindy::ringState_t& state, uint64_t hfdOffs, uint64_t hmdOffs,
+                            uint32_t phase, uint64_t semiphase, uint64_t hfdBytes, uint64_t hmdBytes)
+{
+    // The buffers must hold a whole number of frames or the offsets won't wrap where we expect
+    if (semiphase == 0 || hfdBytes % semiphase || hmdBytes % METADATA_BYTES || hmdBytes == 0)
+        throwRuntime("The host buffer sizes aren't a whole number of frames");
+
+    // Counters that don't add up mean the card was reset or reconfigured behind our back
+    uint32_t pending = state.submitted - state.issued;
+    state.inFlight   = state.submitted - state.fetched;
+    if (state.issued - state.fetched > state.inFlight || state.inFlight > hfdBytes / semiphase)
+        throwRuntime("Phase %u counters are inconsistent: submitted %u, issued %u, fetched %u",
+                     phase, state.submitted, state.issued, state.fetched);
+
+    if (hfdOffs >= hfdBytes || hfdOffs % semiphase || hmdOffs >= hmdBytes || hmdOffs % METADATA_BYTES)
+        throwRuntime("Phase %u ring offsets are inconsistent with the buffer sizes", phase);
+
+    state.nextHfdOffset = (hfdOffs + pending * semiphase) % hfdBytes;
+    state.nextHmdOffset = (hmdOffs + (uint64_t)pending * METADATA_BYTES) % hmdBytes;
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRingState() - Reads back where one phase of the card is in the host buffers
+//
+// The card captures the offsets of the next frame to fetch in the same clock cycle that it bumps
+// the "issued" count, so we re-read until the count is the same on both sides of the offsets.
+// The counters are read in the order fetched, issued, submitted so that they can only appear to
+// grow, never to go backwards.  Frames that were submitted but not issued yet are still in
+// front of the card, so the host's next frame goes that many semiphases past the card's offsets
+//=================================================================================================    
+CMindy::ringState_t CMindy::getRingState(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getRingState()");
+
+    ringState_t state;
+    uint64_t    hfdOffs, hmdOffs;
+    uint32_t    issued, tries = 0;
+
+    do
+    {
+        if (++tries > 100) throwRuntime("Phase %u ring state never settled", phase);
+        state.fetched   = Fetched::read(BAR0_, phase);
+        state.issued    = Issued::read(BAR0_, phase);
+        hfdOffs         = HfdOffs::read(BAR0_, phase);
+        hmdOffs         = HmdOffs::read(BAR0_, phase);
+        issued          = Issued::read(BAR0_, phase);
+        state.submitted = FrameCtr::read(BAR0_, phase);
+    } while (issued != state.issued);
+
+    finishRingState(state, hfdOffs, hmdOffs, phase, getFrameSize() / 2,
+                    getHostFrameDataSize(), getHostMetaDataSize());
+    return state;
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// beginConfig() - Starts staging a new configuration.  Until commitConfig(), writes to the
+//                 staged registers are held in their shadows and the card doesn't see them
+//=================================================================================================    
+void CMindy::beginConfig()
+{
+    if (DF_MODULE_REV::read(BAR0_) < 6) throwRuntime("This RTL doesn't support staged configuration");
+    DF_CFG_CTRL::write(BAR0_, 1);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// commitConfig() - Applies the staged configuration at the next frame boundary
+//
+// The card stops accepting frame commands, waits until every frame it has issued has been
+// delivered, then applies the configuration and restarts the rings in a single clock cycle.
+// Once the commit is complete we stop staging, which changes nothing since the shadows and the
+// registers the card uses now hold the same values.
+//
+// If the card never gets there, we cancel the commit so that it goes back to accepting frame
+// commands with its old configuration.  The cancel can cross with the commit landing, in which
+// case the commit stands
+//=================================================================================================    
+void CMindy::commitConfig(uint32_t timeoutMs, ringState_t state[2])
+{
+    if ((DF_CFG_CTRL::read(BAR0_) & 1) == 0) throwRuntime("commitConfig() without beginConfig()");
+
+    DF_CFG_COMMIT::write(BAR0_, 1);
+
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+    while (DF_CFG_COMMIT::read(BAR0_) & 1)
+    {
+        if (chrono::steady_clock::now() > deadline)
+        {
+            cancelCommit();
+            if (DF_CFG_COMMIT::read(BAR0_) & 2)
+            {
+                throwRuntime("The card didn't reach a frame boundary within %u ms.  The commit"
+                             " was cancelled and the new configuration is still staged", timeoutMs);
+            }
+            break;
+        }
+        this_thread::sleep_for(chrono::microseconds(10));
+    }
+
+    DF_CFG_CTRL::write(BAR0_, 0);
+
+    // Every ring restarted at offset 0, so tell the caller where the next frames go
+    if (state)
+    {
+        state[0] = getRingState(0);
+        state[1] = getRingState(1);
+    }
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// cancelCommit() - Cancels a commit that's waiting for a frame boundary, and waits until the
+//                  card has either cancelled it or applied it
+//=================================================================================================    
+void CMindy::cancelCommit()
+{
+    // RTL without a cancel would take the write for another commit
+    if (DF_MODULE_REV::read(BAR0_) < 10)
+        throwRuntime("The card didn't reach a frame boundary, and this RTL can't cancel a commit");
+
+    // The emulated card polls the register, so we change it only if the commit hasn't landed
+    if (emulated_)
+    {
+        uint32_t& reg = *(uint32_t*)(BAR0_ + DF_CFG_COMMIT::offset);
+        uint32_t  expected = 1;
+        atomic_ref<uint32_t>(reg).compare_exchange_strong(expected, 2);
+        MindyReg::tapAccess((volatile uint32_t*)&reg, 0, true);
+    }
+    else
+        DF_CFG_COMMIT::write(BAR0_, 0);
+
+    // The cancel takes effect within a few clock cycles, or the emulated card's next poll
+    for (int i = 0; i < 100000; ++i)
+    {
+        if ((DF_CFG_COMMIT::read(BAR0_) & 1) == 0) return;
+        this_thread::sleep_for(chrono::microseconds(10));
+    }
+    throwRuntime("The card didn't respond to a cancelled commit");
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getStreamCount() - Returns the number of streams the card can carry
+//=================================================================================================    
+uint32_t CMindy::getStreamCount()
+{
+    if (FC_MODULE_REV::read(BAR0_) < 4) return 1;
+    return FC_STREAMS::read(BAR0_);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// stream() - Returns a handle to one of the card's streams
+//=================================================================================================    
+CMindyStream CMindy::stream(uint32_t index)
+{
+    if (index >= getStreamCount()) throwRuntime("This card doesn't have a stream %u", index);
+    return CMindyStream(*this, index);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setStreamWeight() - Sets the number of frames a stream may send before the next stream that
+//                     has frames waiting gets its turn
+//=================================================================================================    
+void CMindy::setStreamWeight(uint32_t index, uint32_t weight)
+{
+    if (index >= getStreamCount() || weight < 1 || weight > 15)
+        throwRuntime("bad parameter on setStreamWeight()");
+
+    // On RTL without streams there's only stream 0, and nothing to share the card with
+    if (FC_MODULE_REV::read(BAR0_) < 4) return;
+
+    uint32_t weights = FC_STREAM_WEIGHTS::read(BAR0_);
+    weights &= ~(0xF << (index * 4));
+    weights |= weight << (index * 4);
+    FC_STREAM_WEIGHTS::write(BAR0_, weights);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getStreamWeight() - Returns the number of frames a stream may send per turn
+//=================================================================================================    
+uint32_t CMindy::getStreamWeight(uint32_t index)
+{
+    if (index >= getStreamCount()) throwRuntime("bad parameter on getStreamWeight()");
+    if (FC_MODULE_REV::read(BAR0_) < 4) return 1;
+
+    uint32_t weight = (FC_STREAM_WEIGHTS::read(BAR0_) >> (index * 4)) & 0xF;
+    return weight ? weight : 1;
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getCardTimestamp() - Returns the current value of Mindy's free-running timestamp counter
+//=================================================================================================    
+uint64_t CMindy::getCardTimestamp()
+{
+    return FC_TIMESTAMP::read(BAR0_);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setMetadataStamping() - Enables or disables stamping the timestamp of the frame-counter write
+//                         into bytes 104 thru 111 of each outgoing metadata record, and the
+//                         stream ID into byte 103
+//=================================================================================================    
+void CMindy::setMetadataStamping(bool enable, bool streamId)
+{
+    if (streamId && FC_MODULE_REV::read(BAR0_) < 4)
+        throwRuntime("This RTL doesn't support streams");
+
+    RS_MD_STAMP::write(BAR0_, (enable ? 1 : 0) | (streamId ? 2 : 0));
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// readTrace() - Removes every entry from one of the trace FIFOs and appends them to "result"
+//
+// Returns: The number of entries that were read
+//=================================================================================================    
+uint32_t CMindy::readTrace(tracePoint_t point, vector<uint64_t>& result)
+{
+    if (point >= TRACE_POINTS) throwRuntime("bad parameter on readTrace()");
+
+    const traceRegs_t& regs = traceRegs[point];
+
+    // Find out how many entries there are, then read each one.  Reading the upper half of an 
+    // entry removes it from the FIFO
+    uint32_t count = read32(regs.count);
+    for (uint32_t i = 0; i < count; ++i) result.push_back(read64(regs.entry));
+
+    return count;
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getTraceLost() - Returns the number of entries lost because a trace FIFO was full
+//=================================================================================================    
+uint32_t CMindy::getTraceLost(tracePoint_t point)
+{
+    if (point >= TRACE_POINTS) throwRuntime("bad parameter on getTraceLost()");
+    return read32(traceRegs[point].lost);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getFrameCounterPciAddress() - Returns the PCI address of the frame-counter that corresponds to
+//                               the specified phase.
+//=================================================================================================    
+uint64_t CMindy::getFrameCounterPciAddress(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getFrameCounterPciAddress()");
+    return PCI0_ + FrameCtr::offset(phase);
+}
+//=================================================================================================    
+
+
+
+//=================================================================================================    
+// getQsfpStatus() - Returns the "connected" status of the QSFP network interfaces
+//
+// Bit 0 : 1 = QSFP_0 is connected, 0 = Not connected
+// Bit 1 : 1 = QSFP_1 is connected, 0 = Not connected
+//=================================================================================================    
+uint32_t CMindy::getQsfpStatus()
+{
+    return SM_QSFP_STATUS::read(BAR0_);    
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getErrorStatus() - Returns an error-status word.  Non-zero indicates a fault
+//=================================================================================================    
+uint32_t CMindy::getErrorStatus()
+{
+    return SM_ERR_STATUS::read(BAR0_);    
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// clearErrorStatus() - Clears latched errors.  The error-status register is write-1-to-clear,
+//                      so an error that latches after it was read isn't cleared with the rest
+//=================================================================================================    
+void CMindy::clearErrorStatus(uint32_t bits)
+{
+    // The emulated register is plain memory, so we do the clearing for it
+    if (emulated_)
+    {
+        uint32_t& reg = *(uint32_t*)(BAR0_ + SM_ERR_STATUS::offset);
+        atomic_ref<uint32_t>(reg).fetch_and(~bits);
+        MindyReg::tapAccess((volatile uint32_t*)&reg, bits, true);
+        return;
+    }
+
+    SM_ERR_STATUS::write(BAR0_, bits);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRtlDateStr() - Returns a string containing the RTL build date
+//=================================================================================================    
+string CMindy::getRtlDateStr()
+{
+    char buffer[100];
+    const char* name[] =
+    {
+        "", "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    };
+
+    // Fetch the value of the register that contains the build date
+    uint32_t dateBits = BV_DATE::read(BAR0_);
+
+    // Split the dateBits into month, day, year
+    int month =(dateBits >> 24) & 0xFF;
+    int day   =(dateBits >> 16) & 0xFF;
+    int year = (dateBits      ) & 0xFFFF;
+
+    // Ensure that at least the month is legal
+    if (month < 1 || month > 12) return "N/A";
+
+    // Format the date like this: "02-Feb-2024"
+    sprintf(buffer, "%02i-%s-%i", day, name[month], year);
+
+    // Hand the4 resulting string to the caller
+    return buffer;
+}
+//=================================================================================================    
+
+
+
+//=================================================================================================    
+// getRtlBuildStr() - Returns a string containing the build version of the RTL
+//=================================================================================================    
+string CMindy::getRtlBuildStr()
+{
+    string retVal;
+    char buffer[100];
+
+    // Fetch the components of the build version
+    int major = BV_MAJOR::read(BAR0_);
+    int minor = BV_MINOR::read(BAR0_);
+    int rev   = BV_BUILD::read(BAR0_);
+    int rc    = BV_RCAND::read(BAR0_);
+
+    // Format the string
+    sprintf(buffer, "%i.%i.%02i", major, minor, rev);
+
+    // Store the buffer we just formatted into our return string
+    retVal = buffer;
+
+    // If this is a release candidate, append that to the return string
+    if (rc)
+    {
+        sprintf(buffer, "-rc-%i", rc);
+        retVal = retVal + buffer;
+    }
+
+    // Hand the caller the resulting build-version string
+    return retVal;
+}
+//=================================================================================================    
+
+
+
+//=================================================================================================    
+// readBanked() - Reads a register in this stream's bank
+//
+// The card presents the banked registers of the stream selected by FC_STREAM_SEL, which we only
+// change for the duration of the access.  It's 0 the rest of the time, so that everything
+// CMindy does is about stream 0
+//=================================================================================================    
+uint64_t CMindyStream::readBanked(uint32_t reg, bool wide)
+{
+    if (index_ && mindy_.emulated_) return mindy_.emulatedBank_[index_][reg];
+
+    if (index_) FC_STREAM_SEL::write(mindy_.BAR0_, index_);
+    uint64_t value = wide ? mindy_.read64(reg) : mindy_.read32(reg);
+    if (index_) FC_STREAM_SEL::write(mindy_.BAR0_, 0);
+    return value;
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// writeBanked() - Writes a register in this stream's bank
+//=================================================================================================    
+void CMindyStream::writeBanked(uint32_t reg, uint64_t value, bool wide)
+{
+    if (index_ && mindy_.emulated_)
+    {
+        mindy_.emulatedBank_[index_][reg] = value;
+        return;
+    }
+
+    if (index_) FC_STREAM_SEL::write(mindy_.BAR0_, index_);
+    if (wide)
+        mindy_.write64(reg, value);
+    else
+        mindy_.write32(reg, value);
+    if (index_) FC_STREAM_SEL::write(mindy_.BAR0_, 0);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setHostFrameDataAddr() - Sets the host-PC RAM address of one of this stream's frame-data
+//                          buffers
+//=================================================================================================    
+void CMindyStream::setHostFrameDataAddr(uint32_t phase, uint32_t semiphase, uint64_t address)
+{
+    if (phase > 1 || semiphase > 1) throwRuntime("bad parameter on setHostFrameDataAddr()");
+    writeBanked(HostFrameData::offset(phase * 2 + semiphase), address);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getHostFrameDataAddr() - Returns the host-PC RAM address of one of this stream's frame-data
+//                          buffers
+//=================================================================================================    
+uint64_t CMindyStream::getHostFrameDataAddr(uint32_t phase, uint32_t semiphase)
+{
+    if (phase > 1 || semiphase > 1) throwRuntime("bad parameter on getHostFrameDataAddr()");
+    return readBanked(HostFrameData::offset(phase * 2 + semiphase));
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setHostMetaDataAddr() - Sets the host-PC RAM address of one of this stream's meta-data buffers
+//=================================================================================================    
+void CMindyStream::setHostMetaDataAddr(uint32_t phase, uint64_t address)
+{
+    if (phase > 1) throwRuntime("bad parameter on setHostMetaDataAddr()");
+    writeBanked(HostMetaData::offset(phase), address);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getHostMetaDataAddr() - Returns the host-PC RAM address of one of this stream's meta-data
+//                         buffers
+//=================================================================================================    
+uint64_t CMindyStream::getHostMetaDataAddr(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getHostMetaDataAddr()");
+    return readBanked(HostMetaData::offset(phase));
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setRemoteFrameDataAddr() - Sets the address of this stream's frame-data buffer on the receiver
+//=================================================================================================    
+void CMindyStream::setRemoteFrameDataAddr(uint64_t address)
+{
+    writeBanked(RS_RFD_ADDR::offset, address);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRemoteFrameDataAddr() - Gets the address of this stream's frame-data buffer on the receiver
+//=================================================================================================    
+uint64_t CMindyStream::getRemoteFrameDataAddr()
+{
+    return readBanked(RS_RFD_ADDR::offset);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setRemoteFrameDataSize() - Sets the size of this stream's frame-data buffer on the receiver
+//=================================================================================================    
+void CMindyStream::setRemoteFrameDataSize(uint64_t size)
+{
+    writeBanked(RS_RFD_SIZE::offset, size);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRemoteFrameDataSize() - Gets the size of this stream's frame-data buffer on the receiver
+//=================================================================================================    
+uint64_t CMindyStream::getRemoteFrameDataSize()
+{
+    return readBanked(RS_RFD_SIZE::offset);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setRemoteMetaDataAddr() - Sets the address of this stream's meta-data buffer on the receiver
+//=================================================================================================    
+void CMindyStream::setRemoteMetaDataAddr(uint64_t address)
+{
+    writeBanked(RS_RMD_ADDR::offset, address);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRemoteMetaDataAddr() - Gets the address of this stream's meta-data buffer on the receiver
+//=================================================================================================    
+uint64_t CMindyStream::getRemoteMetaDataAddr()
+{
+    return readBanked(RS_RMD_ADDR::offset);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setRemoteMetaDataSize() - Sets the size of this stream's meta-data buffer on the receiver
+//=================================================================================================    
+void CMindyStream::setRemoteMetaDataSize(uint64_t size)
+{
+    writeBanked(RS_RMD_SIZE::offset, size);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRemoteMetaDataSize() - Gets the size of this stream's meta-data buffer on the receiver
+//=================================================================================================    
+uint64_t CMindyStream::getRemoteMetaDataSize()
+{
+    return readBanked(RS_RMD_SIZE::offset);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// setRemoteFrameCounterAddr() - Sets the address of this stream's frame counter on the receiver
+//=================================================================================================    
+void CMindyStream::setRemoteFrameCounterAddr(uint64_t address)
+{
+    writeBanked(RS_RFC_ADDR::offset, address);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRemoteFrameCounterAddr() - Gets the address of this stream's frame counter on the receiver
+//=================================================================================================    
+uint64_t CMindyStream::getRemoteFrameCounterAddr()
+{
+    return readBanked(RS_RFC_ADDR::offset);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// addLocalFrameCounter() - Submits "count" frames of one phase of this stream
+//
+// Stream 0 uses the frame-add registers, just as CMindy does.  The other streams share
+// FC_STREAM_ADD, which takes the stream, phase and count in a single write
+//=================================================================================================    
+void CMindyStream::addLocalFrameCounter(uint32_t phase, uint32_t count)
+{
+    if (phase > 1 || count > STREAM_ADD_COUNT) throwRuntime("bad parameter on addLocalFrameCounter()");
+
+    if (index_ == 0) return mindy_.addLocalFrameCounter(phase, count);
+
+    // The emulated card polls its frame counter table, so we do the adding for it
+    if (mindy_.emulated_)
+    {
+        uint32_t& reg = *(uint32_t*)(mindy_.BAR0_ + FC_STREAM_CTR::offset + (index_ * 2 + phase) * 4);
+        atomic_ref<uint32_t>(reg).fetch_add(count);
+        MindyReg::tapAccess((volatile uint32_t*)&reg, count, true);
+        return;
+    }
+
+    FC_STREAM_ADD::write(mindy_.BAR0_, (index_ << STREAM_ADD_STREAM) | (phase << STREAM_ADD_PHASE) | count);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getLocalFrameCounter() - Returns the value of one of this stream's local frame counters
+//=================================================================================================    
+uint32_t CMindyStream::getLocalFrameCounter(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getLocalFrameCounter()");
+    if (index_ == 0) return mindy_.getLocalFrameCounter(phase);
+    return FC_STREAM_CTR::read(mindy_.BAR0_ + (index_ * 2 + phase) * 4);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getFetchedFrameCount() - Returns the number of frames of one phase of this stream that the
+//                          card has finished fetching from host RAM
+//=================================================================================================    
+uint32_t CMindyStream::getFetchedFrameCount(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getFetchedFrameCount()");
+    if (index_ == 0) return mindy_.getFetchedFrameCount(phase);
+    return DF_STREAM_FETCHED::read(mindy_.BAR0_ + (index_ * 2 + phase) * 4);
+}
+//=================================================================================================    
+
+
+//=================================================================================================    
+// getRingState() - Reads back where one phase of this stream is in its host buffers
+//
+// This works the way CMindy::getRingState() does, except that the issued count and the ring
+// offsets are banked.  The emulator doesn't keep them for streams other than 0
+//=================================================================================================    
+CMindy::ringState_t CMindyStream::getRingState(uint32_t phase)
+{
+    if (phase > 1) throwRuntime("bad parameter on getRingState()");
+    if (index_ == 0) return mindy_.getRingState(phase);
+    if (mindy_.emulated_) throwRuntime("The emulator doesn't keep ring state for stream %u", index_);
+
+    CMindy::ringState_t state;
+    uint64_t hfdOffs, hmdOffs;
+    uint32_t issued, tries = 0;
+
+    do
+    {
+        if (++tries > 100) throwRuntime("Stream %u phase %u ring state never settled", index_, phase);
+        state.fetched   = getFetchedFrameCount(phase);
+        state.issued    = readBanked(Issued::offset(phase), false);
+        hfdOffs         = readBanked(HfdOffs::offset(phase));
+        hmdOffs         = readBanked(HmdOffs::offset(phase));
+        issued          = readBanked(Issued::offset(phase), false);
+        state.submitted = getLocalFrameCounter(phase);
+    } while (issued != state.issued);
+
+    finishRingState(state, hfdOffs, hmdOffs, phase, mindy_.getFrameSize() / 2,
+                    mindy_.getHostFrameDataSize(), mindy_.getHostMetaDataSize());
+    return state;
 }
 //=================================================================================================    
@@ -5,6 +5,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <chrono>
+#include "MindyRegs.h"
+
+class MindyEmulator;
+class CMindyStream;
 
 // Throughout this header file:
 //    Valid values for "phase" are 0 or 1
@@ -13,9 +18,111 @@ class CMindy
 {
 public:
 
+    // The MTU of a network of jumbo-frame switches
+    static constexpr uint32_t DEFAULT_MTU = 9000;
+
+    // The bytes of IP, UDP and RDMX header that precede the payload of an RDMX packet
+    static constexpr uint32_t RDMX_HEADER_BYTES = 20 + 8 + 22;
+
+    // The most streams any build of the card can carry (see stream())
+    static constexpr uint32_t MAX_STREAMS = 8;
+
+    // The most frames that one call to addLocalFrameCounter() can submit
+    static constexpr uint32_t MAX_FRAME_ADD = 0x00FFFFFF;
+
+    // Where in each metadata record the card stamps the stream ID (see setMetadataStamping())
+    static constexpr uint32_t METADATA_STREAM_OFFSET = 103;
+
+    // The points in the design where per-frame timestamps are recorded
+    enum tracePoint_t
+    {
+        TRACE_CMD,          // The command for the frame was accepted by frame_counters
+        TRACE_FETCH,        // The first beat of the frame arrived in data_fetch
+        TRACE_PINGPONG,     // The last packet of the frame left the ping-ponger
+        TRACE_FC,           // Both rdmx_shims have finished the frame (see setFrameCounterCoalescing())
+        TRACE_POINTS
+    };
+
+    // How the ping-ponger distributes groups of packets between the two QSFP links
+    enum steerPolicy_t
+    {
+        STEER_ALTERNATE,    // Strictly alternate.  Both links must be up
+        STEER_ADAPTIVE,     // Favor whichever link isn't backpressuring us
+        STEER_WEIGHTED      // Send "weight" groups to each link in turn
+    };
+
+    // The statistics kept by the CMAC of a QSFP port
+    template <class T> struct cmacCounters_t
+    {
+        T txPackets, txBytes;
+        T rxPackets, rxBytes;
+        T fecCorrected;             // RS-FEC codewords that had errors and were corrected
+        T fecUncorrected;           // RS-FEC codewords that had errors and couldn't be
+        T rxBadFcs;                 // Packets received with a bad FCS
+        T rxPause, txPause;         // Pause frames
+    };
+
+    // The traffic on one link
+    struct linkStats_t
+    {
+        uint64_t packets;                       // Packets the ping-ponger sent on the link
+        uint64_t bytes;                         // And their payload bytes
+        cmacCounters_t<uint64_t> cmac;          // Since the CMAC was last reset
+        cmacCounters_t<double>   perSecond;     // Rates since the previous getLinkStats()
+        double   seconds;                       // Since the previous getLinkStats(), or 0
+    };
+
+    // How many remote frame-counter writes the rdmx_shims have made, and how many they saved by
+    // coalescing, since the last reset.  Each frame costs two writes (one per rdmx_shim)
+    struct fcStats_t
+    {
+        uint64_t updates;
+        uint64_t saved;
+    };
+
+    // How many packets the card has fetched and skipped in delta mode since the last reset
+    struct deltaStats_t
+    {
+        uint64_t sent;
+        uint64_t skipped;
+    };
+
+    // The telemetry of the elastic frame-data FIFO between data_fetch and the ping-ponger.
+    // A beat is 64 bytes
+    struct fdFifoStats_t
+    {
+        uint32_t depth;             // Beats the FIFO holds, or 0 if this build has none
+        uint32_t level;             // Beats in it now
+        uint32_t highWater;         // The most beats it has held since the last clear
+        uint32_t underruns;         // Times the frame data ran dry in the middle of a frame
+        uint64_t starvedCycles;     // Clock cycles it spent that way
+    };
+
+    // Where one phase of a running card is in the host frame-data and meta-data buffers
+    struct ringState_t
+    {
+        uint32_t submitted;         // Frames submitted (the local frame counter)
+        uint32_t issued;            // Frames whose fetch the card has issued
+        uint32_t fetched;           // Frames the card has finished fetching
+        uint32_t inFlight;          // Frames whose host buffers the card still owns
+        uint64_t nextHfdOffset;     // Where in the HFD buffers the next frame submitted goes
+        uint64_t nextHmdOffset;     // Where in the HMD buffer its metadata goes
+    };
+
     // Call this once to connect to Mindy over PCIe
     void        init(std::string pcieID = "10EE:903F");
 
+    // Or call this instead, to connect to a card that's already streaming, without resetting
+    // it.  On return, "state" describes where each phase is in the host buffers, so that a
+    // producer can resume where the card is rather than calling clearLocalFrameCounters().
+    // Throws if the card isn't configured for contiguous host buffers or its state doesn't
+    // add up, in which case the caller must configure and reset it as usual.  "state" is only
+    // good until the next commitConfig(), which restarts the rings (see beginConfig())
+    void        attach(ringState_t state[2], std::string pcieID = "10EE:903F");
+
+    // Or call this instead, to use an emulated card (see MindyEmulator.h)
+    void        initEmulated(MindyEmulator& device);
+
     // Returns a string containing the version of the RTL build
     std::string getRtlBuildStr();
     
@@ -27,9 +134,19 @@ public:
     //   Bit 1 : 1 = QSFP_1 is connected, 0 = not connected.
     uint32_t    getQsfpStatus();
 
-    // Returns a non-zero code to report a latched error state
+    // The bits of the error status.  Each one stays set until clearErrorStatus()
+    enum errorBits_t
+    {
+        ERR_FC_OVERFLOW = 1     // The frame-counter command FIFO overflowed
+    };
+
+    // Returns a non-zero code to report a latched error state (see errorBits_t)
     uint32_t    getErrorStatus();
 
+    // Clears the latched errors whose bits are set in "bits".  To be sure that no error is
+    // lost, pass exactly the bits that getErrorStatus() returned
+    void        clearErrorStatus(uint32_t bits = 0xFFFFFFFF);
+
     // Call this to fetch the PCI address of a frame counter
     uint64_t    getFrameCounterPciAddress(uint32_t phase);
 
@@ -60,14 +177,38 @@ public:
     void        setFrameSize(uint32_t size);
     uint32_t    getFrameSize();
 
-    // Get and set the the size of the RDMX packet payloads
-    void        setPacketSize(uint32_t size);
+    // Get and set the the size of the RDMX packet payloads.  The size must be a multiple of
+    // 64, no larger than the card supports, and must divide the frame size evenly.  With its
+    // IP, UDP and RDMX headers, a packet must fit in the "mtu" of the network
+    void        setPacketSize(uint32_t size, uint32_t mtu = DEFAULT_MTU);
     uint32_t    getPacketSize();
 
+    // Returns the largest packet size that the card supports and that fits in "mtu"
+    uint32_t    getMaxPacketSize(uint32_t mtu = DEFAULT_MTU);
+
+    // Returns the number of packets in a frame, as computed by the card
+    uint32_t    getPacketsPerFrame();
+
     // Get and set the number of packets in a ping-pong group
     void        setPacketsPerGroup(uint32_t count);
     uint32_t    getPacketsPerGroup();
 
+    // Get and set the ping-pong steering policy.  The weights (0 thru 255) are the number
+    // of groups sent to each link per turn, and only matter for STEER_WEIGHTED.  In any
+    // policy but STEER_ALTERNATE, a link that goes down is automatically dropped and the
+    // receiver must accept whole frames, with each packet written at its frame offset
+    void        setSteeringPolicy(steerPolicy_t policy, uint32_t weight0 = 1, uint32_t weight1 = 1);
+    steerPolicy_t getSteeringPolicy();
+
+    // Get and set which links may be used when steering.  Bit N = 1 means link N may be used
+    void        setLinkEnable(uint32_t mask);
+    uint32_t    getLinkEnable();
+
+    // Returns the number of packets and bytes the ping-ponger has sent on a link (0 or 1)
+    // since the last reset, and the statistics of that link's CMAC.  The rates are over the
+    // time since the previous call for the same link, and are 0 on the first call
+    linkStats_t getLinkStats(uint32_t link);
+
     // Get and set the address of the frame-data buffer on the receiver
     void        setRemoteFrameDataAddr(uint64_t address);
     uint64_t    getRemoteFrameDataAddr();
@@ -88,27 +229,239 @@ public:
     void        setRemoteFrameCounterAddr(uint64_t address);
     uint64_t    getRemoteFrameCounterAddr();
 
+    // Get and set frame-counter coalescing.  The frame counter on the receiver is written
+    // after every "frames" frames (0 or 1 = every frame), or once the count of a completed
+    // frame has gone unwritten for "timeoutUs" microseconds, whichever comes first.  Both must
+    // be less than 65536.  "timeoutUs" = 0 means no time limit, and is only allowed when every
+    // frame is written, since otherwise the counts of the last few frames of a stream that
+    // stops wouldn't be written until it started again
+    void        setFrameCounterCoalescing(uint32_t frames, uint32_t timeoutUs);
+    void        getFrameCounterCoalescing(uint32_t* frames, uint32_t* timeoutUs);
+
+    // Returns the frame-counter writes made and saved since the last reset
+    fcStats_t   getFrameCounterStats();
+
+    // Enable or disable delta mode.  In this mode the card fetches and sends only the packets
+    // flagged in the bitmap at the start of each frame's metadata record (see FrameDelta.h).
+    // Requires contiguous host buffers, a steering policy other than STEER_ALTERNATE, no more
+    // than 512 packets per frame and a whole number of packets per semiphase.  Set the frame
+    // and packet sizes and the steering policy first
+    void        setDeltaMode(bool enable);
+    bool        getDeltaMode();
+
+    // Returns the packets fetched and skipped in delta mode since the last reset
+    deltaStats_t getDeltaStats();
+
+    // Returns the telemetry of the frame-data FIFO since the last reset or clear.  Compare
+    // the high-water mark with the depth to see how much of the FIFO the host's read jitter
+    // needs, and the underruns with 0 to see whether it was enough
+    fdFifoStats_t getFdFifoStats();
+
+    // Restarts the measurement: the high-water mark drops to the current level and the
+    // underrun counts go to 0
+    void        clearFdFifoStats();
+
+    // Enable or disable scatter-gather (descriptor ring) mode.  In this mode, the
+    // host frame-data and meta-data buffers are ignored and frames are described
+    // by the descriptor rings instead.  See DescriptorRing.h
+    void        setDescriptorMode(bool enable);
+    bool        getDescriptorMode();
+
+    // Get and set the address of the descriptor rings on the host PC
+    void        setHostDescRingAddr(uint32_t phase, uint64_t address);
+    uint64_t    getHostDescRingAddr(uint32_t phase);
+
+    // Get and set the size of the descriptor rings on the host PC
+    // Must be a multiple of 64
+    void        setHostDescRingSize(uint64_t size);
+    uint64_t    getHostDescRingSize();
+
+    // Returns the number of frames that were dropped because of a bad descriptor
+    uint32_t    getDescriptorErrors();
+
+    // Returns the current value of Mindy's free-running timestamp counter
+    uint64_t    getCardTimestamp();
+
+    // Enable or disable stamping the timestamp into bytes 104-111 of outgoing metadata and,
+    // if "streamId" is true, the ID of the frame's stream into byte 103
+    void        setMetadataStamping(bool enable, bool streamId = false);
+
+    // Drains a trace FIFO, appending its entries to "result".  Each entry is:
+    //   bits 63:48 = frame sequence number, bit 47 = phase, bits 46:0 = card timestamp
+    uint32_t    readTrace(tracePoint_t point, std::vector<uint64_t>& result);
+
+    // Returns the number of trace entries lost because a trace FIFO was full
+    uint32_t    getTraceLost(tracePoint_t point);
+
     // Clear the local frame counters and reset Mindy
     void        clearLocalFrameCounters();
     
-    // Increments one of the local frame counters
-    void        incrementLocalFrameCounter(uint32_t phase);
+    // Submits one frame and returns the local frame counter, which counts that frame.  On the
+    // hardware, if other threads are submitting too, it may count some of theirs as well.  The
+    // emulator returns exactly the value that our frame brought the counter to
+    uint32_t    incrementLocalFrameCounter(uint32_t phase);
     
+    // Adds "count" (no more than MAX_FRAME_ADD) to one of the local frame counters.  This is
+    // a single register write and may be called from multiple threads at once
+    void        addLocalFrameCounter(uint32_t phase, uint32_t count);
+
+    // The same, for a phase that's known at compile time.  This is a single MMIO store
+    template <uint32_t phase> void addLocalFrameCounter(uint32_t count)
+    {
+        if (emulated_ || count > MAX_FRAME_ADD) return addLocalFrameCounter(phase, count);
+        FrameAdd::at<phase>::write(BAR0_, count);
+    }
+
     // Returns the value of one of the local frame counters
     uint32_t    getLocalFrameCounter(uint32_t phase);
 
-protected:
+    // Returns the number of frames of the specified phase that Mindy has finished
+    // fetching from host RAM.  Resets to zero along with the local frame counters
+    uint32_t    getFetchedFrameCount(uint32_t phase);
+
+    // Reads back where one phase of the card is in the host buffers (see attach())
+    ringState_t getRingState(uint32_t phase);
+
+    // Staged reconfiguration.  After beginConfig(), the host and remote buffers, the descriptor
+    // rings, the frame size, the packet size and the packets per group can be set as usual, but
+    // the card keeps streaming with its old configuration (the get...() calls return the new
+    // values).  commitConfig() applies them all at once at the next frame boundary.  If the
+    // card doesn't reach one within "timeoutMs", the commit is cancelled, the card carries on
+    // with its old configuration, the new one stays staged, and commitConfig() throws.
+    //
+    // A commit restarts every ring at offset 0, while the frame counters carry on, so a
+    // producer that tracks its own ring offsets (FrameSubmitter, or one resumed with attach())
+    // must resync afterwards.  Frames that were submitted but not yet issued when the commit
+    // lands are fetched with the new configuration.  If "state" isn't null, it's filled in
+    // with where each phase's next frame goes, as getRingState() would
+    void        beginConfig();
+    void        commitConfig(uint32_t timeoutMs = 1000, ringState_t state[2] = nullptr);
+
+    // Returns the number of streams the card can carry.  This is 1 on RTL without streams
+    uint32_t    getStreamCount();
+
+    // Returns a handle to stream "index" (0 thru getStreamCount() - 1).  Every other call in
+    // this class is about stream 0, which is the only stream on RTL without streams
+    CMindyStream stream(uint32_t index);
 
-    uint32_t read32 (uint32_t reg);
-    uint64_t read64 (uint32_t reg);
-    void     write32(uint32_t reg, uint32_t value);
-    void     write64(uint32_t reg, uint64_t value);
+    // Get and set the number of frames (1 thru 15) a stream may send per turn when more than
+    // one stream has frames waiting
+    void        setStreamWeight(uint32_t index, uint32_t weight);
+    uint32_t    getStreamWeight(uint32_t index);
 
+    // Raw register access by BAR 0 offset, for diagnostic tools such as mindyctl.  A 64-bit
+    // register is read and written upper half first
+    uint32_t    read32 (uint32_t reg);
+    uint64_t    read64 (uint32_t reg);
+    void        write32(uint32_t reg, uint32_t value);
+    void        write64(uint32_t reg, uint64_t value);
+
+    // Returns the userspace address of BAR 0, so that an MmioRecorder can tell which
+    // register an access was to
+    unsigned char* bar0() {return BAR0_;}
+
+protected:
+
+    // The frame-add registers, indexed by phase
+    using FrameAdd = MindyReg::RegArray<MindyReg::FC_FRAME_ADD_0, MindyReg::FC_FRAME_ADD_1>;
 
     // The userspace address of Mindy's BAR 0
     unsigned char* BAR0_;
 
     // The physical address of Mindy's BAR 0;
     uint64_t       PCI0_;
+
+    // True if we're talking to a MindyEmulator rather than to the hardware
+    bool           emulated_ = false;
+    MindyEmulator* emulator_ = nullptr;
+
+    // The CMAC statistics as of the previous getLinkStats() for each link, and when
+    cmacCounters_t<uint64_t>              prevCmac_[2] = {};
+    std::chrono::steady_clock::time_point prevCmacTime_[2] = {};
+
+    // The emulator doesn't bank registers by stream, so we keep the banked registers of
+    // streams other than 0 here, indexed by register offset
+    std::map<uint32_t, uint64_t>          emulatedBank_[MAX_STREAMS];
+
+    // Cancels a configuration commit that's waiting for a frame boundary
+    void           cancelCommit();
+
+    friend class CMindyStream;
+};
+
+
+//=================================================================================================
+// CMindyStream - One of the independent streams of frames that a card can carry
+//
+// Each stream has its own pair of local frame counters, its own host frame-data and meta-data
+// buffers and its own frame-data ring, meta-data ring and frame counter on the receiver.  The
+// frame size, packet size, host buffer sizes, steering, coalescing and delta mode are shared by
+// every stream and are set through CMindy.  Scatter-gather mode applies to stream 0 only.
+//
+// The card presents the buffer and ring registers of one stream at a time, so the set...() and
+// get...() calls of every stream must be made from one thread (the same one that configures
+// CMindy).  The frame-counter calls are single register accesses and are safe from any thread,
+// so each stream can have its own producer thread.  The ID of a frame's stream is carried in
+// each of its RDMX packet headers, and can also be stamped into its metadata (see
+// CMindy::setMetadataStamping())
+//=================================================================================================
+class CMindyStream
+{
+public:
+
+    // Returns the index of this stream
+    uint32_t    index() {return index_;}
+
+    // Get and set the address of this stream's data-frame buffers on the host PC
+    void        setHostFrameDataAddr(uint32_t phase, uint32_t semiphase, uint64_t address);
+    uint64_t    getHostFrameDataAddr(uint32_t phase, uint32_t semiphase);
+
+    // Get and set the address of this stream's meta-data buffers on the host PC
+    void        setHostMetaDataAddr(uint32_t phase, uint64_t address);
+    uint64_t    getHostMetaDataAddr(uint32_t phase);
+
+    // Get and set the address and size of this stream's frame-data buffer on the receiver
+    void        setRemoteFrameDataAddr(uint64_t address);
+    uint64_t    getRemoteFrameDataAddr();
+    void        setRemoteFrameDataSize(uint64_t size);
+    uint64_t    getRemoteFrameDataSize();
+
+    // Get and set the address and size of this stream's meta-data buffer on the receiver
+    void        setRemoteMetaDataAddr(uint64_t address);
+    uint64_t    getRemoteMetaDataAddr();
+    void        setRemoteMetaDataSize(uint64_t size);
+    uint64_t    getRemoteMetaDataSize();
+
+    // Get and set the address of this stream's frame counter on the receiver
+    void        setRemoteFrameCounterAddr(uint64_t address);
+    uint64_t    getRemoteFrameCounterAddr();
+
+    // Submits "count" frames of one phase of this stream.  This is a single register write
+    // and may be called from multiple threads at once
+    void        addLocalFrameCounter(uint32_t phase, uint32_t count);
+
+    // Returns the value of one of this stream's local frame counters
+    uint32_t    getLocalFrameCounter(uint32_t phase);
+
+    // Returns the number of frames of one phase of this stream that the card has finished
+    // fetching.  All of a card's streams are reset by CMindy::clearLocalFrameCounters()
+    uint32_t    getFetchedFrameCount(uint32_t phase);
+
+    // Reads back where one phase of this stream is in its host buffers
+    CMindy::ringState_t getRingState(uint32_t phase);
+
+protected:
+
+    // Only CMindy::stream() creates these
+    CMindyStream(CMindy& mindy, uint32_t index) : mindy_(mindy), index_(index) {}
+    friend class CMindy;
+
+    // Reads or writes a register in this stream's bank
+    uint64_t    readBanked(uint32_t reg, bool wide = true);
+    void        writeBanked(uint32_t reg, uint64_t value, bool wide = true);
+
+    CMindy&     mindy_;
+    uint32_t    index_;
 };
+//=================================================================================================
 
@@ -0,0 +1,33 @@
+//=================================================================================================
+// throwRuntime.cpp - Throws a std::runtime_error with a printf-style message
+//=================================================================================================
+#include <cstdio>
+#include <cstdarg>
+#include <string>
+#include <stdexcept>
+#include "throwRuntime.h"
+using namespace std;
+
+
+//=================================================================================================
+// throwRuntime() - Throws a runtime exception
+//
+// The first vsnprintf() measures the message, and the second formats it into a string that's
+// exactly big enough
+//=================================================================================================
+void throwRuntime(const char* fmt, ...)
+{
+    va_list ap, ap2;
+    va_start(ap, fmt);
+    va_copy(ap2, ap);
+
+    int length = vsnprintf(nullptr, 0, fmt, ap);
+    va_end(ap);
+
+    string message(length > 0 ? length : 0, '\0');
+    if (length > 0) vsnprintf(message.data(), length + 1, fmt, ap2);
+    va_end(ap2);
+
+    throw runtime_error(message);
+}
+//=================================================================================================
@@ -0,0 +1,8 @@
+//=================================================================================================
+// throwRuntime.h - Throws a std::runtime_error with a printf-style message
+//=================================================================================================
+#pragma once
+
+// Formats a message the way printf() does and throws it as a std::runtime_error.  The message
+// can be any length
+[[noreturn]] void throwRuntime(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
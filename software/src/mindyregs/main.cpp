@@ -0,0 +1,197 @@
+//=================================================================================================
+// mindyregs - Generates the Verilog and shell versions of Mindy's register map
+//
+// Command line: mindyregs verilog <repo_root>
+//               mindyregs shell
+//
+// "verilog" writes <module>_regs.vh next to each module's source, "shell" writes the shell
+// constants to stdout.  Both are generated from mindy_regs.def
+//=================================================================================================
+#include <stdlib.h>
+#include <stdio.h>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct block_t
+{
+    const char* name;
+    uint32_t    base;
+    const char* module;
+    const char* directory;
+};
+
+struct reg_t
+{
+    const char* block;
+    const char* name;
+    uint32_t    index;
+    uint32_t    width;
+    const char* description;
+};
+
+// Build the tables from the register description
+static const block_t blockList[] =
+{
+    #define REGMAP_BLOCK(block, base, module, directory) {#block, base, #module, #directory},
+    #define REGMAP_REG(block, name, index, width, access, description)
+    #include "mindy_regs.def"
+    #undef REGMAP_BLOCK
+    #undef REGMAP_REG
+};
+
+static const reg_t regList[] =
+{
+    #define REGMAP_BLOCK(block, base, module, directory)
+    #define REGMAP_REG(block, name, index, width, access, description) {#block, #name, index, width, description},
+    #include "mindy_regs.def"
+    #undef REGMAP_BLOCK
+    #undef REGMAP_REG
+};
+
+static const char* GENERATED_BY = "Generated by mindyregs from software/src/mindylib/mindy_regs.def";
+
+void checkRegisterMap();
+void writeVerilog(const char* root);
+void writeShell();
+
+
+//=================================================================================================
+// main() - Execution starts here
+//=================================================================================================
+int main(int argc, const char** argv)
+{
+    checkRegisterMap();
+
+    if (argc == 3 && strcmp(argv[1], "verilog") == 0)
+    {
+        writeVerilog(argv[2]);
+        return 0;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "shell") == 0)
+    {
+        writeShell();
+        return 0;
+    }
+
+    fprintf(stderr, "Usage: mindyregs verilog <repo_root>\n");
+    fprintf(stderr, "       mindyregs shell\n");
+    exit(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// checkRegisterMap() - Makes sure no two registers in a block share an index
+//=================================================================================================
+void checkRegisterMap()
+{
+    bool ok = true;
+
+    for (auto& block : blockList)
+    {
+        vector<const char*> owner(256, nullptr);
+
+        for (auto& reg : regList)
+        {
+            if (strcmp(reg.block, block.name) != 0) continue;
+
+            uint32_t slots = reg.width / 32;
+            for (uint32_t i = reg.index; i < reg.index + slots; ++i)
+            {
+                if (i >= owner.size() || owner[i])
+                {
+                    fprintf(stderr, "%s_%s overlaps %s_%s\n", block.name, reg.name, block.name,
+                            i < owner.size() ? owner[i] : "(out of range)");
+                    ok = false;
+                }
+                else owner[i] = reg.name;
+            }
+        }
+    }
+
+    if (!ok) exit(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// writeVerilog() - Writes a file of localparams for each block
+//=================================================================================================
+void writeVerilog(const char* root)
+{
+    for (auto& block : blockList)
+    {
+        string filename = string(root) + "/" + block.directory + "/" + block.module + "_regs.vh";
+
+        FILE* ofile = fopen(filename.c_str(), "w");
+        if (ofile == nullptr)
+        {
+            fprintf(stderr, "Can't create %s\n", filename.c_str());
+            exit(1);
+        }
+
+        fprintf(ofile, "// %s_regs.vh - AXI register map of %s\n", block.module, block.module);
+        fprintf(ofile, "// %s - don't edit by hand\n", GENERATED_BY);
+
+        for (auto& reg : regList)
+        {
+            if (strcmp(reg.block, block.name) != 0) continue;
+
+            if (reg.width == 32)
+                fprintf(ofile, "localparam %-24s = %2u;  // %s\n",
+                        ("REG_" + string(reg.name)).c_str(), reg.index, reg.description);
+            else
+            {
+                fprintf(ofile, "localparam %-24s = %2u;  // %s\n",
+                        ("REG_" + string(reg.name) + "_H").c_str(), reg.index, reg.description);
+                fprintf(ofile, "localparam %-24s = %2u;\n",
+                        ("REG_" + string(reg.name) + "_L").c_str(), reg.index + 1);
+            }
+        }
+
+        fclose(ofile);
+        printf("Wrote %s\n", filename.c_str());
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// writeShell() - Writes shell constants for every register to stdout
+//=================================================================================================
+void writeShell()
+{
+    printf("#==============================================================================\n");
+    printf("# AXI register definitions\n");
+    printf("#\n");
+    printf("# %s - don't edit by hand\n", GENERATED_BY);
+    printf("#==============================================================================\n");
+
+    for (auto& block : blockList)
+    {
+        printf("\n# %s\n", block.module);
+        printf("%s_BASE=0x%04X\n", block.name, block.base);
+
+        for (auto& reg : regList)
+        {
+            if (strcmp(reg.block, block.name) != 0) continue;
+
+            string name = string("REG_") + block.name + "_" + reg.name;
+            uint32_t address = block.base + reg.index * 4;
+
+            if (reg.width == 32)
+                printf("%28s=0x%04X\n", name.c_str(), address);
+            else
+            {
+                printf("%28s=0x%04X\n", (name + "_H").c_str(), address);
+                printf("%28s=0x%04X\n", (name + "_L").c_str(), address + 4);
+            }
+        }
+    }
+}
+//=================================================================================================
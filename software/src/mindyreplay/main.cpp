@@ -0,0 +1,459 @@
+//=================================================================================================
+// mindyreplay - Plays recorded frames through Mindy from disk, and records received frames
+//
+// Command line: mindyreplay [switches] <command> <recording>
+//
+// Commands:
+//   replay  Streams the recording through the card and reports disk and wire throughput
+//           [-device <vendor:device> | -emulate [-ring <frames>]] [-map <file> -phys <addr>]
+//           [-depth <frames>] [-batch <frames>] [-loops <n>]
+//   record  Records frames arriving at a receiver
+//           -map <file> -frame <bytes> -frames <n> -fd <offset>:<bytes> -md <offset>:<bytes>
+//           -fc <offset> [-phase <p>] [-depth <frames>]
+//   synth   Writes a recording of test-pattern frames (see FrameCopy.h), alternating phases
+//           -frame <bytes> -frames <n>
+//
+// The host buffers (for "replay") and the receiver's buffers (for "record") are reached
+// through "-map", a file that maps the physical memory they live in, such as a hugetlbfs file
+// backing the reserved DMA region.  For "replay", "-phys" is the physical address of the start
+// of that file, and each buffer is found from the address the card has been configured with.
+// For "record", the offsets are relative to the start of the file.
+//
+// With "-emulate", the card is emulated (see MindyEmulator.h), configured to the recording's
+// frame size with host buffers of "-ring" frames each, and the buffers are ordinary memory.
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include "mindy.h"
+#include "MindyEmulator.h"
+#include "FrameReplay.h"
+#include "FrameCopy.h"
+#include "throwRuntime.h"
+
+using namespace std;
+
+CMindy Mindy;
+
+// The card, when we're running against an emulated one
+MindyEmulator Emulator;
+
+// Command line options
+string   device    = "10EE:903F";
+bool     emulate   = false;
+string   mapFile;
+uint64_t physAddr  = 0;
+uint32_t ringSize  = 16;
+uint32_t frameSize = 0;
+uint64_t frames    = 0;
+uint32_t phase     = 0;
+uint64_t fdOffset  = 0, fdBytes = 0;
+uint64_t mdOffset  = 0, mdBytes = 0;
+uint64_t fcOffset  = 0;
+bool     haveFc    = false;
+FrameReplayer::config_t replayConfig;
+FrameRecorder::config_t recordConfig;
+
+void execute(const string& command, const string& filename);
+void parseCommandLine(const char** argv, vector<string>& args);
+
+
+//=================================================================================================
+// main() - Execution starts here
+//=================================================================================================
+int main(int argc, const char** argv)
+{
+    vector<string> args;
+
+    parseCommandLine(argv, args);
+
+    try
+    {
+        execute(args[0], args[1]);
+    }
+    catch(const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        exit(1);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// showUsage() - Displays the command-line syntax and exits
+//=================================================================================================
+void showUsage()
+{
+    fprintf(stderr, "Usage: mindyreplay [switches] <command> <recording>\n");
+    fprintf(stderr, "  replay [-device <vendor:device> | -emulate [-ring <frames>]] [-map <file> -phys <addr>]\n");
+    fprintf(stderr, "         [-depth <frames>] [-batch <frames>] [-loops <n>]\n");
+    fprintf(stderr, "  record -map <file> -frame <bytes> -frames <n> -fd <offset>:<bytes> -md <offset>:<bytes>\n");
+    fprintf(stderr, "         -fc <offset> [-phase <p>] [-depth <frames>]\n");
+    fprintf(stderr, "  synth  -frame <bytes> -frames <n>\n");
+    exit(1);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseRange() - Parses "<offset>:<bytes>"
+//=================================================================================================
+static void parseRange(const char* arg, uint64_t* offset, uint64_t* bytes)
+{
+    char* end;
+    *offset = strtoull(arg, &end, 0);
+    if (*end != ':')
+    {
+        fprintf(stderr, "Expected <offset>:<bytes>, not %s\n", arg);
+        exit(1);
+    }
+    *bytes = strtoull(end + 1, nullptr, 0);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// parseCommandLine() - Parses the command line looking for switches.  Everything that isn't
+//                      a switch is returned in "args"
+//=================================================================================================
+void parseCommandLine(const char** argv, vector<string>& args)
+{
+    while (*++argv)
+    {
+        const char* arg = *argv;
+
+        if (strcmp(arg, "-device") == 0 && argv[1])
+        {
+            device = *++argv;
+            continue;
+        }
+
+        if (strcmp(arg, "-emulate") == 0)
+        {
+            emulate = true;
+            continue;
+        }
+
+        if (strcmp(arg, "-map") == 0 && argv[1])
+        {
+            mapFile = *++argv;
+            continue;
+        }
+
+        if (strcmp(arg, "-phys") == 0 && argv[1])
+        {
+            physAddr = strtoull(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-ring") == 0 && argv[1])
+        {
+            ringSize = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-depth") == 0 && argv[1])
+        {
+            replayConfig.depth = recordConfig.depth = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-batch") == 0 && argv[1])
+        {
+            replayConfig.batch = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-loops") == 0 && argv[1])
+        {
+            replayConfig.loops = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-frame") == 0 && argv[1])
+        {
+            frameSize = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-frames") == 0 && argv[1])
+        {
+            frames = strtoull(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-phase") == 0 && argv[1])
+        {
+            phase = strtoul(*++argv, nullptr, 0);
+            continue;
+        }
+
+        if (strcmp(arg, "-fd") == 0 && argv[1])
+        {
+            parseRange(*++argv, &fdOffset, &fdBytes);
+            continue;
+        }
+
+        if (strcmp(arg, "-md") == 0 && argv[1])
+        {
+            parseRange(*++argv, &mdOffset, &mdBytes);
+            continue;
+        }
+
+        if (strcmp(arg, "-fc") == 0 && argv[1])
+        {
+            fcOffset = strtoull(*++argv, nullptr, 0);
+            haveFc   = true;
+            continue;
+        }
+
+        if (arg[0] == '-' && arg[1] != 0)
+        {
+            fprintf(stderr, "Unknown command line switch %s\n", arg);
+            exit(1);
+        }
+
+        args.push_back(arg);
+    }
+
+    if (args.size() != 2) showUsage();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// mapMemory() - Maps "-map" into our address space and returns its address and size
+//=================================================================================================
+static uint8_t* mapMemory(uint64_t* size)
+{
+    if (mapFile.empty()) throwRuntime("-map is required");
+
+    int fd = open(mapFile.c_str(), O_RDWR);
+    if (fd < 0) throwRuntime("Can't open %s: %s", mapFile.c_str(), strerror(errno));
+
+    struct stat sb;
+    fstat(fd, &sb);
+    *size = sb.st_size;
+
+    void* ptr = mmap(0, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) throwRuntime("Can't map %s: %s", mapFile.c_str(), strerror(errno));
+
+    return (uint8_t*)ptr;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// readRecordingHeader() - Returns the header of a recording
+//=================================================================================================
+static recordingHeader_t readRecordingHeader(const string& filename)
+{
+    recordingHeader_t header;
+
+    FILE* ifile = fopen(filename.c_str(), "r");
+    if (ifile == nullptr) throwRuntime("Can't open %s", filename.c_str());
+    bool ok = fread(&header, sizeof header, 1, ifile) == 1;
+    fclose(ifile);
+
+    if (!ok || memcmp(header.magic, RECORDING_MAGIC, sizeof header.magic))
+        throwRuntime("%s isn't a recording", filename.c_str());
+
+    return header;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// emulatedBuffers() - Starts an emulated card, configures it for the recording, and returns
+//                     host buffers made of ordinary memory
+//=================================================================================================
+static FrameReplayer::buffers_t emulatedBuffers(const string& filename)
+{
+    recordingHeader_t header = readRecordingHeader(filename);
+    uint64_t semiphase = header.frameSize / 2;
+
+    Emulator.start();
+    Mindy.initEmulated(Emulator);
+    Mindy.setFrameSize(header.frameSize);
+    Mindy.setPacketSize(4096);
+    Mindy.setPacketsPerGroup(1);
+    Mindy.setHostFrameDataSize(ringSize * semiphase);
+    Mindy.setHostMetaDataSize(ringSize * 128);
+    Mindy.clearLocalFrameCounters();
+
+    // These are never freed: they're in use until the program exits
+    FrameReplayer::buffers_t buffers;
+    for (int p = 0; p < 2; ++p)
+    {
+        for (int sp = 0; sp < 2; ++sp)
+        {
+            buffers.hfd[p][sp] = (uint8_t*)aligned_alloc(RECORD_ALIGN, ringSize * semiphase);
+            if (buffers.hfd[p][sp] == nullptr) throwRuntime("Out of memory");
+        }
+        buffers.hmd[p] = (uint8_t*)aligned_alloc(RECORD_ALIGN, ringSize * 128);
+    }
+
+    // Give the emulated card a moment to come out of reset
+    this_thread::sleep_for(chrono::milliseconds(2));
+    return buffers;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// mappedBuffers() - Connects to the card and finds its host buffers in "-map"
+//=================================================================================================
+static FrameReplayer::buffers_t mappedBuffers()
+{
+    Mindy.init(device);
+
+    uint64_t size;
+    uint8_t* base = mapMemory(&size);
+
+    // Returns the userspace address of a buffer that the card knows by its physical address
+    auto locate = [&](uint64_t address, uint64_t bytes, const char* name)
+    {
+        if (address < physAddr || address + bytes > physAddr + size)
+            throwRuntime("The %s buffer (0x%lx) isn't inside %s", name, address, mapFile.c_str());
+        return base + (address - physAddr);
+    };
+
+    uint64_t hfdBytes = Mindy.getHostFrameDataSize();
+    uint64_t hmdBytes = Mindy.getHostMetaDataSize();
+
+    FrameReplayer::buffers_t buffers;
+    for (uint32_t p = 0; p < 2; ++p)
+    {
+        for (uint32_t sp = 0; sp < 2; ++sp)
+            buffers.hfd[p][sp] = locate(Mindy.getHostFrameDataAddr(p, sp), hfdBytes, "frame-data");
+        buffers.hmd[p] = locate(Mindy.getHostMetaDataAddr(p), hmdBytes, "meta-data");
+    }
+
+    return buffers;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// replay() - Plays a recording through the card and reports the throughput
+//=================================================================================================
+void replay(const string& filename)
+{
+    FrameReplayer::buffers_t buffers = emulate ? emulatedBuffers(filename) : mappedBuffers();
+
+    FrameReplayer replayer(Mindy);
+    auto stats = replayer.replay(filename, buffers, replayConfig);
+
+    printf("Frames     : %lu in %.3f seconds (%lu doorbells, %lu waits for the card)\n",
+           stats.frames, stats.seconds, stats.doorbells, stats.cardStalls);
+    printf("Disk       : %.2f GB/s%s\n", stats.diskGBps, stats.direct ? "" : " (through the page cache)");
+    printf("Wire       : %.2f GB/s\n", stats.wireGBps);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// record() - Records the frames arriving at a receiver
+//=================================================================================================
+void record(const string& filename)
+{
+    if (frameSize == 0 || frames == 0 || fdBytes == 0 || mdBytes == 0 || !haveFc) showUsage();
+
+    uint64_t size;
+    uint8_t* base = mapMemory(&size);
+
+    if (fdOffset + fdBytes > size || mdOffset + mdBytes > size || fcOffset + 4 > size)
+        throwRuntime("The receiver's buffers aren't all inside %s", mapFile.c_str());
+
+    FrameRecorder::source_t source;
+    source.frameData      = base + fdOffset;
+    source.frameDataBytes = fdBytes;
+    source.metaData       = base + mdOffset;
+    source.metaDataBytes  = mdBytes;
+    source.frameCounter   = (volatile uint32_t*)(base + fcOffset);
+
+    recordConfig.frameSize = frameSize;
+    recordConfig.frames    = frames;
+    recordConfig.phase     = phase;
+
+    FrameRecorder recorder;
+    auto stats = recorder.record(filename, source, recordConfig);
+
+    printf("Frames     : %lu in %.3f seconds\n", stats.frames, stats.seconds);
+    printf("Disk       : %.2f GB/s%s\n", stats.diskGBps, stats.direct ? "" : " (through the page cache)");
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// synth() - Writes a recording of test-pattern frames
+//=================================================================================================
+void synth(const string& filename)
+{
+    if (frameSize == 0 || frames == 0) showUsage();
+    if ((frameSize / 2) % RECORD_ALIGN) throwRuntime("-frame must be a multiple of %u", 2 * RECORD_ALIGN);
+
+    FILE* ofile = fopen(filename.c_str(), "w");
+    if (ofile == nullptr) throwRuntime("Can't create %s", filename.c_str());
+
+    // fillPattern() needs 64-byte aligned buffers
+    vector<uint8_t> block(RECORD_ALIGN);
+    uint8_t* frame = (uint8_t*)aligned_alloc(RECORD_ALIGN, frameSize);
+    if (frame == nullptr) throwRuntime("Out of memory");
+
+    recordingHeader_t header;
+    memcpy(header.magic, RECORDING_MAGIC, sizeof header.magic);
+    header.version    = RECORDING_VERSION;
+    header.frameSize  = frameSize;
+    header.frameCount = frames;
+    memcpy(block.data(), &header, sizeof header);
+    fwrite(block.data(), RECORD_ALIGN, 1, ofile);
+
+    uint32_t half = frameSize / 2;
+    for (uint64_t i = 0; i < frames; ++i)
+    {
+        // Frames alternate between the phases, and each phase numbers its own frames
+        uint32_t       p  = i & 1;
+        frameHeader_t* fh = (frameHeader_t*)block.data();
+        memset(block.data(), 0, RECORD_ALIGN);
+        fh->phase    = p;
+        fh->sequence = i;
+        memcpy(fh->metadata, &i, sizeof i);
+
+        fillPattern(frame, frame + half, half, i / 2, p);
+
+        fwrite(block.data(), RECORD_ALIGN, 1, ofile);
+        if (fwrite(frame, frameSize, 1, ofile) != 1) throwRuntime("Can't write %s", filename.c_str());
+    }
+
+    fclose(ofile);
+    free(frame);
+    printf("Wrote %lu frames of %u bytes to %s\n", frames, frameSize, filename.c_str());
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// execute() - Carries out the command
+//=================================================================================================
+void execute(const string& command, const string& filename)
+{
+    if      (command == "replay") replay(filename);
+    else if (command == "record") record(filename);
+    else if (command == "synth")  synth(filename);
+    else showUsage();
+}
+//=================================================================================================
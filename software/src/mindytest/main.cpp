@@ -6,12 +6,21 @@
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <errno.h>
+#include <time.h>
 #include "mindy.h"
+#include "RuntimeProfile.h"
 
 
 using namespace std;
 
 CMindy Mindy;
+RuntimeProfile Profile;
+
+// SCHED_FIFO priority of the producer, 0 = don't run it real-time
+uint32_t rtPriority = 0;
+
+// The submission latency is printed every this many frames, 0 = never
+uint32_t reportEvery = 10000;
 
 void execute();
 void parseCommandLine(const char** argv);
@@ -40,32 +49,30 @@ int main(int argc, const char** argv)
 //=================================================================================================
 // parseCommandLine() - Parses the command line looking for switches
 //
-// On Exit: if "-ecd"  switch was used, "loadEcdFPGA" is 'true'
-//          If "-ecdm" switch was used, "loadMasterFPGA" is 'true'
+// On Exit: if "-rt <priority>" was used, "rtPriority" is the SCHED_FIFO priority
+//          if "-report <frames>" was used, "reportEvery" is how often latency is printed
 //=================================================================================================
 void parseCommandLine(const char** argv)
 {
-/*
     while (*++argv)
     {
         const char* arg = *argv;
 
-        if (strcmp(arg, "-ecd") == 0)
+        if (strcmp(arg, "-rt") == 0 && argv[1])
         {
-            loadEcdFPGA = true;
+            rtPriority = strtoul(*++argv, nullptr, 0);
             continue;
         }        
 
-        if (strcmp(arg, "-ecdm") == 0)
+        if (strcmp(arg, "-report") == 0 && argv[1])
         {
-            loadMasterFPGA = true;
+            reportEvery = strtoul(*++argv, nullptr, 0);
             continue;
         }        
 
         cerr << "Unknown command line switch " << arg << "\n";
         exit(1);
     }    
-*/
 }
 //=================================================================================================
 
@@ -86,13 +93,23 @@ void execute()
     string versionStr = Mindy.getRtlBuildStr();
     printf("RTL Build: %s\n", versionStr.c_str());
 
-    // Ensure that both QSFP cables are connected
-    if (Mindy.getQsfpStatus() != 3)
+    // With both QSFP cables connected, ping-pong normally.  With only one, let the
+    // ping-ponger steer everything onto the link that's up
+    uint32_t qsfpStatus = Mindy.getQsfpStatus();
+    if (qsfpStatus == 0)
     {
-        printf("One or both QSFP cables are disconnected.\n");
+        printf("Both QSFP cables are disconnected.\n");
         exit(1);        
     }
 
+    if (qsfpStatus == 3)
+        Mindy.setSteeringPolicy(CMindy::STEER_ALTERNATE);
+    else
+    {
+        printf("QSFP_%d is disconnected, running on a single link\n", qsfpStatus == 1 ? 1 : 0);
+        Mindy.setSteeringPolicy(CMindy::STEER_ADAPTIVE);
+    }
+
     Mindy.setHostAbmAddr(0x100000000LL);
 
     Mindy.setHostFrameDataAddr(0,0,0x100000000LL);
@@ -132,13 +149,44 @@ void execute()
     Mindy.clearLocalFrameCounters();
 
 
+    // Lock our memory, and pin ourselves to a CPU near the card
+    RuntimeProfile::config_t rtConfig;
+    rtConfig.priority = rtPriority;
+    Profile.setup(rtConfig);
+    Profile.enterRealtime();
+    Profile.report(stdout);
+
     // Do nothing for a few milliseconds
     usleep(100000);
 
+    // Submit a frame every 350us, measuring how late each doorbell is
+    LatencyHistogram lateness;
+    timespec deadline, now;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
     for (int i=0; i<1000000000; i++)
     {
+        deadline.tv_nsec += 350000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr);
+
         Mindy.incrementLocalFrameCounter(0);
-        usleep(350);
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t late = (now.tv_sec - deadline.tv_sec) * 1000000000LL + (now.tv_nsec - deadline.tv_nsec);
+        lateness.record(late > 0 ? late : 0);
+
+        if (reportEvery && lateness.count() == reportEvery)
+        {
+            printf("Submission latency (us): p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                   lateness.percentile(50) / 1000.0, lateness.percentile(99) / 1000.0,
+                   lateness.percentile(99.9) / 1000.0, lateness.max() / 1000.0);
+            lateness.reset();
+        }
     }
 
     printf("Done!\n");
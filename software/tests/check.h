@@ -0,0 +1,83 @@
+//=================================================================================================
+// check.h - A minimal harness for the behaviour tests that ctest runs
+//=================================================================================================
+#pragma once
+#include <cstdio>
+#include <exception>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+
+/*
+    Each test program is a list of test functions:
+
+        static void testSomething()
+        {
+            CHECK(buffer != nullptr);
+            CHECK_EQ(count, 42u);
+        }
+
+        int main() {return runTests({{"something", testSomething}});}
+
+    A failed check prints where it was and what it saw, and the test carries on.  An exception
+    ends the test and counts as a failure.  The exit code is the number of tests that failed,
+    which is what ctest looks at.  A program that can't run in this environment (no io_uring,
+    say) returns SKIP_TEST instead, which CMakeLists.txt tells ctest is a skip.
+*/
+
+// The exit code for "this test can't run here"
+const int SKIP_TEST = 77;
+
+// The number of checks that have failed in the current test
+inline int checkFailures = 0;
+
+// Reports a failed check
+inline void checkFailed(const char* file, int line, const std::string& what)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what.c_str());
+    ++checkFailures;
+}
+
+// Compares two values, and reports both if they differ
+template <class A, class B>
+void checkEqual(const A& a, const B& b, const char* aText, const char* bText, const char* file, int line)
+{
+    if (a == b) return;
+    std::ostringstream what;
+    what << aText << " == " << bText << " (" << a << " vs " << b << ")";
+    checkFailed(file, line, what.str());
+}
+
+#define CHECK(cond)     do {if (!(cond)) checkFailed(__FILE__, __LINE__, #cond);} while (0)
+#define CHECK_EQ(a, b)  checkEqual((a), (b), #a, #b, __FILE__, __LINE__)
+
+// One named test
+struct test_t
+{
+    const char* name;
+    void        (*function)();
+};
+
+// Runs each test in turn, and returns the number that failed
+inline int runTests(std::initializer_list<test_t> tests)
+{
+    int failed = 0;
+
+    for (auto& test : tests)
+    {
+        checkFailures = 0;
+        try
+        {
+            test.function();
+        }
+        catch (std::exception& ex)
+        {
+            checkFailed(test.name, 0, std::string("exception: ") + ex.what());
+        }
+
+        printf("%s %s\n", checkFailures ? "FAIL" : "pass", test.name);
+        if (checkFailures) ++failed;
+    }
+
+    return failed;
+}
@@ -0,0 +1,237 @@
+//=================================================================================================
+// test_capacity.cpp - Behaviour tests for CapacityModel's predictions
+//=================================================================================================
+#include <cmath>
+#include <stdexcept>
+#include "CapacityModel.h"
+#include "check.h"
+using namespace std;
+
+
+//=================================================================================================
+// stage() - Returns the named stage of a prediction, or nullptr if it isn't there
+//=================================================================================================
+static const CapacityModel::stage_t* stage(const CapacityModel::result_t& result, const string& name)
+{
+    for (auto& stage : result.stages) if (stage.name == name) return &stage;
+    return nullptr;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// near() - Returns true if two numbers agree to within a part in a million
+//=================================================================================================
+static bool near(double a, double b)
+{
+    return fabs(a - b) <= 1e-6 * max(fabs(a), fabs(b));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testBottleneck() - The slowest stage is named as the bottleneck, and sets the maximum rate
+//=================================================================================================
+static void testBottleneck()
+{
+    CapacityModel::config_t config;
+
+    // A slow host makes the PCIe read the bottleneck
+    CapacityModel::params_t slowHost;
+    slowHost.pcieGBps = 1;
+    auto result = CapacityModel(slowHost).predict(config);
+    CHECK_EQ(result.bottleneck, "PCIe read");
+
+    // Slow links with a fast host make a link the bottleneck
+    CapacityModel::params_t slowLinks;
+    slowLinks.pcieGBps = 100;
+    slowLinks.linkGbps = 10;
+    result = CapacityModel(slowLinks).predict(config);
+    CHECK(result.bottleneck == "link 0" || result.bottleneck == "link 1");
+
+    // With weighted steering the heavier link is the one that runs out first
+    config.policy         = CMindy::STEER_WEIGHTED;
+    config.linkWeights[0] = 1;
+    config.linkWeights[1] = 3;
+    result = CapacityModel(slowLinks).predict(config);
+    CHECK_EQ(result.bottleneck, "link 1");
+    CHECK(stage(result, "link 1")->secondsPerFrame > 2.5 * stage(result, "link 0")->secondsPerFrame);
+
+    // Whatever the bottleneck, the maximum rate is the reciprocal of the slowest stage
+    double slowest = 0;
+    for (auto& stage : result.stages) slowest = max(slowest, stage.secondsPerFrame);
+    CHECK(near(result.maxFramesPerSec, 1 / slowest));
+    CHECK(near(result.maxGBps, result.maxFramesPerSec * config.frameSize / 1e9));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testLinks() - A link that isn't used has no stages, and one that carries everything takes
+//               about twice as long as one that carries half
+//=================================================================================================
+static void testLinks()
+{
+    CapacityModel model;
+    CapacityModel::config_t config;
+    config.policy = CMindy::STEER_ADAPTIVE;
+
+    auto both = model.predict(config);
+    CHECK(stage(both, "link 0") && stage(both, "link 1"));
+
+    config.links = 2;
+    auto one = model.predict(config);
+    CHECK(stage(one, "link 0") == nullptr);
+    CHECK(stage(one, "rdmx_shim 0") == nullptr);
+    CHECK(stage(one, "link 1") != nullptr);
+
+    double ratio = stage(one, "link 1")->secondsPerFrame / stage(both, "link 1")->secondsPerFrame;
+    CHECK(ratio > 1.9 && ratio <= 2.0);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testTarget() - A target rate fits only if it's below the maximum, and each stage's
+//                utilization is its share of the time between frames
+//=================================================================================================
+static void testTarget()
+{
+    CapacityModel model;
+    CapacityModel::config_t config;
+
+    double maximum = model.predict(config).maxFramesPerSec;
+
+    auto under = model.predict(config, maximum * 0.9);
+    CHECK(under.fits);
+    CHECK_EQ(under.targetFramesPerSec, maximum * 0.9);
+    for (auto& stage : under.stages)
+    {
+        CHECK(near(stage.utilization, stage.secondsPerFrame * maximum * 0.9));
+        CHECK(stage.utilization < 1);
+    }
+    CHECK(near(stage(under, under.bottleneck)->utilization, 0.9));
+
+    auto over = model.predict(config, maximum * 1.1);
+    CHECK(!over.fits);
+    CHECK(stage(over, over.bottleneck)->utilization > 1);
+
+    // Without a target, nothing is utilized
+    auto none = model.predict(config);
+    CHECK_EQ(none.targetFramesPerSec, 0.0);
+    for (auto& stage : none.stages) CHECK_EQ(stage.utilization, 0.0);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testDelta() - In delta mode, only the changed packets are fetched and sent, but at least one
+//=================================================================================================
+static void testDelta()
+{
+    CapacityModel::params_t params;
+    params.pcieGBps = 1;
+    CapacityModel model(params);
+
+    CapacityModel::config_t config;
+    config.frameSize  = 1024 * 1024;
+    config.packetSize = 4096;
+    config.policy     = CMindy::STEER_ADAPTIVE;
+    double full = model.predict(config).maxFramesPerSec;
+
+    config.deltaMode  = true;
+    config.deltaDirty = 1.0;
+    CHECK(near(model.predict(config).maxFramesPerSec, full));
+
+    config.deltaDirty = 0.25;
+    double quarter = model.predict(config).maxFramesPerSec;
+    CHECK(quarter > 3 * full);
+
+    config.deltaDirty = 0;
+    CHECK(model.predict(config).maxFramesPerSec > quarter);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testImpliedBandwidth() - The bandwidth worked back from the rate the PCIe read allows is the
+//                          bandwidth the prediction was made with
+//=================================================================================================
+static void testImpliedBandwidth()
+{
+    for (double burstOverheadNs : {0.0, 40.0})
+    {
+        CapacityModel::params_t params;
+        params.pcieGBps        = 7.5;
+        params.burstOverheadNs = burstOverheadNs;
+        CapacityModel model(params);
+
+        CapacityModel::config_t config;
+        auto result = model.predict(config);
+        CHECK_EQ(result.bottleneck, "PCIe read");
+        CHECK(near(model.impliedPcieGBps(config, result.maxFramesPerSec), 7.5));
+
+        // impliedPcieGBps() leaves the parameters as they were
+        CHECK_EQ(model.params().pcieGBps, 7.5);
+
+        // A rate faster than the fixed costs allow implies no bandwidth at all
+        CHECK_EQ(model.impliedPcieGBps(config, 1e7), 0.0);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testInvalid() - Configurations the card couldn't run are refused
+//=================================================================================================
+static void testInvalid()
+{
+    auto refused = [](void (*change)(CapacityModel::config_t&))
+    {
+        CapacityModel::config_t config;
+        change(config);
+        try {CapacityModel().predict(config);} catch (exception&) {return true;}
+        return false;
+    };
+
+    CHECK(!refused([](CapacityModel::config_t&) {}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.frameSize  = 3 * 1024 * 1024;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.frameSize  = 2048;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.packetSize = 100;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.packetSize = 0;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.packetSize = 32768;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.frameSize  = 4096; c.packetSize = 3072;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.links = 1;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.packetsPerGroup = 0;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.packetsPerGroup = 3;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.deltaMode = true;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.policy = CMindy::STEER_ADAPTIVE; c.links = 0;}));
+    CHECK(refused([](CapacityModel::config_t& c) {c.policy = CMindy::STEER_WEIGHTED; c.linkWeights[0] = 0; c.links = 1;}));
+    CHECK(refused([](CapacityModel::config_t& c)
+    {
+        c.policy = CMindy::STEER_ADAPTIVE; c.deltaMode = true; c.frameSize = 4 * 1024 * 1024; c.packetSize = 4096;
+    }));
+
+    bool threw = false;
+    try {CapacityModel().impliedPcieGBps(CapacityModel::config_t(), 0);} catch (exception&) {threw = true;}
+    CHECK(threw);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests
+//=================================================================================================
+int main()
+{
+    return runTests(
+    {
+        {"bottleneck",          testBottleneck},
+        {"links",               testLinks},
+        {"target",              testTarget},
+        {"delta",               testDelta},
+        {"implied bandwidth",   testImpliedBandwidth},
+        {"invalid",             testInvalid},
+    });
+}
+//=================================================================================================
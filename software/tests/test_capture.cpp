@@ -0,0 +1,445 @@
+//=================================================================================================
+// test_capture.cpp - Behaviour tests for PcapReader, decodeRdmx() and RdmxAnalyzer, against
+//                    synthetic captures
+//=================================================================================================
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "RdmxCapture.h"
+#include "check.h"
+using namespace std;
+
+typedef vector<uint8_t> bytes_t;
+
+
+//=================================================================================================
+// rdmxPacket() - Builds an RDMX packet the way rdmx_xmit does, optionally with an 802.1Q tag.
+//                The payload is "payload" if it's given, and zeros otherwise
+//=================================================================================================
+static bytes_t rdmxPacket(uint8_t mac, uint64_t address, uint32_t payloadLen, uint8_t stream = 0,
+                          bool vlan = false, const void* payload = nullptr)
+{
+    bytes_t p;
+    auto be = [&](uint64_t value, int bytes) {while (bytes--) p.push_back(value >> (8 * bytes));};
+
+    be(0x02AABBCCDD00 | 0xEE, 6);                       // Destination MAC
+    be(0x020011223300 | mac, 6);                        // Source MAC
+    if (vlan) be(0x81000064, 4);                        // 802.1Q, VLAN 100
+    be(0x0800, 2);
+
+    be(0x45, 1); be(0, 1); be(20 + 8 + 22 + payloadLen, 2);
+    be(0, 4); be(64, 1); be(17, 1); be(0, 2);
+    be(0x0A000000 | mac, 4); be(0x0A0000FE, 4);
+
+    be(0xC000 | mac, 2); be(0x1234, 2); be(8 + 22 + payloadLen, 2); be(0, 2);
+
+    be(RDMX_MAGIC, 2); be(address, 8); be(stream, 1); be(0, 11);
+
+    size_t start = p.size();
+    p.resize(start + payloadLen);
+    if (payload) memcpy(&p[start], payload, payloadLen);
+    return p;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// capture_t - Builds a capture file in either byte order
+//=================================================================================================
+struct capture_t
+{
+    bytes_t bytes;
+    bool    swapped = false;
+
+    void put16(uint16_t value) {put(swapped ? __builtin_bswap16(value) : value);}
+    void put32(uint32_t value) {put(swapped ? __builtin_bswap32(value) : value);}
+
+    template <class T> void put(T value)
+    {
+        bytes.insert(bytes.end(), (uint8_t*)&value, (uint8_t*)&value + sizeof value);
+    }
+
+    void putBytes(const bytes_t& data, bool pad = false)
+    {
+        bytes.insert(bytes.end(), data.begin(), data.end());
+        if (pad) bytes.resize((bytes.size() + 3) & ~3);
+    }
+
+    // Writes the capture to a file and opens it.  The file is deleted at once; the mapping
+    // keeps it alive until the reader is closed
+    void open(PcapReader& reader)
+    {
+        char name[] = "/tmp/test_captureXXXXXX";
+        int fd = mkstemp(name);
+        if (fd < 0) throw runtime_error("Can't create a temporary file");
+        bool written = write(fd, bytes.data(), bytes.size()) == (ssize_t)bytes.size();
+        close(fd);
+
+        try
+        {
+            if (!written) throw runtime_error("Can't write a temporary file");
+            reader.open(name);
+        }
+        catch (...)
+        {
+            unlink(name);
+            throw;
+        }
+        unlink(name);
+    }
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// pcapng_t - Builds a pcapng capture a block at a time
+//=================================================================================================
+struct pcapng_t : capture_t
+{
+    // Starts a section, whose byte order is "swapped"
+    void section()
+    {
+        capture_t body;
+        body.swapped = swapped;
+        body.put32(0x1A2B3C4D);
+        body.put16(1);
+        body.put16(0);
+        body.put32(0xFFFFFFFF);
+        body.put32(0xFFFFFFFF);
+        block(0x0A0D0D0A, body.bytes);
+    }
+
+    // Adds an interface, with an if_tsresol option if "tsresol" isn't 0
+    void interface(uint16_t linkType, uint8_t tsresol = 0)
+    {
+        capture_t body;
+        body.swapped = swapped;
+        body.put16(linkType);
+        body.put16(0);
+        body.put32(65535);
+        if (tsresol)
+        {
+            body.put16(9);
+            body.put16(1);
+            body.putBytes({tsresol}, true);
+        }
+        body.put16(0);
+        body.put16(0);
+        block(1, body.bytes);
+    }
+
+    // Adds an enhanced packet block.  "capLen" is the length it claims, if it isn't 0
+    void epb(uint32_t iface, uint64_t units, const bytes_t& data, uint32_t capLen = 0)
+    {
+        capture_t body;
+        body.swapped = swapped;
+        body.put32(iface);
+        body.put32(units >> 32);
+        body.put32(units);
+        body.put32(capLen ? capLen : data.size());
+        body.put32(data.size());
+        body.putBytes(data, true);
+        block(6, body.bytes);
+    }
+
+    // Adds a simple packet block
+    void spb(const bytes_t& data)
+    {
+        capture_t body;
+        body.swapped = swapped;
+        body.put32(data.size());
+        body.putBytes(data, true);
+        block(3, body.bytes);
+    }
+
+    void block(uint32_t type, const bytes_t& body)
+    {
+        uint32_t length = 12 + body.size();
+        put32(type);
+        put32(length);
+        putBytes(body);
+        put32(length);
+    }
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// testDecode() - The fields of an RDMX packet are decoded, with or without a VLAN tag, and
+//                packets that aren't RDMX are refused
+//=================================================================================================
+static void testDecode()
+{
+    for (bool vlan : {false, true})
+    {
+        bytes_t p = rdmxPacket(7, 0x123456789ABCDEF0, 1000, 3, vlan);
+        rdmxPacket_t rdmx;
+        CHECK(decodeRdmx(p.data(), p.size(), rdmx));
+        CHECK_EQ(rdmx.srcMac[5], 7);
+        CHECK_EQ(rdmx.dstMac[5], 0xEE);
+        CHECK_EQ(rdmx.srcIp, 0x0A000007u);
+        CHECK_EQ(rdmx.dstIp, 0x0A0000FEu);
+        CHECK_EQ(rdmx.srcPort, 0xC007);
+        CHECK_EQ(rdmx.dstPort, 0x1234);
+        CHECK_EQ(rdmx.address, 0x123456789ABCDEF0ull);
+        CHECK_EQ(rdmx.stream, 3);
+        CHECK_EQ(rdmx.payloadLen, 1000u);
+        CHECK_EQ(rdmx.payloadOffset, RDMX_HEADER_BYTES + (vlan ? 4 : 0));
+
+        // The headers alone are enough
+        CHECK(decodeRdmx(p.data(), RDMX_HEADER_BYTES, rdmx));
+        CHECK_EQ(rdmx.payloadLen, 1000u);
+
+        // But a packet cut off before the stream ID isn't
+        CHECK(!decodeRdmx(p.data(), 52 + (vlan ? 4 : 0), rdmx));
+    }
+
+    rdmxPacket_t rdmx;
+    bytes_t p = rdmxPacket(1, 0, 64);
+
+    bytes_t arp = p;
+    arp[12] = 0x08; arp[13] = 0x06;
+    CHECK(!decodeRdmx(arp.data(), arp.size(), rdmx));
+
+    bytes_t tcp = p;
+    tcp[14 + 9] = 6;
+    CHECK(!decodeRdmx(tcp.data(), tcp.size(), rdmx));
+
+    bytes_t notRdmx = p;
+    notRdmx[42] = 0x12;
+    CHECK(!decodeRdmx(notRdmx.data(), notRdmx.size(), rdmx));
+
+    CHECK(!decodeRdmx(p.data(), 13, rdmx));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testPcap() - pcap in either byte order, with microsecond or nanosecond timestamps, and a
+//              record cut short by the end of the file ends the capture
+//=================================================================================================
+static void testPcap()
+{
+    vector<bytes_t> packets = {rdmxPacket(1, 0x1000, 1024), rdmxPacket(2, 0x2000, 128),
+                               rdmxPacket(1, 0x3000, 4)};
+
+    for (bool swapped : {false, true})
+    for (bool nanos : {false, true})
+    {
+        capture_t capture;
+        capture.swapped = swapped;
+        capture.put32(nanos ? 0xA1B23C4D : 0xA1B2C3D4);
+        capture.put16(2);
+        capture.put16(4);
+        capture.put32(0);
+        capture.put32(0);
+        capture.put32(65535);
+        capture.put32(1);
+
+        for (uint32_t i = 0; i < packets.size(); ++i)
+        {
+            capture.put32(1700000000 + i);
+            capture.put32(123 + i);
+            capture.put32(packets[i].size());
+            capture.put32(packets[i].size() + 4);
+            capture.putBytes(packets[i]);
+        }
+
+        // A record whose packet the file ends in the middle of
+        capture.put32(1800000000);
+        capture.put32(0);
+        capture.put32(1000);
+        capture.put32(1000);
+        capture.putBytes(bytes_t(10));
+
+        PcapReader reader;
+        capture.open(reader);
+        CHECK_EQ(string(reader.format()), "pcap");
+
+        capturedPacket_t packet;
+        for (uint32_t i = 0; i < packets.size(); ++i)
+        {
+            CHECK(reader.next(packet));
+            CHECK_EQ(packet.ns, (1700000000ull + i) * 1000000000 + (123 + i) * (nanos ? 1 : 1000));
+            CHECK_EQ(packet.capLen, packets[i].size());
+            CHECK_EQ(packet.wireLen, packets[i].size() + 4);
+            CHECK_EQ(packet.iface, 0u);
+            CHECK(memcmp(packet.data, packets[i].data(), packets[i].size()) == 0);
+        }
+        CHECK(!reader.next(packet));
+        CHECK(!reader.next(packet));
+    }
+
+    // A capture of something other than Ethernet is refused
+    capture_t raw;
+    raw.put32(0xA1B2C3D4);
+    raw.putBytes(bytes_t(16));
+    raw.put32(101);
+    PcapReader reader;
+    bool threw = false;
+    try {raw.open(reader);} catch (exception&) {threw = true;}
+    CHECK(threw);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testPcapng() - pcapng with several interfaces and their timestamp resolutions, enhanced and
+//                simple packet blocks, sections in both byte orders, and the packets that are
+//                skipped: those on an interface that isn't Ethernet, and those whose captured
+//                length is more than the block holds, however large it is
+//=================================================================================================
+static void testPcapng()
+{
+    bytes_t a = rdmxPacket(1, 0x1000, 1024);
+    bytes_t b = rdmxPacket(2, 0x2000, 130);     // Not a multiple of 4, so the block is padded
+    bytes_t c = rdmxPacket(3, 0x3000, 4);
+
+    pcapng_t capture;
+    capture.section();
+    capture.interface(1);                   // Microseconds, the default
+    capture.interface(1, 9);                // Nanoseconds
+    capture.interface(101);                 // Raw IP, which is skipped
+    capture.interface(1, 0x80 | 20);        // 2^-20 seconds
+
+    capture.epb(0, 1500000000123456ull, a);
+    capture.epb(1, 1234567890123456789ull, b);
+    capture.epb(2, 1, c);
+    capture.epb(3, (3ull << 20) | (1 << 19), c);
+    capture.spb(b);
+    capture.epb(0, 1, a, 0xFFFFFFF0);       // A captured length that would wrap around
+    capture.epb(0, 1, a, a.size() + 4);     // One that's just past the end of the block
+    capture.epb(7, 1, a);                   // An interface that doesn't exist
+
+    // A new section in the other byte order, with interfaces of its own
+    capture.swapped = true;
+    capture.section();
+    capture.interface(1, 3);                // Milliseconds
+    capture.epb(0, 42, c);
+
+    // And a block that the file ends in the middle of
+    capture.swapped = false;
+    size_t end = capture.bytes.size();
+    capture.epb(0, 1, a);
+    capture.bytes.resize(end + 40);
+
+    PcapReader reader;
+    capture.open(reader);
+    CHECK_EQ(string(reader.format()), "pcapng");
+
+    struct expected_t {const bytes_t& data; uint64_t ns; uint32_t iface;};
+    vector<expected_t> expected =
+    {
+        {a, 1500000000123456000ull, 0},
+        {b, 1234567890123456789ull, 1},
+        {c, 3500000000ull,          3},
+        {b, 0,                      0},
+        {c, 42000000ull,            0},
+    };
+
+    capturedPacket_t packet;
+    for (auto& e : expected)
+    {
+        CHECK(reader.next(packet));
+        CHECK_EQ(packet.ns, e.ns);
+        CHECK_EQ(packet.iface, e.iface);
+        CHECK_EQ(packet.capLen, e.data.size());
+        CHECK_EQ(packet.wireLen, e.data.size());
+        CHECK(memcmp(packet.data, e.data.data(), e.data.size()) == 0);
+    }
+    CHECK(!reader.next(packet));
+    CHECK_EQ(reader.skipped(), 4u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testAnalyzer() - Frames sent half on each link are put back together and numbered by their
+//                  frame counters, and a frame that lost a packet is short
+//=================================================================================================
+static void testAnalyzer()
+{
+    const uint32_t PACKET = 1024, FRAMES = 3, FIRST = 10;
+
+    for (bool lose : {false, true})
+    {
+        vector<bytes_t> packets;
+        vector<uint32_t> ifaces;
+        for (uint32_t frame = 0; frame < FRAMES; ++frame)
+        {
+            for (uint8_t link = 1; link <= 2; ++link)
+            {
+                uint64_t base = 0x100000000ull + frame * 4 * PACKET + (link - 1) * 2 * PACKET;
+                for (uint32_t p = 0; p < 2; ++p)
+                {
+                    if (lose && frame == 1 && link == 2 && p == 1) continue;
+                    packets.push_back(rdmxPacket(link, base + p * PACKET, PACKET));
+                }
+
+                uint32_t count = FIRST + frame;
+                packets.push_back(rdmxPacket(link, 0x200000000ull + frame * 128, 128));
+                packets.push_back(rdmxPacket(link, 0x300000000ull, 4, 0, link == 2, &count));
+            }
+        }
+
+        // Something that isn't RDMX at all
+        packets.push_back(bytes_t(60, 0));
+
+        RdmxAnalyzer analyzer;
+        analyzer.setFrameSize(4 * PACKET);
+
+        uint64_t ns = 1000;
+        for (auto& data : packets)
+        {
+            capturedPacket_t packet = {ns += 100, data.data(), (uint32_t)data.size(), (uint32_t)data.size(), 0};
+            analyzer.add(packet);
+        }
+        analyzer.finish();
+
+        CHECK_EQ(analyzer.otherPackets(), 1u);
+        CHECK_EQ(analyzer.links().size(), (size_t)2);
+        for (auto& link : analyzer.links())
+        {
+            CHECK_EQ(link.kindPackets[RdmxAnalyzer::META_DATA], FRAMES);
+            CHECK_EQ(link.kindPackets[RdmxAnalyzer::FRAME_COUNTER], FRAMES);
+            CHECK_EQ(link.reordered, 0u);
+            CHECK_EQ(link.mdSkips, 0u);
+            CHECK_EQ(link.fcJumps, 0u);
+        }
+
+        auto& frames = analyzer.frames();
+        CHECK_EQ(frames.size(), (size_t)FRAMES);
+        for (uint32_t i = 0; i < frames.size() && i < FRAMES; ++i)
+        {
+            bool short_ = lose && i == 1;
+            CHECK_EQ(frames[i].number, FIRST + i);
+            CHECK_EQ(frames[i].links, 3u);
+            CHECK_EQ(frames[i].packets, short_ ? 3u : 4u);
+            CHECK_EQ(frames[i].bytes, (short_ ? 3u : 4u) * PACKET);
+            CHECK(frames[i].firstFdNs < frames[i].lastFdNs && frames[i].lastFdNs < frames[i].mdNs);
+
+            // Link 1 sends its frame counter before link 2 has sent its meta-data
+            CHECK(frames[i].fcNs > frames[i].firstFdNs && frames[i].fcNs < frames[i].mdNs);
+        }
+        CHECK_EQ(analyzer.shortFrames(), lose ? 1u : 0u);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests
+//=================================================================================================
+int main()
+{
+    return runTests(
+    {
+        {"decode",              testDecode},
+        {"pcap",                testPcap},
+        {"pcapng",              testPcapng},
+        {"analyzer",            testAnalyzer},
+    });
+}
+//=================================================================================================
@@ -0,0 +1,209 @@
+//=================================================================================================
+// test_delta.cpp - Behaviour tests for DeltaEncoder's bitmaps and applyDelta()
+//=================================================================================================
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "FrameDelta.h"
+#include "FrameIntegrity.h"
+#include "check.h"
+using namespace std;
+
+
+//=================================================================================================
+// A frame being encoded: its data, contiguous, and its metadata record
+//=================================================================================================
+struct frame_t
+{
+    vector<uint8_t> data;
+    uint8_t         metadata[METADATA_RECORD_BYTES] = {};
+
+    frame_t(size_t bytes, uint32_t seed) : data(bytes)
+    {
+        mt19937 rng(seed);
+        for (auto& byte : data) byte = (uint8_t)rng();
+    }
+
+    uint32_t encode(DeltaEncoder& encoder, uint32_t phase)
+    {
+        return encoder.encode(phase, metadata, data.data(), data.data() + data.size() / 2);
+    }
+
+    // Returns the packets flagged in the bitmap
+    vector<uint32_t> flagged(uint32_t packets)
+    {
+        vector<uint32_t> result;
+        for (uint32_t packet = 0; packet < packets; ++packet)
+            if (DeltaEncoder::isDirty(metadata, packet)) result.push_back(packet);
+        return result;
+    }
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// testChanges() - The first frame is sent in full, an unchanged one as packet 0 alone, and
+//                 otherwise exactly the packets that changed, however small the change and
+//                 wherever it is in the packet.  Packet sizes that aren't a multiple of the
+//                 vector width exercise the tails of the comparisons
+//=================================================================================================
+static void testChanges()
+{
+    for (size_t packetBytes : {64, 192, 4096})
+    {
+        const uint32_t PACKETS = 16;
+        DeltaEncoder encoder;
+        encoder.setup(PACKETS * packetBytes, packetBytes);
+        frame_t frame(PACKETS * packetBytes, 1);
+
+        CHECK_EQ(frame.encode(encoder, 0), PACKETS);
+        CHECK_EQ(frame.flagged(PACKETS).size(), (size_t)PACKETS);
+
+        CHECK_EQ(frame.encode(encoder, 0), 1u);
+        CHECK(frame.flagged(PACKETS) == vector<uint32_t>{0});
+
+        // The first byte of packet 3 and the last byte of packet 12, in the other semiphase
+        frame.data[3 * packetBytes] ^= 0x01;
+        frame.data[13 * packetBytes - 1] ^= 0x80;
+        CHECK_EQ(frame.encode(encoder, 0), 2u);
+        CHECK((frame.flagged(PACKETS) == vector<uint32_t>{3, 12}));
+
+        // The changes have been remembered
+        CHECK_EQ(frame.encode(encoder, 0), 1u);
+
+        CHECK_EQ(encoder.packetsEncoded(), 4ull * PACKETS);
+        CHECK_EQ(encoder.packetsFlagged(), PACKETS + 4ull);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testPhases() - Each phase is compared with the previous frame of its own phase, and reset()
+//                makes the next frame of each be sent in full
+//=================================================================================================
+static void testPhases()
+{
+    const size_t PACKET = 1024, PACKETS = 32;
+    DeltaEncoder encoder;
+    encoder.setup(PACKETS * PACKET, PACKET);
+
+    frame_t a(PACKETS * PACKET, 1), b(PACKETS * PACKET, 2);
+    CHECK_EQ(a.encode(encoder, 0), PACKETS);
+    CHECK_EQ(b.encode(encoder, 1), PACKETS);
+    CHECK_EQ(a.encode(encoder, 0), 1u);
+    CHECK_EQ(b.encode(encoder, 1), 1u);
+
+    // Frame "b" on phase 0 differs from "a" everywhere
+    CHECK_EQ(b.encode(encoder, 0), PACKETS);
+
+    encoder.reset();
+    CHECK_EQ(b.encode(encoder, 0), PACKETS);
+    CHECK_EQ(b.encode(encoder, 1), PACKETS);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testMetadata() - Only the bitmap in the first 64 bytes of the metadata record is written
+//=================================================================================================
+static void testMetadata()
+{
+    DeltaEncoder encoder;
+    encoder.setup(8192, 512);
+    frame_t frame(8192, 3);
+    memset(frame.metadata, 0xEE, sizeof frame.metadata);
+
+    frame.encode(encoder, 0);
+    for (size_t i = DELTA_BITMAP_BYTES; i < METADATA_RECORD_BYTES; ++i) CHECK_EQ(frame.metadata[i], 0xEE);
+
+    // 16 packets set the first two bytes of the bitmap, and no more
+    CHECK_EQ(frame.metadata[0], 0xFF);
+    CHECK_EQ(frame.metadata[1], 0xFF);
+    CHECK_EQ(frame.metadata[2], 0);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testApplyDelta() - A receiver that applies each delta to its own copy ends up with the frame
+//                    the sender encoded, even though the unflagged packets of the slot the
+//                    frame landed in hold something else
+//=================================================================================================
+static void testApplyDelta()
+{
+    const size_t PACKET = 256, PACKETS = 64, BYTES = PACKET * PACKETS;
+    DeltaEncoder encoder;
+    encoder.setup(BYTES, PACKET);
+
+    frame_t sender(BYTES, 4);
+    vector<uint8_t> copy(BYTES, 0);
+    mt19937 rng(5);
+
+    for (int round = 0; round < 20; ++round)
+    {
+        // Change a few packets, except in the first round, which is sent in full anyway
+        if (round)
+            for (int i = 0; i < 5; ++i) sender.data[rng() % BYTES] = (uint8_t)rng();
+
+        sender.encode(encoder, 0);
+
+        // The ring slot holds the changed packets, and garbage everywhere else
+        vector<uint8_t> slot(BYTES);
+        for (auto& byte : slot) byte = (uint8_t)rng();
+        for (uint32_t packet = 0; packet < PACKETS; ++packet)
+            if (DeltaEncoder::isDirty(sender.metadata, packet))
+                memcpy(&slot[packet * PACKET], &sender.data[packet * PACKET], PACKET);
+
+        DeltaEncoder::applyDelta(copy.data(), slot.data(), sender.metadata, BYTES, PACKET);
+        CHECK(copy == sender.data);
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testSetup() - Sizes the card can't send in delta mode are refused
+//=================================================================================================
+static void testSetup()
+{
+    auto refused = [](size_t frameBytes, size_t packetBytes)
+    {
+        DeltaEncoder encoder;
+        try {encoder.setup(frameBytes, packetBytes);} catch (exception&) {return true;}
+        return false;
+    };
+
+    CHECK(refused(65536, 100));         // Not a multiple of 64
+    CHECK(refused(65536, 0));
+    CHECK(refused(3 * 1024, 1024));     // A semiphase isn't a whole number of packets
+    CHECK(refused(1024 * 64, 64));      // More than 512 packets
+    CHECK(!refused(512 * 64, 64));
+
+    DeltaEncoder unset;
+    uint8_t metadata[METADATA_RECORD_BYTES];
+    bool threw = false;
+    try {unset.encode(0, metadata, metadata, metadata);} catch (exception&) {threw = true;}
+    CHECK(threw);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests
+//=================================================================================================
+int main()
+{
+    printf("DeltaEncoder is using %s\n", DeltaEncoder::impl());
+
+    return runTests(
+    {
+        {"changes",             testChanges},
+        {"phases",              testPhases},
+        {"metadata",            testMetadata},
+        {"apply delta",         testApplyDelta},
+        {"setup",               testSetup},
+    });
+}
+//=================================================================================================
@@ -0,0 +1,253 @@
+//=================================================================================================
+// test_emulator.cpp - Behaviour tests for CMindy running against MindyEmulator
+//=================================================================================================
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mindy.h"
+#include "MindyEmulator.h"
+#include "check.h"
+using namespace std;
+
+MindyEmulator Emulator;
+CMindy        Mindy;
+
+// The configuration the tests run with: 64K frames of 16 packets, and room for 16 frames of
+// each phase in the host buffers
+const uint32_t FRAME_SIZE  = 0x10000;
+const uint32_t PACKET_SIZE = 4096;
+const uint32_t RING_FRAMES = 16;
+
+
+//=================================================================================================
+// waitFor() - Waits up to 5 seconds for a condition to come true.  Returns false if it doesn't
+//=================================================================================================
+template <class F> static bool waitFor(F condition)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (chrono::steady_clock::now() < deadline)
+    {
+        if (condition()) return true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// restart() - Puts the emulated card back into its power-on state, configures it, and waits
+//             until it has taken the reset
+//=================================================================================================
+static void restart()
+{
+    Emulator.start();
+    Mindy.initEmulated(Emulator);
+    Mindy.setFrameSize(FRAME_SIZE);
+    Mindy.setPacketSize(PACKET_SIZE);
+    Mindy.setPacketsPerGroup(1);
+    Mindy.setHostFrameDataSize(RING_FRAMES * FRAME_SIZE / 2);
+    Mindy.setHostMetaDataSize(RING_FRAMES * 128);
+    Mindy.clearLocalFrameCounters();
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testFramesFlow() - Submitted frames are fetched and sent, and the ring offsets advance the
+//                    way data_fetch advances them, wrapping at the end of the host buffers
+//=================================================================================================
+static void testFramesFlow()
+{
+    restart();
+
+    const uint32_t FRAMES = RING_FRAMES + 4;
+    Mindy.addLocalFrameCounter(0, FRAMES);
+    Mindy.addLocalFrameCounter(1, 3);
+
+    CHECK(waitFor([]() {return Mindy.getFetchedFrameCount(0) == FRAMES
+                            && Mindy.getFetchedFrameCount(1) == 3;}));
+
+    auto state = Mindy.getRingState(0);
+    CHECK_EQ(state.submitted, FRAMES);
+    CHECK_EQ(state.fetched, FRAMES);
+    CHECK_EQ(state.inFlight, 0u);
+    CHECK_EQ(state.nextHfdOffset, 4ull * FRAME_SIZE / 2);
+    CHECK_EQ(state.nextHmdOffset, 4ull * 128);
+
+    // Every packet of every frame went out on one link or the other
+    uint64_t packets = Mindy.getLinkStats(0).packets + Mindy.getLinkStats(1).packets;
+    CHECK_EQ(packets, (FRAMES + 3ull) * (FRAME_SIZE / PACKET_SIZE));
+
+    // Each frame writes the frame counter on both links
+    CHECK_EQ(Mindy.getFrameCounterStats().updates, 2ull * (FRAMES + 3));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testNoLinks() - Like the card, the emulator stops fetching while it has no usable link, and
+//                 carries on where it left off when one comes back
+//=================================================================================================
+static void testNoLinks()
+{
+    restart();
+
+    Emulator.setLinksUp(0);
+    Mindy.addLocalFrameCounter(0, 5);
+    this_thread::sleep_for(chrono::milliseconds(50));
+    CHECK_EQ(Mindy.getFetchedFrameCount(0), 0u);
+    CHECK_EQ(Mindy.getQsfpStatus(), 0u);
+
+    Emulator.setLinksUp(3);
+    CHECK(waitFor([]() {return Mindy.getFetchedFrameCount(0) == 5;}));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testClearCounters() - Clearing the frame counters resets both phases and the data path
+//=================================================================================================
+static void testClearCounters()
+{
+    restart();
+
+    Mindy.addLocalFrameCounter(0, 3);
+    Mindy.addLocalFrameCounter(1, 2);
+    CHECK(waitFor([]() {return Mindy.getFetchedFrameCount(1) == 2;}));
+
+    Mindy.clearLocalFrameCounters();
+    CHECK(waitFor([]() {return Mindy.getLocalFrameCounter(1) == 0 && Mindy.getFetchedFrameCount(0) == 0;}));
+    CHECK_EQ(Mindy.getRingState(0).nextHfdOffset, 0u);
+    CHECK_EQ(Mindy.getLinkStats(0).packets + Mindy.getLinkStats(1).packets, 0u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testIncrement() - incrementLocalFrameCounter() counts the frame it submits, from any number of
+//                   threads at once, and no frame is lost
+//=================================================================================================
+static void testIncrement()
+{
+    restart();
+
+    const uint32_t THREADS = 4, EACH = 500;
+    vector<thread> threads;
+    atomic<uint32_t> badReturns {0};
+
+    for (uint32_t t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&badReturns]()
+        {
+            uint32_t previous = 0;
+            for (uint32_t i = 0; i < EACH; ++i)
+            {
+                uint32_t count = Mindy.incrementLocalFrameCounter(1);
+                if (count <= previous) ++badReturns;
+                previous = count;
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    CHECK_EQ(badReturns.load(), 0u);
+    CHECK_EQ(Mindy.getLocalFrameCounter(1), THREADS * EACH);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testErrorStatus() - Clearing the latched errors that were read leaves alone one that latched
+//                     after the read
+//=================================================================================================
+static void testErrorStatus()
+{
+    restart();
+    CHECK_EQ(Mindy.getErrorStatus(), 0u);
+
+    Emulator.latchError(CMindy::ERR_FC_OVERFLOW);
+    uint32_t errors = Mindy.getErrorStatus();
+    CHECK_EQ(errors, (uint32_t)CMindy::ERR_FC_OVERFLOW);
+
+    // Another error latches between the read and the clear
+    Emulator.latchError(2);
+    Mindy.clearErrorStatus(errors);
+    CHECK_EQ(Mindy.getErrorStatus(), 2u);
+
+    Mindy.clearErrorStatus(0);
+    CHECK_EQ(Mindy.getErrorStatus(), 2u);
+
+    Mindy.clearErrorStatus();
+    CHECK_EQ(Mindy.getErrorStatus(), 0u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testCommitConfig() - A commit restarts the rings at offset 0 and says so, and the frames after
+//                      it use the new configuration
+//=================================================================================================
+static void testCommitConfig()
+{
+    restart();
+
+    Mindy.addLocalFrameCounter(0, 5);
+    CHECK(waitFor([]() {return Mindy.getFetchedFrameCount(0) == 5;}));
+    CHECK_EQ(Mindy.getRingState(0).nextHfdOffset, 5ull * FRAME_SIZE / 2);
+
+    CMindy::ringState_t state[2];
+    Mindy.beginConfig();
+    Mindy.setFrameSize(2 * FRAME_SIZE);
+    Mindy.commitConfig(1000, state);
+
+    CHECK_EQ(state[0].submitted, 5u);
+    CHECK_EQ(state[0].nextHfdOffset, 0u);
+    CHECK_EQ(state[0].nextHmdOffset, 0u);
+    CHECK_EQ(state[1].nextHfdOffset, 0u);
+
+    Mindy.addLocalFrameCounter(0, 2);
+    CHECK(waitFor([]() {return Mindy.getFetchedFrameCount(0) == 7;}));
+    CHECK_EQ(Mindy.getRingState(0).nextHfdOffset, 2ull * FRAME_SIZE);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testCancelCommit() - A commit that never reaches a frame boundary is cancelled, and says so
+//=================================================================================================
+static void testCancelCommit()
+{
+    restart();
+
+    // With the emulated card stopped, nothing will ever take the commit
+    Emulator.stop();
+    Mindy.beginConfig();
+    Mindy.setFrameSize(2 * FRAME_SIZE);
+
+    string error;
+    try {Mindy.commitConfig(20);} catch (exception& ex) {error = ex.what();}
+    CHECK(error.find("cancelled") != string::npos);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests
+//=================================================================================================
+int main()
+{
+    return runTests(
+    {
+        {"frames flow",         testFramesFlow},
+        {"no links",            testNoLinks},
+        {"clear counters",      testClearCounters},
+        {"increment",           testIncrement},
+        {"error status",        testErrorStatus},
+        {"commit config",       testCommitConfig},
+        {"cancel commit",       testCancelCommit},
+    });
+}
+//=================================================================================================
@@ -0,0 +1,236 @@
+//=================================================================================================
+// test_integrity.cpp - Behaviour tests for crc32c and for FrameStamper/FrameVerifier
+//=================================================================================================
+#include <cstring>
+#include <random>
+#include <vector>
+#include "crc32c.h"
+#include "FrameIntegrity.h"
+#include "check.h"
+using namespace std;
+
+// The size of each semiphase of the test frames
+const size_t SEMIPHASE = 4096 + 192;
+
+
+//=================================================================================================
+// randomBytes() - Returns a buffer of pseudo-random bytes that's the same on every run
+//=================================================================================================
+static vector<uint8_t> randomBytes(size_t length, uint32_t seed)
+{
+    mt19937 rng(seed);
+    vector<uint8_t> buffer(length);
+    for (auto& byte : buffer) byte = (uint8_t)rng();
+    return buffer;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testCrcKnownValues() - The check value and other published CRC-32C results
+//=================================================================================================
+static void testCrcKnownValues()
+{
+    uint8_t zeros[32], ones[32];
+    memset(zeros, 0x00, sizeof zeros);
+    memset(ones,  0xFF, sizeof ones);
+
+    // From the CRC catalogue and RFC 3720, appendix B.4
+    CHECK_EQ(crc32c("123456789", 9), 0xE3069283u);
+    CHECK_EQ(crc32c(zeros, 32), 0x8A9136AAu);
+    CHECK_EQ(crc32c(ones, 32), 0x62A8AB43u);
+    CHECK_EQ(crc32c(zeros, 0), 0u);
+
+    CHECK_EQ(crc32cSoftware("123456789", 9), 0xE3069283u);
+    CHECK_EQ(crc32cSoftware(ones, 32), 0x62A8AB43u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testCrcImplementations() - The hardware and table-driven versions agree at every length and
+//                            alignment, including the lengths where the three-stream version
+//                            changes strategy, and pieces can be chained or combined
+//=================================================================================================
+static void testCrcImplementations()
+{
+    auto data = randomBytes(70000, 1);
+
+    for (size_t offset = 0; offset < 8; ++offset)
+    {
+        for (size_t length : {1, 7, 8, 63, 64, 255, 256, 1023, 1024, 3 * 1024 + 5, 8191, 65536})
+        {
+            uint32_t expected = crc32cSoftware(data.data() + offset, length);
+            CHECK_EQ(crc32c(data.data() + offset, length), expected);
+
+            // The same data in two pieces, chained and combined
+            size_t   split = length / 3;
+            uint32_t crcA  = crc32c(data.data() + offset, split);
+            uint32_t crcB  = crc32c(data.data() + offset + split, length - split);
+            CHECK_EQ(crc32c(data.data() + offset + split, length - split, crcA), expected);
+            CHECK_EQ(crc32cCombine(crcA, crcB, length - split), expected);
+        }
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// A frame with its metadata record, stamped and ready to verify
+//=================================================================================================
+struct frame_t
+{
+    vector<uint8_t> data;
+    uint8_t         metadata[METADATA_RECORD_BYTES];
+
+    frame_t(uint32_t seed) : data(randomBytes(2 * SEMIPHASE, seed))
+    {
+        auto md = randomBytes(METADATA_RECORD_BYTES, seed + 1000);
+        memcpy(metadata, md.data(), sizeof metadata);
+    }
+
+    void stamp(FrameStamper& stamper, uint32_t phase)
+    {
+        stamper.stamp(phase, metadata, data.data(), data.data() + SEMIPHASE, SEMIPHASE);
+    }
+
+    FrameVerifier::result_t verify(FrameVerifier& verifier, uint32_t phase)
+    {
+        return verifier.verify(phase, metadata, data.data(), data.size());
+    }
+};
+//=================================================================================================
+
+
+//=================================================================================================
+// testIntactFrames() - Frames that arrive intact and in order verify, on each phase separately,
+//                      and the timestamp that metadata stamping writes doesn't matter
+//=================================================================================================
+static void testIntactFrames()
+{
+    FrameStamper  stamper;
+    FrameVerifier verifier;
+
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        frame_t frame(i);
+        frame.stamp(stamper, i & 1);
+        memset(frame.metadata + METADATA_STAMP_OFFSET, 0xA5, 8);
+        CHECK_EQ(frame.verify(verifier, i & 1), FrameVerifier::FRAME_OK);
+    }
+
+    CHECK_EQ(verifier.getCounts(0).framesOk, 5u);
+    CHECK_EQ(verifier.getCounts(1).framesOk, 5u);
+    CHECK_EQ(verifier.getErrorCount(0) + verifier.getErrorCount(1), 0u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testPieces() - A frame received in pieces verifies the same as a contiguous one
+//=================================================================================================
+static void testPieces()
+{
+    FrameStamper  stamper;
+    FrameVerifier verifier;
+    frame_t       frame(7);
+    frame.stamp(stamper, 0);
+
+    const void* pieces[3]  = {frame.data.data(), frame.data.data() + 100, frame.data.data() + 5000};
+    size_t      lengths[3] = {100, 4900, frame.data.size() - 5000};
+    CHECK_EQ(verifier.verify(0, frame.metadata, pieces, lengths, 3), FrameVerifier::FRAME_OK);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testCorruption() - Each kind of damage is reported as what it is
+//=================================================================================================
+static void testCorruption()
+{
+    FrameStamper  stamper;
+    FrameVerifier verifier;
+
+    // A flipped bit of frame data
+    frame_t bad(1);
+    bad.stamp(stamper, 0);
+    bad.data[SEMIPHASE + 17] ^= 0x10;
+    CHECK_EQ(bad.verify(verifier, 0), FrameVerifier::FRAME_CRC);
+
+    // A flipped bit in the part of the metadata the application owns
+    frame_t badMd(2);
+    badMd.stamp(stamper, 0);
+    badMd.metadata[50] ^= 0x01;
+    CHECK_EQ(badMd.verify(verifier, 0), FrameVerifier::METADATA_CRC);
+
+    // A metadata record that was never stamped
+    frame_t unstamped(3);
+    memset(unstamped.metadata + INTEGRITY_TRAILER_OFFSET, 0, 16);
+    CHECK_EQ(unstamped.verify(verifier, 0), FrameVerifier::BAD_MAGIC);
+
+    auto counts = verifier.getCounts(0);
+    CHECK_EQ(counts.frameCrc, 1u);
+    CHECK_EQ(counts.metadataCrc, 1u);
+    CHECK_EQ(counts.badMagic, 1u);
+    CHECK_EQ(verifier.getErrorCount(0), 3u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testSequenceGaps() - Missing frames are counted, and verification picks up after them.  The
+//                      frame after a damaged one isn't a gap
+//=================================================================================================
+static void testSequenceGaps()
+{
+    FrameStamper  stamper;
+    FrameVerifier verifier;
+    vector<frame_t> frames;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        frames.emplace_back(i);
+        frames.back().stamp(stamper, 0);
+    }
+
+    CHECK_EQ(frames[0].verify(verifier, 0), FrameVerifier::FRAME_OK);
+    CHECK_EQ(frames[3].verify(verifier, 0), FrameVerifier::SEQUENCE_GAP);
+    CHECK_EQ(frames[4].verify(verifier, 0), FrameVerifier::FRAME_OK);
+
+    frames[5].data[0] ^= 1;
+    CHECK_EQ(frames[5].verify(verifier, 0), FrameVerifier::FRAME_CRC);
+    CHECK_EQ(frames[6].verify(verifier, 0), FrameVerifier::FRAME_OK);
+
+    auto counts = verifier.getCounts(0);
+    CHECK_EQ(counts.sequenceGaps, 1u);
+    CHECK_EQ(counts.framesMissing, 2u);
+    CHECK_EQ(counts.framesOk, 3u);
+
+    // After a reset, both ends start over at 1
+    verifier.reset();
+    stamper.reset();
+    frame_t first(100);
+    first.stamp(stamper, 0);
+    CHECK_EQ(first.verify(verifier, 0), FrameVerifier::FRAME_OK);
+    CHECK_EQ(verifier.getCounts(0).framesOk, 1u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests
+//=================================================================================================
+int main()
+{
+    printf("crc32c is using the %s implementation\n", crc32cIsHardware() ? "SSE4.2" : "table-driven");
+
+    return runTests(
+    {
+        {"crc known values",     testCrcKnownValues},
+        {"crc implementations",  testCrcImplementations},
+        {"intact frames",        testIntactFrames},
+        {"frame in pieces",      testPieces},
+        {"corruption",           testCorruption},
+        {"sequence gaps",        testSequenceGaps},
+    });
+}
+//=================================================================================================
@@ -0,0 +1,171 @@
+//=================================================================================================
+// test_ioring.cpp - Behaviour tests for IoRing, against a temporary file
+//=================================================================================================
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "IoRing.h"
+#include "check.h"
+using namespace std;
+
+// The size of each request, and the number of them the tests make
+const uint32_t BLOCK  = 4096;
+const uint32_t BLOCKS = 64;
+
+
+//=================================================================================================
+// tempFile() - Creates an empty file that's deleted when it's closed
+//=================================================================================================
+static int tempFile()
+{
+    char name[] = "/tmp/test_ioringXXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0) throw runtime_error("Can't create a temporary file");
+    unlink(name);
+    return fd;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// reapAll() - Reaps completions until none are in flight, recording each result by "userData"
+//=================================================================================================
+static void reapAll(IoRing& ring, vector<int32_t>& results)
+{
+    while (ring.inFlight())
+    {
+        uint64_t userData;
+        int32_t  result;
+        ring.submit(1);
+        while (ring.reap(&userData, &result))
+        {
+            if (userData < results.size()) results[userData] = result;
+        }
+    }
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testRoundTrip() - Blocks written at explicit offsets, out of order and in more requests than
+//                   the ring holds at once, read back intact
+//=================================================================================================
+static void testRoundTrip()
+{
+    int fd = tempFile();
+    IoRing ring;
+    ring.open(8);
+
+    vector<uint8_t> out(BLOCK * BLOCKS), in(BLOCK * BLOCKS, 0);
+    for (size_t i = 0; i < out.size(); ++i) out[i] = (uint8_t)(i * 7 + i / BLOCK);
+
+    // Write the blocks in reverse order, eight at a time
+    vector<int32_t> results(BLOCKS, -1);
+    for (uint32_t i = 0; i < BLOCKS; ++i)
+    {
+        uint32_t block = BLOCKS - 1 - i;
+        ring.prepWrite(fd, &out[block * BLOCK], BLOCK, (uint64_t)block * BLOCK, block);
+        if (ring.inFlight() == 8) reapAll(ring, results);
+    }
+    reapAll(ring, results);
+    for (uint32_t i = 0; i < BLOCKS; ++i) CHECK_EQ(results[i], (int32_t)BLOCK);
+
+    // Read them back in order
+    results.assign(BLOCKS, -1);
+    for (uint32_t block = 0; block < BLOCKS; ++block)
+    {
+        ring.prepRead(fd, &in[block * BLOCK], BLOCK, (uint64_t)block * BLOCK, block);
+        if (ring.inFlight() == 8) reapAll(ring, results);
+    }
+    reapAll(ring, results);
+    for (uint32_t i = 0; i < BLOCKS; ++i) CHECK_EQ(results[i], (int32_t)BLOCK);
+
+    CHECK(in == out);
+    CHECK_EQ(ring.inFlight(), 0u);
+    close(fd);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testResults() - Short reads and errors come back as the result of the request they belong to
+//=================================================================================================
+static void testResults()
+{
+    int fd = tempFile();
+    IoRing ring;
+    ring.open(4);
+
+    vector<uint8_t> buffer(BLOCK, 0x5A);
+    vector<int32_t> results(3, 1);
+
+    ring.prepWrite(fd, buffer.data(), 100, 0, 0);
+    reapAll(ring, results);
+    CHECK_EQ(results[0], 100);
+
+    // A read that runs off the end of the file, one that starts past it, and one from a
+    // file descriptor that isn't open
+    ring.prepRead(fd, buffer.data(), BLOCK, 0, 0);
+    ring.prepRead(fd, buffer.data(), BLOCK, 10 * BLOCK, 1);
+    ring.prepRead(-1, buffer.data(), BLOCK, 0, 2);
+    reapAll(ring, results);
+    CHECK_EQ(results[0], 100);
+    CHECK_EQ(results[1], 0);
+    CHECK_EQ(results[2], -EBADF);
+    close(fd);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testLimits() - Queueing more requests than the ring holds is refused, not overwritten
+//=================================================================================================
+static void testLimits()
+{
+    int fd = tempFile();
+    IoRing ring;
+    ring.open(4);
+
+    uint8_t buffer[64] = {};
+    for (int i = 0; i < 4; ++i) ring.prepWrite(fd, buffer, sizeof buffer, i * sizeof buffer, i);
+
+    bool threw = false;
+    try {ring.prepWrite(fd, buffer, sizeof buffer, 0, 99);} catch (exception&) {threw = true;}
+    CHECK(threw);
+
+    vector<int32_t> results(4, -1);
+    reapAll(ring, results);
+    for (int i = 0; i < 4; ++i) CHECK_EQ(results[i], (int32_t)sizeof buffer);
+    close(fd);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests, or skips them where io_uring isn't available (old kernels, and
+//          containers that block it)
+//=================================================================================================
+int main()
+{
+    try
+    {
+        IoRing probe;
+        probe.open(4);
+    }
+    catch (exception& ex)
+    {
+        printf("Skipping: %s\n", ex.what());
+        return SKIP_TEST;
+    }
+
+    return runTests(
+    {
+        {"round trip",          testRoundTrip},
+        {"results",             testResults},
+        {"limits",              testLimits},
+    });
+}
+//=================================================================================================
@@ -0,0 +1,240 @@
+//=================================================================================================
+// test_mindyd.cpp - Behaviour tests for the mindyd ring protocol, with MindyClient talking to a
+//                   real mindyd that runs an emulated card
+//
+// mindyd is expected to be next to this executable, as it is in the build directory
+//=================================================================================================
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MindyClient.h"
+#include "check.h"
+using namespace std;
+
+// The shared-memory object our mindyd serves, and its PID
+string ShmName;
+pid_t  Daemon = 0;
+
+
+//=================================================================================================
+// waitFor() - Waits up to 5 seconds for a condition to come true.  Returns false if it doesn't
+//=================================================================================================
+template <class F> static bool waitFor(F condition)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (chrono::steady_clock::now() < deadline)
+    {
+        if (condition()) return true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// attachWhenFree() - Attaches a client, waiting for the daemon to free a slot if need be
+//
+// Returns: false if no slot came free
+//=================================================================================================
+static bool attachWhenFree(MindyClient& client)
+{
+    return waitFor([&client]()
+    {
+        try {client.attach(ShmName);} catch (exception&) {return false;}
+        return true;
+    });
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// startDaemon() - Starts mindyd with an emulated card, and waits until a client can attach
+//
+// Returns: false if it didn't start
+//=================================================================================================
+static bool startDaemon()
+{
+    char exe[4096];
+    ssize_t length = readlink("/proc/self/exe", exe, sizeof exe - 1);
+    if (length <= 0) return false;
+    exe[length] = 0;
+    string daemon = string(exe).substr(0, string(exe).rfind('/') + 1) + "mindyd";
+
+    ShmName = "/mindyd_test_" + to_string(getpid());
+
+    Daemon = fork();
+    if (Daemon == 0)
+    {
+        // If the test dies, so does the daemon.  Keep its banner out of the test's output
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 1);
+        execl(daemon.c_str(), "mindyd", "-emulate", "-shm", ShmName.c_str(), "-status-us", "200", nullptr);
+        _exit(127);
+    }
+
+    MindyClient probe;
+    return attachWhenFree(probe);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// stopDaemon() - Stops mindyd the way an operator would, and returns its exit status
+//=================================================================================================
+static int stopDaemon()
+{
+    int status = -1;
+    kill(Daemon, SIGTERM);
+    waitpid(Daemon, &status, 0);
+    return status;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testSubmit() - Frames submitted from several threads all reach the card, and flush() waits
+//                until they have
+//=================================================================================================
+static void testSubmit()
+{
+    const uint32_t THREADS = 4, EACH = 5000;
+
+    MindyClient client;
+    client.attach(ShmName);
+    auto before = client.refreshStatus();
+
+    vector<thread> threads;
+    for (uint32_t t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([&client, t]()
+        {
+            for (uint32_t i = 0; i < EACH; ++i) client.submit(t & 1, 1 + (i & 1));
+        });
+    }
+    for (auto& t : threads) t.join();
+    client.flush();
+
+    uint64_t perPhase = (THREADS / 2) * (EACH / 2) * 3;
+    CHECK_EQ(client.framesSubmitted(0), perPhase);
+    CHECK_EQ(client.framesSubmitted(1), perPhase);
+
+    auto after = client.refreshStatus();
+    CHECK_EQ(after.submitted[0] - before.submitted[0], (uint32_t)perPhase);
+    CHECK_EQ(after.submitted[1] - before.submitted[1], (uint32_t)perPhase);
+    CHECK(after.updates > before.updates);
+
+    // The card fetches them too
+    CHECK(waitFor([&client]()
+    {
+        auto status = client.status();
+        return status.fetched[0] == status.submitted[0] && status.fetched[1] == status.submitted[1];
+    }));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testSlots() - Every slot can be claimed, one more can't, and a detached slot is reused
+//=================================================================================================
+static void testSlots()
+{
+    // The slots of the clients that came before are freed on the daemon's next sweep
+    vector<unique_ptr<MindyClient>> clients;
+    for (uint32_t i = 0; i < MINDYD_MAX_CLIENTS; ++i)
+    {
+        clients.push_back(make_unique<MindyClient>());
+        CHECK(attachWhenFree(*clients.back()));
+    }
+
+    MindyClient extra;
+    bool threw = false;
+    try {extra.attach(ShmName);} catch (exception&) {threw = true;}
+    CHECK(threw);
+
+    // The daemon frees a detached slot on its next sweep
+    clients.back()->submit(0, 7);
+    clients.back()->detach();
+    CHECK(attachWhenFree(extra));
+
+    // The new owner starts with a clean slot
+    CHECK_EQ(extra.framesSubmitted(0), 0u);
+    extra.submit(1, 2);
+    extra.flush();
+    CHECK_EQ(extra.framesSubmitted(1), 2u);
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testDeadClient() - What a client left in its ring when it died is still submitted, and its
+//                    slot is freed
+//=================================================================================================
+static void testDeadClient()
+{
+    MindyClient observer;
+    CHECK(attachWhenFree(observer));
+    auto before = observer.refreshStatus();
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        MindyClient client;
+        if (!attachWhenFree(client)) _exit(1);
+        client.submit(0, 11);
+        _exit(0);
+    }
+    waitpid(child, nullptr, 0);
+
+    CHECK(waitFor([&observer, &before]()
+    {
+        return observer.refreshStatus().submitted[0] - before.submitted[0] == 11;
+    }));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Starts mindyd, runs the tests against it, and stops it
+//=================================================================================================
+int main()
+{
+    if (!startDaemon())
+    {
+        printf("mindyd didn't start\n");
+        if (Daemon > 0) stopDaemon();
+        return 1;
+    }
+
+    int failed = runTests(
+    {
+        {"submit",              testSubmit},
+        {"slots",               testSlots},
+        {"dead client",         testDeadClient},
+    });
+
+    // mindyd exits cleanly on SIGTERM and removes the shared-memory object
+    int status = stopDaemon();
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        printf("FAIL mindyd exit status 0x%x\n", status);
+        ++failed;
+    }
+    if (shm_open(ShmName.c_str(), O_RDONLY, 0) >= 0)
+    {
+        printf("FAIL mindyd left %s behind\n", ShmName.c_str());
+        ++failed;
+    }
+
+    return failed;
+}
+//=================================================================================================
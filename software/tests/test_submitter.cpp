@@ -0,0 +1,177 @@
+//=================================================================================================
+// test_submitter.cpp - Behaviour tests for FrameSubmitter's multi-producer ring
+//
+// The submitter rings the doorbells of an emulated card, whose frame counters tell us how many
+// frames actually reached it
+//=================================================================================================
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "mindy.h"
+#include "MindyEmulator.h"
+#include "FrameSubmitter.h"
+#include "check.h"
+using namespace std;
+
+MindyEmulator Emulator;
+CMindy        Mindy;
+
+
+//=================================================================================================
+// waitForCounters() - Waits until the emulated card's frame counters reach the values given,
+//                     since it picks up doorbells by polling.  Returns false if they don't
+//=================================================================================================
+static bool waitForCounters(uint32_t phase0, uint32_t phase1)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (chrono::steady_clock::now() < deadline)
+    {
+        if (Mindy.getLocalFrameCounter(0) == phase0 && Mindy.getLocalFrameCounter(1) == phase1)
+            return true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return false;
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// clearCounters() - Clears the frame counters, and waits for the emulated card to notice, since
+//                   it clears phase 1's when it sees phase 0's go to zero
+//=================================================================================================
+static void clearCounters()
+{
+    Mindy.clearLocalFrameCounters();
+    CHECK(waitForCounters(0, 0));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testSingleProducer() - Every frame of every token reaches the card, and the doorbell writes
+//                        are coalesced
+//=================================================================================================
+static void testSingleProducer()
+{
+    clearCounters();
+    auto submitter = make_unique<FrameSubmitter>();
+    submitter->start(Mindy);
+
+    for (int i = 0; i < 1000; ++i) submitter->submit(0);
+    for (int i = 0; i < 100;  ++i) submitter->submit(1, 3);
+    submitter->submit(1, 0);
+    submitter->stop();
+
+    auto stats = submitter->getStats();
+    CHECK_EQ(stats.frames[0], 1000u);
+    CHECK_EQ(stats.frames[1], 300u);
+    CHECK_EQ(stats.depth, 0u);
+    CHECK(stats.doorbells >= 2 && stats.doorbells <= 1100);
+    CHECK(waitForCounters(1000, 300));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testManyProducers() - No token is lost or counted twice when many threads submit at once
+//=================================================================================================
+static void testManyProducers()
+{
+    const uint32_t THREADS = 8, TOKENS = 20000;
+
+    clearCounters();
+    auto submitter = make_unique<FrameSubmitter>();
+    submitter->start(Mindy);
+
+    // Even threads submit phase 0, odd ones phase 1, in counts of 1 thru 3
+    vector<thread> producers;
+    uint64_t expected[2] = {0, 0};
+    for (uint32_t t = 0; t < THREADS; ++t)
+    {
+        for (uint32_t i = 0; i < TOKENS; ++i) expected[t & 1] += i % 3 + 1;
+        producers.emplace_back([&submitter, t]()
+        {
+            for (uint32_t i = 0; i < TOKENS; ++i) submitter->submit(t & 1, i % 3 + 1);
+        });
+    }
+
+    for (auto& producer : producers) producer.join();
+    submitter->stop();
+
+    auto stats = submitter->getStats();
+    CHECK_EQ(stats.frames[0], expected[0]);
+    CHECK_EQ(stats.frames[1], expected[1]);
+    CHECK_EQ(stats.depth, 0u);
+    CHECK(stats.maxDepth <= FrameSubmitter::CAPACITY);
+    CHECK(stats.maxBatch <= FrameSubmitter::CAPACITY);
+    CHECK(waitForCounters((uint32_t)expected[0], (uint32_t)expected[1]));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testFullRing() - trySubmit() reports a full ring rather than overwriting a token, and the
+//                  tokens that were queued are all delivered once the doorbell thread starts
+//=================================================================================================
+static void testFullRing()
+{
+    clearCounters();
+    auto submitter = make_unique<FrameSubmitter>();
+
+    // With no doorbell thread, nothing drains the ring
+    for (uint32_t i = 0; i < FrameSubmitter::CAPACITY; ++i) CHECK(submitter->trySubmit(i & 1));
+    CHECK(!submitter->trySubmit(0));
+    CHECK(!submitter->trySubmit(1, 5));
+    CHECK_EQ(submitter->getStats().depth, FrameSubmitter::CAPACITY);
+
+    submitter->start(Mindy);
+    submitter->stop();
+
+    auto stats = submitter->getStats();
+    CHECK_EQ(stats.frames[0], FrameSubmitter::CAPACITY / 2);
+    CHECK_EQ(stats.frames[1], FrameSubmitter::CAPACITY / 2);
+    CHECK(waitForCounters(FrameSubmitter::CAPACITY / 2, FrameSubmitter::CAPACITY / 2));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// testLargeBatch() - A batch bigger than one doorbell write can hold is split up
+//=================================================================================================
+static void testLargeBatch()
+{
+    clearCounters();
+    auto submitter = make_unique<FrameSubmitter>();
+
+    uint32_t count = CMindy::MAX_FRAME_ADD;
+    submitter->trySubmit(0, count);
+    submitter->trySubmit(0, count);
+    submitter->start(Mindy);
+    submitter->stop();
+
+    auto stats = submitter->getStats();
+    CHECK_EQ(stats.frames[0], 2ull * count);
+    CHECK_EQ(stats.doorbells, 2u);
+    CHECK(waitForCounters(2 * count, 0));
+}
+//=================================================================================================
+
+
+//=================================================================================================
+// main() - Runs the tests against an emulated card
+//=================================================================================================
+int main()
+{
+    Emulator.start();
+    Mindy.initEmulated(Emulator);
+
+    return runTests(
+    {
+        {"single producer", testSingleProducer},
+        {"many producers",  testManyProducers},
+        {"full ring",       testFullRing},
+        {"large batch",     testLargeBatch},
+    });
+}
+//=================================================================================================
@@ -203,11 +203,7 @@ module axi_revision#
     `include "revision_history.vh"
     localparam VERSION_DATE  = (VERSION_MONTH << 24) | (VERSION_DAY << 16) | VERSION_YEAR; 
 
-    localparam REG_MAJOR = 0;
-    localparam REG_MINOR = 1;
-    localparam REG_BUILD = 2;
-    localparam REG_RCAND = 3;
-    localparam REG_DATE  = 4;
+    `include "axi_revision_regs.vh"
    
     //=========================================================================================================
     // State machine that handles AXI master reads of our AXI4-Lite slave registers
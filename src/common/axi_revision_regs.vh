@@ -0,0 +1,7 @@
+// axi_revision_regs.vh - AXI register map of axi_revision
+// Generated by mindyregs from software/src/mindylib/mindy_regs.def - don't edit by hand
+localparam REG_MAJOR                =  0;  // Major version number
+localparam REG_MINOR                =  1;  // Minor version number
+localparam REG_BUILD                =  2;  // Build number
+localparam REG_RCAND                =  3;  // Release candidate
+localparam REG_DATE                 =  4;  // Build date, 0xMMDDYYYY
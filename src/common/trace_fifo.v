@@ -0,0 +1,106 @@
+//====================================================================================
+//                        ------->  Revision History  <------
+//====================================================================================
+//
+//   Date     Who   Ver  Changes
+//====================================================================================
+// 18-Oct-26  DWW     1  Initial creation
+//====================================================================================
+
+/*
+    This is a small FIFO of 64-bit trace entries, intended to be drained by
+    software via AXI register reads.
+
+    Every entry is:
+        bits [63:48] = Frame sequence number
+        bit  [47]    = Phase (if known at the trace point, otherwise 0)
+        bits [46:0]  = Timestamp
+
+    An entry is written on any cycle when "event_strobe" is high.  The entry
+    at the head of the FIFO is always available on "head", and is discarded
+    when "pop" is strobed.   If an event occurs when the FIFO is full, the
+    event is discarded and "overflows" is incremented.
+
+    The frame sequence number starts at 1 after reset and increments with
+    every event, so software can match up the entries for a given frame from
+    trace points in different modules.
+*/
+
+module trace_fifo # (parameter DEPTH = 256)
+(
+    input clk, resetn,
+
+    // The free-running timestamp counter
+    input[63:0] timestamp,
+
+    // Strobe this for one cycle to record an event
+    input       event_strobe,
+    input       event_phase,
+
+    // The entry at the head of the FIFO
+    output[63:0] head,
+
+    // Strobe this for one cycle to discard the entry at the head of the FIFO
+    input        pop,
+
+    // The number of entries in the FIFO
+    output[15:0] count,
+
+    // The number of events that were lost because the FIFO was full
+    output reg[31:0] overflows
+);
+
+localparam PW = $clog2(DEPTH);
+
+// The FIFO itself is small enough to live in distributed RAM
+(* ram_style = "distributed" *) reg[63:0] fifo[0:DEPTH-1];
+
+// Read and write pointers.  These have an extra bit to tell "full" from "empty"
+reg[PW:0] wptr, rptr;
+
+// The frame sequence number of the next event
+reg[15:0] frame_seq;
+
+// Determine how many entries are in the FIFO, and whether it's full
+wire[PW:0] entries = wptr - rptr;
+assign     count   = entries;
+wire       full    = (entries == DEPTH);
+
+// The entry at the head of the FIFO
+assign head = fifo[rptr[PW-1:0]];
+
+//=============================================================================
+// Write events into the FIFO
+//=============================================================================
+always @(posedge clk) begin
+    if (resetn == 0) begin
+        wptr      <= 0;
+        frame_seq <= 1;
+        overflows <= 0;
+    end
+
+    else if (event_strobe) begin
+        frame_seq <= frame_seq + 1;
+        if (full)
+            overflows <= overflows + 1;
+        else begin
+            fifo[wptr[PW-1:0]] <= {frame_seq, event_phase, timestamp[46:0]};
+            wptr               <= wptr + 1;
+        end
+    end
+end
+//=============================================================================
+
+
+//=============================================================================
+// Discard the entry at the head of the FIFO when asked to
+//=============================================================================
+always @(posedge clk) begin
+    if (resetn == 0)
+        rptr <= 0;
+    else if (pop && entries != 0)
+        rptr <= rptr + 1;
+end
+//=============================================================================
+
+endmodule
@@ -5,6 +5,16 @@
 //   Date     Who   Ver  Changes
 //=============================================================================
 // 15-Feb-24  DWW     1  Initial creation
+// 18-Oct-26  DWW     2  Added scatter-gather (descriptor ring) mode
+// 18-Oct-26  DWW     3  Added per-phase "frames fetched" completion counters
+// 18-Oct-26  DWW     4  Added the "first beat of frame" trace
+// 18-Oct-26  DWW     5  Made the ring offsets and "frames issued" counts readable
+// 18-Oct-26  DWW     6  Added staged reconfiguration (REG_CFG_CTRL, REG_CFG_COMMIT)
+// 18-Oct-26  DWW     7  Added delta mode (REG_DELTA_CTRL)
+// 18-Oct-26  DWW     8  Added multiple streams, each with its own buffers
+// 19-Oct-26  DWW     9  Each 64-bit register latches its own lower half
+// 19-Oct-26  DWW    10  A commit that is waiting for the pipeline to drain can be
+//                       cancelled
 //=============================================================================
 
 /*
@@ -19,9 +29,10 @@
 
     The overall flow of this design is:
 
-    (1) Wait to receive a command on the AXIS_CMD stream.  That command will
-        be a 0 or a 1 (meaning that we should read a frame data and meta-data
-        from host RAM for phase 0 or phase 1 of the sensor chip)
+    (1) Wait to receive a command on the AXIS_CMD stream.  Bit 0 of that 
+        command will be a 0 or a 1 (meaning that we should read a frame data
+        and meta-data from host RAM for phase 0 or phase 1 of the sensor chip)
+        and bits 3:1 are the stream the frame belongs to (see "Streams")
 
     (2) Issue the appropriate read-requests to the PCIe bus to satisfy that
         command
@@ -31,7 +42,136 @@
 
     When data is fetched from the PCIe bus and written to the AXIS_FD, it is
     intentionally stripped of its RLAST/TLAST bits.   The downstream module
-    that receives this data will re-packetize it as neccessary
+    that receives this data will re-packetize it as neccessary.  (TLAST is 
+    reused to mark the last beat of each frame, see "delta mode" below)
+
+    Scatter-gather (descriptor) mode:
+
+    When bit 0 of REG_DESC_CTRL is set, the HFD and HMD buffers are ignored.
+    Instead, each phase has a ring of 64-byte frame descriptors in host RAM:
+
+         bytes  0 -  7 : Address of the 128-byte metadata record
+         bytes  8 - 15 : Address of the semiphase 0 page-list
+         bytes 16 - 23 : Address of the semiphase 1 page-list
+         bytes 24 - 27 : Sequence number (1 for the first frame of a phase)
+         bytes 28 - 63 : Reserved
+
+    A page-list is an array of 64-bit addresses of 4K-aligned pages, one
+    entry for every 4096 bytes of the semiphase.
+
+    Descriptors are fetched up to DESC_BATCH at a time and cached.  A cached
+    descriptor whose sequence number isn't the one we expect is stale (the
+    host hadn't written it yet when we fetched it) and causes a re-fetch.   
+    If a freshly fetched descriptor has the wrong sequence number, the frame
+    is dropped and REG_DESC_ERRORS is incremented.
+
+    Because page-lists and descriptors arrive on the same R-channel as frame
+    data, every read request we issue is tagged (in a small FIFO) with the 
+    kind of data it will return, and the R-channel routes each burst by its
+    tag.
+
+    Completion counters:
+
+    REG_FETCHED0 and REG_FETCHED1 count the frames (per phase) whose last
+    beat of frame-data has arrived from the host.  Once the count for a 
+    phase reaches the value that was written to its frame counter, every
+    frame of that phase has been fetched and its host buffers may be reused.
+    A frame that is dropped because of a bad descriptor is counted as soon
+    as every frame ahead of it has been fetched.
+
+    Ring state:
+
+    REG_ISSUED0 and REG_ISSUED1 count the frames (per phase) whose read 
+    requests have all been issued.  Each time that count changes, the 
+    offsets (into the HFD and HMD buffers) of the next frame of that phase
+    are captured in REG_HFDn_OFFS and REG_HMDn_OFFS, in the same clock 
+    cycle.  A producer that restarts while the card is running reads these
+    to find out where in its buffers the card is, rather than resetting
+    the card.  See CMindy::attach()
+
+    Staged reconfiguration:
+
+    The buffer addresses and sizes, REG_DESC_CTRL and the descriptor rings
+    are written into shadow registers, and reads return the shadows.  While
+    bit 0 of REG_CFG_CTRL is clear, the registers we actually use follow
+    the shadows, just as if they'd been written directly.  While it's set
+    (it drives "cfg_stage" out to rdmx_shim_ctl, which stages its own ring
+    and frame geometry the same way), writes only accumulate in the shadows.
+
+    A write to REG_CFG_COMMIT stops us from accepting commands, then waits
+    until no frame is in flight: nothing is being fetched, and every frame
+    we've issued has been delivered ("frame_delivered", from rdmx_shim_ctl).
+    At that point "cfg_commit" strobes for one cycle, and in that cycle:
+
+        - every staged register (ours and rdmx_shim_ctl's) takes its new value
+        - every ring (HFD, HMD, descriptors, and the remote rings written by
+          the rdmx_shims) restarts at offset 0
+        - the cached descriptors are discarded
+
+    Frame counters, sequence numbers and completion counters carry on.  We
+    then wait for rdmx_shim_ctl to report "cfg_settled" (PACKETS_PER_FRAME
+    has been recomputed) before accepting commands again.  Bit 0 of
+    REG_CFG_COMMIT reads as 1 until then.
+
+    If the pipeline never drains (a link is down, or an rdmx_shim is stalled),
+    writing 0 to REG_CFG_COMMIT cancels the commit: we go back to accepting
+    commands with the old configuration, and the staged values stay in the
+    shadows.  Bit 1 of REG_CFG_COMMIT reads as 1 when the most recent commit
+    was cancelled.  A cancel that arrives after "cfg_commit" is ignored.
+
+    Delta mode:
+
+    When bit 0 of REG_DELTA_CTRL is set (and scatter-gather mode isn't), 
+    only the packets of a frame that have changed are fetched.  The first 
+    64 bytes of each frame's metadata record are a bitmap with one bit per
+    PACKET_SIZE-byte packet of the frame (bit 0 of byte 0 is the first 
+    packet).  The host sets the bit of every packet that differs from the 
+    previous frame of that phase.   Frames can therefore have no more than
+    512 packets, and both semiphases must hold a whole number of packets.
+
+    After requesting the metadata, we wait for its first beat to arrive, then
+    request the frame data of each packet whose bit is set, splitting a 
+    packet into as many bursts as it takes to avoid crossing a burst 
+    boundary.  A frame whose bitmap is empty is sent as packet 0 alone, so 
+    that the frame is still delivered.  The metadata (bitmap included) is 
+    forwarded unchanged.
+
+    Each beat of frame data is output with the byte offset (within the 
+    frame) of its burst on AXIS_FD_OUT_TUSER, and the last beat of each 
+    frame is flagged with AXIS_FD_OUT_TLAST.   The ping_ponger uses those
+    (when DELTA_MODE is high) to tag the packets and to find the end of the
+    frame, and the rdmx_shims write each packet at its usual place in the 
+    remote ring.  That requires a "steered" STEER_POLICY.
+
+    REG_DELTA_SENT and REG_DELTA_SKIPPED count the packets that were fetched
+    and skipped.  REG_DELTA_CTRL is staged like the other configuration
+    registers.
+
+    Streams:
+
+    Each of the STREAMS streams (see frame_counters.v) has its own HFD and 
+    HMD buffer addresses, ring offsets and completion counters.  The sizes 
+    of the buffers, the frame geometry, delta mode and the staging of the
+    configuration are shared by every stream.  Scatter-gather mode applies
+    only to stream 0; the frames of other streams always come from their 
+    HFD and HMD buffers.
+
+    The buffer address, ring offset and REG_ISSUEDn registers are banked:
+    they belong to the stream selected by "stream_sel" (REG_STREAM_SEL in
+    frame_counters).  REG_FETCHED0 and REG_FETCHED1 always belong to stream
+    0, and the completion counters of every stream can be read from the 
+    REG_STREAM_FETCHED table at index REG_STREAM_FETCHED + 2 * stream + phase,
+    so that they can be polled without selecting a stream.
+
+    The stream of each frame's metadata is output on AXIS_MD_OUT_TUSER so 
+    that the rdmx_shims can use that stream's remote rings.
+
+    Tracing:
+
+    A trace entry (see trace_fifo.v) is recorded when the first beat of 
+    each frame (i.e., the first beat of its metadata) arrives from the host.
+    A frame that is dropped is recorded when it is dropped, so that the 
+    frame sequence numbers stay in step with the other trace points.
 */
 
 module data_fetch #
@@ -39,14 +179,28 @@ module data_fetch #
     parameter PCIE_BITS      = 512,
     parameter AXI_BURST_SIZE = 2048,
     parameter FD_FIFO_DEPTH  = 1024,
-    parameter FD_FIFO_TYPE   = "auto"
+    parameter FD_FIFO_TYPE   = "auto",
+    parameter DESC_BATCH     = 8,
+    parameter STREAMS        = 4
 )
 (
     input clk, resetn,
 
+    // The stream whose registers are presented to the AXI bus
+    input[2:0] stream_sel,
+
+    // The free-running timestamp counter from frame_counters
+    input[63:0] timestamp,
+
     // The address of the ABM buffer on the host
     output reg[63:0] host_abm_addr,
 
+    // Staged reconfiguration (see above)
+    output reg cfg_stage, 
+    output reg cfg_commit,
+    input      cfg_settled,
+    input      frame_delivered,
+
     //================== This is an AXI4-Lite slave interface ==================
         
     // "Specify write address"              -- Master --    -- Slave --
@@ -152,18 +306,33 @@ module data_fetch #
     //             Meta-data output stream that mindy-core expects
     //==========================================================================
     output  [PCIE_BITS-1:0] AXIS_MD_OUT_TDATA,
+    output  [7:0]           AXIS_MD_OUT_TUSER,
     output                  AXIS_MD_OUT_TVALID,
     input                   AXIS_MD_OUT_TREADY,
     //==========================================================================
 
 
-    // The number of bytes in a full-frame
-    input [31:0] FRAME_SIZE
+    //==========================================================================
+    //    The byte offset within its frame, and end-of-frame, of frame-data
+    //==========================================================================
+    output  [31:0]          AXIS_FD_OUT_TUSER,
+    output                  AXIS_FD_OUT_TLAST,
+    //==========================================================================
+
+    // This is high when delta mode is in use (see above)
+    output reg DELTA_MODE,
+
+    // The number of bytes in a full-frame, and in a packet
+    input [31:0] FRAME_SIZE,
+    input [15:0] PACKET_SIZE,
+
+    // The number of packets in a frame
+    input [31:0] PACKETS_PER_FRAME
 );  
 
 // Any time the register map of this module changes, this number should
 // be bumped
-localparam MODULE_VERSION = 1;
+localparam MODULE_VERSION = 10;
 
 // Width of the PCIe bus, in bytes
 localparam PCIE_WIDTH = PCIE_BITS / 8;
@@ -175,25 +344,7 @@ localparam METADATA_BYTES = 128;
 localparam AXI_BURST_CYCLES = AXI_BURST_SIZE / PCIE_WIDTH;
 
 //=========================  AXI Register Map  ================================
-localparam REG_MODULE_REV   =  0;
-localparam REG_HFD00_ADDR_H =  1;  // Host frame data, phase 0, semi-phase 0
-localparam REG_HFD00_ADDR_L =  2;
-localparam REG_HFD01_ADDR_H =  3;  // Host frame data, phase 0, semi-phase 1
-localparam REG_HFD01_ADDR_L =  4;
-localparam REG_HFD10_ADDR_H =  5;  // Host frame data, phase 1, semi-phase 0
-localparam REG_HFD10_ADDR_L =  6;
-localparam REG_HFD11_ADDR_H =  7;  // Host frame data, phase 1, semi-phase 1
-localparam REG_HFD11_ADDR_L =  8;
-localparam REG_HMD0_ADDR_H  =  9;  // Host metadata, phase 0
-localparam REG_HMD0_ADDR_L  = 10;
-localparam REG_HMD1_ADDR_H  = 11;  // Host metadata, phase 1
-localparam REG_HMD1_ADDR_L  = 12;
-localparam REG_HFD_BYTES_H  = 13;  // Host frame-data buffer, size in bytes
-localparam REG_HFD_BYTES_L  = 14;
-localparam REG_HMD_BYTES_H  = 15;  // Host meta-data buffer, size in bytes
-localparam REG_HMD_BYTES_L  = 16;
-localparam REG_ABM_ADDR_H   = 17;  // Host ABM buffer
-localparam REG_ABM_ADDR_L   = 18;
+`include "data_fetch_regs.vh"
 //=============================================================================
 
 
@@ -230,21 +381,51 @@ localparam SLVERR = 2;
 localparam DECERR = 3;
 
 // An AXI slave is gauranteed a minimum of 128 bytes of address space
-// (128 bytes is 32 32-bit registers)
-localparam ADDR_MASK = 7'hFF;
+// (128 bytes is 32 32-bit registers).  We have more than 64 registers, 
+// so we decode 512 bytes
+localparam ADDR_MASK = 9'h1FF;
 
 // Input-command state machine
-reg[2:0] icsm_state;
-localparam ICSM_WAIT_CMD     = 0;
-localparam ICSM_REQ_METADATA = 1;
-localparam ICSM_REQ_FD_SP0   = 2;
-localparam ICSM_REQ_FD_SP1   = 3;
-
-// Addresses of host frame data buffers, 2 phases, 2 buffers per phase
-reg[63:0] host_fd_addr[0:1][0:1], host_fd_bytes;
-
-// Addresses of host meta-data buffers, 2 phases
-reg[63:0] host_md_addr[0:1], host_md_bytes;
+reg[4:0] icsm_state;
+localparam ICSM_WAIT_CMD     =  0;
+localparam ICSM_REQ_METADATA =  1;
+localparam ICSM_REQ_FD_SP0   =  2;
+localparam ICSM_REQ_FD_SP1   =  3;
+localparam ICSM_SG_CHECK     =  4;
+localparam ICSM_SG_REQ_DESC  =  5;
+localparam ICSM_SG_WAIT_DESC =  6;
+localparam ICSM_SG_USE_DESC  =  7;
+localparam ICSM_SG_REQ_MD    =  8;
+localparam ICSM_SG_CHUNK     =  9;
+localparam ICSM_SG_REQ_PLIST = 10;
+localparam ICSM_SG_WAIT_PLST = 11;
+localparam ICSM_SG_PAGE      = 12;
+localparam ICSM_SG_REQ_FD    = 13;
+localparam ICSM_SG_DROP      = 14;
+localparam ICSM_DELTA_MAP    = 15;
+localparam ICSM_DELTA_SCAN   = 16;
+localparam ICSM_DELTA_BURST  = 17;
+localparam ICSM_DELTA_REQ_FD = 18;
+
+// Every read-request we issue is tagged with the kind of data it returns
+localparam TAG_MD    = 0;
+localparam TAG_FD    = 1;
+localparam TAG_DESC  = 2;
+localparam TAG_PLIST = 3;
+
+// Size of a host page, and the size of one descriptor, in bytes
+localparam PAGE_BYTES = 4096;
+localparam DESC_BYTES = 64;
+
+// Number of page-list entries we fetch in a single AXI burst
+localparam PLIST_ENTRIES = AXI_BURST_SIZE / 8;
+
+// Addresses of host frame data buffers, 2 phases, 2 buffers per phase,
+// for every stream
+reg[63:0] host_fd_addr[0:STREAMS-1][0:1][0:1], host_fd_bytes;
+
+// Addresses of host meta-data buffers, 2 phases, for every stream
+reg[63:0] host_md_addr[0:STREAMS-1][0:1], host_md_bytes;
 
 // Number of bytes in a semi-phase
 wire[31:0] semiphase_bytes = FRAME_SIZE / 2;
@@ -253,25 +434,55 @@ wire[31:0] semiphase_bytes = FRAME_SIZE / 2;
 reg phase_select_reg;
 wire phase_select = (icsm_state == ICSM_WAIT_CMD) ? AXIS_CMD_TDATA[0] : phase_select_reg;
 
-// Offsets into the two host-side metadata buffers, one per phase
-reg[63:0] hmd_offs[0:1];
+// And which stream
+reg[2:0]  stream_select_reg;
+wire[2:0] stream_select = (icsm_state == ICSM_WAIT_CMD) ? AXIS_CMD_TDATA[3:1] : stream_select_reg;
+
+// Only stream 0 uses the descriptor rings in scatter-gather mode
+wire sg_stream = sg_enable & (stream_select == 0);
+
+// Loop counters
+integer s, p;
+
+// Scatter-gather mode: enable, descriptor rings (one per phase), and ring size
+reg       sg_enable;
+reg[63:0] host_desc_addr[0:1], host_desc_bytes;
+
+// The values most recently written to the registers above (see "staged 
+// reconfiguration")
+reg[63:0] shadow_fd_addr[0:STREAMS-1][0:1][0:1], shadow_fd_bytes;
+reg[63:0] shadow_md_addr[0:STREAMS-1][0:1], shadow_md_bytes;
+reg       shadow_sg_enable;
+reg[63:0] shadow_desc_addr[0:1], shadow_desc_bytes;
+reg       shadow_delta_enable;
 
-// Offsets into the four host-side frame-data buffers
-// Order of the indices is [phase][semiphase]
-reg[63:0] hfd_offs[0:1][0:1];
+// This is high from a write to REG_CFG_COMMIT until the commit is complete
+wire cfg_pending;
 
-// Current pointers into the semiphase frame buffers in host RAM
+// Number of frames that were dropped because of a bad descriptor
+reg[31:0] desc_errors;
+
+// Offsets into the two host-side metadata buffers of each stream, one per
+// phase
+reg[63:0] hmd_offs[0:STREAMS-1][0:1];
+
+// Offsets into the four host-side frame-data buffers of each stream
+// Order of the indices is [stream][phase][semiphase]
+reg[63:0] hfd_offs[0:STREAMS-1][0:1][0:1];
+
+// Current pointers into the semiphase frame buffers in host RAM, for the
+// stream we're issuing read requests for
 wire[63:0] hfd_ptr[0:1][0:1];
-assign hfd_ptr[0][0] = host_fd_addr[0][0] + hfd_offs[0][0];
-assign hfd_ptr[0][1] = host_fd_addr[0][1] + hfd_offs[0][1];
-assign hfd_ptr[1][0] = host_fd_addr[1][0] + hfd_offs[1][0];
-assign hfd_ptr[1][1] = host_fd_addr[1][1] + hfd_offs[1][1];
+assign hfd_ptr[0][0] = host_fd_addr[stream_select][0][0] + hfd_offs[stream_select][0][0];
+assign hfd_ptr[0][1] = host_fd_addr[stream_select][0][1] + hfd_offs[stream_select][0][1];
+assign hfd_ptr[1][0] = host_fd_addr[stream_select][1][0] + hfd_offs[stream_select][1][0];
+assign hfd_ptr[1][1] = host_fd_addr[stream_select][1][1] + hfd_offs[stream_select][1][1];
 
 // Current pointers to the metadata frame buffers in host RAM
 // One pointer for each phase
 wire[63:0] hmd_ptr[0:1];
-assign hmd_ptr[0] = host_md_addr[0] + hmd_offs[0];
-assign hmd_ptr[1] = host_md_addr[1] + hmd_offs[1];
+assign hmd_ptr[0] = host_md_addr[stream_select][0] + hmd_offs[stream_select][0];
+assign hmd_ptr[1] = host_md_addr[stream_select][1] + hmd_offs[stream_select][1];
 
 // How many AXI transactions will it take to fetch an entire phase?
 wire[31:0] bursts_per_phase = FRAME_SIZE / AXI_BURST_SIZE;
@@ -279,9 +490,6 @@ wire[31:0] bursts_per_phase = FRAME_SIZE / AXI_BURST_SIZE;
 // How many AXI transactions will it take to fetch an entire semiphase?
 wire[31:0] bursts_per_semiphase = bursts_per_phase / 2;
 
-// The number of data-cycles required by an entire frame (1 phase) of frame data
-wire[31:0] cycles_per_frame = FRAME_SIZE / (PCIE_BITS/8);
-
 //=============================================================================
 // This block provides a mechanism for incrementing the host RAM pointers
 // for meta-data, frame-data semiphase 0, and frame-data semiphase 1
@@ -294,46 +502,45 @@ wire[31:0] cycles_per_frame = FRAME_SIZE / (PCIE_BITS/8);
 //     incr_hmd_offs
 //     incr hfd0_offs
 //     incr hfd1_offs
-//     hfd_offs[][]
-//     hmd_offs[]
+//     hfd_offs[][][]
+//     hmd_offs[][]
 //=============================================================================
 reg[1:0] inc_pointer;
 localparam INC_MD_PTR  = 1;
 localparam INC_FD0_PTR = 2;
 localparam INC_FD1_PTR = 3;
 
-wire[63:0] incr_hmd_offs  = hmd_offs[phase_select]    + METADATA_BYTES;
-wire[63:0] incr_hfd0_offs = hfd_offs[phase_select][0] + semiphase_bytes;
-wire[63:0] incr_hfd1_offs = hfd_offs[phase_select][1] + semiphase_bytes;
+wire[63:0] incr_hmd_offs  = hmd_offs[stream_select][phase_select]    + METADATA_BYTES;
+wire[63:0] incr_hfd0_offs = hfd_offs[stream_select][phase_select][0] + semiphase_bytes;
+wire[63:0] incr_hfd1_offs = hfd_offs[stream_select][phase_select][1] + semiphase_bytes;
 //-----------------------------------------------------------------------------
 
 always @(posedge clk) begin
-    if (resetn == 0) begin
-        hfd_offs[0][0] <= 0;
-        hfd_offs[0][1] <= 0;  
-        hfd_offs[1][0] <= 0;
-        hfd_offs[1][1] <= 0;
-        hmd_offs[0]    <= 0;
-        hmd_offs[1]    <= 0;
+    if (resetn == 0 || cfg_commit) begin
+        for (s=0; s<STREAMS; s=s+1) for (p=0; p<2; p=p+1) begin
+            hfd_offs[s][p][0] <= 0;
+            hfd_offs[s][p][1] <= 0;  
+            hmd_offs[s][p]    <= 0;
+        end
     end else case(inc_pointer)
 
         INC_MD_PTR:
             if (incr_hmd_offs < host_md_bytes)
-                hmd_offs[phase_select] <= incr_hmd_offs;
+                hmd_offs[stream_select][phase_select] <= incr_hmd_offs;
             else
-                hmd_offs[phase_select] <= 0;
+                hmd_offs[stream_select][phase_select] <= 0;
 
         INC_FD0_PTR:
             if (incr_hfd0_offs < host_fd_bytes)
-                hfd_offs[phase_select][0] <= incr_hfd0_offs;
+                hfd_offs[stream_select][phase_select][0] <= incr_hfd0_offs;
             else
-                hfd_offs[phase_select][0] <= 0;
+                hfd_offs[stream_select][phase_select][0] <= 0;
 
         INC_FD1_PTR:
             if (incr_hfd1_offs < host_fd_bytes)
-                hfd_offs[phase_select][1] <= incr_hfd1_offs;
+                hfd_offs[stream_select][phase_select][1] <= incr_hfd1_offs;
             else
-                hfd_offs[phase_select][1] <= 0;
+                hfd_offs[stream_select][phase_select][1] <= 0;
     endcase
 
 end
@@ -347,13 +554,15 @@ end
 //
 // A command is either: "read metadata and frame data from phase 0" 
 //                  or: "read metadata and frame data from phase 1"
+// of a particular stream
 //=============================================================================
 
 // Number of bursts we've requested so far
 reg[31:0] burst_counter;
 
-// Assert AXIS_CMD_TREADY whenever we're waiting for a command to arrive
-assign AXIS_CMD_TREADY = (resetn == 1 && icsm_state == ICSM_WAIT_CMD);
+// Assert AXIS_CMD_TREADY whenever we're waiting for a command to arrive,
+// unless a configuration commit is waiting for the pipeline to drain
+assign AXIS_CMD_TREADY = (resetn == 1 && icsm_state == ICSM_WAIT_CMD && ~cfg_pending);
 
 // Tell ARSIZE how wide our data bus is
 assign M_AXI_ARSIZE = $clog2(PCIE_WIDTH);
@@ -361,40 +570,227 @@ assign M_AXI_ARSIZE = $clog2(PCIE_WIDTH);
 // Make the burst type "auto-increment address"
 assign M_AXI_ARBURST = 1;
 
-// We're outputting a valid read request most of the time
-assign M_AXI_ARVALID = (resetn == 1) & icsm_state != ICSM_WAIT_CMD;
+// All of our read requests use the same ID so that they complete in order
+assign M_AXI_ARID = 0;
+
+// These are the states in which we are issuing a read-request
+wire ar_request_state = (icsm_state == ICSM_REQ_METADATA)
+                      | (icsm_state == ICSM_REQ_FD_SP0  )
+                      | (icsm_state == ICSM_REQ_FD_SP1  )
+                      | (icsm_state == ICSM_SG_REQ_DESC )
+                      | (icsm_state == ICSM_SG_REQ_MD   )
+                      | (icsm_state == ICSM_SG_REQ_PLIST)
+                      | (icsm_state == ICSM_SG_REQ_FD   )
+                      | (icsm_state == ICSM_DELTA_REQ_FD);
+
+// The tag FIFO (further below) must have room for the tag of every request
+wire tag_full, tag_empty;
+
+// We output a valid read request in any of the request states
+assign M_AXI_ARVALID = (resetn == 1) & ar_request_state & ~tag_full;
+
+// This is the tag that describes the data our current read-request returns
+reg[1:0] ar_tag;
+always @* begin
+    case (icsm_state)
+        ICSM_REQ_METADATA:  ar_tag = TAG_MD;
+        ICSM_SG_REQ_MD:     ar_tag = TAG_MD;
+        ICSM_SG_REQ_DESC:   ar_tag = TAG_DESC;
+        ICSM_SG_REQ_PLIST:  ar_tag = TAG_PLIST;
+        default:            ar_tag = TAG_FD;
+    endcase
+end
+
+// This is asserted when the current read-request is the last one of a frame
+wire ar_eof;
+
+//-----------------------------------------------------------------------------
+// Scatter-gather state
+//-----------------------------------------------------------------------------
+
+// Cached descriptors, DESC_BATCH per phase.  Only the first 32 bytes matter
+reg[255:0] desc_cache[0:1][0:DESC_BATCH-1];
+
+// Byte offset (into the descriptor ring) of the next descriptor, per phase
+reg[63:0] desc_offs[0:1];
+
+// Number of descriptors in the cache, and the cache slot of the next one
+reg[7:0] desc_avail[0:1], desc_slot[0:1];
+
+// The sequence number we expect to find in the next descriptor, per phase
+reg[31:0] expected_seq[0:1];
+
+// This is set when the descriptors in the cache were just fetched
+reg desc_fresh;
+
+// Number of descriptors being fetched by the current descriptor-read
+reg[7:0] desc_fetch_len;
+
+// The page-list entries for the chunk of pages we're currently fetching
+reg[PCIE_BITS-1:0] plist[0:(PLIST_ENTRIES/8)-1];
+
+// This strobes high when a descriptor-read or page-list read has arrived
+reg aux_done;
+
+// This strobes high when a frame is dropped because of a bad descriptor
+reg frame_dropped;
+
+// The current descriptor, and its fields
+wire[255:0] cur_desc     = desc_cache[phase_select_reg][desc_slot[phase_select_reg]];
+wire[ 63:0] cur_desc_md  = cur_desc[ 63:  0];
+wire[ 63:0] cur_desc_sp0 = cur_desc[127: 64];
+wire[ 63:0] cur_desc_sp1 = cur_desc[191:128];
+wire[ 31:0] cur_desc_seq = cur_desc[223:192];
+
+// Page-list addresses for the two semiphases of the frame being fetched
+reg[63:0] sg_plist_addr[0:1];
+
+// The semiphase we're fetching, and the index of the first page of the
+// current chunk of pages within that semiphase
+reg       sg_semiphase;
+reg[31:0] sg_page_base;
+
+// Number of pages in the current chunk, and the index of the current page
+reg[15:0] chunk_pages, page_idx;
+
+// Number of pages (and AXI bursts per page) in a semiphase
+wire[31:0] pages_per_semiphase = (semiphase_bytes + PAGE_BYTES - 1) / PAGE_BYTES;
+wire[31:0] bytes_per_page      = (semiphase_bytes < PAGE_BYTES) ? semiphase_bytes : PAGE_BYTES;
+wire[31:0] bursts_per_page     = bytes_per_page / AXI_BURST_SIZE;
+
+// Number of pages in the next chunk of the page-list
+wire[31:0] pages_remaining = pages_per_semiphase - sg_page_base;
+wire[31:0] next_chunk_pages = (pages_remaining < PLIST_ENTRIES) ? pages_remaining : PLIST_ENTRIES;
+
+// The address of the current page, as read from the page-list
+wire[PCIE_BITS-1:0] plist_word = plist[page_idx / 8];
+wire[63:0]          page_addr  = plist_word[(page_idx % 8)*64 +: 64];
+
+// How many descriptors we can fetch before reaching the end of the ring
+wire[63:0] desc_room = (host_desc_bytes - desc_offs[phase_select_reg]) / DESC_BYTES;
+wire[7:0]  desc_batch_len = (desc_room == 0         ) ? 1 :
+                            (desc_room < DESC_BATCH ) ? desc_room : DESC_BATCH;
+
+// Offset of the descriptor after the current one, wrapped to the ring size
+wire[63:0] incr_desc_offs = desc_offs[phase_select_reg] + DESC_BYTES;
+wire[63:0] next_desc_offs = (incr_desc_offs < host_desc_bytes) ? incr_desc_offs : 0;
+
+// These are true when the frame-data request being issued is the last one 
+// of its page, its chunk, its semiphase, or its semiphase pair
+wire sg_last_burst = ~(burst_counter < bursts_per_page);
+wire sg_last_page  = ~(page_idx + 1 < chunk_pages);
+wire sg_last_chunk = ~(sg_page_base + chunk_pages < pages_per_semiphase);
+
+//-----------------------------------------------------------------------------
+// Delta mode state
+//-----------------------------------------------------------------------------
+
+// Delta mode is only used with the HFD and HMD buffers
+wire delta_active = DELTA_MODE & ~sg_stream;
+
+// The dirty-packet bitmap from the first beat of the most recent metadata 
+// record, and a flag that says it has arrived (see "delta_map_ready" below)
+reg[511:0] delta_map;
+reg        delta_map_ready;
+
+// The bits of the bitmap that correspond to packets of the frame
+wire[511:0] delta_mask  = (PACKETS_PER_FRAME >= 512) ? {512{1'b1}} 
+                        : {512{1'b1}} >> (512 - PACKETS_PER_FRAME);
+wire[511:0] delta_dirty = delta_map & delta_mask;
+
+// The packets of the frame still to be fetched.  Bit 0 is the packet at
+// "delta_offs", the byte offset within the frame of the next burst
+reg[511:0] delta_pending;
+reg[ 31:0] delta_offs;
+
+// The addresses of the frame's two semiphases
+reg[63:0] delta_base[0:1];
+
+// Bytes of the current packet not yet requested, and bytes in this burst
+reg[15:0] delta_left, delta_burst;
+
+// The number of packets of this frame requested so far
+reg[31:0] delta_count;
+
+// The number of packets that have been fetched and skipped in delta mode
+reg[63:0] delta_sent, delta_skipped;
+
+// The semiphase the next burst comes from, and its offset in that semiphase
+wire       delta_sp      = (delta_offs >= semiphase_bytes);
+wire[31:0] delta_sp_offs = delta_sp ? delta_offs - semiphase_bytes : delta_offs;
+
+// A burst ends at the end of the packet or at a burst boundary, whichever
+// comes first
+wire[31:0] delta_room = AXI_BURST_SIZE - (delta_sp_offs % AXI_BURST_SIZE);
+wire[15:0] delta_len  = (delta_left < delta_room) ? delta_left : delta_room;
+
+// This is true when the frame-data request being issued is the last one of
+// its packet
+wire delta_last_burst = (delta_left == delta_burst);
+
+// Determine whether the current read-request is the final request of a frame
+assign ar_eof = ((icsm_state == ICSM_REQ_FD_SP1) & ~(burst_counter < bursts_per_semiphase))
+              | ((icsm_state == ICSM_SG_REQ_FD ) & sg_last_burst & sg_last_page 
+                                                 & sg_last_chunk & (sg_semiphase == 1))
+              | ((icsm_state == ICSM_DELTA_REQ_FD) & delta_last_burst 
+                                                   & (delta_pending[511:1] == 0));
 
 //-----------------------------------------------------------------------------
 
 always @(posedge clk) begin
 
-    // We will strobe this for one clock-cycle at a time
-    inc_pointer <= 0;
+    // We will strobe these for one clock-cycle at a time
+    inc_pointer   <= 0;
+    frame_dropped <= 0;
 
     if (resetn == 0) begin
-        icsm_state    <= 0;
+        icsm_state      <= 0;
+        desc_offs[0]    <= 0;
+        desc_offs[1]    <= 0;
+        desc_avail[0]   <= 0;
+        desc_avail[1]   <= 0;
+        expected_seq[0] <= 1;
+        expected_seq[1] <= 1;
+        desc_errors     <= 0;
+        delta_sent      <= 0;
+        delta_skipped   <= 0;
     end else case (icsm_state)
 
     // We wait for a command to arrive.  When it arrives, we save the phase
-    // number and begin an AXI request to obtain the metadata
+    // number and begin an AXI request to obtain the metadata.  A commit of
+    // a new configuration restarts the descriptor rings
     ICSM_WAIT_CMD:
-        if (AXIS_CMD_TVALID & AXIS_CMD_TREADY) begin
-            phase_select_reg <= AXIS_CMD_TDATA[0];
-            M_AXI_ARADDR     <= hmd_ptr[phase_select];
-            M_AXI_ARLEN      <= 2-1;
-            inc_pointer      <= INC_MD_PTR;
-            icsm_state       <= ICSM_REQ_METADATA;
+        if (cfg_commit) begin
+            desc_offs[0]  <= 0;
+            desc_offs[1]  <= 0;
+            desc_avail[0] <= 0;
+            desc_avail[1] <= 0;
+        end 
+        
+        else if (AXIS_CMD_TVALID & AXIS_CMD_TREADY) begin
+            phase_select_reg  <= AXIS_CMD_TDATA[0];
+            stream_select_reg <= AXIS_CMD_TDATA[3:1];
+            if (sg_stream)
+                icsm_state   <= ICSM_SG_CHECK;
+            else begin
+                M_AXI_ARADDR <= hmd_ptr[phase_select];
+                M_AXI_ARLEN  <= 2-1;
+                inc_pointer  <= INC_MD_PTR;
+                icsm_state   <= ICSM_REQ_METADATA;
+            end
         end
 
     // Wait for meta-data request to be accepted, then 
-    // issue the first request for frame data (from semiphase 0)
+    // issue the first request for frame data (from semiphase 0).  In delta
+    // mode, we must see the bitmap in the metadata first
     ICSM_REQ_METADATA:
         if (M_AXI_ARVALID & M_AXI_ARREADY) begin
             burst_counter <= 1;
             M_AXI_ARADDR  <= hfd_ptr[phase_select][0];
             M_AXI_ARLEN   <= AXI_BURST_CYCLES - 1;
+            delta_base[0] <= hfd_ptr[phase_select][0];
             inc_pointer   <= INC_FD0_PTR;
-            icsm_state    <= ICSM_REQ_FD_SP0;
+            icsm_state    <= delta_active ? ICSM_DELTA_MAP : ICSM_REQ_FD_SP0;
         end
 
     // Wait for our frame-data request to be accepted.
@@ -426,51 +822,557 @@ always @(posedge clk) begin
             end
         end
 
+    //-------------------------------------------------------------------------
+    //               From here down to SG_CHECK are the delta mode states
+    //-------------------------------------------------------------------------
+
+    // Wait for the bitmap to arrive.  An empty bitmap fetches packet 0
+    ICSM_DELTA_MAP:
+        if (delta_map_ready) begin
+            delta_base[1] <= hfd_ptr[phase_select][1];
+            inc_pointer   <= INC_FD1_PTR;
+            delta_pending <= (delta_dirty == 0) ? 1 : delta_dirty;
+            delta_offs    <= 0;
+            delta_count   <= 0;
+            icsm_state    <= ICSM_DELTA_SCAN;
+        end
+
+    // Skip over the packets that haven't changed, 8 at a time when we can
+    ICSM_DELTA_SCAN:
+        if (delta_pending[0]) begin
+            delta_left    <= PACKET_SIZE;
+            icsm_state    <= ICSM_DELTA_BURST;
+        end 
+        
+        else if (delta_pending[7:0] == 0) begin
+            delta_pending <= delta_pending >> 8;
+            delta_offs    <= delta_offs + 8 * PACKET_SIZE;
+        end 
+        
+        else begin
+            delta_pending <= delta_pending >> 1;
+            delta_offs    <= delta_offs + PACKET_SIZE;
+        end
+
+    // Set up a read-request for the next burst of the current packet
+    ICSM_DELTA_BURST:
+        begin
+            M_AXI_ARADDR  <= delta_base[delta_sp] + delta_sp_offs;
+            M_AXI_ARLEN   <= delta_len / PCIE_WIDTH - 1;
+            delta_burst   <= delta_len;
+            icsm_state    <= ICSM_DELTA_REQ_FD;
+        end
+
+    // Wait for our frame-data request to be accepted, then move on to the
+    // next burst of the packet, or the next changed packet
+    ICSM_DELTA_REQ_FD:
+        if (M_AXI_ARVALID & M_AXI_ARREADY) begin
+            delta_offs <= delta_offs + delta_burst;
+            
+            if (~delta_last_burst) begin
+                delta_left    <= delta_left - delta_burst;
+                icsm_state    <= ICSM_DELTA_BURST;
+            end 
+            
+            else if (delta_pending[511:1]) begin
+                delta_count   <= delta_count + 1;
+                delta_sent    <= delta_sent  + 1;
+                delta_pending <= delta_pending >> 1;
+                icsm_state    <= ICSM_DELTA_SCAN;
+            end
+
+            else begin
+                delta_sent    <= delta_sent + 1;
+                delta_skipped <= delta_skipped + PACKETS_PER_FRAME - delta_count - 1;
+                icsm_state    <= ICSM_WAIT_CMD;
+            end
+        end
+
+    //-------------------------------------------------------------------------
+    //            From here down are the scatter-gather mode states
+    //-------------------------------------------------------------------------
+
+    // If there are no cached descriptors for this phase, go fetch some
+    ICSM_SG_CHECK:
+        if (desc_avail[phase_select_reg] == 0) begin
+            M_AXI_ARADDR   <= host_desc_addr[phase_select_reg] + desc_offs[phase_select_reg];
+            M_AXI_ARLEN    <= desc_batch_len - 1;
+            desc_fetch_len <= desc_batch_len;
+            icsm_state     <= ICSM_SG_REQ_DESC;
+        end else
+            icsm_state     <= ICSM_SG_USE_DESC;
+
+    // Wait for our descriptor read-request to be accepted
+    ICSM_SG_REQ_DESC:
+        if (M_AXI_ARVALID & M_AXI_ARREADY) icsm_state <= ICSM_SG_WAIT_DESC;
+
+    // Wait for the descriptors to arrive in the cache
+    ICSM_SG_WAIT_DESC:
+        if (aux_done) begin
+            desc_avail[phase_select_reg] <= desc_fetch_len;
+            desc_slot [phase_select_reg] <= 0;
+            desc_fresh                   <= 1;
+            icsm_state                   <= ICSM_SG_USE_DESC;
+        end
+
+    // If the descriptor is the one we're expecting, fetch the metadata it
+    // points to.  A stale descriptor from the cache causes a re-fetch, and
+    // a bad descriptor that was just fetched causes the frame to be dropped
+    ICSM_SG_USE_DESC:
+        begin
+            desc_fresh <= 0;
+            
+            if (cur_desc_seq == expected_seq[phase_select_reg] || desc_fresh) begin
+                desc_offs   [phase_select_reg] <= next_desc_offs;
+                desc_slot   [phase_select_reg] <= desc_slot [phase_select_reg] + 1;
+                desc_avail  [phase_select_reg] <= desc_avail[phase_select_reg] - 1;
+                expected_seq[phase_select_reg] <= expected_seq[phase_select_reg] + 1;
+            end
+
+            if (cur_desc_seq == expected_seq[phase_select_reg]) begin
+                sg_plist_addr[0] <= cur_desc_sp0;
+                sg_plist_addr[1] <= cur_desc_sp1;
+                M_AXI_ARADDR     <= cur_desc_md;
+                M_AXI_ARLEN      <= 2-1;
+                icsm_state       <= ICSM_SG_REQ_MD;
+            end 
+            
+            else if (desc_fresh) begin
+                desc_errors      <= desc_errors + 1;
+                icsm_state       <= ICSM_SG_DROP;
+            end 
+            
+            else begin
+                desc_avail[phase_select_reg] <= 0;
+                icsm_state                   <= ICSM_SG_CHECK;
+            end
+        end
+
+    // Wait for the metadata request to be accepted
+    ICSM_SG_REQ_MD:
+        if (M_AXI_ARVALID & M_AXI_ARREADY) begin
+            sg_semiphase <= 0;
+            sg_page_base <= 0;
+            icsm_state   <= ICSM_SG_CHUNK;
+        end
+
+    // Set up a read-request for the next chunk of the page-list
+    ICSM_SG_CHUNK:
+        begin
+            chunk_pages  <= next_chunk_pages;
+            M_AXI_ARADDR <= sg_plist_addr[sg_semiphase] + 8 * sg_page_base;
+            M_AXI_ARLEN  <= (next_chunk_pages + 7) / 8 - 1;
+            icsm_state   <= ICSM_SG_REQ_PLIST;
+        end
+
+    // Wait for the page-list request to be accepted
+    ICSM_SG_REQ_PLIST:
+        if (M_AXI_ARVALID & M_AXI_ARREADY) icsm_state <= ICSM_SG_WAIT_PLST;
+
+    // Wait for that chunk of the page-list to arrive
+    ICSM_SG_WAIT_PLST:
+        if (aux_done) begin
+            page_idx   <= 0;
+            icsm_state <= ICSM_SG_PAGE;
+        end
+
+    // Set up the first read-request for the current page
+    ICSM_SG_PAGE:
+        begin
+            burst_counter <= 1;
+            M_AXI_ARADDR  <= page_addr;
+            M_AXI_ARLEN   <= AXI_BURST_CYCLES - 1;
+            icsm_state    <= ICSM_SG_REQ_FD;
+        end
+
+    // Wait for our frame-data request to be accepted, then move on to the
+    // next burst, the next page, the next chunk, or the next semiphase
+    ICSM_SG_REQ_FD:
+        if (M_AXI_ARVALID & M_AXI_ARREADY) begin
+            if (burst_counter < bursts_per_page) begin
+                burst_counter <= burst_counter + 1;
+                M_AXI_ARADDR  <= M_AXI_ARADDR + AXI_BURST_SIZE;
+            end 
+            
+            else if (page_idx + 1 < chunk_pages) begin
+                page_idx      <= page_idx + 1;
+                icsm_state    <= ICSM_SG_PAGE;
+            end
+            
+            else if (sg_page_base + chunk_pages < pages_per_semiphase) begin
+                sg_page_base  <= sg_page_base + chunk_pages;
+                icsm_state    <= ICSM_SG_CHUNK;
+            end
+            
+            else if (sg_semiphase == 0) begin
+                sg_semiphase  <= 1;
+                sg_page_base  <= 0;
+                icsm_state    <= ICSM_SG_CHUNK;
+            end
+            
+            else
+                icsm_state    <= ICSM_WAIT_CMD;
+        end
+
+    // A dropped frame is counted as "fetched" once every frame ahead of it
+    // has been fetched, so that the completion counters stay in order
+    ICSM_SG_DROP:
+        if (tag_empty) begin
+            frame_dropped <= 1;
+            icsm_state    <= ICSM_WAIT_CMD;
+        end
+
     endcase
 end
 //=============================================================================
 
 
 
+//=============================================================================
+// The tag FIFO: every read request pushes a tag that describes the data it
+// will return, and the tag is popped when the last beat of that data arrives.
+//
+// Each entry is {stream, frame-offset, delta-bitmap, phase, end-of-frame, 
+// kind-of-data}
+//
+// "frame-offset" is the byte offset within the frame of a delta mode burst,
+// and "delta-bitmap" is set on a metadata read whose bitmap we need
+//=============================================================================
+localparam TAG_FIFO_DEPTH = 64;
+reg[39:0] tag_fifo[0:TAG_FIFO_DEPTH-1];
+reg[6:0] tag_wptr, tag_rptr;
+
+// The FIFO is full when the write-pointer is a full lap ahead of the read-ptr
+assign tag_full  = ((tag_wptr - tag_rptr) == TAG_FIFO_DEPTH);
+assign tag_empty =  (tag_wptr == tag_rptr);
+
+// This is the tag of the data currently arriving on the R-channel
+wire[39:0] r_entry = tag_fifo[tag_rptr[5:0]];
+wire[ 1:0] r_tag   = r_entry[1:0];
+wire       r_eof   = r_entry[2];
+wire       r_phase = r_entry[3];
+wire       r_map   = r_entry[4];
+wire[31:0] r_offs  = r_entry[36:5];
+wire[ 2:0] r_stream = r_entry[39:37];
+
+// Whether the current read-request is a metadata read in delta mode
+wire ar_map = delta_active & (icsm_state == ICSM_REQ_METADATA);
+
+// Handshakes on the AR and R channels
+wire ar_handshake = M_AXI_ARVALID & M_AXI_ARREADY;
+wire r_handshake  = M_AXI_RVALID  & M_AXI_RREADY;
+//-----------------------------------------------------------------------------
+always @(posedge clk) begin
+    if (resetn == 0) begin
+        tag_wptr <= 0;
+        tag_rptr <= 0;
+    end else begin
+        if (ar_handshake) begin
+            tag_fifo[tag_wptr[5:0]] <= {stream_select_reg, delta_offs, ar_map, 
+                                        phase_select_reg, ar_eof, ar_tag};
+            tag_wptr                <= tag_wptr + 1;
+        end
+        if (r_handshake & M_AXI_RLAST) tag_rptr <= tag_rptr + 1;
+    end
+end
+//=============================================================================
+
+
+
 //=============================================================================
 // The output frame-data and meta-data output streams are directly connected
 // to the R-channel of the M_AXI interface
 //=============================================================================
 
-// The number of data-cycles for a full frame *including meta-data*
-wire[31:0] cycles_per_fd_plus_md = cycles_per_frame + 2;
+// Is the data we're currently receiving metadata or frame-data?
+wire is_metadata  = (r_tag == TAG_MD);
+wire is_framedata = (r_tag == TAG_FD);
 
-// As cycles of data arrive on the R-channel of M_AXI, this continuously counts
-// from 1 to "cycles_per_fd_plus_md"
-reg[31:0] output_cycle;
+// Tie TDATA and TVALID of the output streams to M_AXI's R-channel
+assign AXIS_MD_OUT_TDATA  = (is_metadata  == 1) ? M_AXI_RDATA : 0;
+assign AXIS_FD_OUT_TDATA  = (is_framedata == 1) ? M_AXI_RDATA : 0;
+assign AXIS_MD_OUT_TVALID = M_AXI_RVALID & is_metadata;
 
-// Is the data we're currently receiving metadata?
-wire is_metadata = (output_cycle <= 2);
+// Metadata carries the stream of its frame
+assign AXIS_MD_OUT_TUSER  = r_stream;
+assign AXIS_FD_OUT_TVALID = M_AXI_RVALID & is_framedata;
 
-// Tie TDATA and TVALID of the output streams to M_AXI's R-channel
-assign AXIS_MD_OUT_TDATA  = (is_metadata == 1) ? M_AXI_RDATA : 0;
-assign AXIS_FD_OUT_TDATA  = (is_metadata == 0) ? M_AXI_RDATA : 0;
-assign AXIS_MD_OUT_TVALID = M_AXI_RVALID &  is_metadata;
-assign AXIS_FD_OUT_TVALID = M_AXI_RVALID & ~is_metadata;
+// Frame-data carries the frame offset of its burst, and is flagged on the
+// last beat of its frame
+assign AXIS_FD_OUT_TUSER  = r_offs;
+assign AXIS_FD_OUT_TLAST  = AXIS_FD_OUT_TVALID & r_eof & M_AXI_RLAST;
 
 // Tell M_AXI that we're ready to receive when the appropriate output
-// stream is ready to receive
+// stream is ready to receive.  Descriptors and page-lists are always
+// accepted immediately.
 assign M_AXI_RREADY = (resetn == 1)
-                    & (is_metadata ? AXIS_MD_OUT_TREADY : AXIS_FD_OUT_TREADY);
+                    & (is_metadata  ? AXIS_MD_OUT_TREADY :
+                       is_framedata ? AXIS_FD_OUT_TREADY : 1);
+
+//-----------------------------------------------------------------------------
+// Descriptors and page-lists that arrive on the R-channel are stored in 
+// "desc_cache" and "plist".   "aux_done" strobes high when the last beat
+// of one of those reads arrives
+//-----------------------------------------------------------------------------
+reg[7:0] aux_beat;
+wire     aux_data = (r_tag == TAG_DESC) | (r_tag == TAG_PLIST);
+always @(posedge clk) begin
+
+    // This strobes high for a single cycle at a time
+    aux_done <= 0;
+
+    if (resetn == 0)
+        aux_beat <= 0;
+    else if (r_handshake & aux_data) begin
+        if (M_AXI_RLAST) begin
+            aux_beat <= 0;
+            aux_done <= 1;
+        end else
+            aux_beat <= aux_beat + 1;
+    end
+end
+
+always @(posedge clk) begin
+    if (r_handshake & (r_tag == TAG_DESC))
+        desc_cache[phase_select_reg][aux_beat] <= M_AXI_RDATA[255:0];
+    if (r_handshake & (r_tag == TAG_PLIST))
+        plist[aux_beat] <= M_AXI_RDATA;
+end
+//=============================================================================
+
+
+
+//=============================================================================
+// Count the frames that have been completely fetched from the host, per 
+// stream and phase
+//=============================================================================
+reg[31:0] frames_fetched[0:STREAMS-1][0:1];
+//-----------------------------------------------------------------------------
+always @(posedge clk) begin
+    if (resetn == 0) begin
+        for (s=0; s<STREAMS; s=s+1) begin
+            frames_fetched[s][0] <= 0;
+            frames_fetched[s][1] <= 0;
+        end
+    end 
+    
+    else if (r_handshake & M_AXI_RLAST & r_eof)
+        frames_fetched[r_stream][r_phase] <= frames_fetched[r_stream][r_phase] + 1;
+
+    else if (frame_dropped)
+        frames_fetched[stream_select_reg][phase_select_reg] 
+            <= frames_fetched[stream_select_reg][phase_select_reg] + 1;
+end
+//=============================================================================
+
+
+
+//=============================================================================
+// Count the frames whose read requests have all been issued, per stream and
+// phase, and capture the ring offsets of the next frame of that phase at the 
+// same time
+//
+// "frame_issued" is delayed by a cycle so that the pointer increments of the
+// frame (see "inc_pointer") have landed before the offsets are captured.  A 
+// dropped frame counts as issued.  Both strobes are valid in a cycle where
+// "phase_select_reg" and "stream_select_reg" still belong to the frame
+//=============================================================================
+reg[31:0] frames_issued[0:STREAMS-1][0:1];
+reg[63:0] issued_hfd_offs[0:STREAMS-1][0:1], issued_hmd_offs[0:STREAMS-1][0:1];
+reg       frame_issued;
+//-----------------------------------------------------------------------------
+always @(posedge clk) begin
+
+    frame_issued <= M_AXI_ARVALID & M_AXI_ARREADY & ar_eof;
+
+    if (resetn == 0) begin
+        for (s=0; s<STREAMS; s=s+1) for (p=0; p<2; p=p+1) begin
+            frames_issued  [s][p] <= 0;
+            issued_hfd_offs[s][p] <= 0;
+            issued_hmd_offs[s][p] <= 0;
+        end
+    end
+
+    else if (frame_issued | frame_dropped) begin
+        frames_issued  [stream_select_reg][phase_select_reg] 
+            <= frames_issued[stream_select_reg][phase_select_reg] + 1;
+        issued_hfd_offs[stream_select_reg][phase_select_reg] 
+            <= hfd_offs[stream_select_reg][phase_select_reg][1];
+        issued_hmd_offs[stream_select_reg][phase_select_reg] 
+            <= hmd_offs[stream_select_reg][phase_select_reg];
+    end
+
+    else if (cfg_commit) begin
+        for (s=0; s<STREAMS; s=s+1) for (p=0; p<2; p=p+1) begin
+            issued_hfd_offs[s][p] <= 0;
+            issued_hmd_offs[s][p] <= 0;
+        end
+    end
+end
+//=============================================================================
+
+
+
+//=============================================================================
+// The registers we use follow their shadows, unless the configuration is 
+// being staged, in which case they're updated only on "cfg_commit"
+//=============================================================================
+always @(posedge clk) begin
+    if (~cfg_stage | cfg_commit) begin
+        for (s=0; s<STREAMS; s=s+1) for (p=0; p<2; p=p+1) begin
+            host_fd_addr[s][p][0] <= shadow_fd_addr[s][p][0];
+            host_fd_addr[s][p][1] <= shadow_fd_addr[s][p][1];
+            host_md_addr[s][p]    <= shadow_md_addr[s][p];
+        end
+        host_fd_bytes      <= shadow_fd_bytes;
+        host_md_bytes      <= shadow_md_bytes;
+        sg_enable          <= shadow_sg_enable;
+        host_desc_addr[0]  <= shadow_desc_addr[0];
+        host_desc_addr[1]  <= shadow_desc_addr[1];
+        host_desc_bytes    <= shadow_desc_bytes;
+        DELTA_MODE         <= shadow_delta_enable;
+    end
+end
+//=============================================================================
+
+
+
+//=============================================================================
+// Configuration-commit state machine
+//
+// A commit waits until every frame that has been issued has also been 
+// delivered by the rdmx_shims, and nothing is being fetched.  Dropped frames
+// never reach the rdmx_shims, so they aren't counted.  After "cfg_commit",
+// we give rdmx_shim_ctl a few cycles to notice the new frame geometry before
+// we believe "cfg_settled"
+//
+// Drives:
+//    cfg_commit (strobe)
+//    csm_state
+//    cfg_cancelled
+//=============================================================================
+reg[1:0]  csm_state;
+localparam CSM_IDLE   = 0;
+localparam CSM_DRAIN  = 1;
+localparam CSM_SETTLE = 2;
+
+// The number of frames issued, and the number that have been delivered
+reg[31:0] frames_sent, frames_delivered;
+
+// Strobe high when 1 or 0 is written to REG_CFG_COMMIT
+reg       commit_request, commit_cancel;
+
+// Set when a commit is cancelled, cleared when the next one is requested
+reg       cfg_cancelled;
 
+// Counts down the cycles before we look at "cfg_settled"
+reg[1:0]  settle_wait;
+
+// The pipeline is empty when nothing is being fetched and nothing is in flight
+wire pipeline_empty = (icsm_state == ICSM_WAIT_CMD) & tag_empty 
+                    & ~frame_issued & ~frame_dropped
+                    & (frames_sent == frames_delivered);
+
+assign cfg_pending = (csm_state != CSM_IDLE);
 //-----------------------------------------------------------------------------
-// Here we count arriving data cycles, with "output_cycle" counting 
-// continuously from 1 to "cycles_per_fd_plus_md"
+always @(posedge clk) begin
+
+    // This strobes high for a single cycle at a time
+    cfg_commit <= 0;
+
+    if (resetn == 0) begin
+        csm_state        <= CSM_IDLE;
+        cfg_cancelled    <= 0;
+        frames_sent      <= 0;
+        frames_delivered <= 0;
+    end else begin
+
+        if (frame_issued)    frames_sent      <= frames_sent      + 1;
+        if (frame_delivered) frames_delivered <= frames_delivered + 1;
+
+        case (csm_state)
+
+            CSM_IDLE:
+                if (commit_request) begin
+                    cfg_cancelled <= 0;
+                    csm_state     <= CSM_DRAIN;
+                end
+
+            CSM_DRAIN:
+                if (commit_cancel) begin
+                    cfg_cancelled <= 1;
+                    csm_state     <= CSM_IDLE;
+                end else if (pipeline_empty) begin
+                    cfg_commit  <= 1;
+                    settle_wait <= 3;
+                    csm_state   <= CSM_SETTLE;
+                end
+
+            CSM_SETTLE:
+                if (settle_wait)
+                    settle_wait <= settle_wait - 1;
+                else if (cfg_settled)
+                    csm_state   <= CSM_IDLE;
+
+        endcase
+    end
+end
+//=============================================================================
+
+
+
+//=============================================================================
+// Record a trace entry when the first beat of each frame arrives
+//=============================================================================
+
+// This is high when the next beat on the R-channel is the first of its burst
+reg r_first_beat;
+always @(posedge clk) begin
+    if (resetn == 0)
+        r_first_beat <= 1;
+    else if (r_handshake)
+        r_first_beat <= M_AXI_RLAST;
+end
+
+// The first beat of a frame is the first beat of its metadata
+wire frame_started = r_handshake & is_metadata & r_first_beat;
+
+wire[63:0] trace_head;
+wire[15:0] trace_count;
+wire[31:0] trace_lost;
+reg        trace_pop;
 //-----------------------------------------------------------------------------
+trace_fifo fetch_trace
+(
+    .clk            (clk),
+    .resetn         (resetn),
+    .timestamp      (timestamp),
+    .event_strobe   (frame_started | frame_dropped),
+    .event_phase    (frame_started ? r_phase : phase_select_reg),
+    .head           (trace_head),
+    .pop            (trace_pop),
+    .count          (trace_count),
+    .overflows      (trace_lost)
+);
+//=============================================================================
+
+
+
+//=============================================================================
+// In delta mode, capture the bitmap from the first beat of each metadata 
+// record.  "delta_map_ready" stays high until the icsm has used it
+//=============================================================================
 always @(posedge clk) begin
     if (resetn == 0)
-        output_cycle <= 1;
-    else if (M_AXI_RVALID & M_AXI_RREADY) begin
-        if (output_cycle == cycles_per_fd_plus_md)
-            output_cycle <= 1;
-        else
-            output_cycle <= output_cycle + 1;
+        delta_map_ready <= 0;
+    
+    else if (r_handshake & is_metadata & r_first_beat & r_map) begin
+        delta_map       <= M_AXI_RDATA;
+        delta_map_ready <= 1;
     end
+
+    else if (icsm_state == ICSM_DELTA_MAP)
+        delta_map_ready <= 0;
 end
 //=============================================================================
 
@@ -483,9 +1385,15 @@ end
 //=============================================================================
 always @(posedge clk) begin
 
+    // These strobe high for a single cycle at a time
+    commit_request <= 0;
+    commit_cancel  <= 0;
+
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
-        ashi_write_state  <= 0;
+        ashi_write_state    <= 0;
+        cfg_stage           <= 0;
+        shadow_delta_enable <= 0;
 
     // If we're not in reset, and a write-request has occured...        
     end else case (ashi_write_state)
@@ -499,35 +1407,58 @@ always @(posedge clk) begin
                 case (ashi_windx)
                
                     // Phase 0 frame-data ring buffer addresses
-                    REG_HFD00_ADDR_H:   host_fd_addr[0][0][63:32] <= ashi_wdata;
-                    REG_HFD00_ADDR_L:   host_fd_addr[0][0][31:00] <= ashi_wdata;
-                    REG_HFD01_ADDR_H:   host_fd_addr[0][1][63:32] <= ashi_wdata;
-                    REG_HFD01_ADDR_L:   host_fd_addr[0][1][31:00] <= ashi_wdata;
+                    REG_HFD00_ADDR_H:   shadow_fd_addr[stream_sel][0][0][63:32] <= ashi_wdata;
+                    REG_HFD00_ADDR_L:   shadow_fd_addr[stream_sel][0][0][31:00] <= ashi_wdata;
+                    REG_HFD01_ADDR_H:   shadow_fd_addr[stream_sel][0][1][63:32] <= ashi_wdata;
+                    REG_HFD01_ADDR_L:   shadow_fd_addr[stream_sel][0][1][31:00] <= ashi_wdata;
 
                     // Phase 1 frame-data ring buffer addresses
-                    REG_HFD10_ADDR_H:   host_fd_addr[1][0][63:32] <= ashi_wdata;
-                    REG_HFD10_ADDR_L:   host_fd_addr[1][0][31:00] <= ashi_wdata;
-                    REG_HFD11_ADDR_H:   host_fd_addr[1][1][63:32] <= ashi_wdata;
-                    REG_HFD11_ADDR_L:   host_fd_addr[1][1][31:00] <= ashi_wdata;
+                    REG_HFD10_ADDR_H:   shadow_fd_addr[stream_sel][1][0][63:32] <= ashi_wdata;
+                    REG_HFD10_ADDR_L:   shadow_fd_addr[stream_sel][1][0][31:00] <= ashi_wdata;
+                    REG_HFD11_ADDR_H:   shadow_fd_addr[stream_sel][1][1][63:32] <= ashi_wdata;
+                    REG_HFD11_ADDR_L:   shadow_fd_addr[stream_sel][1][1][31:00] <= ashi_wdata;
 
                     // Meta-data ring buffers addresses for both phases
-                    REG_HMD0_ADDR_H:    host_md_addr[0][63:32] <= ashi_wdata;
-                    REG_HMD0_ADDR_L:    host_md_addr[0][31:00] <= ashi_wdata;
-                    REG_HMD1_ADDR_H:    host_md_addr[1][63:32] <= ashi_wdata;
-                    REG_HMD1_ADDR_L:    host_md_addr[1][31:00] <= ashi_wdata;
+                    REG_HMD0_ADDR_H:    shadow_md_addr[stream_sel][0][63:32] <= ashi_wdata;
+                    REG_HMD0_ADDR_L:    shadow_md_addr[stream_sel][0][31:00] <= ashi_wdata;
+                    REG_HMD1_ADDR_H:    shadow_md_addr[stream_sel][1][63:32] <= ashi_wdata;
+                    REG_HMD1_ADDR_L:    shadow_md_addr[stream_sel][1][31:00] <= ashi_wdata;
 
                     // Frame-data ring-buffer size in bytes
-                    REG_HFD_BYTES_H:    host_fd_bytes[63:32] <= ashi_wdata;
-                    REG_HFD_BYTES_L:    host_fd_bytes[31:00] <= ashi_wdata;
+                    REG_HFD_BYTES_H:    shadow_fd_bytes[63:32] <= ashi_wdata;
+                    REG_HFD_BYTES_L:    shadow_fd_bytes[31:00] <= ashi_wdata;
 
                     // Meta-data ring-buffer size in bytes
-                    REG_HMD_BYTES_H:    host_md_bytes[63:32] <= ashi_wdata;
-                    REG_HMD_BYTES_L:    host_md_bytes[31:00] <= ashi_wdata;
+                    REG_HMD_BYTES_H:    shadow_md_bytes[63:32] <= ashi_wdata;
+                    REG_HMD_BYTES_L:    shadow_md_bytes[31:00] <= ashi_wdata;
 
                     // Address of the ABM in Host-RAM
                     REG_ABM_ADDR_H:     host_abm_addr[63:32] <= ashi_wdata;
                     REG_ABM_ADDR_L:     host_abm_addr[31:00] <= ashi_wdata;
 
+                    // Scatter-gather mode control
+                    REG_DESC_CTRL:      shadow_sg_enable <= ashi_wdata[0];
+
+                    // Descriptor ring addresses for both phases
+                    REG_DESC0_ADDR_H:   shadow_desc_addr[0][63:32] <= ashi_wdata;
+                    REG_DESC0_ADDR_L:   shadow_desc_addr[0][31:00] <= ashi_wdata;
+                    REG_DESC1_ADDR_H:   shadow_desc_addr[1][63:32] <= ashi_wdata;
+                    REG_DESC1_ADDR_L:   shadow_desc_addr[1][31:00] <= ashi_wdata;
+
+                    // Descriptor ring size in bytes
+                    REG_DESC_BYTES_H:   shadow_desc_bytes[63:32] <= ashi_wdata;
+                    REG_DESC_BYTES_L:   shadow_desc_bytes[31:00] <= ashi_wdata;
+
+                    // Staged reconfiguration
+                    REG_CFG_CTRL:       cfg_stage      <= ashi_wdata[0];
+                    REG_CFG_COMMIT:     if (ashi_wdata[0])
+                                            commit_request <= 1;
+                                        else
+                                            commit_cancel  <= 1;
+
+                    // Delta mode control
+                    REG_DELTA_CTRL:     shadow_delta_enable <= ashi_wdata[0];
+
                     // Writes to any other register are a decode-error
                     default: ashi_wresp <= DECERR;
                 endcase
@@ -547,7 +1478,25 @@ end
 //=============================================================================
 // World's simplest state machine for handling AXI4-Lite read requests
 //=============================================================================
+
+// When the upper half of a trace entry, a ring offset or a delta mode counter
+// is read, the lower half is latched.  Each register has its own latch, so
+// reads of different registers can be interleaved
+reg[31:0] trace_lo;
+reg[31:0] hfd_offs_lo[0:1], hmd_offs_lo[0:1];
+reg[31:0] delta_sent_lo, delta_skipped_lo;
+
+// When reading the REG_STREAM_FETCHED table, this is the stream and phase
+wire[31:0] fetched_entry  = ashi_rindx - REG_STREAM_FETCHED;
+wire[ 2:0] fetched_stream = fetched_entry[3:1];
+wire       fetched_phase  = fetched_entry[0];
+wire       fetched_read   = (ashi_rindx >= REG_STREAM_FETCHED) & (fetched_entry < 2 * STREAMS);
+//-----------------------------------------------------------------------------
 always @(posedge clk) begin
+
+    // This strobes high for a single cycle at a time
+    trace_pop <= 0;
+
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
         ashi_read_state <= 0;
@@ -562,30 +1511,108 @@ always @(posedge clk) begin
         case (ashi_rindx)
            
             REG_MODULE_REV:     ashi_rdata <= MODULE_VERSION;
-            REG_HFD00_ADDR_H:   ashi_rdata <= host_fd_addr[0][0][63:32];
-            REG_HFD00_ADDR_L:   ashi_rdata <= host_fd_addr[0][0][31:00];
-            REG_HFD01_ADDR_H:   ashi_rdata <= host_fd_addr[0][1][63:32];
-            REG_HFD01_ADDR_L:   ashi_rdata <= host_fd_addr[0][1][31:00];
-            REG_HFD10_ADDR_H:   ashi_rdata <= host_fd_addr[1][0][63:32];
-            REG_HFD10_ADDR_L:   ashi_rdata <= host_fd_addr[1][0][31:00];
-            REG_HFD11_ADDR_H:   ashi_rdata <= host_fd_addr[1][1][63:32];
-            REG_HFD11_ADDR_L:   ashi_rdata <= host_fd_addr[1][1][31:00];
-
-            REG_HMD0_ADDR_H:    ashi_rdata <= host_md_addr[0][63:32];
-            REG_HMD0_ADDR_L:    ashi_rdata <= host_md_addr[0][31:00];
-            REG_HMD1_ADDR_H:    ashi_rdata <= host_md_addr[1][63:32];
-            REG_HMD1_ADDR_L:    ashi_rdata <= host_md_addr[1][31:00];
-
-            REG_HFD_BYTES_H:    ashi_rdata <= host_fd_bytes[63:32];
-            REG_HFD_BYTES_L:    ashi_rdata <= host_fd_bytes[31:00];
-            REG_HMD_BYTES_H:    ashi_rdata <= host_md_bytes[63:32];
-            REG_HMD_BYTES_L:    ashi_rdata <= host_md_bytes[31:00];
+            REG_HFD00_ADDR_H:   ashi_rdata <= shadow_fd_addr[stream_sel][0][0][63:32];
+            REG_HFD00_ADDR_L:   ashi_rdata <= shadow_fd_addr[stream_sel][0][0][31:00];
+            REG_HFD01_ADDR_H:   ashi_rdata <= shadow_fd_addr[stream_sel][0][1][63:32];
+            REG_HFD01_ADDR_L:   ashi_rdata <= shadow_fd_addr[stream_sel][0][1][31:00];
+            REG_HFD10_ADDR_H:   ashi_rdata <= shadow_fd_addr[stream_sel][1][0][63:32];
+            REG_HFD10_ADDR_L:   ashi_rdata <= shadow_fd_addr[stream_sel][1][0][31:00];
+            REG_HFD11_ADDR_H:   ashi_rdata <= shadow_fd_addr[stream_sel][1][1][63:32];
+            REG_HFD11_ADDR_L:   ashi_rdata <= shadow_fd_addr[stream_sel][1][1][31:00];
+
+            REG_HMD0_ADDR_H:    ashi_rdata <= shadow_md_addr[stream_sel][0][63:32];
+            REG_HMD0_ADDR_L:    ashi_rdata <= shadow_md_addr[stream_sel][0][31:00];
+            REG_HMD1_ADDR_H:    ashi_rdata <= shadow_md_addr[stream_sel][1][63:32];
+            REG_HMD1_ADDR_L:    ashi_rdata <= shadow_md_addr[stream_sel][1][31:00];
+
+            REG_HFD_BYTES_H:    ashi_rdata <= shadow_fd_bytes[63:32];
+            REG_HFD_BYTES_L:    ashi_rdata <= shadow_fd_bytes[31:00];
+            REG_HMD_BYTES_H:    ashi_rdata <= shadow_md_bytes[63:32];
+            REG_HMD_BYTES_L:    ashi_rdata <= shadow_md_bytes[31:00];
 
             REG_ABM_ADDR_H:     ashi_rdata <= host_abm_addr[63:32];
             REG_ABM_ADDR_L:     ashi_rdata <= host_abm_addr[31:00];
 
-            // Reads of any other register are a decode-error
-            default: ashi_rresp <= DECERR;
+            REG_DESC_CTRL:      ashi_rdata <= shadow_sg_enable;
+            REG_DESC0_ADDR_H:   ashi_rdata <= shadow_desc_addr[0][63:32];
+            REG_DESC0_ADDR_L:   ashi_rdata <= shadow_desc_addr[0][31:00];
+            REG_DESC1_ADDR_H:   ashi_rdata <= shadow_desc_addr[1][63:32];
+            REG_DESC1_ADDR_L:   ashi_rdata <= shadow_desc_addr[1][31:00];
+            REG_DESC_BYTES_H:   ashi_rdata <= shadow_desc_bytes[63:32];
+            REG_DESC_BYTES_L:   ashi_rdata <= shadow_desc_bytes[31:00];
+            REG_DESC_ERRORS:    ashi_rdata <= desc_errors;
+            REG_FETCHED0:       ashi_rdata <= frames_fetched[0][0];
+            REG_FETCHED1:       ashi_rdata <= frames_fetched[0][1];
+            REG_TRACE_COUNT:    ashi_rdata <= trace_count;
+            REG_TRACE_L:        ashi_rdata <= trace_lo;
+            REG_TRACE_LOST:     ashi_rdata <= trace_lost;
+            REG_ISSUED0:        ashi_rdata <= frames_issued[stream_sel][0];
+            REG_ISSUED1:        ashi_rdata <= frames_issued[stream_sel][1];
+            REG_HFD0_OFFS_L:    ashi_rdata <= hfd_offs_lo[0];
+            REG_HFD1_OFFS_L:    ashi_rdata <= hfd_offs_lo[1];
+            REG_HMD0_OFFS_L:    ashi_rdata <= hmd_offs_lo[0];
+            REG_HMD1_OFFS_L:    ashi_rdata <= hmd_offs_lo[1];
+            REG_CFG_CTRL:       ashi_rdata <= cfg_stage;
+            REG_CFG_COMMIT:     ashi_rdata <= {cfg_cancelled, cfg_pending};
+            REG_DELTA_CTRL:     ashi_rdata <= shadow_delta_enable;
+            REG_DELTA_SENT_L:   ashi_rdata <= delta_sent_lo;
+            REG_DELTA_SKIPPED_L: ashi_rdata <= delta_skipped_lo;
+
+            // Reading the upper half of a delta mode counter latches the
+            // lower half
+            REG_DELTA_SENT_H:
+                begin
+                    ashi_rdata <= delta_sent[63:32];
+                    delta_sent_lo <= delta_sent[31:00];
+                end
+
+            REG_DELTA_SKIPPED_H:
+                begin
+                    ashi_rdata <= delta_skipped[63:32];
+                    delta_skipped_lo <= delta_skipped[31:00];
+                end
+
+            // Reading the upper half of a ring offset latches the lower half
+            REG_HFD0_OFFS_H:
+                begin
+                    ashi_rdata <= issued_hfd_offs[stream_sel][0][63:32];
+                    hfd_offs_lo[0] <= issued_hfd_offs[stream_sel][0][31:00];
+                end
+
+            REG_HFD1_OFFS_H:
+                begin
+                    ashi_rdata <= issued_hfd_offs[stream_sel][1][63:32];
+                    hfd_offs_lo[1] <= issued_hfd_offs[stream_sel][1][31:00];
+                end
+
+            REG_HMD0_OFFS_H:
+                begin
+                    ashi_rdata <= issued_hmd_offs[stream_sel][0][63:32];
+                    hmd_offs_lo[0] <= issued_hmd_offs[stream_sel][0][31:00];
+                end
+
+            REG_HMD1_OFFS_H:
+                begin
+                    ashi_rdata <= issued_hmd_offs[stream_sel][1][63:32];
+                    hmd_offs_lo[1] <= issued_hmd_offs[stream_sel][1][31:00];
+                end
+
+            // Reading the upper half of a trace entry latches the lower
+            // half and removes the entry from the trace FIFO
+            REG_TRACE_H:
+                begin
+                    ashi_rdata <= trace_head[63:32];
+                    trace_lo   <= trace_head[31:0];
+                    trace_pop  <= 1;
+                end
+
+            // The completion counters of every stream are a table, and reads
+            // of any other register are a decode-error
+            default:
+                if (fetched_read)
+                    ashi_rdata <= frames_fetched[fetched_stream][fetched_phase];
+                else
+                    ashi_rresp <= DECERR;
         endcase
     end
 end
@@ -0,0 +1,53 @@
+// data_fetch_regs.vh - AXI register map of data_fetch
+// Generated by mindyregs from software/src/mindylib/mindy_regs.def - don't edit by hand
+localparam REG_MODULE_REV           =  0;  // Module version
+localparam REG_HFD00_ADDR_H         =  1;  // Host frame data, phase 0, semi-phase 0
+localparam REG_HFD00_ADDR_L         =  2;
+localparam REG_HFD01_ADDR_H         =  3;  // Host frame data, phase 0, semi-phase 1
+localparam REG_HFD01_ADDR_L         =  4;
+localparam REG_HFD10_ADDR_H         =  5;  // Host frame data, phase 1, semi-phase 0
+localparam REG_HFD10_ADDR_L         =  6;
+localparam REG_HFD11_ADDR_H         =  7;  // Host frame data, phase 1, semi-phase 1
+localparam REG_HFD11_ADDR_L         =  8;
+localparam REG_HMD0_ADDR_H          =  9;  // Host metadata, phase 0
+localparam REG_HMD0_ADDR_L          = 10;
+localparam REG_HMD1_ADDR_H          = 11;  // Host metadata, phase 1
+localparam REG_HMD1_ADDR_L          = 12;
+localparam REG_HFD_BYTES_H          = 13;  // Host frame-data buffer, size in bytes
+localparam REG_HFD_BYTES_L          = 14;
+localparam REG_HMD_BYTES_H          = 15;  // Host meta-data buffer, size in bytes
+localparam REG_HMD_BYTES_L          = 16;
+localparam REG_ABM_ADDR_H           = 17;  // Host ABM buffer
+localparam REG_ABM_ADDR_L           = 18;
+localparam REG_DESC_CTRL            = 19;  // Bit 0 = 1 means "scatter-gather mode"
+localparam REG_DESC0_ADDR_H         = 20;  // Descriptor ring, phase 0
+localparam REG_DESC0_ADDR_L         = 21;
+localparam REG_DESC1_ADDR_H         = 22;  // Descriptor ring, phase 1
+localparam REG_DESC1_ADDR_L         = 23;
+localparam REG_DESC_BYTES_H         = 24;  // Descriptor ring, size in bytes
+localparam REG_DESC_BYTES_L         = 25;
+localparam REG_DESC_ERRORS          = 26;  // Number of frames dropped for bad descriptors
+localparam REG_FETCHED0             = 27;  // Number of phase 0 frames fetched
+localparam REG_FETCHED1             = 28;  // Number of phase 1 frames fetched
+localparam REG_TRACE_COUNT          = 29;  // Number of entries in the trace FIFO
+localparam REG_TRACE_H              = 30;  // Oldest trace entry (reading upper half pops it)
+localparam REG_TRACE_L              = 31;
+localparam REG_TRACE_LOST           = 32;  // Number of trace entries lost to overflow
+localparam REG_HFD0_OFFS_H          = 33;  // Offset in the phase 0 HFD buffers of the next frame to fetch
+localparam REG_HFD0_OFFS_L          = 34;
+localparam REG_HFD1_OFFS_H          = 35;  // Offset in the phase 1 HFD buffers of the next frame to fetch
+localparam REG_HFD1_OFFS_L          = 36;
+localparam REG_HMD0_OFFS_H          = 37;  // Offset in the phase 0 HMD buffer of the next frame to fetch
+localparam REG_HMD0_OFFS_L          = 38;
+localparam REG_HMD1_OFFS_H          = 39;  // Offset in the phase 1 HMD buffer of the next frame to fetch
+localparam REG_HMD1_OFFS_L          = 40;
+localparam REG_ISSUED0              = 41;  // Number of phase 0 frames whose fetch has been issued
+localparam REG_ISSUED1              = 42;  // Number of phase 1 frames whose fetch has been issued
+localparam REG_CFG_CTRL             = 43;  // Bit 0 = 1 means "configuration writes are staged"
+localparam REG_CFG_COMMIT           = 44;  // Write 1 to apply the staged configuration, 0 to cancel.  Bit 0 = pending, bit 1 = cancelled
+localparam REG_DELTA_CTRL           = 45;  // Bit 0 = 1 means "delta mode": only changed packets are sent
+localparam REG_DELTA_SENT_H         = 46;  // Packets fetched in delta mode
+localparam REG_DELTA_SENT_L         = 47;
+localparam REG_DELTA_SKIPPED_H      = 48;  // Packets skipped in delta mode because they hadn't changed
+localparam REG_DELTA_SKIPPED_L      = 49;
+localparam REG_STREAM_FETCHED       = 64;  // Table of fetched-frame counts, at STREAM_FETCHED + 2 * stream + phase
@@ -5,6 +5,11 @@
 //   Date     Who   Ver  Changes
 //=============================================================================
 // 16-Dec-23  DWW     1  Initial creation
+// 18-Oct-26  DWW     2  Added the "frame add" registers
+// 18-Oct-26  DWW     3  Added the timestamp counter and command trace
+// 18-Oct-26  DWW     4  Added multiple streams, with weighted round-robin
+// 19-Oct-26  DWW     5  Frame-add counts are limited to 24 bits, and the
+//                       pending counts saturate instead of wrapping
 //============================================================================
 
 /*
@@ -13,9 +18,54 @@
 
     If a zero value is written to a frame counter, both frame counters are set
     to zero, and a reset is asserted to the rest of the module
+
+    Writing a value N to one of the "frame add" registers adds N to the
+    corresponding frame counter and queues N commands for that phase.  This
+    allows software to submit a batch of frames with a single PCIe write, 
+    and since the addition is performed here, several threads can submit
+    frames without having to read the frame counter first.  Reading a 
+    "frame add" register returns the number of commands that are still 
+    waiting to be written to the command-FIFO.  As with REG_STREAM_ADD,
+    N is limited to 24 bits: a larger value is a slave-error and adds 
+    nothing.
+
+    This module also owns the free-running 64-bit timestamp counter that
+    every other trace point in the design uses, and records a trace entry
+    (see trace_fifo.v) each time a command is written to the command-FIFO.
+
+    Commands that arrive via the "frame add" registers or via the frame
+    counters themselves are held in per-phase pending counts and are written
+    to the command-FIFO only when it has room, so the order of commands 
+    within each phase is always preserved.  Should a pending count ever
+    reach 2^32, it sticks there and "fifo_overflow" is held high until the
+    frame counters are next cleared, since commands have been lost.
+
+    Streams:
+
+    The card can carry STREAMS (up to 8) independent streams of frames.  Each
+    has its own pair of frame counters, its own host buffers (in data_fetch),
+    and its own remote rings and remote frame counter (in rdmx_shim_ctl).  
+    The frame counters and frame-add registers above belong to stream 0, and 
+    every stream's counters can be read in the REG_STREAM_CTR table, at 
+    index REG_STREAM_CTR + 2 * stream + phase.
+
+    Frames of any stream are submitted by writing REG_STREAM_ADD with the
+    stream in bits 31:28, the phase in bit 24 and the number of frames in 
+    bits 23:0, so a submission is still a single write.  Reading it returns 
+    the number of commands of every stream still waiting for the FIFO.
+
+    When more than one stream has commands pending, they take turns: a 
+    stream may write up to its weight (bits 4*N+3:4*N of REG_STREAM_WEIGHTS
+    for stream N, where 0 counts as 1) commands before the next stream with
+    commands pending gets its turn.  Within a stream, the phases alternate
+    as they always have.  Each command is {stream, phase}: the stream in 
+    bits 3:1 and the phase in bit 0.
+
+    REG_STREAM_SEL drives "stream_sel", which chooses the stream whose ring
+    registers data_fetch and rdmx_shim_ctl present to the AXI bus.
 */
 
-module frame_counters
+module frame_counters # (parameter STREAMS = 4)
 (
     (* X_INTERFACE_INFO = "xilinx.com:signal:clock:1.0 clk CLK" *)
     (* X_INTERFACE_PARAMETER = "ASSOCIATED_RESET resetn:external_resetn" *)
@@ -23,12 +73,19 @@ module frame_counters
     input   resetn,
 
     // This is asserted on any clock cycle when we are trying to write to the
-    // command FIFO, but it isn't ready to receive 
+    // command FIFO, but it isn't ready to receive, and is held high once a
+    // pending count has overflowed
     output  fifo_overflow,
 
     // This resets modules external to this one
     output  external_resetn,
 
+    // Free-running timestamp counter, one tick per clock cycle
+    output reg[63:0] timestamp,
+
+    // The stream whose registers data_fetch and rdmx_shim_ctl present
+    output reg[2:0] stream_sel,
+
     //================== This is an AXI4-Lite slave interface =================
         
     // "Specify write address"              -- Master --    -- Slave --
@@ -73,12 +130,10 @@ module frame_counters
 
 // Any time the register map of this module changes, this number should
 // be bumped
-localparam MODULE_VERSION = 1;
+localparam MODULE_VERSION = 4;
 
 //=========================  AXI Register Map  =============================
-localparam REG_MODULE_REV       = 0;
-localparam REG_FRAME_CTR_0      = 1;
-localparam REG_FRAME_CTR_1      = 2;
+`include "frame_counters_regs.vh"
 //==========================================================================
 
 
@@ -123,11 +178,43 @@ reg[7:0] axis_cmd_tdata;
 reg      axis_cmd_tvalid;
 wire     axis_cmd_tready;
 
-// Assert the "overflow" signal if we attempt to write to a full FIFO
-assign fifo_overflow = axis_cmd_tvalid & ~axis_cmd_tready;
+// This goes high when a pending count overflows, and stays high until reset
+reg pending_overflow;
+
+// Assert the "overflow" signal if we attempt to write to a full FIFO, or if
+// commands have been lost to a pending count that overflowed
+assign fifo_overflow = (axis_cmd_tvalid & ~axis_cmd_tready) | pending_overflow;
+
+// Thse are frame counters, one for each phase of each stream
+reg[31:0] frame_counter[0:STREAMS-1][0:1];
+
+// The number of commands to add to the pending count of one phase of one
+// stream.  These are driven by the AXI write state-machine and "add_count"
+// is only non-zero for one cycle at a time
+reg[31:0] add_count;
+reg[ 2:0] add_stream;
+reg       add_phase;
+
+// The number of commands for each phase of each stream waiting to be 
+// written to the FIFO
+reg[31:0] pending[0:STREAMS-1][0:1];
+
+// The number of commands each stream may write per turn, 4 bits per stream
+reg[31:0] stream_weights;
 
-// Thse are frame counters, one for each phase
-reg[31:0] frame_counter[0:1];
+// The fields of a write to REG_STREAM_ADD
+wire[ 3:0] sa_stream = ashi_wdata[31:28];
+wire       sa_phase  = ashi_wdata[24];
+wire[23:0] sa_count  = ashi_wdata[23:0];
+
+// When reading the REG_STREAM_CTR table, this is the stream and phase
+wire[31:0] ctr_entry  = ashi_rindx - REG_STREAM_CTR;
+wire[ 2:0] ctr_stream = ctr_entry[3:1];
+wire       ctr_phase  = ctr_entry[0];
+wire       ctr_read   = (ashi_rindx >= REG_STREAM_CTR) & (ctr_entry < 2 * STREAMS);
+
+// Loop counters
+integer s, p;
 
 // External resetn is asserted when this is non-zero
 reg[7:0] reset_counter;
@@ -138,15 +225,15 @@ assign external_resetn = ~((resetn == 0) | (reset_counter != 0));
 //==========================================================================
 // This state machine handles AXI4-Lite write requests
 //
-// Drives: frame_counter[0] and frame_counter[1]
+// Drives: frame_counter[][]
 //         resetn_counter (and therefore external_resetn)
-//         axis_cmd_tdata
-//         axis_cmd_tvalid
+//         add_count, add_stream, add_phase
+//         stream_sel, stream_weights
 //==========================================================================
 always @(posedge clk) begin
 
-    // This strobe high for a single cycle at a time
-    axis_cmd_tvalid <= 0;
+    // This is only non-zero for a single cycle at a time
+    add_count <= 0;
 
     // This controls "external_resetn"
     if (reset_counter) reset_counter <= reset_counter - 1;
@@ -154,6 +241,8 @@ always @(posedge clk) begin
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
         ashi_write_state  <= 0;
+        stream_sel        <= 0;
+        stream_weights    <= 32'h11111111;
 
     // If we're not in reset, and a write-request has occured...        
     end else case (ashi_write_state)
@@ -168,28 +257,73 @@ always @(posedge clk) begin
                
                     REG_FRAME_CTR_0:
                         if (ashi_wdata == 0) begin
-                            frame_counter[0] <= 0;
-                            frame_counter[1] <= 0;
+                            for (s=0; s<STREAMS; s=s+1) begin
+                                frame_counter[s][0] <= 0;
+                                frame_counter[s][1] <= 0;
+                            end
                             reset_counter    <= 16;
                             ashi_write_state <= 1;
-                        end else if (ashi_wdata != frame_counter[0]) begin
-                            frame_counter[0] <= ashi_wdata;
-                            axis_cmd_tdata   <= 0;
-                            axis_cmd_tvalid  <= 1;
+                        end else if (ashi_wdata != frame_counter[0][0]) begin
+                            frame_counter[0][0] <= ashi_wdata;
+                            add_count           <= 1;
+                            add_stream          <= 0;
+                            add_phase           <= 0;
                         end      
 
                     REG_FRAME_CTR_1:
                         if (ashi_wdata == 0) begin
-                            frame_counter[0] <= 0;
-                            frame_counter[1] <= 0;
+                            for (s=0; s<STREAMS; s=s+1) begin
+                                frame_counter[s][0] <= 0;
+                                frame_counter[s][1] <= 0;
+                            end
                             reset_counter    <= 16;
                             ashi_write_state <= 1;
-                        end else if (ashi_wdata != frame_counter[1]) begin
-                            frame_counter[1] <= ashi_wdata;
-                            axis_cmd_tdata   <= 1;
-                            axis_cmd_tvalid  <= 1;
+                        end else if (ashi_wdata != frame_counter[0][1]) begin
+                            frame_counter[0][1] <= ashi_wdata;
+                            add_count           <= 1;
+                            add_stream          <= 0;
+                            add_phase           <= 1;
                         end      
 
+                    // A count wider than 24 bits is a slave-error
+                    REG_FRAME_ADD_0:
+                        if (ashi_wdata[31:24] == 0) begin
+                            frame_counter[0][0] <= frame_counter[0][0] + ashi_wdata;
+                            add_count           <= ashi_wdata;
+                            add_stream          <= 0;
+                            add_phase           <= 0;
+                        end else
+                            ashi_wresp <= SLVERR;
+
+                    REG_FRAME_ADD_1:
+                        if (ashi_wdata[31:24] == 0) begin
+                            frame_counter[0][1] <= frame_counter[0][1] + ashi_wdata;
+                            add_count           <= ashi_wdata;
+                            add_stream          <= 0;
+                            add_phase           <= 1;
+                        end else
+                            ashi_wresp <= SLVERR;
+
+                    // A submission for any stream.  A stream we don't have 
+                    // is a slave-error
+                    REG_STREAM_ADD:
+                        if (sa_stream < STREAMS) begin
+                            frame_counter[sa_stream][sa_phase] 
+                                       <= frame_counter[sa_stream][sa_phase] + sa_count;
+                            add_count  <= sa_count;
+                            add_stream <= sa_stream;
+                            add_phase  <= sa_phase;
+                        end else
+                            ashi_wresp <= SLVERR;
+
+                    REG_STREAM_SEL:
+                        if (ashi_wdata < STREAMS)
+                            stream_sel <= ashi_wdata;
+                        else
+                            ashi_wresp <= SLVERR;
+
+                    REG_STREAM_WEIGHTS: stream_weights <= ashi_wdata;
+
                     // Writes to any other register are a decode-error
                     default: ashi_wresp <= DECERR;
                 endcase
@@ -204,12 +338,168 @@ end
 
 
 
+//==========================================================================
+// This state machine writes pending commands to the command-FIFO, one 
+// command at a time.  The streams with commands pending take turns (see 
+// "Streams" above), and within a stream we alternate between the phases
+// when both have commands pending
+//
+// Drives: pending[][], pending_overflow
+//         cur_stream, credit, last_phase[]
+//         axis_cmd_tdata
+//         axis_cmd_tvalid
+//==========================================================================
+
+// This is the phase that we last wrote a command for, per stream
+reg last_phase[0:STREAMS-1];
+
+// The stream whose turn it is, and how many more commands it may write
+reg[2:0] cur_stream;
+reg[3:0] credit;
+
+// We'll write a command on any cycle when the FIFO has room and we're not
+// already writing one.  ("tready" isn't valid for the cycle after a write)
+wire fifo_has_room = axis_cmd_tready & ~axis_cmd_tvalid;
+
+// Which streams have commands pending, and the weight of each stream
+reg[STREAMS-1:0] has_pending;
+reg[3:0]         weight[0:STREAMS-1];
+always @* begin
+    for (s=0; s<STREAMS; s=s+1) begin
+        has_pending[s] = (pending[s][0] != 0) | (pending[s][1] != 0);
+        weight[s]      = (stream_weights[4*s +: 4] == 0) ? 1 : stream_weights[4*s +: 4];
+    end
+end
+
+// The first stream after "cur_stream" (wrapping around to "cur_stream"
+// itself) that has commands pending
+reg[2:0] next_stream;
+reg      next_found;
+always @* begin
+    next_stream = cur_stream;
+    next_found  = 0;
+    for (s=1; s<=STREAMS; s=s+1) begin
+        if (~next_found & has_pending[(cur_stream + s) % STREAMS]) begin
+            next_stream = (cur_stream + s) % STREAMS;
+            next_found  = 1;
+        end
+    end
+end
+
+// The current stream keeps its turn while it has commands and credit left
+wire       keep_turn    = has_pending[cur_stream] & (credit != 0);
+
+// Determine which stream and phase (if any) we should write a command for
+wire       issue        = fifo_has_room & (has_pending != 0);
+wire[2:0]  issue_stream = keep_turn ? cur_stream : next_stream;
+wire       issue_phase  = ~((pending[issue_stream][0] != 0) 
+                        & ((pending[issue_stream][1] == 0) | (last_phase[issue_stream] == 1)));
 
+// A pending count plus the commands being added to it, with room for a carry
+reg[32:0]  pending_sum;
+//--------------------------------------------------------------------------
+always @(posedge clk) begin
+
+    // This strobes high for a single cycle at a time
+    axis_cmd_tvalid <= 0;
+
+    // If we're in reset, there are no commands pending
+    if (resetn == 0 || reset_counter != 0) begin
+        for (s=0; s<STREAMS; s=s+1) begin
+            pending[s][0] <= 0;
+            pending[s][1] <= 0;
+            last_phase[s] <= 1;
+        end
+        cur_stream       <= 0;
+        credit           <= 0;
+        pending_overflow <= 0;
+    end 
+    
+    else begin
+        for (s=0; s<STREAMS; s=s+1) for (p=0; p<2; p=p+1) begin
+            pending_sum = pending[s][p] 
+                        + ((add_stream == s && add_phase == p) ? add_count : 0);
+            if (pending_sum[32]) begin
+                pending[s][p]    <= 32'hFFFFFFFF;
+                pending_overflow <= 1;
+            end else
+                pending[s][p]    <= pending_sum
+                                  - (issue && issue_stream == s && issue_phase == p);
+        end
+
+        if (issue) begin
+            axis_cmd_tdata             <= {4'b0, issue_stream, issue_phase};
+            axis_cmd_tvalid            <= 1;
+            last_phase[issue_stream]   <= issue_phase;
+            if (keep_turn)
+                credit                 <= credit - 1;
+            else begin
+                cur_stream             <= issue_stream;
+                credit                 <= weight[issue_stream] - 1;
+            end
+        end
+    end
+end
+//==========================================================================
+
+
+
+
+
+//==========================================================================
+// The free-running timestamp counter.  This is only reset by a hard reset,
+// not by the reset that clearing the frame counters generates
+//==========================================================================
+always @(posedge clk) begin
+    if (resetn == 0)
+        timestamp <= 0;
+    else
+        timestamp <= timestamp + 1;
+end
+//==========================================================================
+
+
+//==========================================================================
+// Record a trace entry every time a command is written to the FIFO
+//==========================================================================
+wire[63:0] trace_head;
+wire[15:0] trace_count;
+wire[31:0] trace_lost;
+reg        trace_pop;
+//--------------------------------------------------------------------------
+trace_fifo cmd_trace
+(
+    .clk            (clk),
+    .resetn         (external_resetn),
+    .timestamp      (timestamp),
+    .event_strobe   (issue),
+    .event_phase    (issue_phase),
+    .head           (trace_head),
+    .pop            (trace_pop),
+    .count          (trace_count),
+    .overflows      (trace_lost)
+);
+//==========================================================================
+
+
+// When the upper half of a 64-bit value is read, the lower half is latched
+reg[31:0] latched_lo;
+
+// The number of commands of every stream waiting to be written to the FIFO
+reg[31:0] pending_total;
+always @* begin
+    pending_total = 0;
+    for (s=0; s<STREAMS; s=s+1) pending_total = pending_total + pending[s][0] + pending[s][1];
+end
 
 //==========================================================================
 // World's simplest state machine for handling AXI4-Lite read requests
 //==========================================================================
 always @(posedge clk) begin
+
+    // This strobes high for a single cycle at a time
+    trace_pop <= 0;
+
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
         ashi_read_state <= 0;
@@ -225,11 +515,42 @@ always @(posedge clk) begin
             
             // Allow a read from any valid register                
             REG_MODULE_REV:     ashi_rdata <= MODULE_VERSION;
-            REG_FRAME_CTR_0:    ashi_rdata <= frame_counter[0];
-            REG_FRAME_CTR_1:    ashi_rdata <= frame_counter[1];
+            REG_FRAME_CTR_0:    ashi_rdata <= frame_counter[0][0];
+            REG_FRAME_CTR_1:    ashi_rdata <= frame_counter[0][1];
+            REG_FRAME_ADD_0:    ashi_rdata <= pending[0][0];
+            REG_FRAME_ADD_1:    ashi_rdata <= pending[0][1];
+            REG_STREAMS:        ashi_rdata <= STREAMS;
+            REG_STREAM_SEL:     ashi_rdata <= stream_sel;
+            REG_STREAM_ADD:     ashi_rdata <= pending_total;
+            REG_STREAM_WEIGHTS: ashi_rdata <= stream_weights;
+            REG_TRACE_COUNT:    ashi_rdata <= trace_count;
+            REG_TRACE_LOST:     ashi_rdata <= trace_lost;
+            REG_TIMESTAMP_L:    ashi_rdata <= latched_lo;
+            REG_TRACE_L:        ashi_rdata <= latched_lo;
+
+            // Reading the upper half of the timestamp latches the lower half
+            REG_TIMESTAMP_H:
+                begin
+                    ashi_rdata <= timestamp[63:32];
+                    latched_lo <= timestamp[31:0];
+                end
+
+            // Reading the upper half of a trace entry latches the lower
+            // half and removes the entry from the trace FIFO
+            REG_TRACE_H:
+                begin
+                    ashi_rdata <= trace_head[63:32];
+                    latched_lo <= trace_head[31:0];
+                    trace_pop  <= 1;
+                end
             
-            // Reads of any other register are a decode-error
-            default: ashi_rresp <= DECERR;
+            // The frame counters of every stream are a table, and reads of 
+            // any other register are a decode-error
+            default:
+                if (ctr_read)
+                    ashi_rdata <= frame_counter[ctr_stream][ctr_phase];
+                else
+                    ashi_rresp <= DECERR;
         endcase
     end
 end
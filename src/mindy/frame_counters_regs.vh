@@ -0,0 +1,18 @@
+// frame_counters_regs.vh - AXI register map of frame_counters
+// Generated by mindyregs from software/src/mindylib/mindy_regs.def - don't edit by hand
+localparam REG_MODULE_REV           =  0;  // Module version
+localparam REG_FRAME_CTR_0          =  1;  // Local frame counter, phase 0
+localparam REG_FRAME_CTR_1          =  2;  // Local frame counter, phase 1
+localparam REG_FRAME_ADD_0          =  3;  // Writing N (up to 2^24 - 1) submits N phase 0 frames
+localparam REG_FRAME_ADD_1          =  4;  // Writing N (up to 2^24 - 1) submits N phase 1 frames
+localparam REG_TIMESTAMP_H          =  5;  // Free-running timestamp counter
+localparam REG_TIMESTAMP_L          =  6;
+localparam REG_TRACE_COUNT          =  7;  // Number of entries in the trace FIFO
+localparam REG_TRACE_H              =  8;  // Oldest trace entry (reading upper half pops it)
+localparam REG_TRACE_L              =  9;
+localparam REG_TRACE_LOST           = 10;  // Number of trace entries lost to overflow
+localparam REG_STREAMS              = 11;  // Number of streams the card supports
+localparam REG_STREAM_SEL           = 12;  // Stream whose ring and buffer registers are visible
+localparam REG_STREAM_ADD           = 13;  // Bits 31:28 = stream, bit 24 = phase, bits 23:0 = frames to submit
+localparam REG_STREAM_WEIGHTS       = 14;  // Frames per turn, 4 bits per stream (0 means 1)
+localparam REG_STREAM_CTR           = 16;  // Table of frame counters, at STREAM_CTR + 2 * stream + phase
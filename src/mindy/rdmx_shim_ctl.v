@@ -5,23 +5,136 @@
 //   Date     Who   Ver  Changes
 //====================================================================================
 // 16-Dec-23  DWW     1  Initial creation
+// 18-Oct-26  DWW     2  Added meta-data stamping and the end-of-frame traces
+// 18-Oct-26  DWW     3  Added the ping_ponger steering controls and link counters
+// 18-Oct-26  DWW     4  Computes PACKETS_PER_FRAME for any packet size
+// 18-Oct-26  DWW     5  Added the shadow registers for staged reconfiguration
+// 18-Oct-26  DWW     6  Added the frame-counter coalescing controls and counters
+// 18-Oct-26  DWW     7  Remote rings and frame counters are per-stream
 //====================================================================================
 
 /*
     This module provides configuration information to the rdmx_shim modules
+
+    It also records two traces (see trace_fifo.v):
+
+      - When the last packet of each frame leaves the ping-ponger
+      - When both rdmx_shims have written the frame-counter for a frame
+
+    It also holds the ping_ponger's steering policy and reports the number of
+    packets and bytes the ping_ponger has written to each link.  Reading the 
+    upper half of one of those 64-bit counters latches the lower half.
+
+    PACKETS_PER_FRAME is computed here by a small sequential divider, which 
+    restarts whenever FRAME_SIZE or PACKET_SIZE changes, and takes 33 cycles.
+    That lets PACKET_SIZE be any multiple of 64 up to MAX_PACKET_SIZE, rather
+    than only a power of 2.
+
+    The trace FIFOs are reset by "frame_resetn" (the reset that frame_counters
+    generates) so that their frame sequence numbers stay in step with the
+    trace points in frame_counters and data_fetch.
+
+    Staged reconfiguration:
+
+    The ring geometry, FRAME_SIZE, PACKET_SIZE and PACKETS_PER_GROUP are
+    written into shadow registers, and reads return the shadow registers.
+    While "cfg_stage" (from data_fetch) is low, the outputs follow the 
+    shadows.  While it's high, the outputs only take on the shadow values 
+    when data_fetch strobes "cfg_commit", which it does when no frame is
+    in flight.  The same cycle, RING_RESTART tells the rdmx_shims to start
+    over at the beginning of their ring buffers.
+
+    Frame-counter coalescing:
+
+    REG_FC_COALESCE is the number of frames per write of the remote frame-
+    counter (0 or 1 means every frame) and REG_FC_TIMEOUT is the longest, in
+    microseconds, that the count of a completed frame may go unwritten (0 
+    means no limit).  See rdmx_shim.v.  REG_FC_UPDATES counts the frame-
+    counter writes made by both rdmx_shims, and REG_FC_SAVED counts the 
+    frames for which an rdmx_shim didn't write it.  Both reset along with 
+    the frame counters.
+
+    "cfg_settled" goes low whenever FRAME_SIZE or PACKET_SIZE changes, and
+    high again once PACKETS_PER_FRAME has been recomputed.  "frame_delivered"
+    strobes once per frame, when both rdmx_shims have written the frame-
+    counter for it.
+
+    Streams:
+
+    Each of the STREAMS streams (see frame_counters.v) has its own remote 
+    frame-data ring, meta-data ring and frame-counter address.  Those 
+    registers are banked: they belong to the stream selected by "stream_sel"
+    (REG_STREAM_SEL in frame_counters).  The RFD, RMD and RFC outputs hold
+    the values of every stream, 64 bits per stream with stream 0 in the low
+    bits.  The frame geometry and everything else are shared by every stream.
+
+    Bit 1 of REG_MD_STAMP stamps each frame's stream into byte 103 of its
+    outgoing meta-data.
 */
 
-module rdmx_shim_ctl
+module rdmx_shim_ctl #
+(
+    // The largest packet an rdmx_shim can write in one burst (256 data-cycles).
+    // The data FIFO in rdmx_xmit must hold at least one packet of this size
+    parameter MAX_PACKET_SIZE = 16384,
+
+    // The frequency of "clk", used to convert REG_FC_TIMEOUT to clock cycles
+    parameter CLOCK_MHZ = 250,
+
+    // The number of streams (see frame_counters.v)
+    parameter STREAMS = 4
+)
 (
     input clk, resetn,
 
-    output reg[63:0] RFD_ADDR, RFD_SIZE,
-    output reg[63:0] RMD_ADDR, RMD_SIZE,
-    output reg[63:0] RFC_ADDR,
+    // The stream whose registers are presented to the AXI bus
+    input[2:0] stream_sel,
+
+    // The remote rings and frame-counter of every stream
+    output reg[STREAMS*64-1:0] RFD_ADDR, RFD_SIZE,
+    output reg[STREAMS*64-1:0] RMD_ADDR, RMD_SIZE,
+    output reg[STREAMS*64-1:0] RFC_ADDR,
     
     output reg[31:0] FRAME_SIZE,
     output reg[15:0] PACKET_SIZE,
     output reg[31:0] PACKETS_PER_GROUP,
+    output reg[31:0] PACKETS_PER_FRAME,
+
+    // When these are high, the rdmx_shims stamp the timestamp and the stream
+    // into the meta-data
+    output reg       MD_STAMP_ENABLE,
+    output reg       MD_STREAM_STAMP,
+
+    // Steering controls for the ping_ponger.  STEERED goes to the rdmx_shims
+    output reg[1:0]  STEER_POLICY,
+    output reg[7:0]  LINK_WEIGHT0, LINK_WEIGHT1,
+    output reg[1:0]  LINK_ENABLE,
+    output           STEERED,
+
+    // Per-link packet and byte counters from the ping_ponger
+    input[63:0]      link0_packets, link1_packets,
+    input[63:0]      link0_bytes,   link1_bytes,
+
+    // The reset generated by frame_counters
+    input            frame_resetn,
+
+    // Frame-counter coalescing controls for the rdmx_shims, and their strobes
+    output reg[15:0] FC_COALESCE_FRAMES,
+    output reg[31:0] FC_COALESCE_CYCLES,
+    input            shim0_fc_update, shim1_fc_update,
+    input            shim0_fc_skip,   shim1_fc_skip,
+
+    // Staged reconfiguration (see above)
+    input            cfg_stage, cfg_commit,
+    output reg       cfg_settled,
+    output           frame_delivered,
+    output reg       RING_RESTART,
+
+    // The free-running timestamp counter from frame_counters
+    input[63:0]      timestamp,
+
+    // End-of-frame strobes from the ping-ponger and from the two rdmx_shims
+    input            pp_eof, shim0_eof, shim1_eof,
 
     //================== This is an AXI4-Lite slave interface ==================
         
@@ -58,19 +171,7 @@ module rdmx_shim_ctl
 
 
 //=========================  AXI Register Map  =============================
-localparam REG_RFD_ADDR_H        =  0;
-localparam REG_RFD_ADDR_L        =  1;
-localparam REG_RFD_SIZE_H        =  2;
-localparam REG_RFD_SIZE_L        =  3;
-localparam REG_RMD_ADDR_H        =  4;
-localparam REG_RMD_ADDR_L        =  5;
-localparam REG_RMD_SIZE_H        =  6;
-localparam REG_RMD_SIZE_L        =  7;
-localparam REG_RFC_ADDR_H        =  8;
-localparam REG_RFC_ADDR_L        =  9;
-localparam REG_FRAME_SIZE        = 10;
-localparam REG_PACKET_SIZE       = 11;
-localparam REG_PACKETS_PER_GROUP = 12;
+`include "rdmx_shim_ctl_regs.vh"
 //==========================================================================
 
 
@@ -107,12 +208,58 @@ localparam SLVERR = 2;
 localparam DECERR = 3;
 
 // An AXI slave is gauranteed a minimum of 128 bytes of address space
-// (128 bytes is 32 32-bit registers)
-localparam ADDR_MASK = 7'h7F;
+// (128 bytes is 32 32-bit registers).  We have more than 32 registers, 
+// so we decode 256 bytes
+localparam ADDR_MASK = 8'hFF;
 
 // This is a scratch-pad register that doesn't do anything
 reg[31:0] scratch;
 
+// The longest a completed frame's count may go unwritten, in microseconds
+reg[15:0] fc_timeout_us;
+
+// The rdmx_shims want the time limit in clock cycles
+always @(posedge clk) FC_COALESCE_CYCLES <= fc_timeout_us * CLOCK_MHZ;
+
+// The rdmx_shims need to know whether the ping_ponger splits frames evenly
+assign STEERED = (STEER_POLICY != 0);
+
+// The values most recently written to the registers that are staged.  The
+// remote rings and frame-counter are per-stream
+reg[63:0] shadow_rfd_addr[0:STREAMS-1], shadow_rfd_size[0:STREAMS-1];
+reg[63:0] shadow_rmd_addr[0:STREAMS-1], shadow_rmd_size[0:STREAMS-1];
+reg[63:0] shadow_rfc_addr[0:STREAMS-1];
+
+// Loop counter
+integer s;
+reg[31:0] shadow_frame_size;
+reg[15:0] shadow_packet_size;
+reg[31:0] shadow_packets_per_group;
+
+//==========================================================================
+// The outputs follow the shadow registers, unless the configuration is
+// being staged, in which case they're updated only on "cfg_commit"
+//==========================================================================
+always @(posedge clk) begin
+
+    // This strobes high for a single cycle at a time
+    RING_RESTART <= cfg_commit;
+
+    if (~cfg_stage | cfg_commit) begin
+        for (s=0; s<STREAMS; s=s+1) begin
+            RFD_ADDR[s*64 +: 64] <= shadow_rfd_addr[s];
+            RFD_SIZE[s*64 +: 64] <= shadow_rfd_size[s];
+            RMD_ADDR[s*64 +: 64] <= shadow_rmd_addr[s];
+            RMD_SIZE[s*64 +: 64] <= shadow_rmd_size[s];
+            RFC_ADDR[s*64 +: 64] <= shadow_rfc_addr[s];
+        end
+        FRAME_SIZE        <= shadow_frame_size;
+        PACKET_SIZE       <= shadow_packet_size;
+        PACKETS_PER_GROUP <= shadow_packets_per_group;
+    end
+end
+//==========================================================================
+
 //==========================================================================
 // This state machine handles AXI4-Lite write requests
 //
@@ -123,6 +270,12 @@ always @(posedge clk) begin
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
         ashi_write_state  <= 0;
+        STEER_POLICY      <= 0;
+        LINK_WEIGHT0      <= 1;
+        LINK_WEIGHT1      <= 1;
+        LINK_ENABLE       <= 3;
+        FC_COALESCE_FRAMES <= 1;
+        fc_timeout_us     <= 0;
 
     // If we're not in reset, and a write-request has occured...        
     end else case (ashi_write_state)
@@ -134,20 +287,36 @@ always @(posedge clk) begin
             
                 // Allow a write to any valid register
                 case (ashi_windx)
-                    REG_RFD_ADDR_H : RFD_ADDR[63:32] <= ashi_wdata;
-                    REG_RFD_ADDR_L : RFD_ADDR[31:00] <= ashi_wdata;
-                    REG_RFD_SIZE_H : RFD_SIZE[63:32] <= ashi_wdata;
-                    REG_RFD_SIZE_L : RFD_SIZE[31:00] <= ashi_wdata;
-                    REG_RMD_ADDR_H : RMD_ADDR[63:32] <= ashi_wdata;
-                    REG_RMD_ADDR_L : RMD_ADDR[31:00] <= ashi_wdata;
-                    REG_RMD_SIZE_H : RMD_SIZE[63:32] <= ashi_wdata; 
-                    REG_RMD_SIZE_L : RMD_SIZE[31:00] <= ashi_wdata; 
-                    REG_RFC_ADDR_H : RFC_ADDR[63:32] <= ashi_wdata;
-                    REG_RFC_ADDR_L : RFC_ADDR[31:00] <= ashi_wdata;
-
-                    REG_FRAME_SIZE       : FRAME_SIZE        <=ashi_wdata;
-                    REG_PACKET_SIZE      : PACKET_SIZE       <= ashi_wdata;
-                    REG_PACKETS_PER_GROUP: PACKETS_PER_GROUP <= ashi_wdata;
+                    REG_RFD_ADDR_H : shadow_rfd_addr[stream_sel][63:32] <= ashi_wdata;
+                    REG_RFD_ADDR_L : shadow_rfd_addr[stream_sel][31:00] <= ashi_wdata;
+                    REG_RFD_SIZE_H : shadow_rfd_size[stream_sel][63:32] <= ashi_wdata;
+                    REG_RFD_SIZE_L : shadow_rfd_size[stream_sel][31:00] <= ashi_wdata;
+                    REG_RMD_ADDR_H : shadow_rmd_addr[stream_sel][63:32] <= ashi_wdata;
+                    REG_RMD_ADDR_L : shadow_rmd_addr[stream_sel][31:00] <= ashi_wdata;
+                    REG_RMD_SIZE_H : shadow_rmd_size[stream_sel][63:32] <= ashi_wdata; 
+                    REG_RMD_SIZE_L : shadow_rmd_size[stream_sel][31:00] <= ashi_wdata; 
+                    REG_RFC_ADDR_H : shadow_rfc_addr[stream_sel][63:32] <= ashi_wdata;
+                    REG_RFC_ADDR_L : shadow_rfc_addr[stream_sel][31:00] <= ashi_wdata;
+
+                    REG_FRAME_SIZE       : shadow_frame_size        <= ashi_wdata;
+                    REG_PACKET_SIZE      : shadow_packet_size       <= ashi_wdata;
+                    REG_PACKETS_PER_GROUP: shadow_packets_per_group <= ashi_wdata;
+                    REG_MD_STAMP:
+                        begin
+                            MD_STAMP_ENABLE <= ashi_wdata[0];
+                            MD_STREAM_STAMP <= ashi_wdata[1];
+                        end
+
+                    REG_STEER_POLICY     : STEER_POLICY      <= ashi_wdata[1:0];
+                    REG_LINK_ENABLE      : LINK_ENABLE       <= ashi_wdata[1:0];
+                    REG_FC_COALESCE      : FC_COALESCE_FRAMES <= ashi_wdata[15:0];
+                    REG_FC_TIMEOUT       : fc_timeout_us     <= ashi_wdata[15:0];
+
+                    REG_LINK_WEIGHTS:
+                        begin
+                            LINK_WEIGHT0 <= ashi_wdata[ 7:0];
+                            LINK_WEIGHT1 <= ashi_wdata[15:8];
+                        end
 
                     // Writes to any other register are a decode-error
                     default: ashi_wresp <= DECERR;
@@ -165,10 +334,152 @@ end
 
 
 
+//==========================================================================
+// This divides FRAME_SIZE by PACKET_SIZE, one quotient bit per cycle, and
+// stores the result in PACKETS_PER_FRAME.  An invalid PACKET_SIZE of 0 
+// results in 1 packet per frame.  "cfg_settled" is high once the result
+// for the current FRAME_SIZE and PACKET_SIZE has been published
+//==========================================================================
+reg[31:0] div_frame_size, div_quotient;
+reg[15:0] div_packet_size;
+reg[32:0] div_remainder;
+reg[ 5:0] div_steps;
+
+// The remainder and quotient after the next step of the division
+wire[32:0] div_shifted   = {div_remainder[31:0], div_quotient[31]};
+wire       div_subtract  = (div_shifted >= div_packet_size);
+//--------------------------------------------------------------------------
+always @(posedge clk) begin
+    if (resetn == 0) begin
+        div_frame_size    <= 0;
+        div_packet_size   <= 0;
+        div_steps         <= 0;
+        PACKETS_PER_FRAME <= 1;
+        cfg_settled       <= 0;
+    end
+
+    // If the frame or packet size has changed, start a new division
+    else if (div_frame_size != FRAME_SIZE || div_packet_size != PACKET_SIZE) begin
+        cfg_settled     <= 0;
+        div_frame_size  <= FRAME_SIZE;
+        div_packet_size <= PACKET_SIZE;
+        div_quotient    <= FRAME_SIZE;
+        div_remainder   <= 0;
+        div_steps       <= 32;
+    end
+
+    // Compute the next bit of the quotient
+    else if (div_steps) begin
+        div_remainder <= div_subtract ? div_shifted - div_packet_size : div_shifted;
+        div_quotient  <= {div_quotient[30:0], div_subtract};
+        div_steps     <= div_steps - 1;
+    end
+
+    // When the division is done, publish the result
+    else begin
+        PACKETS_PER_FRAME <= (div_packet_size == 0) ? 1 : div_quotient;
+        cfg_settled       <= 1;
+    end
+end
+//==========================================================================
+
+
+
+//==========================================================================
+// Figure out when both rdmx_shims have finished a frame (and written the
+// frame-counter for it, unless that write was coalesced).  "fc_balance" is
+// the number of frames that shim 0 is ahead of shim 1 (or behind it, if 
+// negative)
+//==========================================================================
+reg signed[15:0] fc_balance;
+
+wire fc_written = (shim0_eof & shim1_eof)
+                | (shim0_eof & (fc_balance < 0))
+                | (shim1_eof & (fc_balance > 0));
+
+// data_fetch counts these to know when no frame is in flight
+assign frame_delivered = fc_written;
+//--------------------------------------------------------------------------
+always @(posedge clk) begin
+    if (frame_resetn == 0)
+        fc_balance <= 0;
+    else
+        fc_balance <= fc_balance + shim0_eof - shim1_eof;
+end
+//==========================================================================
+
+
+//==========================================================================
+// Count the frame-counter writes the rdmx_shims make, and the ones they
+// save by coalescing
+//==========================================================================
+reg[63:0] fc_updates, fc_saved;
+//--------------------------------------------------------------------------
+always @(posedge clk) begin
+    if (frame_resetn == 0) begin
+        fc_updates <= 0;
+        fc_saved   <= 0;
+    end else begin
+        fc_updates <= fc_updates + shim0_fc_update + shim1_fc_update;
+        fc_saved   <= fc_saved   + shim0_fc_skip   + shim1_fc_skip;
+    end
+end
+//==========================================================================
+
+
+//==========================================================================
+// The two trace FIFOs
+//==========================================================================
+wire[63:0] pp_trace_head,  fc_trace_head;
+wire[15:0] pp_trace_count, fc_trace_count;
+wire[31:0] pp_trace_lost,  fc_trace_lost;
+reg        pp_trace_pop,   fc_trace_pop;
+//--------------------------------------------------------------------------
+trace_fifo pp_trace
+(
+    .clk            (clk),
+    .resetn         (frame_resetn),
+    .timestamp      (timestamp),
+    .event_strobe   (pp_eof),
+    .event_phase    (1'b0),
+    .head           (pp_trace_head),
+    .pop            (pp_trace_pop),
+    .count          (pp_trace_count),
+    .overflows      (pp_trace_lost)
+);
+
+trace_fifo fc_trace
+(
+    .clk            (clk),
+    .resetn         (frame_resetn),
+    .timestamp      (timestamp),
+    .event_strobe   (fc_written),
+    .event_phase    (1'b0),
+    .head           (fc_trace_head),
+    .pop            (fc_trace_pop),
+    .count          (fc_trace_count),
+    .overflows      (fc_trace_lost)
+);
+//==========================================================================
+
+
+
 //==========================================================================
 // World's simplest state machine for handling AXI4-Lite read requests
 //==========================================================================
+
+// When the upper half of a trace entry is read, the lower half is latched
+reg[31:0] trace_lo;
+
+// The same, for the link counters
+reg[31:0] counter_lo;
+//--------------------------------------------------------------------------
 always @(posedge clk) begin
+
+    // These strobe high for a single cycle at a time
+    pp_trace_pop <= 0;
+    fc_trace_pop <= 0;
+
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
         ashi_read_state <= 0;
@@ -183,20 +494,67 @@ always @(posedge clk) begin
         case (ashi_rindx)
             
             // Allow a read from any valid register                
-            REG_RFD_ADDR_H : ashi_rdata <= RFD_ADDR[63:32];
-            REG_RFD_ADDR_L : ashi_rdata <= RFD_ADDR[31:00];
-            REG_RFD_SIZE_H : ashi_rdata <= RFD_SIZE[63:32];
-            REG_RFD_SIZE_L : ashi_rdata <= RFD_SIZE[31:00];
-            REG_RMD_ADDR_H : ashi_rdata <= RMD_ADDR[63:32];
-            REG_RMD_ADDR_L : ashi_rdata <= RMD_ADDR[31:00];
-            REG_RMD_SIZE_H : ashi_rdata <= RMD_SIZE[63:32]; 
-            REG_RMD_SIZE_L : ashi_rdata <= RMD_SIZE[31:00]; 
-            REG_RFC_ADDR_H : ashi_rdata <= RFC_ADDR[63:32];
-            REG_RFC_ADDR_L : ashi_rdata <= RFC_ADDR[31:00];
-
-            REG_FRAME_SIZE        : ashi_rdata <= FRAME_SIZE;       
-            REG_PACKET_SIZE       : ashi_rdata <= PACKET_SIZE;
-            REG_PACKETS_PER_GROUP : ashi_rdata <= PACKETS_PER_GROUP;
+            REG_RFD_ADDR_H : ashi_rdata <= shadow_rfd_addr[stream_sel][63:32];
+            REG_RFD_ADDR_L : ashi_rdata <= shadow_rfd_addr[stream_sel][31:00];
+            REG_RFD_SIZE_H : ashi_rdata <= shadow_rfd_size[stream_sel][63:32];
+            REG_RFD_SIZE_L : ashi_rdata <= shadow_rfd_size[stream_sel][31:00];
+            REG_RMD_ADDR_H : ashi_rdata <= shadow_rmd_addr[stream_sel][63:32];
+            REG_RMD_ADDR_L : ashi_rdata <= shadow_rmd_addr[stream_sel][31:00];
+            REG_RMD_SIZE_H : ashi_rdata <= shadow_rmd_size[stream_sel][63:32]; 
+            REG_RMD_SIZE_L : ashi_rdata <= shadow_rmd_size[stream_sel][31:00]; 
+            REG_RFC_ADDR_H : ashi_rdata <= shadow_rfc_addr[stream_sel][63:32];
+            REG_RFC_ADDR_L : ashi_rdata <= shadow_rfc_addr[stream_sel][31:00];
+
+            REG_FRAME_SIZE        : ashi_rdata <= shadow_frame_size;       
+            REG_PACKET_SIZE       : ashi_rdata <= shadow_packet_size;
+            REG_PACKETS_PER_GROUP : ashi_rdata <= shadow_packets_per_group;
+            REG_MD_STAMP          : ashi_rdata <= {MD_STREAM_STAMP, MD_STAMP_ENABLE};
+
+            REG_PP_TRACE_COUNT    : ashi_rdata <= pp_trace_count;
+            REG_PP_TRACE_L        : ashi_rdata <= trace_lo;
+            REG_PP_TRACE_LOST     : ashi_rdata <= pp_trace_lost;
+            REG_FC_TRACE_COUNT    : ashi_rdata <= fc_trace_count;
+            REG_FC_TRACE_L        : ashi_rdata <= trace_lo;
+            REG_FC_TRACE_LOST     : ashi_rdata <= fc_trace_lost;
+
+            REG_PACKETS_PER_FRAME : ashi_rdata <= PACKETS_PER_FRAME;
+            REG_MAX_PACKET_SIZE   : ashi_rdata <= MAX_PACKET_SIZE;
+
+            REG_STEER_POLICY      : ashi_rdata <= STEER_POLICY;
+            REG_LINK_WEIGHTS      : ashi_rdata <= {LINK_WEIGHT1, LINK_WEIGHT0};
+            REG_LINK_ENABLE       : ashi_rdata <= LINK_ENABLE;
+            REG_LINK0_PACKETS_L   : ashi_rdata <= counter_lo;
+            REG_LINK1_PACKETS_L   : ashi_rdata <= counter_lo;
+            REG_LINK0_BYTES_L     : ashi_rdata <= counter_lo;
+            REG_LINK1_BYTES_L     : ashi_rdata <= counter_lo;
+            REG_FC_COALESCE       : ashi_rdata <= FC_COALESCE_FRAMES;
+            REG_FC_TIMEOUT        : ashi_rdata <= fc_timeout_us;
+            REG_FC_UPDATES_L      : ashi_rdata <= counter_lo;
+            REG_FC_SAVED_L        : ashi_rdata <= counter_lo;
+
+            // Reading the upper half of a link counter latches the lower half
+            REG_LINK0_PACKETS_H   : {ashi_rdata, counter_lo} <= link0_packets;
+            REG_LINK1_PACKETS_H   : {ashi_rdata, counter_lo} <= link1_packets;
+            REG_LINK0_BYTES_H     : {ashi_rdata, counter_lo} <= link0_bytes;
+            REG_LINK1_BYTES_H     : {ashi_rdata, counter_lo} <= link1_bytes;
+            REG_FC_UPDATES_H      : {ashi_rdata, counter_lo} <= fc_updates;
+            REG_FC_SAVED_H        : {ashi_rdata, counter_lo} <= fc_saved;
+
+            // Reading the upper half of a trace entry latches the lower
+            // half and removes the entry from its trace FIFO
+            REG_PP_TRACE_H:
+                begin
+                    ashi_rdata   <= pp_trace_head[63:32];
+                    trace_lo     <= pp_trace_head[31:0];
+                    pp_trace_pop <= 1;
+                end
+
+            REG_FC_TRACE_H:
+                begin
+                    ashi_rdata   <= fc_trace_head[63:32];
+                    trace_lo     <= fc_trace_head[31:0];
+                    fc_trace_pop <= 1;
+                end
 
             // Reads of any other register are a decode-error
             default: ashi_rresp <= DECERR;
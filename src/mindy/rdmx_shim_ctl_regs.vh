@@ -0,0 +1,43 @@
+// rdmx_shim_ctl_regs.vh - AXI register map of rdmx_shim_ctl
+// Generated by mindyregs from software/src/mindylib/mindy_regs.def - don't edit by hand
+localparam REG_RFD_ADDR_H           =  0;  // Receiver's frame-data buffer
+localparam REG_RFD_ADDR_L           =  1;
+localparam REG_RFD_SIZE_H           =  2;  // Receiver's frame-data buffer, size in bytes
+localparam REG_RFD_SIZE_L           =  3;
+localparam REG_RMD_ADDR_H           =  4;  // Receiver's meta-data buffer
+localparam REG_RMD_ADDR_L           =  5;
+localparam REG_RMD_SIZE_H           =  6;  // Receiver's meta-data buffer, size in bytes
+localparam REG_RMD_SIZE_L           =  7;
+localparam REG_RFC_ADDR_H           =  8;  // Receiver's frame counter
+localparam REG_RFC_ADDR_L           =  9;
+localparam REG_FRAME_SIZE           = 10;  // Size of a frame, in bytes
+localparam REG_PACKET_SIZE          = 11;  // Size of an RDMX packet payload, in bytes
+localparam REG_PACKETS_PER_GROUP    = 12;  // Number of packets in a ping-pong group
+localparam REG_MD_STAMP             = 13;  // Bit 0 = stamp the timestamp, bit 1 = stamp the stream ID
+localparam REG_PP_TRACE_COUNT       = 14;  // Number of entries in the ping-pong trace FIFO
+localparam REG_PP_TRACE_H           = 15;  // Oldest ping-pong trace entry
+localparam REG_PP_TRACE_L           = 16;
+localparam REG_PP_TRACE_LOST        = 17;  // Number of ping-pong trace entries lost
+localparam REG_FC_TRACE_COUNT       = 18;  // Number of entries in the FC-write trace FIFO
+localparam REG_FC_TRACE_H           = 19;  // Oldest FC-write trace entry
+localparam REG_FC_TRACE_L           = 20;
+localparam REG_FC_TRACE_LOST        = 21;  // Number of FC-write trace entries lost
+localparam REG_STEER_POLICY         = 22;  // 0 = alternate, 1 = adaptive, 2 = weighted
+localparam REG_LINK_WEIGHTS         = 23;  // Groups per turn: bits 7:0 = link 0, bits 15:8 = link 1
+localparam REG_LINK_ENABLE          = 24;  // Bit N = 1 means link N may be used when steering
+localparam REG_LINK0_PACKETS_H      = 25;  // Packets written to link 0
+localparam REG_LINK0_PACKETS_L      = 26;
+localparam REG_LINK1_PACKETS_H      = 27;  // Packets written to link 1
+localparam REG_LINK1_PACKETS_L      = 28;
+localparam REG_LINK0_BYTES_H        = 29;  // Bytes written to link 0
+localparam REG_LINK0_BYTES_L        = 30;
+localparam REG_LINK1_BYTES_H        = 31;  // Bytes written to link 1
+localparam REG_LINK1_BYTES_L        = 32;
+localparam REG_PACKETS_PER_FRAME    = 33;  // FRAME_SIZE / PACKET_SIZE, as computed by the card
+localparam REG_MAX_PACKET_SIZE      = 34;  // Largest PACKET_SIZE the card supports
+localparam REG_FC_COALESCE          = 35;  // Frames per remote frame-counter write (0 or 1 = every frame)
+localparam REG_FC_TIMEOUT           = 36;  // Longest a frame-count may go unwritten, in microseconds (0 = no limit)
+localparam REG_FC_UPDATES_H         = 37;  // Remote frame-counter writes made by both rdmx_shims
+localparam REG_FC_UPDATES_L         = 38;
+localparam REG_FC_SAVED_H           = 39;  // Remote frame-counter writes saved by coalescing
+localparam REG_FC_SAVED_L           = 40;
@@ -5,6 +5,9 @@
 //   Date     Who   Ver  Changes
 //====================================================================================
 // 18-Feb-24  DWW     1  Initial creation
+// 18-Oct-26  DWW     2  Added the CMAC statistics snapshot.  Only ERR_STATUS writes clear errors
+// 19-Oct-26  DWW     3  Added the telemetry of the frame-data FIFO in mindy_if
+// 19-Oct-26  DWW     4  ERR_STATUS is write-1-to-clear
 //====================================================================================
 
 /*
@@ -23,6 +26,20 @@ module status_mgr # (parameter FREQ_HZ = 250000000)
     // Asserted on any cycle when frame-counter command fifo overflows
     input   fc_overflow,
 
+    // Toggled to ask the CMAC of each QSFP port for a snapshot of its statistics, and each
+    // side's acknowledgement of it (see cmac_control)
+    output reg  cmac_snapshot_req,
+    input       cmac0_tx_ack_async, cmac0_rx_ack_async,
+    input       cmac1_tx_ack_async, cmac1_rx_ack_async,
+
+    // The statistics snapshots, nine 64-bit counters apiece
+    input[9*64-1:0] cmac0_snapshot, cmac1_snapshot,
+
+    // The telemetry of the frame-data FIFO in mindy_if, and a strobe that restarts it
+    input[31:0] fd_fifo_depth, fd_fifo_level, fd_fifo_high, fd_underruns,
+    input[63:0] fd_starved,
+    output reg  fd_fifo_clear,
+
     // Drives the (active low) LEDs
     output [3:0] led_orang_l, led_green_l,
 
@@ -62,8 +79,7 @@ module status_mgr # (parameter FREQ_HZ = 250000000)
 
 
 //=========================  AXI Register Map  =============================
-localparam REG_QSFP_STATUS  = 0;
-localparam REG_ERR_STATUS   = 1;
+`include "status_mgr_regs.vh"
 //==========================================================================
 
 
@@ -99,15 +115,26 @@ localparam OKAY   = 0;
 localparam SLVERR = 2;
 localparam DECERR = 3;
 
-// An AXI slave is gauranteed a minimum of 128 bytes of address space
-// (128 bytes is 32 32-bit registers)
-localparam ADDR_MASK = 7'h7F;
+// An AXI slave is gauranteed a minimum of 128 bytes of address space.
+// We use 256 bytes (64 32-bit registers)
+localparam ADDR_MASK = 8'hFF;
 
 // Create versions of the qsfp<n>_status that are synchronous to "clk"
 wire qsfp0_status, qsfp1_status;
 cdc_single u_cdc0(qsfp0_status_async, clk, qsfp0_status);
 cdc_single u_cdc1(qsfp1_status_async, clk, qsfp1_status);
 
+// Create versions of the CMAC snapshot acknowledgements that are synchronous to "clk"
+wire cmac0_tx_ack, cmac0_rx_ack, cmac1_tx_ack, cmac1_rx_ack;
+cdc_single u_cdc2(cmac0_tx_ack_async, clk, cmac0_tx_ack);
+cdc_single u_cdc3(cmac0_rx_ack_async, clk, cmac0_rx_ack);
+cdc_single u_cdc4(cmac1_tx_ack_async, clk, cmac1_tx_ack);
+cdc_single u_cdc5(cmac1_rx_ack_async, clk, cmac1_rx_ack);
+
+// A snapshot is in progress until every side of both CMACs has acknowledged it
+wire cmac_snapshot_busy = (cmac0_tx_ack != cmac_snapshot_req) | (cmac0_rx_ack != cmac_snapshot_req)
+                        | (cmac1_tx_ack != cmac_snapshot_req) | (cmac1_rx_ack != cmac_snapshot_req);
+
 // These are the active-high versions of the signals that will drive LEDs
 reg[3:0] orang, green;
 
@@ -127,8 +154,8 @@ always @* begin
     green[1] =  qsfp1_status;
 end
 
-// When this is asserted, "latched" errors will be reset back to 0
-reg clear_latched_errors;
+// Each bit of this that is asserted resets that "latched" error back to 0
+reg[0:0] clear_latched_errors;
 
 // This is the latched state of "fc_overflow"
 reg latched_fc_overflow;
@@ -162,14 +189,15 @@ end
 
 //==========================================================================
 // This state machine handles the latching and clearing of error status
-// bits.
+// bits.  An error that occurs in the same cycle as its clear stays latched
 //==========================================================================
 always @(posedge clk) begin
-    if ((resetn == 0) | clear_latched_errors) begin
+    if (resetn == 0)
+        latched_fc_overflow <= 0;
+    else if (fc_overflow)
+        latched_fc_overflow <= 1;
+    else if (clear_latched_errors[0])
         latched_fc_overflow <= 0;
-    end else begin
-        if (fc_overflow) latched_fc_overflow <= 1;
-    end
 end
 //==========================================================================
 
@@ -181,12 +209,14 @@ end
 //==========================================================================
 always @(posedge clk) begin
 
-    // This will strobe high for a single cycle at a time
+    // These will strobe high for a single cycle at a time
     clear_latched_errors <= 0;
+    fd_fifo_clear        <= 0;
 
     // If we're in reset, initialize important registers
     if (resetn == 0) begin
         ashi_write_state  <= 0;
+        cmac_snapshot_req <= 0;
 
     // If we're not in reset, and a write-request has occured...        
     end else case (ashi_write_state)
@@ -196,8 +226,21 @@ always @(posedge clk) begin
                 // Assume for the moment that the result will be OKAY
                 ashi_wresp <= OKAY;              
             
-                // A write to any register clears latched errors
-                clear_latched_errors <= 1;
+                case (ashi_windx)
+                
+                    // Writing a 1 to a bit of the error status clears that error
+                    REG_ERR_STATUS:     clear_latched_errors <= ashi_wdata[0:0];
+
+                    // A write here starts a snapshot, unless one is already underway
+                    REG_LINK_SNAPSHOT:  if (~cmac_snapshot_busy)
+                                            cmac_snapshot_req <= ~cmac_snapshot_req;
+
+                    // A write here restarts the frame-data FIFO's telemetry
+                    REG_FD_FIFO_HIGH:   fd_fifo_clear <= 1;
+
+                    // Writes to any other register are a decode-error
+                    default: ashi_wresp <= DECERR;
+                endcase
             end
 
         // Dummy state, doesn't do anything
@@ -209,6 +252,17 @@ end
 
 
 
+//==========================================================================
+// The 32-bit half of a CMAC statistics counter that each register index
+// maps to.  The upper half of a counter is at the even index
+//==========================================================================
+wire[31:0] cmac0_windx = ashi_rindx - REG_LINK0_TX_PACKETS_H;
+wire[31:0] cmac1_windx = ashi_rindx - REG_LINK1_TX_PACKETS_H;
+wire[31:0] cmac0_word  = cmac0_snapshot[64*cmac0_windx[4:1] + (cmac0_windx[0] ? 0 : 32) +: 32];
+wire[31:0] cmac1_word  = cmac1_snapshot[64*cmac1_windx[4:1] + (cmac1_windx[0] ? 0 : 32) +: 32];
+//==========================================================================
+
+
 //==========================================================================
 // World's simplest state machine for handling AXI4-Lite read requests
 //==========================================================================
@@ -228,11 +282,24 @@ always @(posedge clk) begin
         case (ashi_rindx)
             
             // Allow a read from any valid register                
-            REG_QSFP_STATUS:  ashi_rdata <= {qsfp1_status, qsfp0_status};
-            REG_ERR_STATUS:   ashi_rdata <= latched_fc_overflow;
+            REG_QSFP_STATUS:   ashi_rdata <= {qsfp1_status, qsfp0_status};
+            REG_ERR_STATUS:    ashi_rdata <= latched_fc_overflow;
+            REG_LINK_SNAPSHOT: ashi_rdata <= cmac_snapshot_busy;
+            REG_FD_FIFO_DEPTH: ashi_rdata <= fd_fifo_depth;
+            REG_FD_FIFO_LEVEL: ashi_rdata <= fd_fifo_level;
+            REG_FD_FIFO_HIGH:  ashi_rdata <= fd_fifo_high;
+            REG_FD_UNDERRUNS:  ashi_rdata <= fd_underruns;
+            REG_FD_STARVED_H:  ashi_rdata <= fd_starved[63:32];
+            REG_FD_STARVED_L:  ashi_rdata <= fd_starved[31:0];
             
-            // Reads of any other register are a decode-error
-            default: ashi_rresp <= DECERR;
+            // The CMAC statistics, or a decode-error for any other register
+            default:
+                if (ashi_rindx >= REG_LINK0_TX_PACKETS_H && ashi_rindx <= REG_LINK0_TX_PAUSE_L)
+                    ashi_rdata <= cmac0_word;
+                else if (ashi_rindx >= REG_LINK1_TX_PACKETS_H && ashi_rindx <= REG_LINK1_TX_PAUSE_L)
+                    ashi_rdata <= cmac1_word;
+                else
+                    ashi_rresp <= DECERR;
         endcase
     end
 end
@@ -0,0 +1,47 @@
+// status_mgr_regs.vh - AXI register map of status_mgr
+// Generated by mindyregs from software/src/mindylib/mindy_regs.def - don't edit by hand
+localparam REG_QSFP_STATUS          =  0;  // Bit N = 1 means QSFP_N is up and aligned
+localparam REG_ERR_STATUS           =  1;  // Latched errors, bit 0 = FC FIFO overflow.  Write 1 to a bit to clear it
+localparam REG_LINK_SNAPSHOT        =  2;  // Writing snapshots the CMAC statistics.  Reads 1 until done
+localparam REG_FD_FIFO_DEPTH        =  3;  // Beats the elastic frame-data FIFO holds (0 = no FIFO)
+localparam REG_FD_FIFO_LEVEL        =  4;  // Beats in the frame-data FIFO now
+localparam REG_FD_FIFO_HIGH         =  5;  // Most beats in the frame-data FIFO at once.  Writing restarts the measurement
+localparam REG_FD_UNDERRUNS         =  6;  // Times the frame data ran dry in the middle of a frame
+localparam REG_FD_STARVED_H         =  7;  // Clock cycles the frame data spent dry in the middle of a frame
+localparam REG_FD_STARVED_L         =  8;
+localparam REG_LINK0_TX_PACKETS_H   = 16;  // QSFP_0 packets sent (snapshot)
+localparam REG_LINK0_TX_PACKETS_L   = 17;
+localparam REG_LINK0_TX_BYTES_H     = 18;  // QSFP_0 bytes sent (snapshot)
+localparam REG_LINK0_TX_BYTES_L     = 19;
+localparam REG_LINK0_RX_PACKETS_H   = 20;  // QSFP_0 packets received (snapshot)
+localparam REG_LINK0_RX_PACKETS_L   = 21;
+localparam REG_LINK0_RX_BYTES_H     = 22;  // QSFP_0 bytes received (snapshot)
+localparam REG_LINK0_RX_BYTES_L     = 23;
+localparam REG_LINK0_FEC_CORRECTED_H = 24;  // QSFP_0 RS-FEC codewords corrected (snapshot)
+localparam REG_LINK0_FEC_CORRECTED_L = 25;
+localparam REG_LINK0_FEC_UNCORRECTED_H = 26;  // QSFP_0 RS-FEC codewords that couldn't be corrected (snapshot)
+localparam REG_LINK0_FEC_UNCORRECTED_L = 27;
+localparam REG_LINK0_RX_BAD_FCS_H   = 28;  // QSFP_0 packets received with a bad FCS (snapshot)
+localparam REG_LINK0_RX_BAD_FCS_L   = 29;
+localparam REG_LINK0_RX_PAUSE_H     = 30;  // QSFP_0 pause frames received (snapshot)
+localparam REG_LINK0_RX_PAUSE_L     = 31;
+localparam REG_LINK0_TX_PAUSE_H     = 32;  // QSFP_0 pause frames sent (snapshot)
+localparam REG_LINK0_TX_PAUSE_L     = 33;
+localparam REG_LINK1_TX_PACKETS_H   = 40;  // QSFP_1 packets sent (snapshot)
+localparam REG_LINK1_TX_PACKETS_L   = 41;
+localparam REG_LINK1_TX_BYTES_H     = 42;  // QSFP_1 bytes sent (snapshot)
+localparam REG_LINK1_TX_BYTES_L     = 43;
+localparam REG_LINK1_RX_PACKETS_H   = 44;  // QSFP_1 packets received (snapshot)
+localparam REG_LINK1_RX_PACKETS_L   = 45;
+localparam REG_LINK1_RX_BYTES_H     = 46;  // QSFP_1 bytes received (snapshot)
+localparam REG_LINK1_RX_BYTES_L     = 47;
+localparam REG_LINK1_FEC_CORRECTED_H = 48;  // QSFP_1 RS-FEC codewords corrected (snapshot)
+localparam REG_LINK1_FEC_CORRECTED_L = 49;
+localparam REG_LINK1_FEC_UNCORRECTED_H = 50;  // QSFP_1 RS-FEC codewords that couldn't be corrected (snapshot)
+localparam REG_LINK1_FEC_UNCORRECTED_L = 51;
+localparam REG_LINK1_RX_BAD_FCS_H   = 52;  // QSFP_1 packets received with a bad FCS (snapshot)
+localparam REG_LINK1_RX_BAD_FCS_L   = 53;
+localparam REG_LINK1_RX_PAUSE_H     = 54;  // QSFP_1 pause frames received (snapshot)
+localparam REG_LINK1_RX_PAUSE_L     = 55;
+localparam REG_LINK1_TX_PAUSE_H     = 56;  // QSFP_1 pause frames sent (snapshot)
+localparam REG_LINK1_TX_PAUSE_L     = 57;
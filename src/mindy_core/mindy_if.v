@@ -5,27 +5,47 @@
 //   Date     Who   Ver  Changes
 //=============================================================================
 // 15-Feb-24  DWW     1  Initial creation
+// 18-Oct-26  DWW     2  Frame data carries TUSER and TLAST through
+// 18-Oct-26  DWW     3  Meta-data carries its stream number in TUSER
+// 18-Oct-26  DWW     4  Added the elastic frame-data FIFO and its telemetry
 //=============================================================================
 
 /*
-    As of this writing, this module doesn't do much: the stream carrying in
-    frame data connects directly to the output stream and the stream carrying
-    in meta-data connects to a pair of FIFO's that each output identical
-    copies of that data.
-
-    Potential enhancements in the future:
-
-    (1) Put a FIFO between the input and the output on the frame-data stream.
-        This could be useful if it's common for us to have upstream modules
-        that need to be able to send us data faster than we can get rid of 
-        it.
+    The stream carrying in frame data (along with its TUSER and TLAST, which
+    data_fetch uses in delta mode) passes through an elastic FIFO on its way
+    to the output stream, and the stream carrying in meta-data connects to a
+    pair of FIFO's that each output identical copies of that data (along with
+    its TUSER, the stream that the frame belongs to).
+
+    The frame-data FIFO absorbs the jitter in the PCIe read completions that
+    data_fetch receives, so that a host-memory hiccup doesn't starve the
+    ping_ponger (and the links) in the middle of a frame.  It's FD_FIFO_DEPTH
+    beats deep, in FD_FIFO_TYPE memory: 4096 beats of 512 bits (with TUSER
+    and TLAST) is 256 KB, or 8 UltraRAMs.  FD_FIFO_DEPTH = 0 connects the 
+    input straight to the output, as before.
+
+    Telemetry, for sizing the FIFO from measurements:
+
+    fd_fifo_depth = FD_FIFO_DEPTH
+    fd_fifo_level = Number of beats in the FIFO now
+    fd_fifo_high  = The most beats that have been in the FIFO at once
+    fd_underruns  = Number of times the output ran dry in the middle of a
+                    frame (between its first beat and its TLAST) while the
+                    ping_ponger was ready for more
+    fd_starved    = Number of clock cycles it spent that way
+
+    A strobe on fd_fifo_clear restarts the measurement: the high-water mark
+    drops to the current level and the underrun counters go to zero.  These
+    work with FD_FIFO_DEPTH = 0 too, to measure the need for a FIFO.
 */
 
 
 module mindy_if #
 (
-    parameter DATA_WBITS   = 512,
-    parameter MD_FIFO_TYPE = "distributed"
+    parameter DATA_WBITS    = 512,
+    parameter MD_FIFO_TYPE  = "distributed",
+    parameter FD_FIFO_DEPTH = 4096,
+    parameter FD_FIFO_TYPE  = "ultra"
 )
 (
     input clk, resetn,
@@ -34,6 +54,8 @@ module mindy_if #
     //                   Input stream of frame data 
     //==========================================================================
     input  [DATA_WBITS-1:0] AXIS_FD_IN_TDATA,
+    input  [31:0]           AXIS_FD_IN_TUSER,
+    input                   AXIS_FD_IN_TLAST,
     input                   AXIS_FD_IN_TVALID,
     output                  AXIS_FD_IN_TREADY,
     //==========================================================================
@@ -43,6 +65,7 @@ module mindy_if #
     //                   Input stream of meta-data
     //==========================================================================
     input  [DATA_WBITS-1:0] AXIS_MD_IN_TDATA,
+    input  [7:0]            AXIS_MD_IN_TUSER,
     input                   AXIS_MD_IN_TVALID,
     output                  AXIS_MD_IN_TREADY,
     //==========================================================================
@@ -51,6 +74,7 @@ module mindy_if #
     // Meta-data gets emitted on both of these streams simultaneously
     //==========================================================================
     output [DATA_WBITS-1:0] AXIS_MD0_OUT_TDATA,    AXIS_MD1_OUT_TDATA,
+    output [7:0]            AXIS_MD0_OUT_TUSER,    AXIS_MD1_OUT_TUSER,
     output                  AXIS_MD0_OUT_TVALID,   AXIS_MD1_OUT_TVALID,
     input                   AXIS_MD0_OUT_TREADY,   AXIS_MD1_OUT_TREADY,
     //==========================================================================
@@ -60,16 +84,153 @@ module mindy_if #
     // Frame-data gets emitted on this stream
     //==========================================================================
     output [DATA_WBITS-1:0] AXIS_FD_OUT_TDATA,
+    output [31:0]           AXIS_FD_OUT_TUSER,
+    output                  AXIS_FD_OUT_TLAST,
     output                  AXIS_FD_OUT_TVALID,
-    input                   AXIS_FD_OUT_TREADY
+    input                   AXIS_FD_OUT_TREADY,
+    //==========================================================================
+
+
+    //==========================================================================
+    //                  Telemetry of the frame-data FIFO
+    //==========================================================================
+    input                   fd_fifo_clear,
+    output[31:0]            fd_fifo_depth,
+    output reg[31:0]        fd_fifo_level,
+    output reg[31:0]        fd_fifo_high,
+    output reg[31:0]        fd_underruns,
+    output reg[63:0]        fd_starved
     //==========================================================================
 );  
 
 
-// Frame data passes straight through to the output stream. 
-assign AXIS_FD_OUT_TDATA  = AXIS_FD_IN_TDATA;
-assign AXIS_FD_OUT_TVALID = AXIS_FD_IN_TVALID;
-assign AXIS_FD_IN_TREADY  = AXIS_FD_OUT_TREADY;
+//=============================================================================
+// Frame data passes through the elastic FIFO, or straight through to the 
+// output stream if there isn't one
+//=============================================================================
+generate if (FD_FIFO_DEPTH == 0) begin
+
+    assign AXIS_FD_OUT_TDATA  = AXIS_FD_IN_TDATA;
+    assign AXIS_FD_OUT_TUSER  = AXIS_FD_IN_TUSER;
+    assign AXIS_FD_OUT_TLAST  = AXIS_FD_IN_TLAST;
+    assign AXIS_FD_OUT_TVALID = AXIS_FD_IN_TVALID;
+    assign AXIS_FD_IN_TREADY  = AXIS_FD_OUT_TREADY;
+
+end else begin
+
+    xpm_fifo_axis #
+    (
+        .CLOCKING_MODE      ("common_clock"),
+        .PACKET_FIFO        ("false"),
+        .FIFO_DEPTH         (FD_FIFO_DEPTH),
+        .TDATA_WIDTH        (DATA_WBITS),
+        .TUSER_WIDTH        (32),
+        .FIFO_MEMORY_TYPE   (FD_FIFO_TYPE),
+        .USE_ADV_FEATURES   ("0000")
+    )
+    fd_fifo
+    (
+        // Clock and reset
+       .s_aclk          (clk   ),
+       .m_aclk          (clk   ),
+       .s_aresetn       (resetn),
+
+        // The input bus to the FIFO
+       .s_axis_tdata    (AXIS_FD_IN_TDATA  ),
+       .s_axis_tuser    (AXIS_FD_IN_TUSER  ),
+       .s_axis_tlast    (AXIS_FD_IN_TLAST  ),
+       .s_axis_tvalid   (AXIS_FD_IN_TVALID ),
+       .s_axis_tready   (AXIS_FD_IN_TREADY ),
+       .s_axis_tkeep    (                  ),
+
+        // The output bus of the FIFO
+       .m_axis_tdata    (AXIS_FD_OUT_TDATA ),
+       .m_axis_tuser    (AXIS_FD_OUT_TUSER ),
+       .m_axis_tlast    (AXIS_FD_OUT_TLAST ),
+       .m_axis_tvalid   (AXIS_FD_OUT_TVALID),
+       .m_axis_tready   (AXIS_FD_OUT_TREADY),
+       .m_axis_tkeep    (                  ),
+
+        // Unused input stream signals
+       .s_axis_tdest(),
+       .s_axis_tid  (),
+       .s_axis_tstrb(),
+
+        // Unused output stream signals
+       .m_axis_tdest(),
+       .m_axis_tid  (),
+       .m_axis_tstrb(),
+
+        // Other unused signals
+       .almost_empty_axis(),
+       .almost_full_axis(),
+       .dbiterr_axis(),
+       .prog_empty_axis(),
+       .prog_full_axis(),
+       .rd_data_count_axis(),
+       .sbiterr_axis(),
+       .wr_data_count_axis(),
+       .injectdbiterr_axis(),
+       .injectsbiterr_axis()
+    );
+
+end endgenerate
+
+assign fd_fifo_depth = FD_FIFO_DEPTH;
+//=============================================================================
+
+
+//=============================================================================
+// This block keeps the telemetry of the frame-data FIFO (see above)
+//=============================================================================
+wire fd_in_handshake  = AXIS_FD_IN_TVALID  & AXIS_FD_IN_TREADY;
+wire fd_out_handshake = AXIS_FD_OUT_TVALID & AXIS_FD_OUT_TREADY;
+
+// This is high between the first beat of a frame on the output and its TLAST
+reg fd_mid_frame;
+
+// The ping_ponger wants frame data in the middle of a frame, and there's none
+wire fd_starving = fd_mid_frame & AXIS_FD_OUT_TREADY & ~AXIS_FD_OUT_TVALID;
+
+// The value of "fd_starving" on the previous clock cycle
+reg fd_starving_prev;
+//-----------------------------------------------------------------------------
+always @(posedge clk) begin
+
+    if (resetn == 0) begin
+        fd_fifo_level    <= 0;
+        fd_fifo_high     <= 0;
+        fd_underruns     <= 0;
+        fd_starved       <= 0;
+        fd_mid_frame     <= 0;
+        fd_starving_prev <= 0;
+    end 
+    
+    else begin
+
+        // Count the beats going in and coming out
+        if (fd_in_handshake & ~fd_out_handshake) fd_fifo_level <= fd_fifo_level + 1;
+        if (fd_out_handshake & ~fd_in_handshake) fd_fifo_level <= fd_fifo_level - 1;
+
+        // Keep track of where we are within a frame on the output
+        if (fd_out_handshake) fd_mid_frame <= ~AXIS_FD_OUT_TLAST;
+
+        // Keep track of the high-water mark, and of how often the output ran dry
+        if (fd_fifo_clear) begin
+            fd_fifo_high     <= fd_fifo_level;
+            fd_underruns     <= 0;
+            fd_starved       <= 0;
+            fd_starving_prev <= 0;
+        end else begin
+            if (fd_fifo_level > fd_fifo_high) fd_fifo_high <= fd_fifo_level;
+            if (fd_starving & ~fd_starving_prev) fd_underruns <= fd_underruns + 1;
+            if (fd_starving) fd_starved <= fd_starved + 1;
+            fd_starving_prev <= fd_starving;
+        end
+
+    end
+end
+//=============================================================================
 
 
 // The "tready" signals from the two meta-data FIFOs
@@ -90,7 +251,7 @@ xpm_fifo_axis #
     .PACKET_FIFO        ("false"),
     .FIFO_DEPTH         (16),
     .TDATA_WIDTH        (DATA_WBITS),
-    .TUSER_WIDTH        (1),
+    .TUSER_WIDTH        (8),
     .FIFO_MEMORY_TYPE   (MD_FIFO_TYPE),
     .USE_ADV_FEATURES   ("0000")
 )
@@ -105,7 +266,7 @@ md0_fifo
    .s_axis_tdata    (AXIS_MD_IN_TDATA  ),
    .s_axis_tvalid   (md_in_handshake   ),
    .s_axis_tready   (fifo_md0_in_tready),
-   .s_axis_tuser    (                  ),
+   .s_axis_tuser    (AXIS_MD_IN_TUSER  ),
    .s_axis_tkeep    (                  ),
    .s_axis_tlast    (                  ),
 
@@ -114,7 +275,7 @@ md0_fifo
    .m_axis_tdata    (AXIS_MD0_OUT_TDATA ),
    .m_axis_tvalid   (AXIS_MD0_OUT_TVALID),
    .m_axis_tready   (AXIS_MD0_OUT_TREADY),
-   .m_axis_tuser    (                   ),
+   .m_axis_tuser    (AXIS_MD0_OUT_TUSER ),
    .m_axis_tkeep    (                   ),
    .m_axis_tlast    (                   ),
 
@@ -152,7 +313,7 @@ xpm_fifo_axis #
     .PACKET_FIFO        ("false"),
     .FIFO_DEPTH         (16),
     .TDATA_WIDTH        (DATA_WBITS),
-    .TUSER_WIDTH        (1),
+    .TUSER_WIDTH        (8),
     .FIFO_MEMORY_TYPE   (MD_FIFO_TYPE),
     .USE_ADV_FEATURES   ("0000")
 )
@@ -167,7 +328,7 @@ md1_fifo
    .s_axis_tdata    (AXIS_MD_IN_TDATA  ),
    .s_axis_tvalid   (md_in_handshake   ),
    .s_axis_tready   (fifo_md1_in_tready),
-   .s_axis_tuser    (                  ),
+   .s_axis_tuser    (AXIS_MD_IN_TUSER  ),
    .s_axis_tkeep    (                  ),
    .s_axis_tlast    (                  ),
 
@@ -175,7 +336,7 @@ md1_fifo
    .m_axis_tdata    (AXIS_MD1_OUT_TDATA ),
    .m_axis_tvalid   (AXIS_MD1_OUT_TVALID),
    .m_axis_tready   (AXIS_MD1_OUT_TREADY),
-   .m_axis_tuser    (                   ),
+   .m_axis_tuser    (AXIS_MD1_OUT_TUSER ),
    .m_axis_tkeep    (                   ),
    .m_axis_tlast    (                   ),
 
@@ -5,11 +5,53 @@
 //   Date     Who   Ver  Changes
 //=============================================================================
 // 15-Feb-24  DWW     1  Initial creation
+// 18-Oct-26  DWW     2  Added the "eof" strobe for latency tracing
+// 18-Oct-26  DWW     3  Added adaptive and weighted steering, link failover,
+//                       and per-link packet and byte counters
+// 18-Oct-26  DWW     4  Packets may be any multiple of 64 bytes, up to 16K
+// 18-Oct-26  DWW     5  Added DELTA_MODE
+// 19-Oct-26  DWW     6  Removed FRAME_SIZE, which PACKETS_PER_FRAME replaced
 //=============================================================================
 
 /*
     The packetizes an incoming data-stream, and writes groups of packets to the
     output streams in a ping-pong fashion
+
+    "eof" strobes high for one cycle when the last data-cycle of the last
+    packet of each frame is output
+
+    STEER_POLICY decides which output each group of packets is written to:
+
+      0 (alternate) : Groups strictly alternate between the outputs.  Each
+                      rdmx_shim receives exactly half of every frame
+ 
+      1 (adaptive)  : At the end of each group, we switch to the other output
+                      if it's ready to accept data or if the current output is
+                      stalled.  A congested link therefore carries fewer groups
+
+      2 (weighted)  : LINK_WEIGHT0 groups are written to output 0, then
+                      LINK_WEIGHT1 groups are written to output 1.  A weight
+                      of 0 means "don't use this link"
+
+    In policies 1 and 2, a link is only used if its QSFP is up and aligned
+    (LINK0_UP_ASYNC/LINK1_UP_ASYNC, straight from the CMACs) and its bit is
+    set in LINK_ENABLE.  If the current link
+    goes down, we fail over to the other one at the next packet boundary.
+
+    Since the split between the outputs is no longer fixed in policies 1 and 2
+    ("steered" mode), every packet is tagged on TUSER with its byte offset
+    within the frame, and at the end of each frame the number of packets that
+    were written to each output is sent on that output's AXIS_FPC stream.  
+    rdmx_shim uses those to place each packet and to find the end of a frame.
+    A new count is never written before the previous one has been accepted.
+
+    STEER_POLICY should only be changed while no frames are in flight.
+
+    When DELTA_MODE is high, data_fetch sends only the packets of a frame that
+    have changed (see data_fetch.v).  Each packet is then tagged with the frame
+    offset that arrives with it on AXIS_IN_TUSER, and a frame ends with the 
+    packet that carries AXIS_IN_TLAST rather than after PACKETS_PER_FRAME
+    packets.  Delta mode requires a steered STEER_POLICY.
 */
 
 
@@ -21,6 +63,8 @@ module ping_ponger
     // Input stream of frame data
     //=========================================================================
     input[511:0]   AXIS_IN_TDATA,
+    input[31:0]    AXIS_IN_TUSER,
+    input          AXIS_IN_TLAST,
     input          AXIS_IN_TVALID,
     output         AXIS_IN_TREADY,
     //=========================================================================
@@ -30,23 +74,73 @@ module ping_ponger
     //=========================================================================
     output[511:0]   AXIS_OUT0_TDATA,    AXIS_OUT1_TDATA,
     output          AXIS_OUT0_TLAST,    AXIS_OUT1_TLAST,
+    output[31:0]    AXIS_OUT0_TUSER,    AXIS_OUT1_TUSER,
     output          AXIS_OUT0_TVALID,   AXIS_OUT1_TVALID,
     input           AXIS_OUT0_TREADY,   AXIS_OUT1_TREADY,
     //=========================================================================
 
+    //=========================================================================
+    // The number of packets of each frame that went to each output
+    //=========================================================================
+    output reg[31:0] AXIS_FPC0_TDATA,   AXIS_FPC1_TDATA,
+    output reg       AXIS_FPC0_TVALID,  AXIS_FPC1_TVALID,
+    input            AXIS_FPC0_TREADY,  AXIS_FPC1_TREADY,
+    //=========================================================================
+
     // The outgoing packet size, in bytes
     input [15:0] PACKET_SIZE,
 
     // The number of packets in a ping-pong group
-    input [31:0] PACKETS_PER_GROUP
+    input [31:0] PACKETS_PER_GROUP,
+
+    // The number of packets in a frame
+    input [31:0] PACKETS_PER_FRAME,
+
+    // When this is high, only the changed packets of each frame arrive
+    input        DELTA_MODE,
+
+    // How packet groups are steered to the outputs, and the weights of the two
+    // outputs when STEER_POLICY is "weighted"
+    input [ 1:0] STEER_POLICY,
+    input [ 7:0] LINK_WEIGHT0, LINK_WEIGHT1,
+
+    // Bit N is for output N
+    input [ 1:0] LINK_ENABLE,
+
+    // The QSFP "up and aligned" status of each link, in the CMAC's clock domain
+    input        LINK0_UP_ASYNC, LINK1_UP_ASYNC,
+
+    // The number of packets and bytes that have been written to each output
+    output reg[63:0] LINK0_PACKETS, LINK1_PACKETS,
+    output reg[63:0] LINK0_BYTES,   LINK1_BYTES,
+
+    // Strobes high when the last packet of a frame has been output
+    output       eof
 );  
 
 
-// Number of data-cycles that comprise an outgoing packet
-wire[7:0] cycles_per_packet = PACKET_SIZE / 64;
+// Steering policies
+localparam POLICY_ALTERNATE = 0;
+localparam POLICY_ADAPTIVE  = 1;
+localparam POLICY_WEIGHTED  = 2;
+
+// In any policy but "alternate", the rdmx_shims are told how each frame was split
+wire steered = (STEER_POLICY != POLICY_ALTERNATE);
+
+// The QSFP status of each link, synchronized to our clock
+wire[1:0] link_up;
+cdc_single u_cdc_link0(LINK0_UP_ASYNC, clk, link_up[0]);
+cdc_single u_cdc_link1(LINK1_UP_ASYNC, clk, link_up[1]);
+
+// The outputs that we're allowed to write to in steered mode
+wire[1:0] link_ok = link_up & LINK_ENABLE;
+
+// Number of data-cycles that comprise an outgoing packet.  A packet can be up 
+// to 256 data-cycles (16K bytes), the longest burst an rdmx_shim can write
+wire[8:0] cycles_per_packet = PACKET_SIZE / 64;
 
 // The current data-cycle number being output.  Runs from 1 to "cycles_per_packet"
-reg[7:0] data_cycle_count;
+reg[8:0] data_cycle_count;
 
 // This is asserted on the last clock cycle of every outgoing packet
 wire last_cycle = (data_cycle_count == cycles_per_packet);
@@ -54,48 +148,225 @@ wire last_cycle = (data_cycle_count == cycles_per_packet);
 // This selects which output stream we're writing to
 reg output_select;
 
+// The number of the packet within the current frame, starting at 1
+reg[31:0] frame_packet_count;
+
+// This is asserted on any clock cycle of the last packet of a frame
+wire last_frame_packet;
+
+// This is asserted on the last clock cycle of the last packet of a frame
+wire last_frame_cycle;
+
+// In steered mode, we hold off the last data-cycle of a frame until both
+// rdmx_shims have accepted their packet-counts for the previous frame
+wire fpc_hold = steered & last_frame_cycle & (AXIS_FPC0_TVALID | AXIS_FPC1_TVALID);
+
 // The output TDATA is driven directly from the input stream
 assign AXIS_OUT0_TDATA = (output_select == 0) ? AXIS_IN_TDATA : 0;
 assign AXIS_OUT1_TDATA = (output_select == 1) ? AXIS_IN_TDATA : 0;
 
 // The output TVALID is driven by the input TVALID, gated by "output_select"
-assign AXIS_OUT0_TVALID = AXIS_IN_TVALID & (output_select == 0);
-assign AXIS_OUT1_TVALID = AXIS_IN_TVALID & (output_select == 1);
+assign AXIS_OUT0_TVALID = AXIS_IN_TVALID & (output_select == 0) & ~fpc_hold;
+assign AXIS_OUT1_TVALID = AXIS_IN_TVALID & (output_select == 1) & ~fpc_hold;
 
 // The output TLAST signals are asserted on the last cycle of every packet
 assign AXIS_OUT0_TLAST = last_cycle & AXIS_OUT0_TVALID;
 assign AXIS_OUT1_TLAST = last_cycle & AXIS_OUT1_TVALID;
 
 // The TREADY signal on the input stream is driven by one of the output streams
-assign AXIS_IN_TREADY = (output_select == 0) ? AXIS_OUT0_TREADY : AXIS_OUT1_TREADY;
+assign AXIS_IN_TREADY = ((output_select == 0) ? AXIS_OUT0_TREADY : AXIS_OUT1_TREADY) & ~fpc_hold;
 
 // Create some convenient shortcuts to the output TVALID, TLAST, and TREADY
 wire axis_out_tvalid = (output_select == 0) ? AXIS_OUT0_TVALID : AXIS_OUT1_TVALID;
 wire axis_out_tlast  = (output_select == 0) ? AXIS_OUT0_TLAST  : AXIS_OUT1_TLAST;
 wire axis_out_tready = (output_select == 0) ? AXIS_OUT0_TREADY : AXIS_OUT1_TREADY;
 
+// This is high on the handshake of the last data-cycle of every packet
+wire packet_sent = axis_out_tvalid & axis_out_tready & axis_out_tlast;
+
+// This is high when the next data-cycle is the first one of a packet
+wire packet_boundary = (data_cycle_count == 1);
+
+
+//=============================================================================
+// This block decides which output the next group of packets should go to
+//=============================================================================
+wire      other_select = ~output_select;
+wire[1:0] out_tready   = {AXIS_OUT1_TREADY, AXIS_OUT0_TREADY};
+wire[7:0] weight_cur   = (output_select == 0) ? LINK_WEIGHT0 : LINK_WEIGHT1;
+wire[7:0] weight_other = (output_select == 0) ? LINK_WEIGHT1 : LINK_WEIGHT0;
+
+// The number of groups written to the current output since we switched to it
+reg[7:0]  group_count;
+
+reg next_select;
+always @* begin
+
+    // In "alternate" mode, we always switch
+    if (STEER_POLICY == POLICY_ALTERNATE)
+        next_select = other_select;
+
+    // If the current link has gone down, fail over to the other one
+    else if (~link_ok[output_select] & link_ok[other_select])
+        next_select = other_select;
+
+    // If the other link is down, stay where we are
+    else if (~link_ok[other_select])
+        next_select = output_select;
+    
+    // Switch if the other output is ready or the current one is stalled
+    else if (STEER_POLICY == POLICY_ADAPTIVE)
+        next_select = (out_tready[other_select] | ~out_tready[output_select])
+                    ? other_select : output_select;
+
+    // Switch when the current link has had its share of groups
+    else if (STEER_POLICY == POLICY_WEIGHTED)
+        next_select = (weight_other != 0 && group_count >= weight_cur)
+                    ? other_select : output_select;
+
+    else
+        next_select = output_select;
+end
+//=============================================================================
+
+
 //=============================================================================
 // This block watches for the handshake on the last data-cycle of outgoing
-// packets.  Every "PACKETS_PER_GROUP" packets, it switches the "output_select"
-// register from 0 to 1 (or vice-versa)
+// packets.  At the end of every group of "PACKETS_PER_GROUP" packets, it 
+// sets "output_select" to the output chosen by the steering policy.
+//
+// In steered mode, if the current link goes down, we switch immediately
+// rather than waiting for the end of the group.  This is only done between
+// packets, so that no packet is ever split between the outputs.
 //=============================================================================
 reg[15:0] packet_counter;
 //-----------------------------------------------------------------------------
 always @(posedge clk) begin
     if (resetn == 0) begin
         packet_counter <= 1;
+        group_count    <= 1;
         output_select  <= 0;
     end
     
-    else if (axis_out_tvalid & axis_out_tready & axis_out_tlast) begin
+    else if (packet_sent) begin
         if (packet_counter < PACKETS_PER_GROUP)
             packet_counter <= packet_counter + 1;
         else begin
             packet_counter <= 1;
-            output_select  <= ~output_select;
+            output_select  <= next_select;
+            if (next_select == output_select && group_count != 8'hFF)
+                group_count <= group_count + 1;
+            else
+                group_count <= 1;
         end
     end
 
+    else if (steered & packet_boundary & ~(axis_out_tvalid & axis_out_tready)
+                     & ~link_ok[output_select] & link_ok[other_select]) begin
+        packet_counter <= 1;
+        group_count    <= 1;
+        output_select  <= other_select;
+    end
+
+end
+//=============================================================================
+
+
+//=============================================================================
+// This block counts the packets in each frame so that "eof" can be strobed
+// when the last packet of a frame goes out.  It also keeps track of the byte
+// offset of the current packet within its frame, which is output on TUSER
+//
+// In delta mode, the frame offset and the end of the frame come from the 
+// input stream instead
+//=============================================================================
+reg[31:0] frame_offset;
+
+assign AXIS_OUT0_TUSER = DELTA_MODE ? AXIS_IN_TUSER : frame_offset;
+assign AXIS_OUT1_TUSER = DELTA_MODE ? AXIS_IN_TUSER : frame_offset;
+
+assign last_frame_packet = DELTA_MODE ? AXIS_IN_TLAST 
+                                      : (frame_packet_count >= PACKETS_PER_FRAME);
+
+assign last_frame_cycle = last_cycle & last_frame_packet;
+
+assign eof = packet_sent & last_frame_packet;
+//-----------------------------------------------------------------------------
+always @(posedge clk) begin
+    if (resetn == 0) begin
+        frame_packet_count <= 1;
+        frame_offset       <= 0;
+    end else if (packet_sent) begin
+        if (eof) begin
+            frame_packet_count <= 1;
+            frame_offset       <= 0;
+        end else begin
+            frame_packet_count <= frame_packet_count + 1;
+            frame_offset       <= frame_offset + PACKET_SIZE;
+        end
+    end
+end
+//=============================================================================
+
+
+//=============================================================================
+// In steered mode, this block counts the packets of each frame that are 
+// written to each output, and at the end of the frame, sends those counts
+// to the rdmx_shims on the AXIS_FPC streams
+//=============================================================================
+reg[31:0] fpc0, fpc1;
+//-----------------------------------------------------------------------------
+always @(posedge clk) begin
+    
+    // Clear TVALID when the rdmx_shim accepts the count
+    if (AXIS_FPC0_TVALID & AXIS_FPC0_TREADY) AXIS_FPC0_TVALID <= 0;
+    if (AXIS_FPC1_TVALID & AXIS_FPC1_TREADY) AXIS_FPC1_TVALID <= 0;
+
+    if (resetn == 0) begin
+        fpc0             <= 0;
+        fpc1             <= 0;
+        AXIS_FPC0_TVALID <= 0;
+        AXIS_FPC1_TVALID <= 0;
+    end
+    
+    else if (packet_sent) begin
+        if (eof) begin
+            AXIS_FPC0_TDATA  <= fpc0 + (output_select == 0);
+            AXIS_FPC1_TDATA  <= fpc1 + (output_select == 1);
+            AXIS_FPC0_TVALID <= steered;
+            AXIS_FPC1_TVALID <= steered;
+            fpc0             <= 0;
+            fpc1             <= 0;
+        end 
+        else if (output_select == 0)
+            fpc0 <= fpc0 + 1;
+        else
+            fpc1 <= fpc1 + 1;
+    end
+end
+//=============================================================================
+
+
+//=============================================================================
+// This block counts the packets and bytes written to each output
+//=============================================================================
+always @(posedge clk) begin
+    if (resetn == 0) begin
+        LINK0_PACKETS <= 0;
+        LINK1_PACKETS <= 0;
+        LINK0_BYTES   <= 0;
+        LINK1_BYTES   <= 0;
+    end
+
+    else if (packet_sent) begin
+        if (output_select == 0) begin
+            LINK0_PACKETS <= LINK0_PACKETS + 1;
+            LINK0_BYTES   <= LINK0_BYTES   + PACKET_SIZE;
+        end else begin
+            LINK1_PACKETS <= LINK1_PACKETS + 1;
+            LINK1_BYTES   <= LINK1_BYTES   + PACKET_SIZE;
+        end
+    end
 end
 //=============================================================================
 
@@ -7,6 +7,13 @@
 //   Date     Who   Ver  Changes
 //====================================================================================
 // 29-Feb-24  DWW     2  Fixed bug with the meta-data registers being too small
+// 18-Oct-26  DWW     3  Optionally stamps the timestamp into the meta-data
+// 18-Oct-26  DWW     4  Added "steered" mode for uneven splits of a frame
+// 18-Oct-26  DWW     5  Packets may be any multiple of 64 bytes, up to 16K
+// 18-Oct-26  DWW     6  Added RING_RESTART
+// 18-Oct-26  DWW     7  Frame-counter writes can be coalesced
+// 18-Oct-26  DWW     8  Added multiple streams, each with its own rings
+// 19-Oct-26  DWW     9  A frame-data beat stays valid until it's accepted
 //====================================================================================
 
 
@@ -20,11 +27,58 @@
      When writing frame data, the addresses they are written to are in a circular ring
      buffer.   Meta-data are written to a separate ring buffer.
 
+     When STAMP_ENABLE is asserted, bytes 104 thru 111 of the meta-data are replaced
+     with the value of TIMESTAMP at the moment the meta-data is output, which is the
+     cycle before the frame-counter is written.
+
+     When STEERED is asserted, the ping_ponger doesn't split frames evenly between
+     the two rdmx_shims.  In that mode:
+
+     (1) Each packet is written at its own offset within the frame (AXIS_FD_TUSER),
+         so the ring buffer holds whole frames, FRAME_SIZE bytes apart, and the
+         packets carried by the other rdmx_shim leave gaps for it to fill
+     (2) The end of a frame is found by counting packets up to the count that
+         arrives on the AXIS_FPC stream.  That count can be zero, in which case
+         we output only the meta-data and the frame-count
+
+     Frame-counter coalescing:
+
+     The frame-count is normally written after every frame.  When FC_COALESCE_FRAMES
+     is greater than 1, it's only written after every FC_COALESCE_FRAMES frames, or 
+     once FC_COALESCE_CYCLES clock cycles have passed since the oldest frame whose 
+     count hasn't been written yet, whichever comes first (0 cycles means "no time
+     limit").  A write due to the time limit is made between two packets, and carries
+     the count of the last frame that was completed.  "fc_update" strobes for every
+     write of the frame-count, and "fc_skip" strobes for every frame whose count
+     wasn't written.  "eof" strobes once per frame either way.
+
+     RING_RESTART is strobed when a new configuration has been committed.  It 
+     only arrives between frames, and it sends both ring-buffer pointers back to
+     the start of their rings.  The frame count carries on.
+
+     Streams:
+
+     Every frame belongs to one of STREAMS streams, and the stream arrives on 
+     AXIS_MD_TUSER along with the frame's meta-data.  Each stream has its own
+     frame-data ring, meta-data ring and frame-counter address (the ring and
+     address inputs hold STREAMS 64-bit values, stream 0 in the low bits), its
+     own ring-buffer pointers, and its own frame-count.  We don't accept the
+     frame-data of a frame until its meta-data has arrived, so we always know
+     which stream a packet belongs to.  The stream is output on M_AXI_AWUSER
+     with every write, so that rdmx_xmit can put it into the RDMX header, and
+     when STREAM_STAMP is asserted it's also stamped into byte 103 of the 
+     meta-data.
+
+     A coalesced frame-count is owed to one stream at a time.  When a frame of
+     a different stream arrives while a frame-count is still owed, the owed 
+     count is written before the new frame starts.
+
 */
 
 module rdmx_shim #
 (
-    parameter DATA_WBITS = 512
+    parameter DATA_WBITS = 512,
+    parameter STREAMS    = 4
 )
 (
     input clk, resetn,
@@ -35,25 +89,55 @@ module rdmx_shim #
     // Size of a single-phase (i.e., 2 semiphases) sensor-data frame, in bytes
     input[31:0] FRAME_SIZE,
 
-    // Geometry of the frame-data ring buffer
-    input[63:0] FD_RING_ADDR, FD_RING_SIZE,
+    // The number of packets in a frame (i.e., FRAME_SIZE / PACKET_SIZE)
+    input[31:0] PACKETS_PER_FRAME,
+
+    // Geometry of the frame-data ring buffer of each stream
+    input[STREAMS*64-1:0] FD_RING_ADDR, FD_RING_SIZE,
+
+    // Geometry of the meta-command ring buffer of each stream
+    input[STREAMS*64-1:0] MD_RING_ADDR, MD_RING_SIZE,
+
+    // The remote address where the frame-counter of each stream should be stored
+    input[STREAMS*64-1:0] FC_ADDR,
+
+    // The free-running timestamp counter, and whether to stamp it into meta-data
+    input[63:0] TIMESTAMP,
+    input       STAMP_ENABLE,
 
-    // Geometry of the meta-command ring buffer
-    input[63:0] MD_RING_ADDR, MD_RING_SIZE,
+    // When this is high, the stream is stamped into the meta-data
+    input       STREAM_STAMP,
 
-    // The remote address where the frame-counter should be stored
-    input[63:0] FC_ADDR,
+    // When this is high, packets are placed by their frame offset (see above)
+    input       STEERED,
+
+    // Strobes when the ring-buffers have been reconfigured (see above)
+    input       RING_RESTART,
+
+    // Frame-counter coalescing (see above)
+    input[15:0] FC_COALESCE_FRAMES,
+    input[31:0] FC_COALESCE_CYCLES,
+    output      fc_update, fc_skip,
 
     //====================   The frame data input stream   =====================
     input [DATA_WBITS-1:0] AXIS_FD_TDATA,
+    input [31:0]           AXIS_FD_TUSER,
     input                  AXIS_FD_TVALID,
     input                  AXIS_FD_TLAST,
     output                 AXIS_FD_TREADY,
     //==========================================================================
 
 
+    //========  The number of packets we'll receive of each frame (steered)  ===
+    input[31:0]            AXIS_FPC_TDATA,
+    input                  AXIS_FPC_TVALID,
+    output                 AXIS_FPC_TREADY,
+    //==========================================================================
+
+
     //======================  The metadata input stream  =======================
     input[DATA_WBITS-1:0]  AXIS_MD_TDATA,
+    input[7:0]             AXIS_MD_TUSER,
     input                  AXIS_MD_TVALID,
     output                 AXIS_MD_TREADY,
     //==========================================================================
@@ -71,6 +155,7 @@ module rdmx_shim #
     output     [3:0]                         M_AXI_AWQOS,
     output     [2:0]                         M_AXI_AWPROT,
     output reg                               M_AXI_AWVALID,
+    output     [7:0]                         M_AXI_AWUSER,
     input                                                   M_AXI_AWREADY,
 
     // "Write Data"                         -- Master --    -- Slave --
@@ -106,27 +191,86 @@ module rdmx_shim #
     //==========================================================================
 
     // These are for debugging with an ILA
-    output reg[31:0] frame_count,
+    output[31:0]     frame_count,
     output           eof
 );
 
 // The width of a meta-data in bytes
 localparam METADATA_WIDTH = 128;
 
-// Compute the number of data-cycles in an outgoing packet
-wire[7:0] cycles_per_packet = PACKET_SIZE / (DATA_WBITS/8);
+// The byte offset within the 2nd half of the meta-data where the timestamp goes
+localparam MD_STAMP_OFFSET = 104 - (DATA_WBITS/8);
+
+// And where the stream goes
+localparam MD_STREAM_OFFSET = 103 - (DATA_WBITS/8);
+
+// The stream of the frame we're working on (from the TUSER of its meta-data),
+// and the stream whose frame-count we're writing, or that is owed one
+reg[2:0] md_stream, fc_stream;
+
+// The ring geometry of the stream of the current frame
+wire[63:0] fd_ring_addr = FD_RING_ADDR[md_stream*64 +: 64];
+wire[63:0] fd_ring_size = FD_RING_SIZE[md_stream*64 +: 64];
+wire[63:0] md_ring_addr = MD_RING_ADDR[md_stream*64 +: 64];
+wire[63:0] md_ring_size = MD_RING_SIZE[md_stream*64 +: 64];
+
+// And the remote frame-counter we're writing to
+wire[63:0] fc_addr      = FC_ADDR[fc_stream*64 +: 64];
 
-// Offset where we'll write the next frame-data 
-reg [63:0] fd_ptr;
-wire[63:0] next_fd_ptr = fd_ptr + PACKET_SIZE;   
+// Loop counter
+integer s;
 
-// Offset where we'll write the next meta-data
-reg [63:0] md_ptr;
+// Compute the number of data-cycles in an outgoing packet.  This can be up to
+// 256, the longest burst that AWLEN can describe
+wire[8:0] cycles_per_packet = PACKET_SIZE / (DATA_WBITS/8);
+
+// Offset (per stream) where we'll write the next frame-data.  In steered 
+// mode, this is the offset of the current frame
+reg [63:0] fd_ptrs[0:STREAMS-1];
+wire[63:0] fd_ptr        = fd_ptrs[md_stream];
+wire[63:0] next_fd_ptr   = fd_ptr + PACKET_SIZE;   
+wire[63:0] next_fd_frame = fd_ptr + FRAME_SIZE;
+
+// Offset (per stream) where we'll write the next meta-data
+reg [63:0] md_ptrs[0:STREAMS-1];
+wire[63:0] md_ptr      = md_ptrs[md_stream];
 wire[63:0] next_md_ptr = md_ptr + METADATA_WIDTH;
 
+// The number of the next frame to complete, per stream
+reg [31:0] frame_counts[0:STREAMS-1];
+assign frame_count = frame_counts[md_stream];
+
 // When writing data-bursts to the output interface, this is the current beat
 reg[8:0] beat;
 
+// The frame-count we write to FC_ADDR: the number of the last completed frame
+reg[31:0] fc_value;
+
+// The number of completed frames whose count hasn't been written yet, and the
+// number of cycles since the first of them was completed
+reg[15:0] fc_owed;
+reg[31:0] fc_timer;
+
+// This is high when the frame-count we're writing is due to the time limit
+reg       fc_flush;
+
+// The time limit on an unwritten frame-count has been reached
+wire fc_expired = (fc_owed != 0) & (FC_COALESCE_CYCLES != 0) 
+                & (fc_timer >= FC_COALESCE_CYCLES);
+
+// At the end of a frame, this tells us whether to write the frame-count
+wire fc_due = (fc_owed + 1 >= FC_COALESCE_FRAMES) | fc_expired;
+
+// The meta-data (and therefore the stream) of the current frame has arrived
+wire md_ready;
+
+// A frame of another stream has arrived while a frame-count is still owed
+wire fc_switch = (fc_owed != 0) & md_ready & (fc_stream != md_stream);
+
+// We hold off frame-data until we know its stream, and until any frame-count
+// owed to a different stream has been written
+wire fd_hold = ~md_ready | fc_switch;
+
 // This will be high when outputting the first beat of a burst 
 wire first_beat = (M_AXI_WVALID & M_AXI_WREADY & (beat == 0));
 
@@ -139,45 +283,56 @@ localparam FSM_OUTPUT_MD1  = 3;
 localparam FSM_OUTPUT_MD2  = 4;
 localparam FSM_OUTPUT_FC   = 5;
 
+// The number of the packet we're about to receive within the current frame
+reg[31:0] packet_count;
+
+// This is high when a frame-data beat was offered on the previous cycle and
+// wasn't accepted.  Until it is, it must stay on the bus
+reg fd_offered;
+
+// In steered mode, this is high when we're between packets and we've received
+// every packet of this frame that the ping_ponger sent us
+wire frame_done = STEERED & AXIS_FPC_TVALID & (beat == 0) & ~fd_hold
+                & ~fd_offered & (packet_count == AXIS_FPC_TDATA + 1);
+
 // 128 bytes of metadata
 reg[DATA_WBITS-1:0] metadata[0:1];
 
+// The 2nd half of the meta-data, with the timestamp and the stream stamped
+// into it if enabled
+reg[DATA_WBITS-1:0] metadata_2;
+always @* begin
+    metadata_2 = metadata[1];
+    if (STAMP_ENABLE) metadata_2[MD_STAMP_OFFSET*8  +: 64] = TIMESTAMP;
+    if (STREAM_STAMP) metadata_2[MD_STREAM_OFFSET*8 +:  8] = md_stream;
+end
+
 // Create a byte-swapped version of the data on the input stream
 //wire[DATA_WBITS-1:0] AXIS_FD_tdata_swapped;
 //byte_swap#(DATA_WBITS) bs2(.I(AXIS_FD_TDATA), .O(AXIS_FD_tdata_swapped));
 
 //=============================================================================
-// This block computes the number of outgoing packets per data-frame
+// The number of packets we'll see in each data-frame
 //
 // One instance of this module (rdmx_shim) will only see half of the packets
 // for a data-frame.  The other half of the packets are being sent to the
 // other instance of rdmx_shim.
 //=============================================================================
-reg [31:0] packets_per_frame;
-wire[31:0] packets_per_half_frame = packets_per_frame / 2;
-always @* begin
-    case (PACKET_SIZE)
-          64:   packets_per_frame = FRAME_SIZE /   64;
-         128:   packets_per_frame = FRAME_SIZE /  128;
-         256:   packets_per_frame = FRAME_SIZE /  256;
-         512:   packets_per_frame = FRAME_SIZE /  512;
-        1024:   packets_per_frame = FRAME_SIZE / 1024;
-        2048:   packets_per_frame = FRAME_SIZE / 2048;
-        4096:   packets_per_frame = FRAME_SIZE / 4096;
-        8192:   packets_per_frame = FRAME_SIZE / 8192;
-     default:   packets_per_frame = 1;
-    endcase
-end
+wire[31:0] packets_per_half_frame = PACKETS_PER_FRAME / 2;
 //=============================================================================
 
 //=============================================================================
-// This block reads in two data-cycles of metadata
+// This block reads in two data-cycles of metadata, and the stream they
+// belong to
 //=============================================================================
 reg[1:0] mdsm_state;
 reg      fetch_metadata;
 
 // We're ready to receive metadata in states 0 and 1
 assign AXIS_MD_TREADY = (resetn == 1 && mdsm_state < 2);
+
+// The metadata of the current frame is here in state 2
+assign md_ready = (mdsm_state == 2);
 //-----------------------------------------------------------------------------
 always @(posedge clk) begin
     if (resetn == 0) begin
@@ -188,6 +343,7 @@ always @(posedge clk) begin
         // When it arrives, store it in metadata[0]
         0:  if (AXIS_MD_TVALID & AXIS_MD_TREADY) begin
                 metadata[0] <= AXIS_MD_TDATA;
+                md_stream   <= AXIS_MD_TUSER[2:0];
                 mdsm_state  <= 1;
             end
 
@@ -248,8 +404,8 @@ always @* begin
     case (output_mode)
         OM_FD   :   M_AXI_WDATA = AXIS_FD_TDATA;
         OM_MD1  :   M_AXI_WDATA = metadata[0];
-        OM_MD2  :   M_AXI_WDATA = metadata[1];
-        OM_FC   :   M_AXI_WDATA = frame_count;
+        OM_MD2  :   M_AXI_WDATA = metadata_2;
+        OM_FC   :   M_AXI_WDATA = fc_value;
         default :   M_AXI_WDATA = 0;
     endcase
 end
@@ -287,7 +443,7 @@ end
 //-----------------------------------------------------------------------------
 always @* begin
     case (output_mode)
-        OM_FD   :   M_AXI_WVALID = AXIS_FD_TVALID;
+        OM_FD   :   M_AXI_WVALID = AXIS_FD_TVALID & ~frame_done & ~fd_hold;
         OM_MD1  :   M_AXI_WVALID = 1;
         OM_MD2  :   M_AXI_WVALID = 1;
         OM_FC   :   M_AXI_WVALID = 1;
@@ -321,10 +477,11 @@ assign M_AXI_AWQOS   = 0;       /* No QoS                 */
 //-----------------------------------------------------------------------------
 always @* begin
     case (output_mode)
-        OM_FD   :   M_AXI_AWADDR = FD_RING_ADDR + fd_ptr;
-        OM_MD1  :   M_AXI_AWADDR = MD_RING_ADDR + md_ptr;
-        OM_MD2  :   M_AXI_AWADDR = MD_RING_ADDR + md_ptr;
-        OM_FC   :   M_AXI_AWADDR = FC_ADDR;
+        OM_FD   :   M_AXI_AWADDR = STEERED ? fd_ring_addr + fd_ptr + AXIS_FD_TUSER
+                                           : fd_ring_addr + fd_ptr;
+        OM_MD1  :   M_AXI_AWADDR = md_ring_addr + md_ptr;
+        OM_MD2  :   M_AXI_AWADDR = md_ring_addr + md_ptr;
+        OM_FC   :   M_AXI_AWADDR = fc_addr;
         default :   M_AXI_AWADDR = 0;
     endcase
 end
@@ -332,6 +489,14 @@ end
 
 
 
+//-----------------------------------------------------------------------------
+// Drive M_AXI_AWUSER with the stream that the write belongs to
+//-----------------------------------------------------------------------------
+assign M_AXI_AWUSER = (output_mode == OM_FC) ? fc_stream : md_stream;
+//-----------------------------------------------------------------------------
+
+
+
 //-----------------------------------------------------------------------------
 // Drive M_AXI_AWLEN
 //-----------------------------------------------------------------------------
@@ -379,27 +544,44 @@ assign M_AXI_BREADY = 1;
 // Drive the TREADY line of the input stream.  We only allow input when
 // we're in frame-data mode and the output is ready to receive the data-cycle.
 //-----------------------------------------------------------------------------
-assign AXIS_FD_TREADY = (output_mode == OM_FD) & M_AXI_WREADY;
+assign AXIS_FD_TREADY = (output_mode == OM_FD) & M_AXI_WREADY & ~frame_done & ~fd_hold;
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// We accept a packet-count on the cycle we finish with the frame it describes
+//-----------------------------------------------------------------------------
+assign AXIS_FPC_TREADY = (fsm_state == FSM_XFER_PACKET) & frame_done;
 //-----------------------------------------------------------------------------
 
 
 //=============================================================================
-// This state machine manages the "fd_ptr" that specifies the offset where
-// the next packet of frame data should be stored
+// This state machine manages the "fd_ptr" (of the current stream) that 
+// specifies the offset where the next packet of frame data should be stored.
+// In steered mode, it's the offset of the current frame, and it advances 
+// once per frame
 //=============================================================================
 always @(posedge clk) begin
     
-    case(fsm_state)
+    if (RING_RESTART || fsm_state == FSM_START) begin
+        for (s=0; s<STREAMS; s=s+1) fd_ptrs[s] <= 0;
+    end
 
-        FSM_START:
-            fd_ptr <= 0;
+    else case(fsm_state)
 
         FSM_XFER_PACKET:
-            if (M_AXI_WVALID & M_AXI_WREADY & M_AXI_WLAST) begin
-                if (next_fd_ptr < FD_RING_SIZE)
-                    fd_ptr <= next_fd_ptr;
+            if (~STEERED & M_AXI_WVALID & M_AXI_WREADY & M_AXI_WLAST) begin
+                if (next_fd_ptr < fd_ring_size)
+                    fd_ptrs[md_stream] <= next_fd_ptr;
                 else
-                    fd_ptr <= 0;
+                    fd_ptrs[md_stream] <= 0;
+            end
+
+        FSM_OUTPUT_MD2:
+            if (STEERED & M_AXI_WVALID & M_AXI_WREADY) begin
+                if (next_fd_frame + FRAME_SIZE <= fd_ring_size)
+                    fd_ptrs[md_stream] <= next_fd_frame;
+                else
+                    fd_ptrs[md_stream] <= 0;
             end
 
     endcase
@@ -412,25 +594,21 @@ end
 
 
 //=============================================================================
-// This state machine manages the "md_ptr" that specifies the offset where
-// the next meta-data should be stored
+// This state machine manages the "md_ptr" (of the current stream) that 
+// specifies the offset where the next meta-data should be stored
 //=============================================================================
 always @(posedge clk) begin
     
-    case(fsm_state)
+    if (RING_RESTART || fsm_state == FSM_START) begin
+        for (s=0; s<STREAMS; s=s+1) md_ptrs[s] <= 0;
+    end
 
-        FSM_START:
-            md_ptr <= 0;
-
-        FSM_OUTPUT_MD2:
-            if (M_AXI_WVALID & M_AXI_WREADY) begin
-                if (next_md_ptr < MD_RING_SIZE)
-                    md_ptr <= next_md_ptr;
-                else
-                    md_ptr <= 0;
-            end
-
-    endcase
+    else if (fsm_state == FSM_OUTPUT_MD2 && M_AXI_WVALID && M_AXI_WREADY) begin
+        if (next_md_ptr < md_ring_size)
+            md_ptrs[md_stream] <= next_md_ptr;
+        else
+            md_ptrs[md_stream] <= 0;
+    end
 
 end
 //=============================================================================
@@ -440,15 +618,16 @@ end
 //=============================================================================
 // This state machine is responsible for watching packets get copied from the
 // input interface to the output interface and for injecting a meta-data packet
-// and a frame-count packet after every frame.
+// and a frame-count packet after every frame (or every few frames, when the
+// frame-count writes are being coalesced).
 //
 // Drives:
 //    fsm_state (and therefore, "output_mode")
 //    beat
 //    packet_count
-//    frame_count
+//    frame_counts[]
+//    fc_value, fc_stream, fc_owed, fc_timer, fc_flush
 //=============================================================================
-reg[31:0] packet_count;
 
 
 always @(posedge clk) begin
@@ -466,20 +645,37 @@ always @(posedge clk) begin
 
         FSM_START:
             begin
+                for (s=0; s<STREAMS; s=s+1) frame_counts[s] <= 1;
                 beat         <= 0;
-                frame_count  <= 1;
+                fc_stream    <= 0;
                 packet_count <= 1;
+                fc_owed      <= 0;
+                fc_timer     <= 0;
+                fc_flush     <= 0;
                 fsm_state    <= FSM_XFER_PACKET;
             end
 
         // Counts packets as they get output.  Once an entire frame has 
-        // has been output, we move on to the next state
+        // has been output, we move on to the next state.  If a coalesced
+        // frame-count has waited too long, or is owed to a stream other
+        // than the one this frame belongs to, we write it between packets,
+        // when no frame-data beat is waiting on the bus
         FSM_XFER_PACKET:
-            if (M_AXI_WVALID & M_AXI_WREADY) begin
+            if (fc_switch & (beat == 0)) begin
+                fc_flush  <= 1;
+                fsm_state <= FSM_OUTPUT_FC;
+            end
+            else if (frame_done)
+                fsm_state <= FSM_OUTPUT_MD1;
+            else if (fc_expired & (beat == 0) & ~M_AXI_WVALID) begin
+                fc_flush  <= 1;
+                fsm_state <= FSM_OUTPUT_FC;
+            end
+            else if (M_AXI_WVALID & M_AXI_WREADY) begin
                 beat <= beat + 1;
                 if (M_AXI_WLAST) begin
                     beat <= 0;
-                    if (packet_count == packets_per_half_frame) begin
+                    if (~STEERED & packet_count == packets_per_half_frame) begin
                         fsm_state <= FSM_OUTPUT_MD1;
                     end else
                         packet_count <= packet_count + 1;
@@ -493,29 +689,62 @@ always @(posedge clk) begin
                 fsm_state <= FSM_OUTPUT_MD2;
             end
         
-        // Wait for the 2nd half of the meta-data to be output
+        // Wait for the 2nd half of the meta-data to be output.  That's the
+        // end of the frame, and we write its frame-count if it's due
         FSM_OUTPUT_MD2:
             if (M_AXI_WVALID & M_AXI_WREADY) begin
                 fetch_metadata <= 1;
                 beat           <= 0;
-                fsm_state      <= FSM_OUTPUT_FC;
+                fc_value       <= frame_counts[md_stream];
+                fc_stream      <= md_stream;
+                frame_counts[md_stream] <= frame_counts[md_stream] + 1;
+                packet_count   <= 1;
+                if (fc_due)
+                    fsm_state  <= FSM_OUTPUT_FC;
+                else begin
+                    fc_owed    <= fc_owed + 1;
+                    fsm_state  <= FSM_XFER_PACKET;
+                end
             end
 
         // Wait for the frame-counter to be output
         FSM_OUTPUT_FC:
             if (M_AXI_WVALID & M_AXI_WREADY) begin
-                frame_count  <= frame_count + 1;
-                packet_count <= 1;
+                fc_owed      <= 0;
+                fc_timer     <= 0;
+                fc_flush     <= 0;
                 fsm_state    <= FSM_XFER_PACKET;
             end
 
     endcase
 
+    // Time how long the oldest unwritten frame-count has been waiting
+    if (resetn == 1 && fsm_state != FSM_START && fsm_state != FSM_OUTPUT_FC 
+                    && fc_owed != 0 && ~fc_expired)
+        fc_timer <= fc_timer + 1;
+
+end
+
+// A frame-data beat that's on the bus can't be withdrawn, so once we've offered
+// one, "frame_done" stays low until it has been accepted
+always @(posedge clk) begin
+    if (resetn == 0)
+        fd_offered <= 0;
+    else
+        fd_offered <= (output_mode == OM_FD) & M_AXI_WVALID & ~M_AXI_WREADY;
 end
 
+// Handshakes at the end of the meta-data and of the frame-count
+wire md_done = (fsm_state == FSM_OUTPUT_MD2) & M_AXI_WVALID & M_AXI_WREADY;
+wire fc_done = (fsm_state == FSM_OUTPUT_FC ) & M_AXI_WVALID & M_AXI_WREADY;
+
+// These count the frame-count writes we make and the ones we save
+assign fc_update = fc_done;
+assign fc_skip   = md_done & ~fc_due;
+
 // This flag is asserted for one cycle at the end of a frame and is
 // useful for examining end-of-frame behavior in an ILA
-assign eof = (fsm_state == FSM_OUTPUT_FC) & M_AXI_WVALID & M_AXI_WREADY;
+assign eof = (fc_done & ~fc_flush) | fc_skip;
 //=============================================================================
 
 endmodule
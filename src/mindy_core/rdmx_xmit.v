@@ -9,6 +9,10 @@
 // 12-Jan-24  DWW  1001  Changed name to RDMX
 //
 // 19-Feb-24  DWW  1002  Split front-end from back-end and added mixed clocks
+//
+// 18-Oct-26  DWW  1003  Data FIFO holds two of the largest (16K) packets
+//
+// 18-Oct-26  DWW  1004  S_AXI_AWUSER is carried into the RDMX header as the stream ID
 //====================================================================================
 
 /*
@@ -26,7 +30,8 @@
     <>     An ordinary 42-byte ethernet/IP/UDP header                               <>
     <>     A  2-byte magic number (0x0122)
     <>     A  8-byte target address                                                 <>
-    <>     12 bytes of reserved data, always 0                                      <>
+    <>     A  1-byte stream ID (from AWUSER)                                        <>
+    <>     11 bytes of reserved data, always 0                                      <>
     <><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><>
 
     The incoming S_AXI_WDATA data should be byte packed; only the last beat (the
@@ -74,8 +79,9 @@ module rdmx_xmit #
 
     // This should be at minimum MAX_PACKET_COUNT * # of data-cycles in the smallest
     // incoming packet.  This number must be large enough to accomodate the number of
-    // data cycles in the largest incoming packet.
-    parameter DATA_FIFO_DEPTH = 256
+    // data cycles in the largest incoming packet.  The default holds two 16K packets,
+    // so that one can be arriving while the other is being sent
+    parameter DATA_FIFO_DEPTH = 512
 
     //<><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><>
     //>> DATA_FIFO_DEPTH / MAX_PACKET_COUNT = # of cycles in the smallest incoming data packet
@@ -104,6 +110,7 @@ module rdmx_xmit #
     input[3:0]                              S_AXI_AWCACHE,
     input[3:0]                              S_AXI_AWQOS,
     input[2:0]                              S_AXI_AWPROT,
+    input[7:0]                              S_AXI_AWUSER,
     output                                                  S_AXI_AWREADY,
 
     // "Write Data"                         -- Master --    -- Slave --
@@ -161,6 +168,7 @@ wire                  AXIS_PLEN_TREADY;
 
 // Wires to connect the target-address stream
 wire [ADDR_WBITS-1:0] AXIS_ADDR_TDATA;
+wire [7:0]            AXIS_ADDR_TUSER;
 wire                  AXIS_ADDR_TVALID;
 wire                  AXIS_ADDR_TREADY;
 
@@ -192,6 +200,7 @@ front_end
     .S_AXI_AWCACHE  (S_AXI_AWCACHE),         
     .S_AXI_AWQOS    (S_AXI_AWQOS  ),       
     .S_AXI_AWPROT   (S_AXI_AWPROT ),
+    .S_AXI_AWUSER   (S_AXI_AWUSER ),
     .S_AXI_AWREADY  (S_AXI_AWREADY),
     .S_AXI_WDATA    (S_AXI_WDATA  ),
     .S_AXI_WSTRB    (S_AXI_WSTRB  ),
@@ -222,6 +231,7 @@ front_end
     .AXIS_PLEN_TREADY   (AXIS_PLEN_TREADY),
     
     .AXIS_ADDR_TDATA    (AXIS_ADDR_TDATA ),
+    .AXIS_ADDR_TUSER    (AXIS_ADDR_TUSER ),
     .AXIS_ADDR_TVALID   (AXIS_ADDR_TVALID),
     .AXIS_ADDR_TREADY   (AXIS_ADDR_TREADY),
     
@@ -262,6 +272,7 @@ back_end
     .AXIS_PLEN_TREADY   (AXIS_PLEN_TREADY),
     
     .AXIS_ADDR_TDATA    (AXIS_ADDR_TDATA ),
+    .AXIS_ADDR_TUSER    (AXIS_ADDR_TUSER ),
     .AXIS_ADDR_TVALID   (AXIS_ADDR_TVALID),
     .AXIS_ADDR_TREADY   (AXIS_ADDR_TREADY),
     
@@ -8,6 +8,10 @@
 // 25-Jul-23  DWW  1000  Initial creation
 //
 // 12-Jan-24  DWW  1001  Changed name to RDMX
+//
+// 18-Oct-26  DWW  1002  Data FIFO holds two of the largest (16K) packets
+//
+// 18-Oct-26  DWW  1003  AXIS_ADDR_TUSER is carried into the RDMX header as the stream ID
 //====================================================================================
 /*
 
@@ -24,7 +28,8 @@
     <>     An ordinary 42-byte ethernet/IP/UDP header                               <>
     <>     A  2-byte magic number (0x0122)
     <>     A  8-byte target address                                                 <>
-    <>     12 bytes of reserved data, always 0                                      <>
+    <>     A  1-byte stream ID (AXIS_ADDR_TUSER)                                    <>
+    <>     11 bytes of reserved data, always 0                                      <>
     <><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><>
 
     The incoming AXIS_DATA data should be byte packed; only the last beat (the beat with
@@ -82,8 +87,9 @@ module rdmx_xmit_be #
 
     // This should be at minimum MAX_PACKET_COUNT * # of data-cycles in the smallest
     // incoming packet.  This number must be large enough to accomodate the number of
-    // data cycles in the largest incoming packet.
-    parameter DATA_FIFO_DEPTH = 256
+    // data cycles in the largest incoming packet.  The default holds two 16K packets,
+    // so that one can be arriving while the other is being sent
+    parameter DATA_FIFO_DEPTH = 512
 
     //<><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><><>
     //>> DATA_FIFO_DEPTH / MAX_PACKET_COUNT = # of cycles in the smallest incoming data packet
@@ -112,6 +118,7 @@ module rdmx_xmit_be #
     //           Target address input stream, synchronous to src_clk
     //==========================================================================
     input  [ADDR_WBITS-1:0] AXIS_ADDR_TDATA,
+    input  [7:0]            AXIS_ADDR_TUSER,
     input                   AXIS_ADDR_TVALID,
     output                  AXIS_ADDR_TREADY,
     //==========================================================================
@@ -187,6 +194,8 @@ wire[15:0] payload_length = (fplout_tvalid & fplout_tready) ? fplout_tdata : fpl
 //============  This is the output of the target-address FIFO  =============
 reg [ADDR_WBITS-1:0] ftaout_tdata_latched;
 wire[ADDR_WBITS-1:0] ftaout_tdata;
+reg [7:0]            ftaout_tuser_latched;
+wire[7:0]            ftaout_tuser;
 wire                 ftaout_tvalid;
 reg                  ftaout_tready;
 //==========================================================================
@@ -227,8 +236,8 @@ localparam[15:0] udp_checksum   = 0;
 // 2 bytes of magic number
 localparam[15:0] rdmx_magic = 16'h0122;
 
-// 12 bytes of reserved area in the RDMX header
-localparam[12*8-1:0] rdmx_reserved   = 0;
+// 11 bytes of reserved area in the RDMX header
+localparam[11*8-1:0] rdmx_reserved   = 0;
 
 // Compute both the IPv4 packet length and UDP packet length
 wire[15:0]       ip4_length     = IP_HDR_LEN + UDP_HDR_LEN + RDMX_HDR_LEN + payload_length;
@@ -253,6 +262,10 @@ wire[15:0] ip4_checksum = ~(ip4_cs32[15:0] + ip4_cs32[31:16]);
 wire[ADDR_WBITS-1:0] rdmx_target_addr = (ftaout_tready & ftaout_tvalid) ?
                                         ftaout_tdata : ftaout_tdata_latched;
 
+// This is the stream this outgoing packet belongs to
+wire[7:0]            rdmx_stream      = (ftaout_tready & ftaout_tvalid) ?
+                                        ftaout_tuser : ftaout_tuser_latched;
+
 // This is the 64-byte packet header for an RDMX packet
 wire[DATA_WBITS-1:0] pkt_header =
 {
@@ -282,6 +295,7 @@ wire[DATA_WBITS-1:0] pkt_header =
     // RDMX header fields - 22 bytes
     rdmx_magic,
     rdmx_target_addr,
+    rdmx_stream,
     rdmx_reserved
 };
 
@@ -366,6 +380,7 @@ always @(posedge dst_clk) begin
                 // packet-length, or it could arrive earlier.
                 if (ftaout_tready & ftaout_tvalid) begin
                     ftaout_tdata_latched <= ftaout_tdata;
+                    ftaout_tuser_latched <= ftaout_tuser;
                     ftaout_tready        <= 0;                     
                 end
 
@@ -522,6 +537,7 @@ xpm_fifo_axis #
 (
    .FIFO_DEPTH      (MAX_PACKET_COUNT),   
    .TDATA_WIDTH     (ADDR_WBITS),        
+   .TUSER_WIDTH     (8),
    .FIFO_MEMORY_TYPE("auto"),       
    .PACKET_FIFO     ("false"),      
    .USE_ADV_FEATURES("0000"),        
@@ -537,11 +553,13 @@ rdmx_addr_fifo
 
     // The input of this FIFO comes from the AXIS_ADDR stream
    .s_axis_tdata (AXIS_ADDR_TDATA ),
+   .s_axis_tuser (AXIS_ADDR_TUSER ),
    .s_axis_tvalid(AXIS_ADDR_TVALID),
    .s_axis_tready(AXIS_ADDR_TREADY),
 
     // The output bus of the FIFO
    .m_axis_tdata (ftaout_tdata ),     
+   .m_axis_tuser (ftaout_tuser ),
    .m_axis_tvalid(ftaout_tvalid),       
    .m_axis_tready(ftaout_tready),     
 
@@ -549,7 +567,6 @@ rdmx_addr_fifo
    .s_axis_tdest(),
    .s_axis_tid  (),
    .s_axis_tstrb(),
-   .s_axis_tuser(),
    .s_axis_tkeep(),
    .s_axis_tlast(),
 
@@ -557,7 +574,6 @@ rdmx_addr_fifo
    .m_axis_tdest(),             
    .m_axis_tid  (),               
    .m_axis_tstrb(), 
-   .m_axis_tuser(),         
    .m_axis_tkeep(),           
    .m_axis_tlast(),         
 
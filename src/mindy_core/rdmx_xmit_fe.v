@@ -23,6 +23,7 @@ module rdmx_xmit_fe #
     input[3:0]                              S_AXI_AWCACHE,
     input[3:0]                              S_AXI_AWQOS,
     input[2:0]                              S_AXI_AWPROT,
+    input[7:0]                              S_AXI_AWUSER,
     output                                                  S_AXI_AWREADY,
 
     // "Write Data"                         -- Master --    -- Slave --
@@ -70,6 +71,7 @@ module rdmx_xmit_fe #
     //                  Target address output stream
     //==========================================================================
     output [ADDR_WBITS-1:0] AXIS_ADDR_TDATA,
+    output [7:0]            AXIS_ADDR_TUSER,
     output                  AXIS_ADDR_TVALID,
     input                   AXIS_ADDR_TREADY,
     //==========================================================================
@@ -124,6 +126,7 @@ end
 
 // Output stream "target address" is driven directly from the AW-channel
 assign AXIS_ADDR_TDATA  = S_AXI_AWADDR;
+assign AXIS_ADDR_TUSER  = S_AXI_AWUSER;
 assign AXIS_ADDR_TVALID = S_AXI_AWVALID;
 assign S_AXI_AWREADY    = AXIS_ADDR_TREADY;
 
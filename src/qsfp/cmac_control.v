@@ -5,8 +5,25 @@
 //   Date     Who   Ver  Changes
 //===================================================================================================
 // 29-Feb-23  DWW  1000  Initial creation
+// 18-Oct-26  DWW  1001  Added the CMAC statistics counters and their snapshot
 //===================================================================================================
 
+/*
+    The CMAC reports its statistics as per-cycle increments on its stat_tx and stat_rx
+    interfaces.  We accumulate them into 64-bit counters, each in its own clock domain.
+
+    To read them from another clock domain, toggle "snapshot_req_async".  Each domain copies
+    its counters into "snapshot" and then sets its ack equal to the request.  Once both acks
+    match the request, "snapshot" is stable and can be read from any clock domain.
+
+    "snapshot" holds nine 64-bit counters, counter N at [64*N +: 64]:
+        0 = TX packets          1 = TX bytes            2 = RX packets
+        3 = RX bytes            4 = RS-FEC corrected    5 = RS-FEC uncorrected
+        6 = RX bad FCS          7 = RX pause            8 = TX pause
+
+    The counters are cleared when the CMAC resets that side of the link.
+*/
+
 module cmac_control # (parameter RSFEC = 1)
 (
     (* X_INTERFACE_INFO = "xilinx.com:*:rs_fec_ports:2.0 rs_fec ctl_rx_rsfec_enable" *)
@@ -30,8 +47,31 @@ module cmac_control # (parameter RSFEC = 1)
     (* X_INTERFACE_INFO = "xilinx.com:*:ctrl_ports:2.0 ctl_rx ctl_enable" *)
     output ctl_rx_enable,
 
+    // The clocks of the CMAC's TX and RX user interfaces, and the CMAC's resets for them
+    input      tx_clk, tx_reset,
+    input      rx_clk, rx_reset,
+
     // This comes from the stat_rx interface of the CMAC
-    input      stat_rx_aligned
+    input      stat_rx_aligned,
+
+    // Statistics from the stat_tx interface of the CMAC, synchronous to tx_clk
+    input      stat_tx_total_packets,
+    input[5:0] stat_tx_total_bytes,
+    input      stat_tx_pause,
+
+    // Statistics from the stat_rx interface of the CMAC, synchronous to rx_clk
+    input[2:0] stat_rx_total_packets,
+    input[6:0] stat_rx_total_bytes,
+    input[2:0] stat_rx_bad_fcs,
+    input      stat_rx_pause,
+    input      stat_rx_rsfec_corrected_cw_inc,
+    input      stat_rx_rsfec_uncorrected_cw_inc,
+
+    // Toggle the request to take a snapshot.  Each ack matches the request once its side
+    // of the snapshot has been taken
+    input             snapshot_req_async,
+    output reg        snapshot_tx_ack, snapshot_rx_ack,
+    output[9*64-1:0]  snapshot
 );
 
 
@@ -55,4 +95,96 @@ assign ctl_tx_rsfec_enable            = RSFEC;
 //=============================================================================
 
 
-endmodule
\ No newline at end of file
+//=============================================================================
+// The snapshot of the counters
+//=============================================================================
+reg[63:0] snap_tx_packets, snap_tx_bytes, snap_tx_pause;
+reg[63:0] snap_rx_packets, snap_rx_bytes, snap_rx_pause, snap_rx_bad_fcs;
+reg[63:0] snap_fec_corrected, snap_fec_uncorrected;
+
+assign snapshot =
+{
+    snap_tx_pause,          // 8
+    snap_rx_pause,          // 7
+    snap_rx_bad_fcs,        // 6
+    snap_fec_uncorrected,   // 5
+    snap_fec_corrected,     // 4
+    snap_rx_bytes,          // 3
+    snap_rx_packets,        // 2
+    snap_tx_bytes,          // 1
+    snap_tx_packets         // 0
+};
+//=============================================================================
+
+
+//=============================================================================
+// The TX statistics counters, and their half of the snapshot
+//=============================================================================
+reg[63:0] tx_packets, tx_bytes, tx_pause;
+
+wire snapshot_req_tx;
+cdc_single u_cdc_tx(snapshot_req_async, tx_clk, snapshot_req_tx);
+//-----------------------------------------------------------------------------
+always @(posedge tx_clk) begin
+    if (tx_reset) begin
+        tx_packets      <= 0;
+        tx_bytes        <= 0;
+        tx_pause        <= 0;
+        snapshot_tx_ack <= snapshot_req_tx;
+    end else begin
+        tx_packets <= tx_packets + stat_tx_total_packets;
+        tx_bytes   <= tx_bytes   + stat_tx_total_bytes;
+        tx_pause   <= tx_pause   + stat_tx_pause;
+
+        if (snapshot_req_tx != snapshot_tx_ack) begin
+            snap_tx_packets <= tx_packets;
+            snap_tx_bytes   <= tx_bytes;
+            snap_tx_pause   <= tx_pause;
+            snapshot_tx_ack <= snapshot_req_tx;
+        end
+    end
+end
+//=============================================================================
+
+
+//=============================================================================
+// The RX statistics counters, and their half of the snapshot
+//=============================================================================
+reg[63:0] rx_packets, rx_bytes, rx_pause, rx_bad_fcs;
+reg[63:0] fec_corrected, fec_uncorrected;
+
+wire snapshot_req_rx;
+cdc_single u_cdc_rx(snapshot_req_async, rx_clk, snapshot_req_rx);
+//-----------------------------------------------------------------------------
+always @(posedge rx_clk) begin
+    if (rx_reset) begin
+        rx_packets      <= 0;
+        rx_bytes        <= 0;
+        rx_pause        <= 0;
+        rx_bad_fcs      <= 0;
+        fec_corrected   <= 0;
+        fec_uncorrected <= 0;
+        snapshot_rx_ack <= snapshot_req_rx;
+    end else begin
+        rx_packets      <= rx_packets      + stat_rx_total_packets;
+        rx_bytes        <= rx_bytes        + stat_rx_total_bytes;
+        rx_pause        <= rx_pause        + stat_rx_pause;
+        rx_bad_fcs      <= rx_bad_fcs      + stat_rx_bad_fcs;
+        fec_corrected   <= fec_corrected   + stat_rx_rsfec_corrected_cw_inc;
+        fec_uncorrected <= fec_uncorrected + stat_rx_rsfec_uncorrected_cw_inc;
+
+        if (snapshot_req_rx != snapshot_rx_ack) begin
+            snap_rx_packets      <= rx_packets;
+            snap_rx_bytes        <= rx_bytes;
+            snap_rx_pause        <= rx_pause;
+            snap_rx_bad_fcs      <= rx_bad_fcs;
+            snap_fec_corrected   <= fec_corrected;
+            snap_fec_uncorrected <= fec_uncorrected;
+            snapshot_rx_ack      <= snapshot_req_rx;
+        end
+    end
+end
+//=============================================================================
+
+
+endmodule